@@ -0,0 +1,84 @@
+//! A generator for synthetic Cabin programs, used as the input of the pipeline benchmark. The programs are built only from language features that every
+//! stage of the compiler supports, and are scaled in size along independent dimensions, so that a regression in how one kind of construct is handled shows
+//! up as a change in the benchmarks that scale it.
+
+use std::fmt::Write as _;
+
+/// The size of a synthetic Cabin program.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct CorpusSize {
+	/// The number of groups declared in the program. Each group is also instantiated once.
+	pub groups: usize,
+	/// The number of functions declared in the program. Each function is also called once at compile-time.
+	pub functions: usize,
+	/// How many levels deep the nested `if` expressions in the program's nested function go.
+	pub nesting_depth: usize,
+	/// The number of elements in each of the program's list literals.
+	pub list_length: usize,
+}
+
+impl CorpusSize {
+	/// Returns a program size where every dimension is scaled by the same factor.
+	///
+	/// # Parameters
+	/// - `scale` - The factor to scale the program by. A scale of `1` gives a program with one of each construct.
+	///
+	/// # Returns
+	/// The size of the program.
+	pub const fn scaled(scale: usize) -> Self {
+		Self {
+			groups: scale,
+			functions: scale,
+			nesting_depth: scale,
+			list_length: scale * 10,
+		}
+	}
+}
+
+/// Generates a synthetic Cabin program of the given size. The same size always generates the same program, so results for a given size can be compared
+/// between commits.
+///
+/// # Parameters
+/// - `size` - The size of the program to generate.
+///
+/// # Returns
+/// The source code of the program, without the prelude.
+pub fn generate(size: CorpusSize) -> String {
+	let mut program = String::new();
+
+	// Groups
+	for index in 0..size.groups {
+		writeln!(program, "let Group{index} = group {{\n\tamount: Number,\n\tlabel: Text\n}};\n").unwrap();
+		writeln!(
+			program,
+			"let group_instance_{index} = new Group{index} {{\n\tamount = {index},\n\tlabel = \"group {index}\"\n}};\n"
+		)
+		.unwrap();
+	}
+
+	// Functions; Each one is called with a different argument, so that the calls can't be answered by the compile-time call cache
+	for index in 0..size.functions {
+		writeln!(program, "let function_{index} = action(value: Text): Text {{\n\treturn value;\n}};\n").unwrap();
+		writeln!(program, "let function_result_{index} = function_{index}(\"argument {index}\");\n").unwrap();
+	}
+
+	// Deep nesting
+	program.push_str("let nested = action(flag: Boolean): Text {\n");
+	for depth in 1..=size.nesting_depth {
+		writeln!(program, "{}if flag {{", "\t".repeat(depth)).unwrap();
+	}
+	writeln!(program, "{}return \"deep\";", "\t".repeat(size.nesting_depth + 1)).unwrap();
+	for depth in (1..=size.nesting_depth).rev() {
+		writeln!(program, "{}}};", "\t".repeat(depth)).unwrap();
+	}
+	program.push_str("\treturn \"shallow\";\n};\n\nlet nested_result = nested(true);\n\n");
+
+	// Long lists
+	let numbers = (0..size.list_length).map(|index| index.to_string()).collect::<Vec<_>>().join(", ");
+	writeln!(program, "let numbers = [{numbers}];\n").unwrap();
+	let texts = (0..size.list_length).map(|index| format!("\"item {index}\"")).collect::<Vec<_>>().join(", ");
+	writeln!(program, "let texts = [{texts}];\n").unwrap();
+
+	program.push_str("run terminal.print(nested(true));\n");
+	program
+}
@@ -0,0 +1,114 @@
+//! A throughput benchmark for the Cabin lexer. This tokenizes a large input built from repeated copies of the prelude with both the current single-pass lexer
+//! and the original regex-driven one, checks that they produce identical tokens, and reports the throughput of each in megabytes per second.
+//!
+//! Run with `cargo bench --bench lexer`.
+
+// This benchmark only uses the compiler's lexer, so it doesn't use most of the package's dependencies.
+#![allow(unused_crate_dependencies)]
+
+use std::time::{Duration, Instant};
+
+use cabin_language::lexer::{self, Span, Token, TokenType};
+use strum::IntoEnumIterator as _;
+
+/// The number of copies of the prelude to concatenate into the benchmark input. The original lexer copies the remaining source code after every token, so it's
+/// quadratic in the length of the input; This is kept small enough that benchmarking it doesn't take too long.
+const PRELUDE_COPIES: usize = 16;
+
+/// The number of timed runs of each lexer. The reported throughput is based on the fastest run.
+const RUNS: usize = 10;
+
+/// The original implementation of `lexer::tokenize`, which runs each token type's regular expression against the start of the remaining code in turn, and
+/// then copies the rest of the code after each token. This is kept here as a baseline to compare the current lexer against. The original stored an owned
+/// copy of each token's text, which is accounted for here by allocating a copy of each token's text as well.
+///
+/// # Parameters
+/// - `code` - The Cabin source code to tokenize.
+///
+/// # Returns
+/// The tokens in the given code, or an `Err` if an unrecognized token was found.
+fn regex_tokenize(code: &mut String) -> anyhow::Result<Vec<Token>> {
+	*code = code.replace('\t', "    ");
+
+	let mut remaining = code.clone();
+	let mut tokens = Vec::new();
+	let mut line = 1;
+	let mut column = 1;
+	let mut position = 0;
+
+	while !remaining.is_empty() {
+		let Some((token_type, value)) = TokenType::iter().find_map(|token_type| token_type.get_match(&remaining).map(|value| (token_type, value))) else {
+			anyhow::bail!("{line}:{column}:error:Unrecognized token: {}", remaining.split('\n').next().unwrap());
+		};
+
+		let length = value.len();
+		let newline_count = value.chars().filter(|char| *char == '\n').count();
+
+		if token_type != TokenType::Whitespace && token_type != TokenType::LineComment {
+			std::hint::black_box(value);
+			tokens.push(Token {
+				token_type,
+				span: Span { start: position, end: position + length },
+				line,
+				column,
+			});
+		} else {
+			line += newline_count;
+		}
+
+		column = if newline_count > 0 { 1 } else { column + length };
+		position += length;
+		remaining = remaining.get(length..).unwrap().to_owned();
+	}
+
+	Ok(tokens)
+}
+
+/// Measures the throughput of a tokenizer on the given code, printing it to the terminal.
+///
+/// # Parameters
+/// - `name` - The name of the tokenizer to print.
+/// - `code` - The code to tokenize.
+/// - `tokenizer` - The tokenizer to benchmark.
+///
+/// # Returns
+/// The duration of the fastest run.
+fn measure(name: &str, code: &str, tokenizer: fn(&mut String) -> anyhow::Result<Vec<Token>>) -> Duration {
+	let fastest = (0..RUNS)
+		.map(|_| {
+			let mut input = code.to_owned();
+			let start = Instant::now();
+			let tokens = tokenizer(&mut input).unwrap();
+			let elapsed = start.elapsed();
+			std::hint::black_box(tokens);
+			elapsed
+		})
+		.min()
+		.unwrap();
+
+	println!("{name}: {fastest:?} ({:.2} MB/s)", code.len() as f64 / fastest.as_secs_f64() / 1_000_000.0);
+	fastest
+}
+
+fn main() {
+	let prelude = include_str!("../prelude.cbn");
+	let code = [prelude; PRELUDE_COPIES].join("\n");
+
+	// Make sure that the lexers agree before comparing them, including on text that hits the single-pass lexer's fallback to regular expressions.
+	assert_eq!(
+		lexer::tokenize(&mut code.clone()).unwrap(),
+		regex_tokenize(&mut code.clone()).unwrap(),
+		"The single-pass lexer and the regex lexer produced different tokens for the prelude"
+	);
+	let unicode = "let caf\u{e9} = 1;\nlet x\u{a0}< y;\nlet z = \"\u{1f332}\";";
+	assert_eq!(
+		lexer::tokenize(&mut unicode.to_owned()).unwrap(),
+		regex_tokenize(&mut unicode.to_owned()).unwrap(),
+		"The single-pass lexer and the regex lexer produced different tokens for non-ASCII code"
+	);
+
+	println!("Tokenizing {} bytes of Cabin code ({PRELUDE_COPIES} copies of the prelude)\n", code.len());
+	let single_pass = measure("single-pass lexer", &code, lexer::tokenize);
+	let regex = measure("regex lexer", &code, regex_tokenize);
+	println!("\nspeedup: {:.1}x", regex.as_secs_f64() / single_pass.as_secs_f64());
+}
@@ -0,0 +1,275 @@
+//! A benchmark of each stage of the Cabin compiler's pipeline. Synthetic programs of increasing size (see `corpus`) are tokenized, parsed, evaluated at
+//! compile-time, and transpiled to C, and each stage is timed on its own, with the stages before it run untimed to produce its input. The compiler binary is
+//! also run end-to-end with `cabin transpile`, and with `cabin build` when a C compiler is installed.
+//!
+//! Run with `cargo bench --bench pipeline`. To compare against another commit, run `cargo bench --bench pipeline -- --save-baseline <name>` on that commit
+//! first, and then `cargo bench --bench pipeline -- --baseline <name>` on this one. Baselines are stored in `target/cabin-bench`. The generated programs can
+//! be written to a directory with `--emit-corpus <directory>`, for profiling them with other tools.
+
+// This benchmark only uses the compiler through its library, so it doesn't use most of the package's dependencies.
+#![allow(unused_crate_dependencies)]
+
+mod corpus;
+
+use std::{
+	collections::HashMap,
+	fmt::Write as _,
+	path::{Path, PathBuf},
+	process::{Command, Stdio},
+	sync::Arc,
+	time::{Duration, Instant},
+};
+
+use cabin_language::{
+	compiler,
+	context::Context,
+	lexer::Token,
+	parser::{self, Program},
+	prelude,
+};
+use corpus::CorpusSize;
+
+/// The scales of the synthetic programs to benchmark (see `CorpusSize::scaled()`).
+const SCALES: &[usize] = &[1, 10, 100];
+
+/// The number of timed runs of each benchmark. The fastest and median runs are reported.
+const RUNS: usize = 10;
+
+/// The number of timed runs of each end-to-end benchmark, which are much slower than the others because they start the compiler and usually a C compiler.
+const END_TO_END_RUNS: usize = 3;
+
+/// The directory that baselines and the end-to-end benchmark's project are stored in.
+const BENCH_DIRECTORY: &str = concat!(env!("CARGO_MANIFEST_DIR"), "/target/cabin-bench");
+
+/// The name of the fake source file that the benchmarked programs are compiled as.
+const FILE_NAME: &str = "bench.cbn";
+
+/// The results of one benchmark.
+struct Measurement {
+	/// The duration of the fastest run.
+	fastest: Duration,
+	/// The duration of the median run.
+	median: Duration,
+}
+
+/// Times a benchmark, running its setup before each run without timing it.
+///
+/// # Parameters
+/// - `runs` - The number of timed runs.
+/// - `setup` - Creates the input of a run.
+/// - `run` - The code to time, which is given the input created by `setup`.
+///
+/// # Returns
+/// The fastest and median durations of the runs.
+fn measure<I, O>(runs: usize, mut setup: impl FnMut() -> I, mut run: impl FnMut(I) -> O) -> Measurement {
+	let mut durations = (0..runs)
+		.map(|_| {
+			let input = setup();
+			let start = Instant::now();
+			let output = run(std::hint::black_box(input));
+			let elapsed = start.elapsed();
+			std::hint::black_box(output);
+			elapsed
+		})
+		.collect::<Vec<_>>();
+	durations.sort();
+
+	Measurement {
+		fastest: durations.first().copied().unwrap(),
+		median: durations.get(durations.len() / 2).copied().unwrap(),
+	}
+}
+
+/// Tokenizes a program, as the compiler does before parsing it.
+///
+/// # Parameters
+/// - `source_code` - The program's source code, without the prelude.
+///
+/// # Returns
+/// A new context for the program, and the program's tokens.
+fn tokenized(source_code: &str) -> (Context, Vec<Token>) {
+	let mut context = Context::new(FILE_NAME.to_owned(), prelude::with_prelude(source_code));
+	let tokens = prelude::tokenize_with_prelude(Arc::make_mut(&mut context.source_code)).unwrap();
+	(context, tokens)
+}
+
+/// Tokenizes and parses a program, as the compiler does before evaluating it at compile-time.
+///
+/// # Parameters
+/// - `source_code` - The program's source code, without the prelude.
+///
+/// # Returns
+/// The context of the program, and its abstract syntax tree.
+fn parsed(source_code: &str) -> (Context, Program) {
+	let (mut context, tokens) = tokenized(source_code);
+	let ast = parser::parse(&tokens, &mut context).unwrap();
+	(context, ast)
+}
+
+/// Tokenizes, parses, and evaluates a program at compile-time, as the compiler does before transpiling it.
+///
+/// # Parameters
+/// - `source_code` - The program's source code, without the prelude.
+///
+/// # Returns
+/// The context of the program, and its abstract syntax tree after compile-time evaluation.
+fn evaluated(source_code: &str) -> (Context, Program) {
+	let (mut context, ast) = parsed(source_code);
+	let evaluated_ast = ast.compile_time_evaluate(&mut context, true).unwrap();
+	(context, evaluated_ast)
+}
+
+/// Runs the compiler binary on a program, and times it.
+///
+/// # Parameters
+/// - `command` - The compiler subcommand and arguments to run, such as `["build", "--no-cache"]`.
+/// - `source_code` - The program's source code, without the prelude.
+///
+/// # Returns
+/// The measurement, or an `Err` describing why the compiler failed.
+fn measure_end_to_end(command: &[&str], source_code: &str) -> Result<Measurement, String> {
+	let project = Path::new(BENCH_DIRECTORY).join("project");
+	std::fs::create_dir_all(project.join("src")).map_err(|error| error.to_string())?;
+	std::fs::write(project.join("cabin.toml"), "[information]\nname = \"bench\"\nversion = \"0.0.1\"\n").map_err(|error| error.to_string())?;
+	std::fs::write(project.join("src/main.cbn"), source_code).map_err(|error| error.to_string())?;
+
+	let run_compiler = || {
+		Command::new(env!("CARGO_BIN_EXE_cabin"))
+			.args(command)
+			.arg("--quiet")
+			.current_dir(&project)
+			.stdout(Stdio::null())
+			.stderr(Stdio::null())
+			.status()
+	};
+
+	// Run once first, so that failures aren't timed and reported as results
+	let status = run_compiler().map_err(|error| error.to_string())?;
+	if !status.success() {
+		return Err(format!("the compiler exited with {status}"));
+	}
+
+	Ok(measure(END_TO_END_RUNS, || (), |()| run_compiler()))
+}
+
+/// Returns the path of the file that the baseline with the given name is stored in.
+///
+/// # Parameters
+/// - `name` - The name of the baseline.
+///
+/// # Returns
+/// The path of the baseline file.
+fn baseline_path(name: &str) -> PathBuf {
+	Path::new(BENCH_DIRECTORY).join(format!("{name}.tsv"))
+}
+
+/// Reads a baseline saved with `--save-baseline`. Each line of a baseline file is the name of a benchmark followed by the median duration of its runs in
+/// nanoseconds, separated by a tab.
+///
+/// # Parameters
+/// - `name` - The name of the baseline.
+///
+/// # Returns
+/// The median durations of the benchmarks in the baseline, keyed by benchmark name.
+fn read_baseline(name: &str) -> HashMap<String, Duration> {
+	let path = baseline_path(name);
+	let contents = std::fs::read_to_string(&path).unwrap_or_else(|error| panic!("Unable to read baseline {}: {error}", path.display()));
+	contents
+		.lines()
+		.filter_map(|line| {
+			let (benchmark, nanoseconds) = line.split_once('\t')?;
+			Some((benchmark.to_owned(), Duration::from_nanos(nanoseconds.parse().ok()?)))
+		})
+		.collect()
+}
+
+/// Returns the value of a command-line option, such as the name given after `--baseline`.
+///
+/// # Parameters
+/// - `arguments` - The command-line arguments. These include arguments passed by Cargo, such as `--bench`, which are ignored.
+/// - `option` - The option to find the value of.
+///
+/// # Returns
+/// The value of the option, or `None` if it wasn't given.
+fn option_value<'arguments>(arguments: &'arguments [String], option: &str) -> Option<&'arguments str> {
+	arguments
+		.iter()
+		.position(|argument| argument == option)
+		.and_then(|index| arguments.get(index + 1))
+		.map(String::as_str)
+}
+
+fn main() {
+	let arguments = std::env::args().collect::<Vec<_>>();
+	let baseline = option_value(&arguments, "--baseline").map(read_baseline);
+	let save_baseline = option_value(&arguments, "--save-baseline");
+
+	let programs = SCALES.iter().map(|scale| (*scale, corpus::generate(CorpusSize::scaled(*scale)))).collect::<Vec<_>>();
+
+	if let Some(directory) = option_value(&arguments, "--emit-corpus") {
+		std::fs::create_dir_all(directory).unwrap();
+		for (scale, program) in &programs {
+			std::fs::write(Path::new(directory).join(format!("scale-{scale}.cbn")), program).unwrap();
+		}
+		println!("Wrote {} programs to {directory}", programs.len());
+		return;
+	}
+
+	let mut results = Vec::new();
+	let mut report = |name: String, measurement: Measurement| {
+		let comparison = baseline.as_ref().and_then(|baseline| baseline.get(&name)).map_or_else(String::new, |previous| {
+			format!("  {:+.1}% vs. baseline", (measurement.median.as_secs_f64() / previous.as_secs_f64() - 1.0) * 100.0)
+		});
+		println!("{name:<28} fastest {:>12?}   median {:>12?}{comparison}", measurement.fastest, measurement.median);
+		results.push((name, measurement.median));
+	};
+
+	for (scale, program) in &programs {
+		println!("\nScale {scale} ({} bytes of Cabin code, {:?})", program.len(), CorpusSize::scaled(*scale));
+
+		report(
+			format!("tokenize/{scale}"),
+			measure(
+				RUNS,
+				|| prelude::with_prelude(program),
+				|mut source_code| prelude::tokenize_with_prelude(&mut source_code).unwrap(),
+			),
+		);
+		report(
+			format!("parse/{scale}"),
+			measure(RUNS, || tokenized(program), |(mut context, tokens)| parser::parse(&tokens, &mut context).unwrap()),
+		);
+		report(
+			format!("compile_time_evaluate/{scale}"),
+			measure(RUNS, || parsed(program), |(mut context, ast)| ast.compile_time_evaluate(&mut context, true).unwrap()),
+		);
+		report(
+			format!("transpile/{scale}"),
+			measure(RUNS, || evaluated(program), |(mut context, ast)| compiler::transpile(&ast, &mut context).unwrap()),
+		);
+
+		report(
+			format!("cabin transpile/{scale}"),
+			measure_end_to_end(&["transpile"], program).unwrap_or_else(|error| panic!("Error running cabin transpile: {error}")),
+		);
+		let build_name = format!("cabin build/{scale}");
+		if compiler::get_c_compiler().is_some() {
+			report(
+				build_name,
+				measure_end_to_end(&["build", "--no-cache"], program).unwrap_or_else(|error| panic!("Error running cabin build: {error}")),
+			);
+		} else {
+			println!("{build_name:<28} skipped: no C compiler is installed");
+		}
+	}
+
+	if let Some(name) = save_baseline {
+		let mut contents = String::new();
+		for (benchmark, median) in &results {
+			writeln!(contents, "{benchmark}\t{}", median.as_nanos()).unwrap();
+		}
+		std::fs::create_dir_all(BENCH_DIRECTORY).unwrap();
+		std::fs::write(baseline_path(name), contents).unwrap();
+		println!("\nSaved baseline \"{name}\" to {}", baseline_path(name).display());
+	}
+}
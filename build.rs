@@ -0,0 +1,40 @@
+//! The build script for the Cabin compiler. This tokenizes the prelude (see `/prelude.cbn`) once when the compiler is built, and writes the tokens out as a
+//! Rust table that the compiler includes directly (see `src/prelude.rs`). This way, each run of the compiler only has to tokenize the user's code, and
+//! errors in the prelude's tokens are caught when the compiler is built instead of on every run.
+
+// The lexer module is included directly from the compiler's source, so this build script only uses a few of the package's dependencies and a few of the
+// lexer's public items.
+#![allow(unused_crate_dependencies, dead_code)]
+
+/// The compiler's lexer, which is used to tokenize the prelude.
+#[path = "src/lexer.rs"]
+mod lexer;
+
+use std::{fmt::Write as _, path::Path};
+
+fn main() -> anyhow::Result<()> {
+	println!("cargo:rerun-if-changed=prelude.cbn");
+	println!("cargo:rerun-if-changed=src/lexer.rs");
+
+	let out_dir = std::env::var("OUT_DIR")?;
+	let mut prelude = std::fs::read_to_string("prelude.cbn").map_err(|error| anyhow::anyhow!("Error reading the prelude: {error}"))?;
+	let tokens = lexer::tokenize(&mut prelude).map_err(|error| anyhow::anyhow!("{error}\n\twhile tokenizing the prelude"))?;
+
+	// The tokens' spans refer to the prelude after its tabs have been replaced, so that's the version of the prelude that the compiler includes
+	std::fs::write(Path::new(&out_dir).join("prelude.cbn"), &prelude)?;
+
+	// The `Debug` representation of a token type is the name of its variant, which is exactly what's needed to refer to it in Rust code
+	let mut table = String::from("&[\n");
+	#[allow(clippy::use_debug)]
+	for token in &tokens {
+		writeln!(
+			table,
+			"\tToken {{ token_type: TokenType::{:?}, span: Span {{ start: {}, end: {} }}, line: {}, column: {} }},",
+			token.token_type, token.span.start, token.span.end, token.line, token.column
+		)?;
+	}
+	table.push(']');
+	std::fs::write(Path::new(&out_dir).join("prelude_tokens.rs"), table)?;
+
+	Ok(())
+}
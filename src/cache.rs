@@ -0,0 +1,203 @@
+use crate::{
+	compile_time::builtin::has_compile_time_system_effects,
+	compiler::{get_c_compiler, get_native_executable_extension, C_COMPILER_FLAGS},
+	profile::BuildProfile,
+};
+
+use std::{
+	hash::{Hash as _, Hasher},
+	path::{Path, PathBuf},
+	time::SystemTime,
+};
+
+/// The directory that cached builds are stored in, relative to the root of the project. Each cached build is stored in its own subdirectory, named by the
+/// key of the build (see `BuildCache::new()`).
+pub const CACHE_DIRECTORY: &str = "./builds/cache";
+
+/// The name, without an extension, of the files that a cached build is stored in. A cached build is stored as a C file called `main.c` and a native executable
+/// called `main` (`main.exe` on Windows).
+const CACHED_FILE_NAME: &str = "main";
+
+/// The name of the file that the warnings of a cached build are stored in, so that they can be shown again when the cached build is used.
+const WARNINGS_FILE_NAME: &str = "warnings";
+
+/// A 64-bit FNV-1a hasher. Keys of caches that are stored on disk are hashed with this rather than with `DefaultHasher`, whose algorithm can change
+/// between releases of Rust, so that the same inputs always give the same key no matter which toolchain the compiler was built with.
+pub struct StableHasher {
+	/// The hash of the bytes written so far.
+	state: u64,
+}
+
+impl StableHasher {
+	/// Creates a new hasher that hasn't hashed anything yet.
+	///
+	/// # Returns
+	/// The new hasher.
+	#[must_use]
+	pub const fn new() -> Self {
+		Self { state: 0xcbf2_9ce4_8422_2325 }
+	}
+}
+
+impl Default for StableHasher {
+	fn default() -> Self {
+		Self::new()
+	}
+}
+
+impl Hasher for StableHasher {
+	fn finish(&self) -> u64 {
+		self.state
+	}
+
+	fn write(&mut self, bytes: &[u8]) {
+		for byte in bytes {
+			self.state ^= u64::from(*byte);
+			self.state = self.state.wrapping_mul(0x0100_0000_01b3);
+		}
+	}
+}
+
+/// Hashes what identifies the running compiler, so that anything cached by one build of the compiler isn't used by another. The compiler's version alone
+/// doesn't change between builds of the compiler, so the compiler's executable is identified by its size and modification time as well. Rebuilding or
+/// reinstalling the compiler invalidates everything keyed on this.
+///
+/// # Parameters
+/// - `hasher` - The hasher to hash the compiler's identity into.
+pub fn hash_compiler_identity(hasher: &mut impl Hasher) {
+	env!("CARGO_PKG_VERSION").hash(hasher);
+	let compiler_metadata = std::env::current_exe().and_then(std::fs::metadata).ok();
+	compiler_metadata.as_ref().map(std::fs::Metadata::len).hash(hasher);
+	compiler_metadata
+		.and_then(|metadata| metadata.modified().ok())
+		.and_then(|modified| modified.duration_since(SystemTime::UNIX_EPOCH).ok())
+		.hash(hasher);
+}
+
+/// A content-addressed build cache entry for a Cabin program. The entry is keyed by a hash of everything that affects the compiled program: the source code
+/// (including the prelude), the compiler itself, and the C compiler and build profile used to compile the generated C code. If a program is built again with
+/// none of those changed, the cached executable can be used instead of compiling the program again.
+///
+/// Using a cached build skips compile-time evaluation, so builds whose compile-time code interacted with the system, such as by printing or reading a
+/// file, are never stored (see `is_cacheable()`): Their output would be lost, and what they read isn't part of the key. The warnings of a build are stored
+/// with it, and shown again whenever it's used.
+///
+/// Files are written into the cache under names that are unique to the current process, and then renamed into place once they're complete, so multiple
+/// instances of the compiler building the same program at once never see each other's partially written files.
+pub struct BuildCache {
+	/// The directory that this cache entry is stored in.
+	directory: PathBuf,
+}
+
+impl BuildCache {
+	/// Creates the cache entry for the given source code. This doesn't check if the entry exists or create it; Use `cached_executable()` to check for a
+	/// cached build, and `unfinished_c_file()` and `store()` to add one.
+	///
+	/// # Parameters
+	/// - `source_code` - The source code of the program being built, including the prelude.
+	/// - `profile` - The build profile that the program is being built with.
+	///
+	/// # Returns
+	/// The cache entry for the given source code.
+	#[must_use]
+	pub fn new(source_code: &str, profile: &BuildProfile) -> Self {
+		let mut hasher = StableHasher::new();
+		source_code.hash(&mut hasher);
+		hash_compiler_identity(&mut hasher);
+
+		get_c_compiler().hash(&mut hasher);
+		C_COMPILER_FLAGS.hash(&mut hasher);
+		profile.hash(&mut hasher);
+
+		Self {
+			directory: Path::new(CACHE_DIRECTORY).join(format!("{:016x}", hasher.finish())),
+		}
+	}
+
+	/// Returns the path of the C file in this cache entry.
+	#[must_use]
+	pub fn c_file(&self) -> PathBuf {
+		self.directory.join(format!("{CACHED_FILE_NAME}.c"))
+	}
+
+	/// Returns the path of the native executable in this cache entry.
+	#[must_use]
+	pub fn executable(&self) -> PathBuf {
+		self.directory.join(format!("{CACHED_FILE_NAME}{}", get_native_executable_extension()))
+	}
+
+	/// Returns the path of the cached native executable, if this program has already been built and cached.
+	///
+	/// # Returns
+	/// The path of the cached executable, or `None` if there's no cached build of this program.
+	#[must_use]
+	pub fn cached_executable(&self) -> Option<String> {
+		let executable = self.executable();
+		(executable.is_file() && self.c_file().is_file()).then(|| executable.display().to_string())
+	}
+
+	/// Returns the path, without an extension, that this process should write a file to before it's moved into place by `store()`.
+	#[must_use]
+	pub fn unfinished_output_path(&self) -> String {
+		self.directory.join(format!("{CACHED_FILE_NAME}-{}", std::process::id())).display().to_string()
+	}
+
+	/// Returns the path that the generated C code for this program should be written to, creating the cache entry if it doesn't exist. The C code isn't
+	/// moved into place until `store()` is called with the compiled executable.
+	///
+	/// # Returns
+	/// The path to write the C file to, which should then be compiled into `unfinished_output_path()`.
+	///
+	/// # Errors
+	/// If the cache directory couldn't be created.
+	pub fn unfinished_c_file(&self) -> anyhow::Result<String> {
+		std::fs::create_dir_all(&self.directory).map_err(|error| anyhow::anyhow!("Error creating build cache directory: {error}"))?;
+		Ok(self.unfinished_output_path() + ".c")
+	}
+
+	/// Returns whether the build that was just made can be stored in the cache, which is the case unless its compile-time code interacted with the
+	/// system (see `BuildCache`).
+	///
+	/// # Returns
+	/// Whether the build can be stored.
+	#[must_use]
+	pub fn is_cacheable() -> bool {
+		!has_compile_time_system_effects()
+	}
+
+	/// Returns the warnings that the compiler emitted when this cached build was made, which are shown again when the cached build is used.
+	///
+	/// # Returns
+	/// The warnings of this build, which is empty if it had none.
+	#[must_use]
+	pub fn cached_warnings(&self) -> Vec<String> {
+		std::fs::read_to_string(self.directory.join(WARNINGS_FILE_NAME))
+			.unwrap_or_default()
+			.split('\0')
+			.filter(|warning| !warning.is_empty())
+			.map(str::to_owned)
+			.collect()
+	}
+
+	/// Moves a finished build into this cache entry, replacing any existing build. The warnings are written first, because the build is only used once
+	/// its executable is in place (see `cached_executable()`).
+	///
+	/// # Parameters
+	/// - `c_file` - The path of the C file returned by `unfinished_c_file()`.
+	/// - `executable` - The path of the native executable that the C file was compiled to.
+	/// - `warnings` - The warnings that the compiler emitted while making the build.
+	///
+	/// # Returns
+	/// The path of the cached executable.
+	///
+	/// # Errors
+	/// If any of the files couldn't be written or moved into place.
+	pub fn store(&self, c_file: &str, executable: &str, warnings: &[String]) -> anyhow::Result<String> {
+		let warnings_file = format!("{}.{WARNINGS_FILE_NAME}", self.unfinished_output_path());
+		std::fs::write(&warnings_file, warnings.join("\0")).map_err(|error| anyhow::anyhow!("Error storing warnings in the build cache: {error}"))?;
+		std::fs::rename(&warnings_file, self.directory.join(WARNINGS_FILE_NAME)).map_err(|error| anyhow::anyhow!("Error storing warnings in the build cache: {error}"))?;
+		std::fs::rename(c_file, self.c_file()).map_err(|error| anyhow::anyhow!("Error storing C code in the build cache: {error}"))?;
+		std::fs::rename(executable, self.executable()).map_err(|error| anyhow::anyhow!("Error storing executable in the build cache: {error}"))?;
+		Ok(self.executable().display().to_string())
+	}
+}
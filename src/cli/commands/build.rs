@@ -1,21 +1,28 @@
 use crate::{
-	cli::commands::CabinCommand,
-	compiler::{compile_c_to, transpile, write_c},
+	cache::BuildCache,
+	cli::commands::{log_cached_build, log_call_cache, log_removed_c_items, log_translation_units, log_uncached_build, print_warnings, CabinCommand},
+	compile_time::{
+		builtin::IS_FIRST_PRINT,
+		profiler::{CompileTimeBudget, CompileTimeProfiler},
+	},
+	compiler::{compile_c_to, compile_c_with_pgo, get_native_executable_extension, temp_c_file, transpile_to_file},
 	context::Context,
-	lexer::tokenize,
 	log,
+	modules::{main_file, read_program, tokenize_modules},
 	parser::parse,
-	step, PRELUDE,
+	profile::BuildProfile,
+	step, timings,
+	units::TranslationUnits,
 };
 
-use std::path::Path;
+use std::{path::Path, sync::atomic::Ordering};
 
 use colored::Colorize as _;
 
 /// Compiles a Cabin project or file and outputs the build as a native executable. If an argument is passed,
 /// it will be interpreted as a file path of the file to build, and this will be built as a single script file.
 /// If no file is passed, the command is assumed to be running in a Cabin project with a standard file structure,
-/// and it attempts to run the file at `./src/main.cbn`
+/// and it attempts to run the project's main file, which is `./src/main.cbn` unless the `main` field of `cabin.toml` names another
 ///
 /// By default, if you run a file named `file.cbn`, The output will be called `file` on Unix systems and `file.exe`
 /// on Windows. If the command was run on a specific single-file, The compiled binary will be placed in the same directory
@@ -24,7 +31,7 @@ use colored::Colorize as _;
 #[derive(clap::Parser)]
 pub struct BuildCommand {
 	/// The name of the Cabin file to compile into a native binary. This is optional. If given, it will be used as a
-	/// single-file standalone script. If not provided, the file at `./src/main.cbn` will be used. If this file does
+	/// single-file standalone script. If not provided, the project's main file (`./src/main.cbn` by default) will be used. If this file does
 	/// not exist and none was provided, and error is returned and compilation is aborted.
 	filename: Option<String>,
 
@@ -46,11 +53,66 @@ pub struct BuildCommand {
 	/// code will be outputted to this file. The program will still be built to a native executable; This does not cancel compilation.
 	#[arg(long, short = 'c')]
 	emit_c: Option<String>,
+
+	/// Don't use the build cache. By default, the generated C code and native executable of the program are cached in `./builds/cache`, and if the program
+	/// hasn't changed since it was last built, the cached executable is copied to the output path instead of compiling the program again. With this flag,
+	/// the program is always compiled from scratch, and the build isn't cached.
+	#[arg(long)]
+	no_cache: bool,
+
+	/// Build with the `release` profile instead of the `debug` profile. The release profile is fully optimized by default, and can be configured in the
+	/// `[profile.release]` table of `cabin.toml`.
+	#[arg(long, conflicts_with = "profile")]
+	release: bool,
+
+	/// The name of the build profile to build with, which is configured in the `[profile.<name>]` table of `cabin.toml`. This is `debug` by default, or
+	/// `release` when `--release` is passed.
+	#[arg(long)]
+	profile: Option<String>,
+
+	/// Build with profile-guided optimization, using the given shell command as the training workload. The program is first built with instrumentation,
+	/// the given command is run to record how the program behaves, and then the program is rebuilt using that recording to guide optimizations. The path
+	/// of the instrumented executable is available to the command in the `CABIN_PGO_EXECUTABLE` environment variable, for example:
+	/// `cabin build --release --pgo '$CABIN_PGO_EXECUTABLE < input.txt'`. Builds with this flag aren't cached.
+	#[arg(long)]
+	pgo: Option<String>,
+
+	/// Record how long each phase of the compiler takes and the peak memory it uses, including the time spent in the C compiler, and print a table of
+	/// the results when compilation finishes.
+	#[arg(long)]
+	timings: bool,
+
+	/// Record the timings of each phase of the compiler like `--timings`, and write them to the given file in the Chrome trace event format, which can be
+	/// opened with `chrome://tracing` or Perfetto. The summary table is only printed if `--timings` is also passed.
+	#[arg(long)]
+	timings_file: Option<String>,
+
+	/// Profile the compile-time evaluation of the program, and write every call stack it was in to the given file in the folded stack format, weighted by
+	/// the number of steps taken in it, which can be turned into a flamegraph by tools like `inferno-flamegraph` or speedscope. A table of the functions
+	/// and source locations that took the most steps is also printed. A cached build isn't evaluated at compile-time, so nothing is profiled unless the
+	/// program has changed since it was last built or `--no-cache` is passed.
+	#[arg(long)]
+	profile_compile_time: Option<String>,
+
+	/// The maximum number of threads to use for work that the compiler does in parallel, such as transpiling the program's functions into C. This is the
+	/// number of CPUs available by default. The output of the compiler is the same regardless of how many threads it uses.
+	#[arg(long, short)]
+	jobs: Option<usize>,
+
+	/// Split the generated C code into multiple translation units that share a header, compile them in parallel with up to `--jobs` C compilers, and link
+	/// them together. Compiled units are cached in `./builds/cache/objects` unless `--no-cache` is passed, so after a small change to the program only
+	/// the units containing changed functions are compiled again.
+	#[arg(long, conflicts_with = "pgo")]
+	units: bool,
 }
 
 impl CabinCommand for BuildCommand {
 	fn execute(&self) -> anyhow::Result<()> {
-		let file_name = std::fs::canonicalize(self.filename.clone().unwrap_or_else(|| "./src/main.cbn".to_owned()))
+		if self.timings || self.timings_file.is_some() {
+			timings::enable();
+		}
+
+		let file_name = std::fs::canonicalize(self.filename.clone().unwrap_or_else(main_file))
 			.map_err(|error| anyhow::anyhow!("Error canonicalizing source file path: {error}"))?;
 		let file_name_path = file_name.to_str().unwrap();
 		let file_path = Path::new(&file_name_path);
@@ -65,6 +127,8 @@ impl CabinCommand for BuildCommand {
 		let config_string = std::fs::read_to_string("./cabin.toml")
 			.map_err(|error| anyhow::anyhow!("Error getting configuration file: {error}. If you were trying to set this option globally, use the --global flag."))?;
 		let mut config: toml_edit::DocumentMut = config_string.parse()?;
+		let profile = BuildProfile::from_config(&config, self.profile.as_deref().unwrap_or(if self.release { "release" } else { "debug" }))?;
+		let budget = CompileTimeBudget::from_config(&config)?;
 
 		let Some(toml_edit::Item::Table(information_config)) = config.get_mut("information") else {
 			anyhow::bail!("Error reading configuration file: Could not find \"information\" table.");
@@ -96,41 +160,121 @@ impl CabinCommand for BuildCommand {
 
 		// Input file
 		log!(self.quiet, "{}", format!("\t{} source code... ", "Reading".green()).bold())?;
-		let source_code = PRELUDE.to_owned() + "\n\n" + &step!(std::fs::read_to_string(&file_name_string), "Input reading error", self.quiet);
-		let mut context = Context::new(file_name_string);
-
-		// Tokenization
-		log!(self.quiet, "{}", format!("\t{} source code... ", "Tokenizing".green()).bold())?;
-		let tokens = step!(tokenize(source_code), "Tokenization Error", self.quiet, context, true);
-
-		// Parsing
-		log!(self.quiet, "{}", format!("\t{} token stream... ", "Parsing".green()).bold())?;
-		let ast = step!(parse(&mut tokens.into_iter().collect(), &mut context), "Parsing Error", self.quiet, context, true);
-
-		// Compile-time evaluation
-		log!(self.quiet, "{}", format!("\t{} compile-time code... ", "Running".green()).bold())?;
-		let compile_time_ast = step!(ast.compile_time_evaluate(&mut context, true), "Compile-Time Evaluation Error", self.quiet, context, false);
-
-		// Transpilation
-		log!(self.quiet, "{}", format!("\t{} to C... ", "Transpiling".green()).bold())?;
-		let c_code = step!(transpile(&compile_time_ast, &mut context), "Transpilation Error", self.quiet, context, true);
-		let c_file = write_c(&c_code)?;
-		if let Some(emit_c_file) = &self.emit_c {
-			std::fs::write(emit_c_file, &c_code)?;
+		let (source_code, modules) = step!(timings::phase("Reading", || read_program(&file_name_string)), "Input reading error", self.quiet);
+		let mut context = Context::new(file_name_string, source_code);
+		context.modules = modules.into();
+		context.compile_time_profile = CompileTimeProfiler::new(budget, self.profile_compile_time.is_some());
+		if let Some(jobs) = self.jobs {
+			context.jobs = jobs.max(1);
 		}
 
-		// Compilation
-		log!(self.quiet, "{}", format!("\t{} generated C code... ", "Compiling".green()).bold())?;
+		// Output file
 		let output_file = self.output.clone().unwrap_or(if self.filename.is_some() {
 			format!("{file_directory}/{file_basename}", file_directory = file_directory.display())
 		} else {
 			std::fs::create_dir_all("./builds/native")?;
 			format!("./builds/native/{project_name}-v{project_version}")
 		});
-		let output_file_with_extension = compile_c_to(&c_file, &output_file, &mut context)?;
-		std::fs::remove_file(c_file)?;
+
+		// Cached build
+		let mut compiled_units = None;
+		let build_cache = (!self.no_cache && self.pgo.is_none()).then(|| BuildCache::new(&context.source_code, &profile));
+		let output_file_with_extension = if let Some(cached_executable) = build_cache.as_ref().and_then(BuildCache::cached_executable) {
+			log!(self.quiet, "{}", format!("\t{} cached build... ", "Using".green()).bold())?;
+			if let (Some(cache), Some(emit_c_file)) = (&build_cache, &self.emit_c) {
+				std::fs::copy(cache.c_file(), emit_c_file)?;
+			}
+			let output_file_with_extension = output_file + get_native_executable_extension();
+			std::fs::copy(cached_executable, &output_file_with_extension)?;
+			if let Some(cache) = &build_cache {
+				log_cached_build(cache, self.quiet)?;
+			}
+			output_file_with_extension
+		} else {
+			// Tokenization
+			log!(self.quiet, "{}", format!("\t{} source code... ", "Tokenizing".green()).bold())?;
+			let tokens = step!(timings::phase("Tokenizing", || tokenize_modules(&context)), "Tokenization Error", self.quiet, context, true);
+
+			// Parsing
+			log!(self.quiet, "{}", format!("\t{} token stream... ", "Parsing".green()).bold())?;
+			let ast = step!(timings::phase("Parsing", || parse(&tokens, &mut context)), "Parsing Error", self.quiet, context, true);
+
+			// Compile-time evaluation
+			log!(self.quiet, "{}", format!("\t{} compile-time code... ", "Running".green()).bold())?;
+			let evaluated = timings::phase("Compile-time evaluation", || ast.compile_time_evaluate(&mut context, true));
+			if let Some(profile_file) = &self.profile_compile_time {
+				context.compile_time_profile.report(profile_file)?;
+			}
+			let compile_time_ast = step!(evaluated, "Compile-Time Evaluation Error", self.quiet, context, false);
+			if IS_FIRST_PRINT.load(Ordering::Relaxed) {
+				log!(self.quiet, "{}", "Done!\n".green().bold())?;
+			}
+			log_call_cache(&context, self.timings, self.quiet)?;
+
+			// Transpilation
+			log!(self.quiet, "{}", format!("\t{} to C... ", "Transpiling".green()).bold())?;
+			let c_file = build_cache.as_ref().map_or_else(|| Ok(temp_c_file()), BuildCache::unfinished_c_file)?;
+			let translation_units = if self.units {
+				let units = step!(
+					timings::phase("Transpiling", || TranslationUnits::transpile(&compile_time_ast, &mut context)),
+					"Transpilation Error",
+					self.quiet,
+					context,
+					true
+				);
+				std::fs::write(&c_file, units.combined()).map_err(|error| anyhow::anyhow!("Error writing transpiled C code to file: {error}"))?;
+				Some(units)
+			} else {
+				step!(
+					timings::phase("Transpiling", || transpile_to_file(&compile_time_ast, &mut context, &c_file)),
+					"Transpilation Error",
+					self.quiet,
+					context,
+					true
+				);
+				None
+			};
+			if let Some(emit_c_file) = &self.emit_c {
+				std::fs::copy(&c_file, emit_c_file)?;
+				log_removed_c_items(&context, self.quiet)?;
+			}
+
+			// Compilation
+			log!(self.quiet, "{}", format!("\t{} generated C code... ", "Compiling".green()).bold())?;
+			let mut compile = |output_path: &str, compile_context: &mut Context| -> anyhow::Result<String> {
+				let Some(units) = &translation_units else {
+					return compile_c_to(&c_file, output_path, &profile, compile_context);
+				};
+				let (executable, compiled) = units.compile_to(output_path, &profile, build_cache.is_some(), compile_context)?;
+				compiled_units = Some((compiled, units.unit_count()));
+				Ok(executable)
+			};
+			if let Some(training_command) = &self.pgo {
+				let output_file_with_extension = timings::phase("Compiling", || compile_c_with_pgo(&c_file, &output_file, &profile, training_command, &mut context))?;
+				std::fs::remove_file(c_file)?;
+				output_file_with_extension
+			} else if let Some(cache) = build_cache.as_ref().filter(|_cache| BuildCache::is_cacheable()) {
+				let executable = timings::phase("Compiling", || compile(&cache.unfinished_output_path(), &mut context))?;
+				let cached_executable = cache.store(&c_file, &executable, &context.warnings)?;
+				let output_file_with_extension = output_file + get_native_executable_extension();
+				std::fs::copy(cached_executable, &output_file_with_extension)?;
+				output_file_with_extension
+			} else {
+				if build_cache.is_some() {
+					log_uncached_build(self.quiet)?;
+				}
+				let output_file_with_extension = timings::phase("Compiling", || compile(&output_file, &mut context))?;
+				std::fs::remove_file(c_file)?;
+				output_file_with_extension
+			}
+		};
 		println!("{}", "Done!".bold().green());
+		print_warnings(&context.warnings);
+		if let Some((compiled, total)) = compiled_units {
+			log_translation_units(compiled, total, self.quiet)?;
+		}
 
+		timings::report(self.timings, self.timings_file.as_deref())?;
 		println!("{} Build ready at {}", "Done!".green().bold(), output_file_with_extension.cyan().bold());
 
 		Ok(())
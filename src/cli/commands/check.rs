@@ -0,0 +1,143 @@
+use crate::{
+	cli::{
+		commands::CabinCommand,
+		server,
+		watch::{watch, watched_paths},
+	},
+	compile_time::profiler::{CompileTimeBudget, CompileTimeProfiler},
+	context::Context,
+	log,
+	modules::{main_file, read_program, tokenize_modules, Module},
+	parser::parse,
+};
+
+use std::{fmt::Write as _, time::Instant};
+
+use colored::Colorize as _;
+
+/// Checks a Cabin project or file for errors without building it. The program is tokenized, parsed, and evaluated at compile-time, but isn't transpiled to C
+/// or compiled. If a check server is running for the project (see `--serve`), the check is done by the server instead of by a new compiler process.
+#[derive(clap::Parser)]
+pub struct CheckCommand {
+	/// The name of the file to check, or left out to check an entire project.
+	file_name: Option<String>,
+
+	/// Run the program in "quiet mode". This prevents the Cabin compiler from outputting debug messages such as
+	/// "Checking" etc. The only output shown from the Cabin compiler will be errors/warnings/info
+	/// generated from your program itself, not static compiler progress messages.
+	#[arg(long, short)]
+	quiet: bool,
+
+	/// Keep running, and check the program again each time one of its source files or its configuration changes.
+	#[arg(long, short, conflicts_with = "serve")]
+	watch: bool,
+
+	/// Start a check server for the project in the current directory, which keeps running and answers the checks of later `cabin check` commands, so
+	/// that they don't need to start the compiler from scratch. The server listens on a local socket in `./builds/cache`. This is only supported on Unix
+	/// platforms.
+	#[arg(long)]
+	serve: bool,
+}
+
+impl CabinCommand for CheckCommand {
+	fn execute(&self) -> anyhow::Result<()> {
+		if self.serve {
+			log!(self.quiet, "{}", format!("{} on {}...\n", "Serving checks".green(), server::socket_path().display()).bold())?;
+			return server::serve(check);
+		}
+
+		let file_name = self.file_name.clone().unwrap_or_else(main_file);
+		if self.watch {
+			watch(&watched_paths(self.file_name.as_deref()), || self.report(&file_name).map(|_passed| ()));
+		}
+
+		if !self.report(&file_name)? {
+			std::process::exit(1);
+		}
+		Ok(())
+	}
+}
+
+impl CheckCommand {
+	/// Checks a file and prints the result, using the project's check server if one is running.
+	///
+	/// # Parameters
+	/// - `file_name` - The path of the file to check.
+	///
+	/// # Returns
+	/// Whether the file has no errors.
+	///
+	/// # Errors
+	/// If the file couldn't be read, or the result couldn't be written to stdout.
+	fn report(&self, file_name: &str) -> anyhow::Result<bool> {
+		let start = Instant::now();
+		log!(self.quiet, "{}", format!("{} {file_name}... ", "Checking".green()).bold())?;
+
+		let result = if let Some(result) = server::request(file_name) {
+			result
+		} else {
+			let (source_code, modules) = read_program(file_name)?;
+			check(file_name, source_code, modules)
+		};
+
+		match result {
+			Ok(()) => {
+				log!(self.quiet, "{} {}\n", "Done!".green().bold(), format!("({:.2?})", start.elapsed()).truecolor(100, 100, 100))?;
+				Ok(true)
+			},
+			Err(message) => {
+				log!(self.quiet, "{}", "Error:\n\n".red().bold())?;
+				eprintln!("{message}");
+				Ok(false)
+			},
+		}
+	}
+}
+
+/// Checks a program for errors by tokenizing, parsing, and evaluating it at compile-time. Functions with side effects aren't run, so checking a program
+/// doesn't print anything or touch the file system. Compile-time evaluation is limited by the budget in the project's `cabin.toml` if there is one, so
+/// that a runaway compile-time function fails the check instead of hanging it.
+///
+/// # Parameters
+/// - `file_name` - The path of the program's main file, which is used in error messages.
+/// - `source_code` - The source code of the program, as returned by `modules::read_program()`.
+/// - `modules` - The modules of the program, as returned by `modules::read_program()`.
+///
+/// # Returns
+/// The error message if the program has errors, including any details about the error.
+pub fn check(file_name: &str, source_code: String, modules: Vec<Module>) -> Result<(), String> {
+	let mut context = Context::new(file_name.to_owned(), source_code);
+	context.modules = modules.into();
+	context.compile_time_profile = CompileTimeProfiler::new(project_budget()?, false);
+	let result = tokenize_modules(&context)
+		.map_err(|error| format!("{}: {error}", "Tokenization Error".red().bold().underline()))
+		.and_then(|tokens| parse(&tokens, &mut context).map_err(|error| format!("{}: {error}", "Parsing Error".red().bold().underline())))
+		.and_then(|ast| {
+			ast.compile_time_evaluate(&mut context, false)
+				.map_err(|error| format!("{}: {error}", "Compile-Time Evaluation Error".red().bold().underline()))
+		});
+
+	result.map(|_evaluated| ()).map_err(|mut message| {
+		for note in &context.error_details {
+			write!(message, "\n{} {note}\n", "Error Details:".bold().bright_purple().underline()).unwrap_or_else(|_error| unreachable!());
+		}
+		message
+	})
+}
+
+/// Returns the compile-time budget of the project in the current directory (see `CompileTimeBudget`).
+///
+/// # Returns
+/// The project's compile-time budget, which is unlimited if the current directory doesn't have a readable `cabin.toml`.
+///
+/// # Errors
+/// If the project's budget is configured incorrectly.
+fn project_budget() -> Result<CompileTimeBudget, String> {
+	let Some(config) = std::fs::read_to_string("./cabin.toml")
+		.ok()
+		.and_then(|config_string| config_string.parse::<toml_edit::DocumentMut>().ok())
+	else {
+		return Ok(CompileTimeBudget::default());
+	};
+	CompileTimeBudget::from_config(&config).map_err(|error| error.to_string())
+}
@@ -0,0 +1,32 @@
+use crate::{cache::CACHE_DIRECTORY, cli::commands::CabinCommand};
+
+use std::path::Path;
+
+use colored::Colorize as _;
+
+/// Removes the build cache of the current Cabin project. Cached builds are stored in `./builds/cache` by `cabin run` and `cabin build`, and are normally only
+/// reused when nothing about the program has changed, so this is only needed to reclaim disk space, or if the cache has been corrupted somehow.
+#[derive(clap::Parser)]
+pub struct CleanCommand {
+	/// Run the command in "quiet mode". This prevents the Cabin compiler from printing what was removed.
+	#[arg(long, short)]
+	quiet: bool,
+}
+
+impl CabinCommand for CleanCommand {
+	fn execute(&self) -> anyhow::Result<()> {
+		if !Path::new(CACHE_DIRECTORY).exists() {
+			if !self.quiet {
+				println!("{} There's no build cache to remove.", "Done!".green().bold());
+			}
+			return Ok(());
+		}
+
+		std::fs::remove_dir_all(CACHE_DIRECTORY).map_err(|error| anyhow::anyhow!("Error removing the build cache at {CACHE_DIRECTORY}: {error}"))?;
+		if !self.quiet {
+			println!("{} Removed the build cache at {}", "Done!".green().bold(), CACHE_DIRECTORY.cyan().bold());
+		}
+
+		Ok(())
+	}
+}
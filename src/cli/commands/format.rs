@@ -1,4 +1,23 @@
-use crate::{cli::commands::CabinCommand, context::Context, formatter::ToCabin, lexer::tokenize, log, parser::parse, step};
+use crate::{
+	cache::{hash_compiler_identity, StableHasher, CACHE_DIRECTORY},
+	cli::commands::CabinCommand,
+	context::Context,
+	formatter::ToCabin,
+	lexer::tokenize,
+	log,
+	parser::parse,
+	util::map_in_parallel,
+};
+
+use std::{
+	collections::HashMap,
+	fmt::Write as _,
+	hash::{Hash as _, Hasher as _},
+	num::NonZeroUsize,
+	path::Path,
+	sync::Arc,
+	time::Instant,
+};
 
 use colored::Colorize as _;
 
@@ -14,6 +33,34 @@ pub struct FormatCommand {
 	/// generated from your program itself, not static compiler progress messages.
 	#[arg(long, short)]
 	quiet: bool,
+
+	/// Don't rewrite any files, and instead list the files that aren't formatted. The command fails if any file isn't formatted, so this can be used as
+	/// a pre-commit hook or in continuous integration.
+	#[arg(long)]
+	check: bool,
+
+	/// The maximum number of files to format at the same time. This is the number of CPUs available by default.
+	#[arg(long, short)]
+	jobs: Option<usize>,
+
+	/// Format every file, even files that haven't changed since they were last formatted.
+	#[arg(long)]
+	no_cache: bool,
+}
+
+/// The name of the file in `CACHE_DIRECTORY` that stores a hash of each file that's known to be formatted, so that formatting a project again only
+/// parses the files that changed since.
+const FORMATTED_HASHES_FILE: &str = "formatted";
+
+/// What formatting a file did to it.
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum Outcome {
+	/// The file was already formatted, so it was left as it is.
+	Unchanged,
+	/// The file wasn't formatted, and was rewritten with its formatted code.
+	Formatted,
+	/// The file isn't formatted, and was left as it is because of `--check`.
+	NeedsFormatting,
 }
 
 impl CabinCommand for FormatCommand {
@@ -38,12 +85,17 @@ impl CabinCommand for FormatCommand {
 
 		let quiet = options.get("quiet").and_then(|config_quiet| config_quiet.as_bool()).unwrap_or(self.quiet);
 
+		let start = Instant::now();
 		log!(
 			quiet,
 			"{}\n",
-			format!("{} {}...", "Formatting".green(), self.file_name.as_ref().unwrap_or(&project_name.to_owned()))
-				.trim()
-				.bold()
+			format!(
+				"{} {}...",
+				if self.check { "Checking formatting of" } else { "Formatting" }.green(),
+				self.file_name.as_ref().unwrap_or(&project_name.to_owned())
+			)
+			.trim()
+			.bold()
 		)?;
 
 		// Get the files to format. If file_name is provided, this is a single vec of just that file. If not,
@@ -65,35 +117,141 @@ impl CabinCommand for FormatCommand {
 			|filename| vec![filename],
 		);
 
-		for file in files {
-			// Context
-			log!(quiet, "{}", format!("\t{} {}...\n", "Formatting".green(), file.replace('\\', "/")).bold())?;
-
-			// Input file
-			log!(quiet, "{}", format!("\t\t{} source code... ", "Reading".green()).bold())?;
-			let source_code = step!(std::fs::read_to_string(file.clone()), "Input reading error", quiet);
-			let mut context = Context::new(file.clone());
+		let mut formatted_hashes = if self.no_cache { HashMap::new() } else { read_formatted_hashes() };
+		let jobs = self.jobs.unwrap_or_else(|| std::thread::available_parallelism().map_or(1, NonZeroUsize::get));
+		let results = map_in_parallel(&files, jobs, &|file: &String| format_file(file, formatted_hashes.get(file).copied(), self.check));
 
-			// Tokenization
-			log!(quiet, "{}", format!("\t\t{} source code... ", "Tokenizing".green()).bold())?;
-			let tokens = step!(tokenize(source_code), "Tokenization Error", quiet, context, true);
-
-			// Parsing
-			log!(quiet, "{}", format!("\t\t{} token stream... ", "Parsing".green()).bold())?;
-			let ast = step!(parse(&mut tokens.into_iter().collect(), &mut context), "Parsing Error", quiet, context, true);
+		let mut needs_formatting = 0_usize;
+		let mut failures = 0_usize;
+		for (file, result) in files.iter().zip(results) {
+			let file_name = file.replace('\\', "/");
+			match result {
+				Ok((outcome, formatted_hash)) => {
+					if let Some(hash) = formatted_hash {
+						formatted_hashes.insert(file.clone(), hash);
+					}
+					match outcome {
+						Outcome::Unchanged => log!(quiet, "\t{} {file_name}\n", "Unchanged".truecolor(100, 100, 100))?,
+						Outcome::Formatted => log!(quiet, "\t{} {file_name}\n", "Formatted".green().bold())?,
+						Outcome::NeedsFormatting => {
+							needs_formatting += 1;
+							println!("\t{} {file_name}", "Needs formatting".yellow().bold());
+						},
+					}
+				},
+				Err(error) => {
+					failures += 1;
+					formatted_hashes.remove(file);
+					eprintln!("\t{} {file_name}\n\n{error}\n", "Error formatting".red().bold());
+				},
+			}
+		}
 
-			// Formatting
-			log!(quiet, "{}", format!("\t\t{} Parsed AST into formatted Cabin code... ", "Converting".green()).bold())?;
-			let formatted = ast.to_cabin();
-			log!(quiet, "{}\n", "Done!".green().bold())?;
+		// The cache is only an optimization, so failing to write it doesn't fail the command
+		if !self.no_cache {
+			write_formatted_hashes(&formatted_hashes).unwrap_or(());
+		}
 
-			// Writing
-			log!(quiet, "{}", format!("\t\t{} formatted code back onto file... ", "Writing".green()).bold())?;
-			step!(std::fs::write(file, formatted), "File Write Error", quiet, context, true);
-			log!(quiet, "\t{}\n", "Done!".green().bold())?;
+		if failures > 0 {
+			anyhow::bail!("{failures} of {} files couldn't be formatted", files.len());
+		}
+		if needs_formatting > 0 {
+			log!(quiet, "\n{}\n", format!("{needs_formatting} of {} files need formatting", files.len()).yellow().bold())?;
+			std::process::exit(1);
 		}
-		log!(quiet, "{}\n", "Done!".green().bold())?;
+		log!(quiet, "\n{} {}\n", "Done!".green().bold(), format!("({:.2?})", start.elapsed()).truecolor(100, 100, 100))?;
 
 		Ok(())
 	}
 }
+
+/// Formats a single file, rewriting it with its formatted code if it isn't formatted already. A file whose source code has the hash it had when it was
+/// last known to be formatted isn't tokenized or parsed at all.
+///
+/// # Parameters
+/// - `file_name` - The path of the file to format.
+/// - `formatted_hash` - The hash of the file's source code the last time that it was known to be formatted, if it has been.
+/// - `check` - Whether to only check if the file is formatted, without rewriting it.
+///
+/// # Returns
+/// What formatting did to the file, and the hash of the file's source code if it's now known to be formatted.
+///
+/// # Errors
+/// If the file couldn't be read, tokenized, parsed, or written.
+fn format_file(file_name: &str, formatted_hash: Option<u64>, check: bool) -> anyhow::Result<(Outcome, Option<u64>)> {
+	let source_code = std::fs::read_to_string(file_name).map_err(|error| anyhow::anyhow!("Error reading {file_name}: {error}"))?;
+	let source_hash = hash_of(&source_code);
+	if formatted_hash == Some(source_hash) {
+		return Ok((Outcome::Unchanged, Some(source_hash)));
+	}
+
+	let mut context = Context::new(file_name.to_owned(), source_code.clone());
+	let formatted = tokenize(Arc::make_mut(&mut context.source_code))
+		.map_err(|error| format!("{}: {error}", "Tokenization Error".red().bold().underline()))
+		.and_then(|tokens| parse(&tokens, &mut context).map_err(|error| format!("{}: {error}", "Parsing Error".red().bold().underline())))
+		.and_then(|ast| ast.try_to_cabin().map_err(|_error| format!("{}: The file contains code that the formatter can't write", "Formatting Error".red().bold().underline())))
+		.map_err(|mut message| {
+			for note in &context.error_details {
+				write!(message, "\n{} {note}\n", "Error Details:".bold().bright_purple().underline()).unwrap_or_else(|_error| unreachable!());
+			}
+			anyhow::anyhow!(message)
+		})?;
+
+	if formatted == source_code {
+		return Ok((Outcome::Unchanged, Some(source_hash)));
+	}
+	if check {
+		return Ok((Outcome::NeedsFormatting, None));
+	}
+	std::fs::write(file_name, &formatted).map_err(|error| anyhow::anyhow!("Error writing {file_name}: {error}"))?;
+	Ok((Outcome::Formatted, Some(hash_of(&formatted))))
+}
+
+/// Reads the hashes of the files that are known to be formatted from the cache. Each line of the cache file is a hash followed by the path of the file.
+///
+/// # Returns
+/// The hash of each file's source code when it was last known to be formatted, keyed on the path of the file. This is empty if there's no cache yet.
+fn read_formatted_hashes() -> HashMap<String, u64> {
+	std::fs::read_to_string(Path::new(CACHE_DIRECTORY).join(FORMATTED_HASHES_FILE))
+		.unwrap_or_default()
+		.lines()
+		.filter_map(|line| {
+			let (hash, file_name) = line.split_once(' ')?;
+			Some((file_name.to_owned(), u64::from_str_radix(hash, 16).ok()?))
+		})
+		.collect()
+}
+
+/// Writes the hashes of the files that are known to be formatted to the cache (see `read_formatted_hashes()`).
+///
+/// # Parameters
+/// - `formatted_hashes` - The hash of each formatted file's source code, keyed on the path of the file.
+///
+/// # Errors
+/// If the cache directory couldn't be created or the cache file couldn't be written.
+fn write_formatted_hashes(formatted_hashes: &HashMap<String, u64>) -> anyhow::Result<()> {
+	let mut entries = formatted_hashes.iter().collect::<Vec<_>>();
+	entries.sort();
+	let mut contents = String::new();
+	for (file_name, hash) in entries {
+		writeln!(contents, "{hash:016x} {file_name}").unwrap_or_else(|_error| unreachable!());
+	}
+	std::fs::create_dir_all(CACHE_DIRECTORY)?;
+	std::fs::write(Path::new(CACHE_DIRECTORY).join(FORMATTED_HASHES_FILE), contents)?;
+	Ok(())
+}
+
+/// Returns a hash of a file's source code, which is used to tell whether the file has changed since it was last formatted. The compiler is hashed too,
+/// so that files are formatted again when the formatter changes.
+///
+/// # Parameters
+/// - `source_code` - The source code of the file.
+///
+/// # Returns
+/// The hash of the source code.
+fn hash_of(source_code: &str) -> u64 {
+	let mut hasher = StableHasher::new();
+	source_code.hash(&mut hasher);
+	hash_compiler_identity(&mut hasher);
+	hasher.finish()
+}
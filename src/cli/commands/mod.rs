@@ -1,4 +1,13 @@
-use crate::cli::commands::{build::BuildCommand, configure::ConfigureCommand, format::FormatCommand, new::NewCommand, run::RunCommand, transpile::TranspileCommand};
+use crate::{
+	cli::commands::{
+		build::BuildCommand, check::CheckCommand, clean::CleanCommand, configure::ConfigureCommand, format::FormatCommand, new::NewCommand, run::RunCommand,
+		transpile::TranspileCommand,
+	},
+	cache::BuildCache,
+	context::Context,
+};
+
+use colored::Colorize as _;
 
 /// The build module, which handles the `cabin build` command.
 pub mod build;
@@ -6,6 +15,9 @@ pub mod build;
 /// The check module, which handles the `cabin check` command.
 pub mod check;
 
+/// The clean module, which handles the `cabin clean` command.
+pub mod clean;
+
 /// The configure module, which handles the `cabin configure` command.
 pub mod configure;
 
@@ -45,7 +57,7 @@ pub enum SubCommand {
 	/// Compiles a Cabin project or file and outputs the build as a native executable. If an argument is passed,
 	/// it will be interpreted as a file path of the file to build, and this will be built as a single script file.
 	/// If no file is passed, the command is assumed to be running in a Cabin project with a standard file structure,
-	/// and it attempts to run the file at `./src/main.cbn`
+	/// and it attempts to run the project's main file, which is `./src/main.cbn` unless the `main` field of `cabin.toml` names another
 	///
 	/// By default, if you run a file named `file.cbn`, The output will be called `file` on Unix systems and `file.exe`
 	/// on Windows. If the command was run on a specific single-file, The compiled binary will be placed in the same directory
@@ -53,6 +65,15 @@ pub enum SubCommand {
 	/// placed as `builds/file-<VERSION>` (`.exe` on Windows).
 	Build(BuildCommand),
 
+	/// Checks a Cabin project or file for errors without building it. The program is tokenized, parsed, and evaluated at compile-time, but isn't
+	/// transpiled to C or compiled, so this is much faster than `cabin build`. With `--watch`, the program is checked again each time it changes, and
+	/// with `--serve`, a check server is started that answers later checks without starting the compiler from scratch.
+	Check(CheckCommand),
+
+	/// Removes the build cache of the current Cabin project. Cached builds are stored in `./builds/cache` by `cabin run` and `cabin build`, and are normally
+	/// only reused when nothing about the program has changed, so this is only needed to reclaim disk space, or if the cache has been corrupted somehow.
+	Clean(CleanCommand),
+
 	/// Configure the Cabin compiler. If this is run without the `--global` or `-g` flag, it will modify the configuration file (`./cabin.toml`) to include
 	/// the passed options. When running the cabin compiler for that project, those options should be used. If run with the `--global` flag, this will affect
 	/// your global compiler settings `~/.config/cabin/cabin.toml`, which are used as a default when always using the compiler
@@ -143,3 +164,112 @@ macro_rules! log {
 		}
     };
 }
+
+/// Prints the warnings that the compiler emitted, indented under the compiler's progress output. Nothing is printed if there are no warnings.
+///
+/// # Parameters
+/// - `warnings` - The warnings to print.
+pub fn print_warnings(warnings: &[String]) {
+	if warnings.is_empty() {
+		return;
+	}
+
+	println!();
+	for warning in warnings {
+		println!("{}", warning.lines().map(|line| format!("\t{line}")).collect::<Vec<_>>().join("\n"));
+	}
+	println!();
+}
+
+/// Logs that a cached build is being used, which means that the program's compile-time code isn't run again, and prints the warnings that were emitted
+/// when the build was made (see `BuildCache`).
+///
+/// # Parameters
+/// - `cache` - The cache entry of the build.
+/// - `quiet` - Whether the compiler is running in quiet mode, in which case only the warnings are printed.
+///
+/// # Errors
+/// If the output couldn't be written to stdout.
+pub fn log_cached_build(cache: &BuildCache, quiet: bool) -> std::io::Result<()> {
+	log!(
+		quiet,
+		"{}",
+		"\t\tThe program hasn't changed since it was built, so its compile-time code wasn't run again. Run with --no-cache to run it.\n".truecolor(100, 100, 100)
+	)?;
+	print_warnings(&cache.cached_warnings());
+	Ok(())
+}
+
+/// Logs that a build isn't being stored in the build cache because its compile-time code interacted with the system (see `BuildCache::is_cacheable()`).
+///
+/// # Parameters
+/// - `quiet` - Whether the compiler is running in quiet mode, in which case nothing is logged.
+///
+/// # Errors
+/// If the output couldn't be written to stdout.
+pub fn log_uncached_build(quiet: bool) -> std::io::Result<()> {
+	log!(
+		quiet,
+		"{}",
+		"\t\tThis build wasn't cached, because its compile-time code interacts with the system.\n".truecolor(100, 100, 100)
+	)
+}
+
+/// Logs how many of the function calls made at compile-time were reused from the memo cache instead of being evaluated again (see `CallCache`). This is
+/// a statistic about the compiler rather than the program, so it's only logged with `--timings`. Nothing is logged if no calls could be memoized.
+///
+/// # Parameters
+/// - `context` - The context of the compiler after compile-time evaluation has finished.
+/// - `timings` - Whether `--timings` was passed, in which case the statistics are logged.
+/// - `quiet` - Whether the compiler is running in quiet mode, in which case nothing is logged.
+///
+/// # Errors
+/// If the output couldn't be written to stdout.
+pub fn log_call_cache(context: &Context, timings: bool, quiet: bool) -> std::io::Result<()> {
+	if !timings {
+		return Ok(());
+	}
+
+	if let Some(summary) = context.call_cache.summary() {
+		log!(quiet, "{}", format!("\t\t{} compile-time calls: {summary}\n", "Memoized".green()).bold())?;
+	}
+	Ok(())
+}
+
+/// Logs how many items were left out of the generated C code because the program can't reach them (see `reachability::reachable_items()`). This is
+/// logged when the C code is emitted with `--emit-c`, where the removed items are listed in a comment at the end of the header. Nothing is logged if
+/// every item was reachable.
+///
+/// # Parameters
+/// - `context` - The context of the compiler after transpilation has finished.
+/// - `quiet` - Whether the compiler is running in quiet mode, in which case nothing is logged.
+///
+/// # Errors
+/// If the output couldn't be written to stdout.
+pub fn log_removed_c_items(context: &Context, quiet: bool) -> std::io::Result<()> {
+	if !context.removed_c_items.is_empty() {
+		log!(
+			quiet,
+			"{}",
+			format!("\t\t{} {} unreachable items from the generated C\n", "Removed".green(), context.removed_c_items.len()).bold()
+		)?;
+	}
+	Ok(())
+}
+
+/// Logs how many of a program's translation units had to be compiled, and how many were reused from the build cache, after compiling with `--units`.
+///
+/// # Parameters
+/// - `compiled` - The number of translation units that were compiled.
+/// - `total` - The total number of translation units in the program.
+/// - `quiet` - Whether the compiler is running in quiet mode, in which case nothing is logged.
+///
+/// # Errors
+/// If the output couldn't be written to stdout.
+pub fn log_translation_units(compiled: usize, total: usize, quiet: bool) -> std::io::Result<()> {
+	log!(
+		quiet,
+		"{}",
+		format!("\t\t{} {total} translation units: {compiled} compiled, {} cached\n", "Linked".green(), total - compiled).bold()
+	)
+}
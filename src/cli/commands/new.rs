@@ -33,6 +33,12 @@ impl CabinCommand for NewCommand {
 				
 				[options]
 				quiet = false
+				
+				[profile.debug]
+				opt-level = 0
+				
+				[profile.release]
+				opt-level = 3
 				"#
 			)),
 		)?;
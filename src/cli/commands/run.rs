@@ -1,12 +1,21 @@
 use crate::{
-	cli::commands::CabinCommand,
-	compile_time::builtin::IS_FIRST_PRINT,
-	compiler::{compile_c_to, run_native_executable, temp_dir, transpile, write_c},
+	cache::BuildCache,
+	cli::{
+		commands::{log_cached_build, log_call_cache, log_removed_c_items, log_translation_units, log_uncached_build, print_warnings, CabinCommand},
+		watch::{run_again_without_watching, watch, watched_paths},
+	},
+	compile_time::{
+		builtin::IS_FIRST_PRINT,
+		profiler::{CompileTimeBudget, CompileTimeProfiler},
+	},
+	compiler::{compile_c_to, run_native_executable, temp_c_file, temp_output_path, transpile_to_file},
 	context::Context,
-	lexer::tokenize,
 	log,
+	modules::{main_file, read_program, tokenize_modules},
 	parser::parse,
-	step, PRELUDE,
+	profile::BuildProfile,
+	step, timings,
+	units::TranslationUnits,
 };
 
 use std::sync::atomic::Ordering;
@@ -29,13 +38,71 @@ pub struct RunCommand {
 	/// code will be outputted to this file. The program will still be built to a native executable and run.
 	#[arg(long, short = 'c')]
 	pub emit_c: Option<String>,
+
+	/// Don't use the build cache. By default, the generated C code and native executable of the program are cached in `./builds/cache`, and if the program
+	/// hasn't changed since it was last built, the cached executable is run instead of compiling the program again. With this flag, the program is always
+	/// compiled from scratch, and the build isn't cached.
+	#[arg(long)]
+	pub no_cache: bool,
+
+	/// Build with the `release` profile instead of the `debug` profile. The release profile is fully optimized by default, and can be configured in the
+	/// `[profile.release]` table of `cabin.toml`.
+	#[arg(long, conflicts_with = "profile")]
+	pub release: bool,
+
+	/// The name of the build profile to build with, which is configured in the `[profile.<name>]` table of `cabin.toml`. This is `debug` by default, or
+	/// `release` when `--release` is passed.
+	#[arg(long)]
+	pub profile: Option<String>,
+
+	/// Record how long each phase of the compiler takes and the peak memory it uses, including the time spent in the C compiler, and print a table of
+	/// the results when compilation finishes.
+	#[arg(long)]
+	pub timings: bool,
+
+	/// Record the timings of each phase of the compiler like `--timings`, and write them to the given file in the Chrome trace event format, which can be
+	/// opened with `chrome://tracing` or Perfetto. The summary table is only printed if `--timings` is also passed.
+	#[arg(long)]
+	pub timings_file: Option<String>,
+
+	/// Profile the compile-time evaluation of the program, and write every call stack it was in to the given file in the folded stack format, weighted by
+	/// the number of steps taken in it, which can be turned into a flamegraph by tools like `inferno-flamegraph` or speedscope. A table of the functions
+	/// and source locations that took the most steps is also printed. A cached build isn't evaluated at compile-time, so nothing is profiled unless the
+	/// program has changed since it was last built or `--no-cache` is passed.
+	#[arg(long)]
+	pub profile_compile_time: Option<String>,
+
+	/// The maximum number of threads to use for work that the compiler does in parallel, such as transpiling the program's functions into C. This is the
+	/// number of CPUs available by default. The output of the compiler is the same regardless of how many threads it uses.
+	#[arg(long, short)]
+	pub jobs: Option<usize>,
+
+	/// Split the generated C code into multiple translation units that share a header, compile them in parallel with up to `--jobs` C compilers, and link
+	/// them together. Compiled units are cached in `./builds/cache/objects` unless `--no-cache` is passed, so after a small change to the program only
+	/// the units containing changed functions are compiled again.
+	#[arg(long)]
+	pub units: bool,
+
+	/// Keep running, and build and run the program again each time one of its source files or its configuration changes.
+	#[arg(long)]
+	pub watch: bool,
 }
 
 impl CabinCommand for RunCommand {
 	fn execute(&self) -> anyhow::Result<()> {
+		if self.watch {
+			watch(&watched_paths(self.filename.as_deref()), run_again_without_watching);
+		}
+
+		if self.timings || self.timings_file.is_some() {
+			timings::enable();
+		}
+
 		let config_string = std::fs::read_to_string("./cabin.toml")
 			.map_err(|error| anyhow::anyhow!("Error getting configuration file: {error}. Your project must have a cabin.toml file in the project root."))?;
 		let mut config: toml_edit::DocumentMut = config_string.parse()?;
+		let profile = BuildProfile::from_config(&config, self.profile.as_deref().unwrap_or(if self.release { "release" } else { "debug" }))?;
+		let budget = CompileTimeBudget::from_config(&config)?;
 
 		let Some(toml_edit::Item::Table(information_config)) = config.get_mut("information") else {
 			anyhow::bail!("Error reading configuration file: Could not find \"information\" table.");
@@ -54,57 +121,117 @@ impl CabinCommand for RunCommand {
 		}
 
 		// Context
-		let file_name = self.filename.clone().unwrap_or_else(|| "./src/main.cbn".to_owned());
+		let file_name = self.filename.clone().unwrap_or_else(main_file);
 
 		// Input file
 		log!(self.quiet, "{}", format!("\t{} source code... ", "Reading".green()).bold())?;
-		let source_code = PRELUDE.to_owned() + "\n\n" + &step!(std::fs::read_to_string(&file_name), "Input reading error", self.quiet);
-		let mut context = Context::new(file_name);
-
-		// Tokenization
-		log!(self.quiet, "{}", format!("\t{} source code... ", "Tokenizing".green()).bold())?;
-		let tokens = step!(tokenize(source_code), "Tokenization Error", self.quiet, context, true);
-
-		// Parsing
-		log!(self.quiet, "{}", format!("\t{} token stream... ", "Parsing".green()).bold())?;
-		let ast = step!(parse(&mut tokens.into_iter().collect(), &mut context), "Parsing Error", self.quiet, context, true);
-
-		// compile_time
-		log!(self.quiet, "{}", format!("\t{} compile-time code... ", "Running".green()).bold())?;
-		let compile_time_ast = step!(ast.compile_time_evaluate(&mut context, true), "Compile-Time Evaluation Error", self.quiet, context, false);
-		if IS_FIRST_PRINT.load(Ordering::Relaxed) {
-			println!("{}", "Done!".bold().green());
+		let (source_code, modules) = step!(timings::phase("Reading", || read_program(&file_name)), "Input reading error", self.quiet);
+		let mut context = Context::new(file_name, source_code);
+		context.modules = modules.into();
+		context.compile_time_profile = CompileTimeProfiler::new(budget, self.profile_compile_time.is_some());
+		if let Some(jobs) = self.jobs {
+			context.jobs = jobs.max(1);
 		}
 
-		// Transpilation
-		log!(self.quiet, "{}", format!("\t{} to C... ", "Transpiling".green()).bold())?;
-		let c_code = step!(transpile(&compile_time_ast, &mut context), "Transpilation Error", self.quiet, context, true);
-		let c_file = write_c(&c_code)?;
-		if let Some(emit_c_file) = &self.emit_c {
-			std::fs::write(emit_c_file, &c_code)?;
-		}
-
-		// Compilation
-		log!(self.quiet, "{}", format!("\t{} generated C code... ", "Compiling".green()).bold())?;
-		let exe_file = step!(
-			compile_c_to(&c_file, &(temp_dir() + "/cabin_output"), &mut context),
-			"C Compilation Error",
-			self.quiet,
-			context,
-			true
-		);
-
-		if !context.warnings.is_empty() {
-			println!();
-		}
-
-		for warning in &context.warnings {
-			println!("{}", warning.lines().map(|line| format!("\t{line}")).collect::<Vec<_>>().join("\n"));
-		}
+		// Cached build
+		let build_cache = (!self.no_cache).then(|| BuildCache::new(&context.source_code, &profile));
+		let exe_file = if let Some(cached_executable) = build_cache.as_ref().and_then(BuildCache::cached_executable) {
+			log!(self.quiet, "{}", format!("\t{} cached build... ", "Using".green()).bold())?;
+			if let (Some(cache), Some(emit_c_file)) = (&build_cache, &self.emit_c) {
+				std::fs::copy(cache.c_file(), emit_c_file)?;
+			}
+			log!(self.quiet, "{}", "Done!\n".green().bold())?;
+			if let Some(cache) = &build_cache {
+				log_cached_build(cache, self.quiet)?;
+			}
+			cached_executable
+		} else {
+			// Tokenization
+			log!(self.quiet, "{}", format!("\t{} source code... ", "Tokenizing".green()).bold())?;
+			let tokens = step!(timings::phase("Tokenizing", || tokenize_modules(&context)), "Tokenization Error", self.quiet, context, true);
+
+			// Parsing
+			log!(self.quiet, "{}", format!("\t{} token stream... ", "Parsing".green()).bold())?;
+			let ast = step!(timings::phase("Parsing", || parse(&tokens, &mut context)), "Parsing Error", self.quiet, context, true);
+
+			// compile_time
+			log!(self.quiet, "{}", format!("\t{} compile-time code... ", "Running".green()).bold())?;
+			let evaluated = timings::phase("Compile-time evaluation", || ast.compile_time_evaluate(&mut context, true));
+			if let Some(profile_file) = &self.profile_compile_time {
+				context.compile_time_profile.report(profile_file)?;
+			}
+			let compile_time_ast = step!(evaluated, "Compile-Time Evaluation Error", self.quiet, context, false);
+			if IS_FIRST_PRINT.load(Ordering::Relaxed) {
+				println!("{}", "Done!".bold().green());
+			}
+			log_call_cache(&context, self.timings, self.quiet)?;
+
+			// Transpilation
+			log!(self.quiet, "{}", format!("\t{} to C... ", "Transpiling".green()).bold())?;
+			let c_file = build_cache.as_ref().map_or_else(|| Ok(temp_c_file()), BuildCache::unfinished_c_file)?;
+			let translation_units = if self.units {
+				let units = step!(
+					timings::phase("Transpiling", || TranslationUnits::transpile(&compile_time_ast, &mut context)),
+					"Transpilation Error",
+					self.quiet,
+					context,
+					true
+				);
+				std::fs::write(&c_file, units.combined()).map_err(|error| anyhow::anyhow!("Error writing transpiled C code to file: {error}"))?;
+				Some(units)
+			} else {
+				step!(
+					timings::phase("Transpiling", || transpile_to_file(&compile_time_ast, &mut context, &c_file)),
+					"Transpilation Error",
+					self.quiet,
+					context,
+					true
+				);
+				None
+			};
+			if let Some(emit_c_file) = &self.emit_c {
+				std::fs::copy(&c_file, emit_c_file)?;
+				log_removed_c_items(&context, self.quiet)?;
+			}
+
+			// Compilation
+			log!(self.quiet, "{}", format!("\t{} generated C code... ", "Compiling".green()).bold())?;
+			let output_path = build_cache.as_ref().map_or_else(temp_output_path, BuildCache::unfinished_output_path);
+			let exe_file = if let Some(units) = &translation_units {
+				let (exe_file, compiled) = step!(
+					timings::phase("Compiling", || units.compile_to(&output_path, &profile, build_cache.is_some(), &mut context)),
+					"C Compilation Error",
+					self.quiet,
+					context,
+					true
+				);
+				log_translation_units(compiled, units.unit_count(), self.quiet)?;
+				exe_file
+			} else {
+				step!(
+					timings::phase("Compiling", || compile_c_to(&c_file, &output_path, &profile, &mut context)),
+					"C Compilation Error",
+					self.quiet,
+					context,
+					true
+				)
+			};
+
+			print_warnings(&context.warnings);
+
+			// Cache the build, or clean up the generated C code if caching is disabled or the build can't be cached
+			if let Some(cache) = build_cache.as_ref().filter(|_cache| BuildCache::is_cacheable()) {
+				cache.store(&c_file, &exe_file, &context.warnings)?
+			} else {
+				if build_cache.is_some() {
+					log_uncached_build(self.quiet)?;
+				}
+				std::fs::remove_file(&c_file)?;
+				exe_file
+			}
+		};
 
-		if !context.warnings.is_empty() {
-			println!();
-		}
+		timings::report(self.timings, self.timings_file.as_deref())?;
 
 		// Run executable
 		if !self.quiet {
@@ -113,8 +240,6 @@ impl CabinCommand for RunCommand {
 
 		run_native_executable(&exe_file)?;
 
-		std::fs::remove_file(&c_file)?;
-
 		Ok(())
 	}
 }
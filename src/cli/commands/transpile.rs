@@ -1,6 +1,18 @@
-use crate::{cli::commands::CabinCommand, compiler::transpile, context::Context, lexer::tokenize, log, parser::parse, step, PRELUDE};
-
-use std::path::Path;
+use crate::{
+	cli::commands::{log_call_cache, log_removed_c_items, CabinCommand},
+	compile_time::{
+		builtin::IS_FIRST_PRINT,
+		profiler::{CompileTimeBudget, CompileTimeProfiler},
+	},
+	compiler::transpile_to_file,
+	context::Context,
+	log,
+	modules::{main_file, read_program, tokenize_modules},
+	parser::parse,
+	step, timings,
+};
+
+use std::{path::Path, sync::atomic::Ordering};
 
 use colored::Colorize as _;
 
@@ -24,6 +36,27 @@ pub struct TranspileCommand {
 	/// - C
 	#[arg(long, default_value = "C")]
 	to: String,
+
+	/// Record how long each phase of the compiler takes and the peak memory it uses, including the time spent in the C compiler, and print a table of
+	/// the results when compilation finishes.
+	#[arg(long)]
+	timings: bool,
+
+	/// Record the timings of each phase of the compiler like `--timings`, and write them to the given file in the Chrome trace event format, which can be
+	/// opened with `chrome://tracing` or Perfetto. The summary table is only printed if `--timings` is also passed.
+	#[arg(long)]
+	timings_file: Option<String>,
+
+	/// Profile the compile-time evaluation of the program, and write every call stack it was in to the given file in the folded stack format, weighted by
+	/// the number of steps taken in it, which can be turned into a flamegraph by tools like `inferno-flamegraph` or speedscope. A table of the functions
+	/// and source locations that took the most steps is also printed.
+	#[arg(long)]
+	profile_compile_time: Option<String>,
+
+	/// The maximum number of threads to use for work that the compiler does in parallel, such as transpiling the program's functions into C. This is the
+	/// number of CPUs available by default. The output of the compiler is the same regardless of how many threads it uses.
+	#[arg(long, short)]
+	jobs: Option<usize>,
 }
 
 impl CabinCommand for TranspileCommand {
@@ -39,7 +72,11 @@ impl CabinCommand for TranspileCommand {
 			std::process::exit(1);
 		}
 
-		let file_name = std::fs::canonicalize(self.file_name.clone().unwrap_or_else(|| "./src/main.cbn".to_owned()))
+		if self.timings || self.timings_file.is_some() {
+			timings::enable();
+		}
+
+		let file_name = std::fs::canonicalize(self.file_name.clone().unwrap_or_else(main_file))
 			.map_err(|error| anyhow::anyhow!("Error canonicalizing source file path: {error}"))?;
 		let file_name_path = file_name.to_str().unwrap();
 		let file_path = Path::new(&file_name_path);
@@ -54,6 +91,7 @@ impl CabinCommand for TranspileCommand {
 		let config_string = std::fs::read_to_string("./cabin.toml")
 			.map_err(|error| anyhow::anyhow!("Error getting configuration file: {error}. If you were trying to set this option globally, use the --global flag."))?;
 		let mut config: toml_edit::DocumentMut = config_string.parse()?;
+		let budget = CompileTimeBudget::from_config(&config)?;
 
 		let Some(toml_edit::Item::Table(information_config)) = config.get_mut("information") else {
 			anyhow::bail!("Error reading configuration file: Could not find \"information\" table.");
@@ -85,32 +123,52 @@ impl CabinCommand for TranspileCommand {
 
 		// Input file
 		log!(self.quiet, "{}", format!("\t{} source code... ", "Reading".green()).bold())?;
-		let source_code = PRELUDE.to_owned() + "\n\n" + &step!(std::fs::read_to_string(&file_name_string), "Input reading error", self.quiet);
-		let mut context = Context::new(file_name_string);
+		let (source_code, modules) = step!(timings::phase("Reading", || read_program(&file_name_string)), "Input reading error", self.quiet);
+		let mut context = Context::new(file_name_string, source_code);
+		context.modules = modules.into();
+		context.compile_time_profile = CompileTimeProfiler::new(budget, self.profile_compile_time.is_some());
+		if let Some(jobs) = self.jobs {
+			context.jobs = jobs.max(1);
+		}
 
 		// Tokenization
 		log!(self.quiet, "{}", format!("\t{} source code... ", "Tokenizing".green()).bold())?;
-		let tokens = step!(tokenize(source_code), "Tokenization Error", self.quiet, context, true);
+		let tokens = step!(timings::phase("Tokenizing", || tokenize_modules(&context)), "Tokenization Error", self.quiet, context, true);
 
 		// Parsing
 		log!(self.quiet, "{}", format!("\t{} token stream... ", "Parsing".green()).bold())?;
-		let ast = step!(parse(&mut tokens.into_iter().collect(), &mut context), "Parsing Error", self.quiet, context, true);
+		let ast = step!(timings::phase("Parsing", || parse(&tokens, &mut context)), "Parsing Error", self.quiet, context, true);
 
 		// compile_time
 		log!(self.quiet, "{}", format!("\t{} compile-time code... ", "Running".green()).bold())?;
-		let compile_time_ast = step!(ast.compile_time_evaluate(&mut context, true), "Compile-Time Evaluation Error", self.quiet, context, false);
+		let evaluated = timings::phase("Compile-time evaluation", || ast.compile_time_evaluate(&mut context, true));
+		if let Some(profile_file) = &self.profile_compile_time {
+			context.compile_time_profile.report(profile_file)?;
+		}
+		let compile_time_ast = step!(evaluated, "Compile-Time Evaluation Error", self.quiet, context, false);
+		if IS_FIRST_PRINT.load(Ordering::Relaxed) {
+			log!(self.quiet, "{}", "Done!\n".green().bold())?;
+		}
+		log_call_cache(&context, self.timings, self.quiet)?;
 
 		// Transpilation
 		log!(self.quiet, "{}", format!("\t{} to C... ", "Transpiling".green()).bold())?;
-		let c_code = step!(transpile(&compile_time_ast, &mut context), "Transpilation Error", self.quiet, context, true);
 		let output_file = self.file_name.clone().unwrap_or(if self.file_name.is_some() {
 			format!("{file_directory}/{file_basename}", file_directory = file_directory.display())
 		} else {
 			std::fs::create_dir_all("./builds/c")?;
 			format!("./builds/c/{project_name}-v{project_version}.c")
 		});
-		std::fs::write(&output_file, c_code)?;
-
+		step!(
+			timings::phase("Transpiling", || transpile_to_file(&compile_time_ast, &mut context, &output_file)),
+			"Transpilation Error",
+			self.quiet,
+			context,
+			true
+		);
+		log_removed_c_items(&context, self.quiet)?;
+
+		timings::report(self.timings, self.timings_file.as_deref())?;
 		println!("{} C file ready at {}", "Done!".green().bold(), output_file.cyan().bold());
 		Ok(())
 	}
@@ -1,2 +1,4 @@
 pub mod commands;
+pub mod server;
 pub mod theme;
+pub mod watch;
@@ -0,0 +1,169 @@
+use crate::{
+	cache::CACHE_DIRECTORY,
+	modules::{read_program, Module},
+};
+
+use std::path::{Path, PathBuf};
+
+#[cfg(unix)]
+use crate::modules::CONFIG_FILE;
+
+#[cfg(unix)]
+use std::{
+	collections::HashMap,
+	hash::{DefaultHasher, Hash as _, Hasher as _},
+	io::{BufRead as _, BufReader, Read as _, Write as _},
+	os::unix::net::{UnixListener, UnixStream},
+	time::Duration,
+};
+
+/// How long the check server waits for a client to send its request or read the response before giving up on it. Requests are answered one at a time, so
+/// without this, a client that connects and never sends a whole line would stop the server from answering anyone else.
+#[cfg(unix)]
+const CLIENT_TIMEOUT: Duration = Duration::from_secs(5);
+
+/// How long `cabin check` waits for the check server to answer before checking the file itself. The server checks one file at a time, so this leaves
+/// room for the checks queued before this one, but a server that has stopped answering doesn't hang the client.
+#[cfg(unix)]
+const SERVER_TIMEOUT: Duration = Duration::from_secs(120);
+
+/// Returns the path of the socket that the check server of the project in the current directory listens on (see `serve()`).
+///
+/// # Returns
+/// The path of the check server's socket.
+#[must_use]
+pub fn socket_path() -> PathBuf {
+	Path::new(CACHE_DIRECTORY).join("check.sock")
+}
+
+/// Returns a hash of a program's source code and the project's configuration, which is used to tell whether any of its files or its configuration have
+/// changed since it was last checked. The configuration is part of the hash because it changes how the program is checked, such as its compile-time
+/// budget and which files are its modules.
+///
+/// # Parameters
+/// - `source_code` - The source code of the program.
+///
+/// # Returns
+/// The hash of the source code and configuration.
+#[cfg(unix)]
+fn hash_of(source_code: &str) -> u64 {
+	let mut hasher = DefaultHasher::new();
+	source_code.hash(&mut hasher);
+	std::fs::read_to_string(CONFIG_FILE).unwrap_or_default().hash(&mut hasher);
+	hasher.finish()
+}
+
+/// Runs the check server until the process is stopped. The check server is started with `cabin check --serve` and keeps running in the background, so
+/// checking a program doesn't need to start a new compiler process each time: `cabin check` sends the path of the file to check to the server over a local
+/// socket if one is running, and only checks the file itself otherwise (see `request()`). The server remembers the result of the last check of each file
+/// along with a hash of the source code of the file, the other modules of its project (see `modules::read_program()`), and the project's configuration, so
+/// checking a file when nothing in its project has changed since it was last checked doesn't run any of the compiler's phases again. Requests are answered
+/// one at a time, in the order that they're received, and a client that takes longer than `CLIENT_TIMEOUT` to send its request is disconnected.
+///
+/// A request is a single line holding the path of the file to check, and the response is `ok` or `error` on the first line, followed by the error
+/// message if the check failed.
+///
+/// # Parameters
+/// - `check` - Checks a program, given the path of its main file, its source code, and its modules, returning the error message if the check failed.
+///
+/// # Errors
+/// If the socket couldn't be created.
+#[cfg(unix)]
+pub fn serve(mut check: impl FnMut(&str, String, Vec<Module>) -> Result<(), String>) -> anyhow::Result<()> {
+	let path = socket_path();
+	std::fs::create_dir_all(CACHE_DIRECTORY).map_err(|error| anyhow::anyhow!("Error creating cache directory for the check server: {error}"))?;
+	if path.exists() {
+		// A server that's still running keeps answering on the socket, so a socket that can't be connected to was left behind by a server that stopped
+		if UnixStream::connect(&path).is_ok() {
+			anyhow::bail!("A check server is already running for this project at {}", path.display());
+		}
+		std::fs::remove_file(&path)?;
+	}
+	let listener = UnixListener::bind(&path).map_err(|error| anyhow::anyhow!("Error creating the check server's socket at {}: {error}", path.display()))?;
+
+	let mut results = HashMap::<String, (u64, Result<(), String>)>::new();
+	for connection in listener.incoming() {
+		let Ok(mut stream) = connection else {
+			continue;
+		};
+		if stream.set_read_timeout(Some(CLIENT_TIMEOUT)).is_err() || stream.set_write_timeout(Some(CLIENT_TIMEOUT)).is_err() {
+			continue;
+		}
+
+		let mut request = String::new();
+		if BufReader::new(&mut stream).read_line(&mut request).is_err() {
+			continue;
+		}
+		let file_name = request.trim_end().to_owned();
+
+		let result = match read_program(&file_name) {
+			Ok((source_code, modules)) => {
+				let source_hash = hash_of(&source_code);
+				match results.get(&file_name) {
+					Some((cached_hash, cached_result)) if *cached_hash == source_hash => cached_result.clone(),
+					_ => {
+						let checked = check(&file_name, source_code, modules);
+						results.insert(file_name, (source_hash, checked.clone()));
+						checked
+					},
+				}
+			},
+			Err(error) => Err(error.to_string()),
+		};
+
+		let response = match result {
+			Ok(()) => "ok\n".to_owned(),
+			Err(message) => format!("error\n{message}"),
+		};
+		// The client may have stopped waiting for the response, which doesn't affect other requests
+		stream.write_all(response.as_bytes()).unwrap_or(());
+	}
+
+	Ok(())
+}
+
+/// Runs the check server until the process is stopped. The check server listens on a Unix domain socket, so it's only available on Unix platforms.
+///
+/// # Errors
+/// Always, because the check server isn't supported on this platform.
+#[cfg(not(unix))]
+pub fn serve(_check: impl FnMut(&str, String, Vec<Module>) -> Result<(), String>) -> anyhow::Result<()> {
+	anyhow::bail!("The check server is only supported on Unix platforms")
+}
+
+/// Asks the check server of the project in the current directory to check a file, if a check server is running.
+///
+/// # Parameters
+/// - `file_name` - The path of the file to check. This is made absolute, since the server may have been started in a different directory.
+///
+/// # Returns
+/// The result of the check, with the error message if it failed, or `None` if no check server is running or it didn't answer within `SERVER_TIMEOUT`, in
+/// which case the file should be checked locally.
+#[cfg(unix)]
+#[must_use]
+pub fn request(file_name: &str) -> Option<Result<(), String>> {
+	let mut stream = UnixStream::connect(socket_path()).ok()?;
+	stream.set_write_timeout(Some(CLIENT_TIMEOUT)).ok()?;
+	stream.set_read_timeout(Some(SERVER_TIMEOUT)).ok()?;
+	let absolute_path = std::fs::canonicalize(file_name).ok()?;
+	writeln!(stream, "{}", absolute_path.display()).ok()?;
+
+	let mut response = String::new();
+	stream.read_to_string(&mut response).ok()?;
+	let (status, message) = response.split_once('\n')?;
+	match status {
+		"ok" => Some(Ok(())),
+		"error" => Some(Err(message.to_owned())),
+		_ => None,
+	}
+}
+
+/// Asks the check server to check a file. The check server is only available on Unix platforms, so there's never a check server running on this platform.
+///
+/// # Returns
+/// `None`, since no check server can be running.
+#[cfg(not(unix))]
+#[must_use]
+pub fn request(_file_name: &str) -> Option<Result<(), String>> {
+	None
+}
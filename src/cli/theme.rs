@@ -4,6 +4,7 @@ use colored::Colorize as _;
 
 /// A theme for the Cabin CLI tool. Themes are used by the compiler at various points during compilation to pretty-print code snippets from the source
 /// code to point out error locations.
+#[derive(Clone)]
 pub struct Theme {
 	/// The style for keywords, such as `function`, `new`, and `group`.
 	keyword: Style,
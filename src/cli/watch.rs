@@ -0,0 +1,100 @@
+use std::{
+	collections::HashMap,
+	path::{Path, PathBuf},
+	time::{Duration, SystemTime},
+};
+
+use colored::Colorize as _;
+
+/// How long to wait between checking the watched files for changes. This bounds how long it takes for an edit to be noticed, so it's kept well below the
+/// time it takes to check a program after it's noticed.
+const POLL_INTERVAL: Duration = Duration::from_millis(50);
+
+/// The last time that each watched file was modified, keyed on the path of the file.
+type Snapshot = HashMap<PathBuf, SystemTime>;
+
+/// Returns the paths to watch for a command that was run on the given file. A single file is watched on its own; Otherwise the whole project is watched,
+/// which is its source directory and its configuration file.
+///
+/// # Parameters
+/// - `file_name` - The file that the command was run on, or `None` if it was run on the project in the current directory.
+///
+/// # Returns
+/// The files and directories to watch.
+#[must_use]
+pub fn watched_paths(file_name: Option<&str>) -> Vec<PathBuf> {
+	file_name.map_or_else(|| vec![PathBuf::from("./src"), PathBuf::from("./cabin.toml")], |file| vec![PathBuf::from(file)])
+}
+
+/// Returns the last time that each Cabin source file and configuration file in the watched paths was modified. Directories are walked with `walkdir`,
+/// so files that are added to a watched directory are picked up too. Files that can't be read are left out, so a file that's deleted counts as changed.
+///
+/// # Parameters
+/// - `paths` - The files and directories to watch.
+///
+/// # Returns
+/// The modification time of each watched file.
+fn snapshot(paths: &[PathBuf]) -> Snapshot {
+	paths
+		.iter()
+		.flat_map(walkdir::WalkDir::new)
+		.filter_map(Result::ok)
+		.filter(|entry| !entry.file_type().is_dir() && is_watched_file(entry.path()))
+		.filter_map(|entry| Some((entry.path().to_path_buf(), std::fs::metadata(entry.path()).ok()?.modified().ok()?)))
+		.collect()
+}
+
+/// Returns whether a change to the given file can change the result of a command, which is true for Cabin source files and project configuration files.
+///
+/// # Parameters
+/// - `path` - The path of the file.
+///
+/// # Returns
+/// Whether the file should be watched.
+fn is_watched_file(path: &Path) -> bool {
+	path.extension().is_some_and(|extension| extension == "cbn" || extension == "toml")
+}
+
+/// Runs an action, and then runs it again each time a watched file changes, until the process is stopped. Files are polled for changes every
+/// `POLL_INTERVAL`, which only reads the metadata of the files rather than their contents. The action returning an error doesn't stop watching, since the
+/// point of watching is to run the action again once the error has been fixed; The error is printed instead.
+///
+/// # Parameters
+/// - `paths` - The files and directories to watch (see `watched_paths()`).
+/// - `action` - The action to run each time a watched file changes.
+pub fn watch(paths: &[PathBuf], mut action: impl FnMut() -> anyhow::Result<()>) -> ! {
+	let mut last_snapshot = snapshot(paths);
+	loop {
+		if let Err(error) = action() {
+			eprintln!("{} {error}", "Error:".bold().red());
+		}
+		println!("\n{}", "Watching for changes... (Press Ctrl+C to stop)".truecolor(100, 100, 100));
+
+		loop {
+			std::thread::sleep(POLL_INTERVAL);
+			let current_snapshot = snapshot(paths);
+			if current_snapshot != last_snapshot {
+				last_snapshot = current_snapshot;
+				break;
+			}
+		}
+		println!("{}\n", "Change detected, running again...".bold().cyan());
+	}
+}
+
+/// Runs the current command again in a new compiler process, without the `--watch` flag. This is used by commands that exit the process when they
+/// encounter an error, such as `cabin run`, so that each run with `--watch` starts from a fresh process and an error doesn't stop watching.
+///
+/// # Errors
+/// If the new process couldn't be started, or if it exited unsuccessfully.
+pub fn run_again_without_watching() -> anyhow::Result<()> {
+	let executable = std::env::current_exe().map_err(|error| anyhow::anyhow!("Error finding the Cabin compiler executable: {error}"))?;
+	let status = std::process::Command::new(executable)
+		.args(std::env::args_os().skip(1).filter(|argument| argument != "--watch"))
+		.status()
+		.map_err(|error| anyhow::anyhow!("Error starting the Cabin compiler: {error}"))?;
+	if !status.success() {
+		anyhow::bail!("The command exited with {status}");
+	}
+	Ok(())
+}
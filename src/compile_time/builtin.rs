@@ -1,12 +1,17 @@
 use crate::{
 	boolean, global_var, number, object,
 	parser::expressions::{literals::object::InternalValue, Expression},
+	regions::RETURN_REGION,
 	string, void,
 };
 
 use std::{
+	io::Write as _,
 	path::Path,
-	sync::atomic::{AtomicBool, Ordering},
+	sync::{
+		atomic::{AtomicBool, Ordering},
+		Mutex, PoisonError,
+	},
 };
 
 use colored::Colorize as _;
@@ -39,9 +44,119 @@ struct BuiltinFunction {
 /// the compile-time prints. This is true iff there has not been any calls to `terminal.print`at compile-time yet.
 pub static IS_FIRST_PRINT: AtomicBool = AtomicBool::new(true);
 
+/// Whether a builtin that interacts with the system, such as printing to the terminal or reading a file, has been called at compile-time. Builds whose
+/// compile-time code did this aren't cached, because using the cached build would skip those interactions (see `cache::BuildCache`).
+static HAS_COMPILE_TIME_SYSTEM_EFFECTS: AtomicBool = AtomicBool::new(false);
+
+/// Returns whether a builtin that interacts with the system has been called at compile-time (see `HAS_COMPILE_TIME_SYSTEM_EFFECTS`).
+///
+/// # Returns
+/// Whether the system has been interacted with at compile-time.
+#[must_use]
+pub fn has_compile_time_system_effects() -> bool {
+	HAS_COMPILE_TIME_SYSTEM_EFFECTS.load(Ordering::Relaxed)
+}
+
+/// Records that a builtin is being called at compile-time, noting whether it interacts with the system (see `HAS_COMPILE_TIME_SYSTEM_EFFECTS`). Every
+/// builtin that does is in the `terminal` or `File` group.
+///
+/// # Parameters
+/// - `name` - The name of the builtin.
+fn record_compile_time_call(name: &str) {
+	if name.starts_with("terminal.") || name.starts_with("File.") {
+		HAS_COMPILE_TIME_SYSTEM_EFFECTS.store(true, Ordering::Relaxed);
+	}
+}
+
+/// The output of the terminal builtins at compile-time that hasn't been written to the terminal yet. Compile-time prints are collected here and written all
+/// at once when compile-time evaluation ends (see `flush_compile_time_output()`), rather than interleaving a write for each print with the compiler's own
+/// progress output.
+static COMPILE_TIME_OUTPUT: Mutex<String> = Mutex::new(String::new());
+
+/// Writes the output of the terminal builtins that were called at compile-time to the terminal. This is called when compile-time evaluation ends, before
+/// `terminal.input` reads from the terminal at compile-time so that its prompt is shown, and by `terminal.flush`.
+///
+/// # Errors
+/// If writing to the standard output stream failed.
+pub fn flush_compile_time_output() -> anyhow::Result<()> {
+	let output = std::mem::take(&mut *COMPILE_TIME_OUTPUT.lock().unwrap_or_else(PoisonError::into_inner));
+	if output.is_empty() {
+		return Ok(());
+	}
+
+	let mut stdout = std::io::stdout().lock();
+	stdout.write_all(output.as_bytes())?;
+	stdout.flush()?;
+	Ok(())
+}
+
+/// The C runtime for writing to the terminal, which is written into the header of every program (see `Program::split_c()`). Output is collected in a
+/// single large buffer that's written with one `write()` call when it fills up, so printing many lines to a pipe doesn't make a system call or go
+/// through `printf()` formatting for each line. When the standard output is a terminal, each line is written as soon as it's printed instead, so
+/// interactive programs behave as they would with line-buffered output. The buffer is written when the program exits, before reading input, and by
+/// `terminal.flush`.
+///
+/// The state of the buffer is declared weak so that every translation unit shares one buffer (see `units.rs`).
+pub const OUTPUT_RUNTIME: &str = r#"
+#define CABIN_OUTPUT_BUFFER_SIZE (1 << 16)
+
+__attribute__((weak)) char cabin_output_buffer[CABIN_OUTPUT_BUFFER_SIZE];
+__attribute__((weak)) size_t cabin_output_length = 0;
+__attribute__((weak)) bool cabin_output_is_terminal = false;
+
+static inline void cabin_output_write_all(const char* text, size_t length) {
+	while (length > 0) {
+		ssize_t written = write(STDOUT_FILENO, text, length);
+		if (written < 0) {
+			return;
+		}
+		text += written;
+		length -= written;
+	}
+}
+
+static inline void cabin_output_flush(void) {
+	cabin_output_write_all(cabin_output_buffer, cabin_output_length);
+	cabin_output_length = 0;
+}
+
+static inline void cabin_output_write(const char* text, size_t length) {
+	if (length > CABIN_OUTPUT_BUFFER_SIZE - cabin_output_length) {
+		cabin_output_flush();
+		if (length > CABIN_OUTPUT_BUFFER_SIZE) {
+			cabin_output_write_all(text, length);
+			return;
+		}
+	}
+	memcpy(cabin_output_buffer + cabin_output_length, text, length);
+	cabin_output_length += length;
+}
+
+static inline void cabin_output_line(const char* text, size_t length) {
+	cabin_output_write(text, length);
+	cabin_output_write("\n", 1);
+	if (cabin_output_is_terminal) {
+		cabin_output_flush();
+	}
+}
+
+static inline void cabin_output_error_line(const char* text, size_t length) {
+	cabin_output_flush();
+	fwrite(text, 1, length, stderr);
+	fputc('\n', stderr);
+}
+
+static inline void cabin_output_start(void) {
+	cabin_output_is_terminal = isatty(STDOUT_FILENO);
+	atexit(cabin_output_flush);
+}"#;
+
 /// The builtin functions of the language. These are annotated in the source code as `#[builtin("name")]`, where `name` is the name of the builtin.
 /// This name must be known at compile-time.
-static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
+///
+/// The map is ordered, so each builtin also has a fixed index, which compile-time bytecode uses to call a builtin without looking up its name (see
+/// `builtin_index()`).
+static BUILTINS: phf::OrderedMap<&'static str, BuiltinFunction> = phf::phf_ordered_map! {
 	"terminal.print" => BuiltinFunction {
 		compile_time: |args| {
 			let text = args
@@ -49,26 +164,40 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to add), but no arguments were given", "Number.plus".bold().cyan()))?
 				.as_string()?;
 
+			let mut output = COMPILE_TIME_OUTPUT.lock().unwrap_or_else(PoisonError::into_inner);
 			if IS_FIRST_PRINT.load(Ordering::Relaxed) {
-				println!("\n\n{text}");
+				output.push_str("\n\n");
 				IS_FIRST_PRINT.store(false, Ordering::Relaxed);
-			} else {
-				println!("{text}");
 			}
+			output.push_str(&text);
+			output.push('\n');
+			drop(output);
 
 			Ok(void!())
 		},
 		to_c: |parameter_names| {
-			Ok(format!("printf(\"%s\\n\", {}->internal_value);", parameter_names.first().unwrap()))
+			Ok(format!("cabin_output_line(cabin_text_data({text}), cabin_text_length({text}));", text = parameter_names.first().unwrap()))
 		},
 	},
 	"terminal.clear" => BuiltinFunction {
 		compile_time: |_args| {
-			print!("{esc}c", esc = 27 as char);
+			let mut output = COMPILE_TIME_OUTPUT.lock().unwrap_or_else(PoisonError::into_inner);
+			output.push(27 as char);
+			output.push('c');
+			drop(output);
 			Ok(void!())
 		},
 		to_c: |_parameter_names| {
-			Ok(r#"printf("\e[1;1H\e[2J");"#.to_owned())
+			Ok(r#"cabin_output_write("\e[1;1H\e[2J", 10);"#.to_owned())
+		},
+	},
+	"terminal.flush" => BuiltinFunction {
+		compile_time: |_args| {
+			flush_compile_time_output()?;
+			Ok(void!())
+		},
+		to_c: |_parameter_names| {
+			Ok("cabin_output_flush();".to_owned())
 		},
 	},
 	"terminal.print_error" => BuiltinFunction {
@@ -78,15 +207,18 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to add), but no arguments were given", "Number.plus".bold().cyan()))?
 				.as_string()?;
 
+			// Errors are written right away, after any output that was printed before them
+			flush_compile_time_output()?;
 			eprintln!("{text}");
 			Ok(void!())
 		},
 		to_c: |parameter_names| {
-			Ok(format!("printf(\"%s\\n\", {}->internal_value);", parameter_names.first().unwrap()))
+			Ok(format!("cabin_output_error_line(cabin_text_data({text}), cabin_text_length({text}));", text = parameter_names.first().unwrap()))
 		},
 	},
 	"terminal.input" => BuiltinFunction {
 		compile_time: |_args| {
+			flush_compile_time_output()?;
 			let mut buffer = String::new();
 			std::io::stdin().read_line(&mut buffer)?;
 			Ok(string!(buffer.trim()))
@@ -95,7 +227,90 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 			let return_address = parameter_names
 				.first()
 				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to add), but no arguments were given", "Number.plus".bold().cyan()))?;
-			Ok(format!("char* buffer = malloc(sizeof(char) * 256);\nfgets(buffer, 256, stdin);\n*{return_address} = (Text_u) {{ .internal_value = buffer }};"))
+			// The line ending is left out of the Text, as it is at compile-time
+			Ok(unindent::unindent(&format!(
+				r#"
+				cabin_output_flush();
+				char buffer[256];
+				if (fgets(buffer, sizeof(buffer), stdin) == NULL) {{
+					buffer[0] = '\0';
+				}}
+				*{return_address} = cabin_text_from(buffer, strcspn(buffer, "\r\n"));
+				"#
+			)))
+		},
+	},
+	"Text.length" => BuiltinFunction {
+		compile_time: |args| {
+			let text = args
+				.first()
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes one argument (the Text to get the length of), but no arguments were given", "Text.length".bold().cyan()))?
+				.as_string()
+				.map_err(|_error| anyhow::anyhow!("The argument to \"{}\" must be Text", "Text.length".bold().cyan()))?;
+
+			Ok(number!(text.len()))
+		},
+		to_c: |parameter_names| {
+			let text = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes one argument (the Text to get the length of), but no parameter names were given", "Text.length".bold().cyan()))?;
+			let return_address = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" returns a number, but no return address was given", "Text.length".bold().cyan()))?;
+			Ok(format!("*{return_address} = (double) cabin_text_length({text});"))
+		},
+	},
+	"Text.plus" => BuiltinFunction {
+		compile_time: |args| {
+			let this = args
+				.first()
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two pieces of Text to join), but no arguments were given", "Text.plus".bold().cyan()))?
+				.as_string()?;
+			let other = args
+				.get(1)
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two pieces of Text to join), but only one argument was given", "Text.plus".bold().cyan()))?
+				.as_string()?;
+
+			Ok(string!(this + &other))
+		},
+		to_c: |parameter_names| {
+			let this = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two pieces of Text to join), but no parameter names were given", "Text.plus".bold().cyan()))?;
+			let other = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two pieces of Text to join), but only one parameter name was given", "Text.plus".bold().cyan()))?;
+			let return_address = parameter_names.get(2).ok_or_else(|| anyhow::anyhow!("The function \"{}\" returns Text, but no return address was given", "Text.plus".bold().cyan()))?;
+			Ok(format!("*{return_address} = cabin_text_concat({this}, {other});"))
+		},
+	},
+	"Text.join" => BuiltinFunction {
+		compile_time: |args| {
+			let separator = args
+				.first()
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the separator and the list of Text to join), but no arguments were given", "Text.join".bold().cyan()))?
+				.as_string()?;
+			let pieces = args
+				.get_mut(1)
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the separator and the list of Text to join), but only one argument was given", "Text.join".bold().cyan()))?
+				.as_list()
+				.map_err(|_error| anyhow::anyhow!("The second argument to \"{}\" must be a list", "Text.join".bold().cyan()))?
+				.iter()
+				.map(Expression::as_string)
+				.collect::<anyhow::Result<Vec<_>>>()?;
+
+			Ok(string!(pieces.join(&separator)))
+		},
+		to_c: |parameter_names| {
+			let separator = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the separator and the list of Text to join), but no parameter names were given", "Text.join".bold().cyan()))?;
+			let pieces = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the separator and the list of Text to join), but only one parameter name was given", "Text.join".bold().cyan()))?;
+			let return_address = parameter_names.get(2).ok_or_else(|| anyhow::anyhow!("The function \"{}\" returns Text, but no return address was given", "Text.join".bold().cyan()))?;
+
+			// The pieces are collected with a builder, so joining a list of Text copies each piece only a constant number of times on average
+			Ok(unindent::unindent(&format!(
+				r#"
+				cabin_text_builder builder = {{ 0 }};
+				for (int index = 0; index < {pieces}->size; index++) {{
+					if (index > 0) {{
+						cabin_text_builder_append(&builder, {separator});
+					}}
+					cabin_text_builder_append(&builder, (Text_u*) *cabin_list_slot({pieces}, index));
+				}}
+				*{return_address} = cabin_text_builder_finish(&builder);
+				"#
+			)))
 		},
 	},
 	"Number.plus" => BuiltinFunction {
@@ -120,7 +335,8 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 		to_c: |parameter_names| {
 			let this = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to add), but no parameter names were given", "Number.plus".bold().cyan()))?;
 			let other = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to add), but only one parameter name was given (\"{this}\")", "Number.plus".bold().cyan()))?;
-			Ok(format!("return (Number_u) {{ .internal_value = {this}->internal_value + {other}->internal_value }};"))
+			let return_address = parameter_names.get(2).ok_or_else(|| anyhow::anyhow!("The function \"{}\" returns a number, but no return address was given", "Number.plus".bold().cyan()))?;
+			Ok(format!("*{return_address} = {this} + {other};"))
 		},
 	},
 	"Number.minus" => BuiltinFunction {
@@ -145,7 +361,8 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 		to_c: |parameter_names| {
 			let this = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to add), but no parameter names were given", "Number.plus".bold().cyan()))?;
 			let other = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to add), but only one parameter name was given (\"{this}\")", "Number.plus".bold().cyan()))?;
-			Ok(format!("return (Number_u) {{ .internal_value = {this}->internal_value - {other}->internal_value }};"))
+			let return_address = parameter_names.get(2).ok_or_else(|| anyhow::anyhow!("The function \"{}\" returns a number, but no return address was given", "Number.minus".bold().cyan()))?;
+			Ok(format!("*{return_address} = {this} - {other};"))
 		},
 	},
 	"Number.times" => BuiltinFunction {
@@ -170,7 +387,8 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 		to_c: |parameter_names| {
 			let this = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to add), but no parameter names were given", "Number.plus".bold().cyan()))?;
 			let other = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to add), but only one parameter name was given (\"{this}\")", "Number.plus".bold().cyan()))?;
-			Ok(format!("return (Number_u) {{ .internal_value = {this}->internal_value * {other}->internal_value }};"))
+			let return_address = parameter_names.get(2).ok_or_else(|| anyhow::anyhow!("The function \"{}\" returns a number, but no return address was given", "Number.times".bold().cyan()))?;
+			Ok(format!("*{return_address} = {this} * {other};"))
 		},
 	},
 	"Number.divided_by" => BuiltinFunction {
@@ -195,7 +413,8 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 		to_c: |parameter_names| {
 			let this = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to add), but no parameter names were given", "Number.plus".bold().cyan()))?;
 			let other = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to add), but only one parameter name was given (\"{this}\")", "Number.plus".bold().cyan()))?;
-			Ok(format!("return (Number_u) {{ .internal_value = {this}->internal_value / {other}->internal_value }};"))
+			let return_address = parameter_names.get(2).ok_or_else(|| anyhow::anyhow!("The function \"{}\" returns a number, but no return address was given", "Number.divided_by".bold().cyan()))?;
+			Ok(format!("*{return_address} = {this} / {other};"))
 		},
 	},
 	"Number.equals" => BuiltinFunction {
@@ -218,7 +437,53 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 		to_c: |parameter_names| {
 			let this = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to compare), but no parameter names were given", "Number.equals".bold().cyan()))?;
 			let other = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the two numbers to compare), but only one parameter name was given (\"{this}\")", "Number.equals".bold().cyan()))?;
-			Ok(format!("if ({this}->internal_value == {other}->internal_value) {{\n\treturn true_u;\n}}\nreturn false_u;"))
+			let return_address = parameter_names.get(2).ok_or_else(|| anyhow::anyhow!("The function \"{}\" returns a boolean, but no return address was given", "Number.equals".bold().cyan()))?;
+			Ok(format!("*{return_address} = {this} == {other};"))
+		},
+	},
+	"Number.to" => BuiltinFunction {
+		#[allow(clippy::as_conversions)]
+		compile_time: |args| {
+			let start = args
+				.first()
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the number to count from and the number to count up to), but no arguments were given", "Number.to".bold().cyan()))?
+				.as_number()?;
+			let end = args
+				.get(1)
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the number to count from and the number to count up to), but only one argument was given", "Number.to".bold().cyan()))?
+				.as_number()?;
+
+			let count = if end > start { (end - start).ceil() as usize } else { 0 };
+			Ok(object! {
+				List {
+					internal_fields = {
+						data = InternalValue::List((0..count).map(|index| number!(start + index as f64)).collect())
+					}
+				}
+			})
+		},
+		// The numbers are stored in one buffer next to the list's buffer of pointers to them, since lists store pointers to their elements (see
+		// `LIST_RUNTIME` in `group.rs`). Both are allocated in the region that the caller passed for the returned list, so like a list literal, the list
+		// doesn't own its buffer. The count is rounded up like `ceil()` without needing the C math library.
+		to_c: |parameter_names| {
+			let start = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the number to count from and the number to count up to), but no parameter names were given", "Number.to".bold().cyan()))?;
+			let end = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the number to count from and the number to count up to), but only one parameter name was given", "Number.to".bold().cyan()))?;
+			let return_address = parameter_names.get(2).ok_or_else(|| anyhow::anyhow!("The function \"{}\" returns a list, but no return address was given", "Number.to".bold().cyan()))?;
+			Ok(unindent::unindent(&format!(
+				r#"
+				size_t count = {end} > {start} ? (size_t) ({end} - {start}) : 0;
+				if ({start} + count < {end}) {{
+					count++;
+				}}
+				Number_u* numbers = cabin_region_allocate({RETURN_REGION}, count * sizeof(Number_u));
+				void** data = cabin_region_allocate({RETURN_REGION}, count * sizeof(void*));
+				for (size_t index = 0; index < count; index++) {{
+					numbers[index] = {start} + index;
+					data[index] = &numbers[index];
+				}}
+				*{return_address} = (List_u) {{ .size = (int) count, .capacity = (int) count, .start = 0, .owns_data = false, .data = data }};
+				"#
+			)))
 		},
 	},
 	"List.length" => BuiltinFunction {
@@ -233,7 +498,8 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 		},
 		to_c: |parameter_names| {
 			let list = parameter_names.first().ok_or_else(|| anyhow::anyhow!("Expected one argument to List.length, but found none"))?;
-			Ok(format!("return (Number_u) {{ .internal_value = {list}->size }};"))
+			let return_address = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" returns a number, but no return address was given", "List.length".bold().cyan()))?;
+			Ok(format!("*{return_address} = {list}->size;"))
 		},
 	},
 	"List.append" => BuiltinFunction {
@@ -253,11 +519,11 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 
 			Ok(void!())
 		},
-		// TODO: All lists store heap values
+		// Lists store pointers to their elements (see `LIST_RUNTIME` in `group.rs`)
 		to_c: |parameter_names| {
 			let list = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the list to append to and the element to append), but no parameter names were given", "List.append".bold().cyan()))?;
 			let element = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the list to append to and the element to append), but only one parameter name was given", "List.append".bold().cyan()))?;
-			Ok(format!("if ({list}->size == {list}->capacity) {{\n\t{list}->capacity *= 2;\n}}\n{list}->data = realloc({list}->data, {list}->capacity * sizeof(ElementType_u));\n{list}->data[{list}->size++] = {element};"))
+			Ok(format!("cabin_list_append({list}, {element});"))
 		},
 	},
 	"List.prepend" => BuiltinFunction {
@@ -282,7 +548,7 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 		to_c: |parameter_names| {
 			let list = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the list to append to and the element to append), but no parameter names were given", "List.append".bold().cyan()))?;
 			let element = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the list to append to and the element to append), but only one parameter name was given", "List.append".bold().cyan()))?;
-			Ok(format!("if ({list}->size == {list}->capacity) {{\n\t{list}->capacity *= 2;\n}}\n{list}->data = 1 + realloc({list}->data, {list}->capacity * sizeof(ElementType_u));\n{list}->data[0] = {element};\n{list}->size++;"))
+			Ok(format!("cabin_list_prepend({list}, {element});"))
 		},
 	},
 	"List.set" => BuiltinFunction {
@@ -312,7 +578,7 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 			let list = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes three arguments (the list to append, the index to set, and the element to set it to), but no parameter names were given", "List.set".bold().cyan()))?;
 			let index = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes three arguments (the list to append, the index to set, and the element to set it to), but only one parameter name was given", "List.set".bold().cyan()))?;
 			let value = parameter_names.get(2).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes three arguments (the list to append, the index to set, and the element to set it to), but only two parameter names were given", "List.set".bold().cyan()))?;
-			Ok(format!("{list}->data[(int) {index}->internal_value] = {value};"))
+			Ok(format!("*cabin_list_slot({list}, {index}) = {value};"))
 		},
 	},
 	"List.get" => BuiltinFunction {
@@ -335,7 +601,8 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 		to_c: |parameter_names| {
 			let list = parameter_names.first().ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the list to append to and the element to get), but no parameter names were given", "List.get".bold().cyan()))?;
 			let index = parameter_names.get(1).ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the list to append to and the element to get), but only one parameter name was given", "List.get".bold().cyan()))?;
-			Ok(format!("return (Number_u*) {list}->data[(int) {index}->internal_value];"))
+			let return_address = parameter_names.get(2).ok_or_else(|| anyhow::anyhow!("The function \"{}\" returns an element of the list, but no return address was given", "List.get".bold().cyan()))?;
+			Ok(format!("*(void**) {return_address} = *cabin_list_slot({list}, {index});"))
 		},
 	},
 	"File.read" => BuiltinFunction {
@@ -359,19 +626,129 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 
 			Ok(unindent::unindent(&format!(
 				r#"
-				FILE* f = fopen({path}->internal_value, "rb");
+				FILE* f = fopen(cabin_text_data({path}), "rb");
 				char* buffer = 0;
+				size_t length = 0;
 
 				if (f) {{
 					fseek(f, 0, SEEK_END);
-					long length = ftell(f);
+					long size = ftell(f);
 					fseek(f, 0, SEEK_SET);
-					buffer = malloc(length);
-					if (buffer) fread(buffer, 1, length, f);
+					buffer = malloc(size + 1);
+					if (buffer) {{
+						length = fread(buffer, 1, size, f);
+						buffer[length] = '\0';
+					}}
 					fclose(f);
 				}}
 
-				*{return_address} = (Text_u) {{ .internal_value = buffer }};
+				if (buffer) {{
+					cabin_text_adopt({return_address}, buffer, length);
+				}} else {{
+					cabin_text_borrow({return_address}, "", 0);
+				}}
+				"#
+			)))
+		},
+	},
+	"File.open" => BuiltinFunction {
+		compile_time: |_args| {
+			anyhow::bail!(
+				"The function \"{}\" can't be called at compile-time, because open files only exist at runtime. Use \"{}\" to read a file at compile-time.",
+				"File.open".bold().cyan(),
+				"files.read".bold().cyan()
+			)
+		},
+		to_c: |parameter_names| {
+			let path = parameter_names
+				.first()
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the path of the file to open and the return address), but no arguments were given\n", "File.open".bold().cyan()))?;
+			let return_address = parameter_names
+				.get(1)
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the path of the file to open and the return address), but only one argument was given\n", "File.open".bold().cyan()))?;
+			Ok(format!("*{return_address} = cabin_file_open(cabin_text_data({path}));"))
+		},
+	},
+	"File.read_line" => BuiltinFunction {
+		compile_time: |_args| {
+			anyhow::bail!("The function \"{}\" can't be called at compile-time, because open files only exist at runtime.", "File.read_line".bold().cyan())
+		},
+		to_c: |parameter_names| {
+			let file = parameter_names
+				.first()
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the file to read from and the return address), but no arguments were given\n", "File.read_line".bold().cyan()))?;
+			let return_address = parameter_names
+				.get(1)
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the file to read from and the return address), but only one argument was given\n", "File.read_line".bold().cyan()))?;
+			Ok(format!("cabin_file_next_line({file}, {return_address});"))
+		},
+	},
+	"File.read_chunk" => BuiltinFunction {
+		compile_time: |_args| {
+			anyhow::bail!("The function \"{}\" can't be called at compile-time, because open files only exist at runtime.", "File.read_chunk".bold().cyan())
+		},
+		to_c: |parameter_names| {
+			let file = parameter_names
+				.first()
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes three arguments (the file to read from, the size to read, and the return address), but no arguments were given\n", "File.read_chunk".bold().cyan()))?;
+			let size = parameter_names
+				.get(1)
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes three arguments (the file to read from, the size to read, and the return address), but only one argument was given\n", "File.read_chunk".bold().cyan()))?;
+			let return_address = parameter_names
+				.get(2)
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes three arguments (the file to read from, the size to read, and the return address), but only two arguments were given\n", "File.read_chunk".bold().cyan()))?;
+			Ok(format!("cabin_file_read_chunk({file}, {size}, {return_address});"))
+		},
+	},
+	"File.close" => BuiltinFunction {
+		compile_time: |_args| {
+			anyhow::bail!("The function \"{}\" can't be called at compile-time, because open files only exist at runtime.", "File.close".bold().cyan())
+		},
+		to_c: |parameter_names| {
+			let file = parameter_names
+				.first()
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes one argument (the file to close), but no arguments were given\n", "File.close".bold().cyan()))?;
+			Ok(format!("cabin_file_close({file});"))
+		},
+	},
+	"File.map" => BuiltinFunction {
+		compile_time: |args| {
+			let path = args
+				.first()
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the path of the file to map and the return address), but no arguments were given", "File.map".bold().cyan()))?
+				.as_string()
+				.map_err(|_error| anyhow::anyhow!("The first argument to \"{}\" must be Text", "File.map".bold().cyan()))?;
+
+			// There's no memory to map a file into at compile-time, so the file is just read
+			Ok(string!(std::fs::read_to_string(&path).map_err(|error| anyhow::anyhow!("Error reading file: {error}\n\n\t{}", format!("while calling built-in the function \"{}\" at compile-time with the path \"{}\"", "File.map".bold().cyan(), path.bold().cyan()).dimmed()))?))
+		},
+		to_c: |parameter_names| {
+			let path = parameter_names
+				.first()
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the path of the file to map and the return address), but no arguments were given\n", "File.map".bold().cyan()))?;
+			let return_address = parameter_names
+				.get(1)
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the path of the file to map and the return address), but only one argument was given\n", "File.map".bold().cyan()))?;
+
+			// The file is mapped over the start of an anonymous mapping that's one byte larger than it, so the byte after the file is always a zero
+			// that ends the Text, even when the size of the file is a multiple of the page size.
+			Ok(unindent::unindent(&format!(
+				r#"
+				int descriptor = open(cabin_text_data({path}), O_RDONLY);
+				struct stat status;
+				if (descriptor < 0 || fstat(descriptor, &status) != 0) {{
+					fprintf(stderr, "Error: Couldn't open the file \"%s\"\n", cabin_text_data({path}));
+					exit(1);
+				}}
+
+				char* contents = mmap(NULL, status.st_size + 1, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				if (contents == MAP_FAILED || (status.st_size > 0 && mmap(contents, status.st_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, descriptor, 0) == MAP_FAILED)) {{
+					fprintf(stderr, "Error: Couldn't map the file \"%s\" into memory\n", cabin_text_data({path}));
+					exit(1);
+				}}
+				close(descriptor);
+
+				cabin_text_borrow({return_address}, contents, status.st_size);
 				"#
 			)))
 		},
@@ -397,12 +774,15 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 		to_c: |parameter_names| {
 			let path = parameter_names
 				.first()
-				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the list to append to and the element to append), but no arguments were given", "List.append".bold().cyan()))?;
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the path of the file and the Text to write), but no arguments were given", "File.write".bold().cyan()))?;
+			let content = parameter_names
+				.get(1)
+				.ok_or_else(|| anyhow::anyhow!("The function \"{}\" takes two arguments (the path of the file and the Text to write), but only one argument was given", "File.write".bold().cyan()))?;
 
 			Ok(unindent::unindent(&format!(
 				r#"
-				FILE* file = fopen({path}->internal_value, "w");
-				fprintf(file, "Some text");
+				FILE* file = fopen(cabin_text_data({path}), "w");
+				fwrite(cabin_text_data({content}), 1, cabin_text_length({content}), file);
 				fclose(file);
 				"#
 			)))
@@ -424,7 +804,7 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 			Ok(unindent::unindent(&format!(
 				"
 				struct stat buffer;
-				*{return_address} = stat({path}->internal_value, &buffer) == 0;
+				*{return_address} = stat(cabin_text_data({path}), &buffer) == 0;
 				"
 			)))
 		},
@@ -482,11 +862,49 @@ static BUILTINS: phf::Map<&'static str, BuiltinFunction> = phf::phf_map! {
 /// # Returns
 /// The return value of the builtin function.
 pub fn call_builtin_at_compile_time(name: &str, args: &mut [Expression]) -> anyhow::Result<Expression> {
+	record_compile_time_call(name);
 	BUILTINS
 		.get(name)
 		.map_or_else(|| anyhow::bail!("Unknown builtin: {name}"), |builtin| (builtin.compile_time)(args))
 }
 
+/// Returns the index of the builtin function with the given name, which is used to call it with `call_builtin_by_index()`. This lets compile-time
+/// bytecode look up a builtin once when it's compiled, instead of by name on every call (see `bytecode::Instruction::CallBuiltin`).
+///
+/// # Parameters
+/// - `name` - The name of the builtin function.
+///
+/// # Returns
+/// The index of the builtin function, or `None` if no builtin function has the given name.
+#[must_use]
+pub fn builtin_index(name: &str) -> Option<usize> {
+	BUILTINS.get_index(name)
+}
+
+/// Calls the builtin function with the given index (see `builtin_index()`) and arguments at compile-time, and returns the result. This is the same as
+/// `call_builtin_at_compile_time()`, but without looking up the builtin by its name.
+///
+/// # Parameters
+/// - `index` - The index of the builtin function to call.
+/// - `args` - The arguments to pass to the builtin function.
+///
+/// # Returns
+/// The return value of the builtin function.
+///
+/// # Errors
+/// If no builtin function has the given index, or the builtin function returned an error.
+pub fn call_builtin_by_index(index: usize, args: &mut [Expression]) -> anyhow::Result<Expression> {
+	BUILTINS
+		.index(index)
+		.map_or_else(
+			|| anyhow::bail!("Unknown builtin index: {index}"),
+			|(name, builtin)| {
+				record_compile_time_call(name);
+				(builtin.compile_time)(args)
+			},
+		)
+}
+
 /// Converts a builtin function to C code. This should be used during the transpilation step of the compiler, when converting the
 /// Cabin code to C code. To call a builtin function at compile-time, use `call_builtin_at_compile_time`.
 ///
@@ -0,0 +1,841 @@
+use crate::{
+	boolean,
+	compile_time::{
+		builtin::{builtin_index, call_builtin_by_index},
+		memo::{is_fully_known, MAX_REFERENCE_DEPTH},
+		CompileTime as _,
+	},
+	context::Context,
+	lexer::TokenType,
+	number,
+	parser::{
+		expressions::{
+			function_call::FunctionCall,
+			literals::{function_declaration::FunctionDeclaration, Literal, LiteralValue},
+			util::name::Name,
+			Expression,
+		},
+		statements::Statement,
+	},
+};
+
+use std::{collections::HashMap, sync::Arc};
+
+use colored::Colorize as _;
+
+/// A register of the compile-time virtual machine. Registers hold the values of variables and the intermediate results of expressions while bytecode
+/// runs. Each variable and each intermediate result gets its own register, so bytecode never has to save or restore a register.
+type Register = u16;
+
+/// A value in a register of the compile-time virtual machine. Numbers and booleans are stored unboxed, so arithmetic and conditions don't create any
+/// objects or look up any fields; Any other value is stored as the expression that it was evaluated to, and is only passed along to builtin functions.
+#[derive(Clone, Debug)]
+enum Value {
+	/// A number.
+	Number(f64),
+	/// A boolean, which is one of the global variables `true` and `false` outside of the virtual machine.
+	Boolean(bool),
+	/// Any other value that's fully known at compile-time, such as a piece of text or a list.
+	Object(Expression),
+}
+
+/// The type of the values that a register of the compile-time virtual machine holds. Every register holds values of a single type for as long as the
+/// bytecode runs, so the compiler knows which operations the virtual machine can run directly on a register, and leaves any other operation to the
+/// tree-walking interpreter instead of failing while the bytecode runs.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+enum ValueType {
+	/// The register holds numbers.
+	Number,
+	/// The register holds booleans.
+	Boolean,
+	/// The register holds any other values, or values whose type isn't known until the bytecode runs, such as the return values of builtin functions.
+	Other,
+}
+
+impl Value {
+	/// Returns the value of an expression, following variable references to the values that they refer to.
+	///
+	/// # Parameters
+	/// - `expression` - The expression to get the value of.
+	/// - `context` - The global compiler context, which is used to resolve variable references.
+	///
+	/// # Returns
+	/// The value of the expression, or `None` if the expression isn't fully known at compile-time.
+	fn from_expression(expression: &Expression, context: &mut Context) -> Option<Self> {
+		let resolved = resolve(expression, context)?;
+		if let Expression::Literal(Literal(LiteralValue::VariableReference(variable_reference), ..)) = &resolved {
+			return match variable_reference.name().cabin_name() {
+				"true" => Some(Self::Boolean(true)),
+				"false" => Some(Self::Boolean(false)),
+				_ => None,
+			};
+		}
+		if let Ok(number) = resolved.as_number() {
+			return Some(Self::Number(number));
+		}
+		is_fully_known(&resolved, context).then_some(Self::Object(resolved))
+	}
+
+	/// Returns the value that a builtin function returned. Unlike `from_expression()`, this never fails, because the return value of a builtin function
+	/// is always fully known.
+	///
+	/// # Parameters
+	/// - `expression` - The return value of the builtin function.
+	/// - `context` - The global compiler context, which is used to resolve variable references.
+	///
+	/// # Returns
+	/// The value that the builtin function returned.
+	fn from_return_value(expression: Expression, context: &mut Context) -> Self {
+		Self::from_expression(&expression, context).unwrap_or(Self::Object(expression))
+	}
+
+	/// Converts this value back into an expression, so it can be stored in a variable or passed to a builtin function.
+	///
+	/// # Returns
+	/// The expression for this value.
+	fn into_expression(self) -> Expression {
+		match self {
+			Self::Number(number) => number!(number),
+			Self::Boolean(value) => boolean!(value),
+			Self::Object(expression) => expression,
+		}
+	}
+
+	/// Returns the type of this value, which is the type of the register that it's loaded into.
+	///
+	/// # Returns
+	/// The type of this value.
+	const fn value_type(&self) -> ValueType {
+		match self {
+			Self::Number(_) => ValueType::Number,
+			Self::Boolean(_) => ValueType::Boolean,
+			Self::Object(_) => ValueType::Other,
+		}
+	}
+
+	/// Returns the name of the type of this value, which is used in error messages.
+	///
+	/// # Returns
+	/// The name of the value's type.
+	fn type_name(&self) -> &'static str {
+		match self {
+			Self::Number(_) => "Number",
+			Self::Boolean(_) => "Boolean",
+			Self::Object(Expression::Literal(Literal(LiteralValue::Object(object), ..))) => object.name.cabin_name(),
+			Self::Object(_) => "Anything",
+		}
+	}
+}
+
+/// An operation on two values in registers. The virtual machine runs these directly on unboxed numbers, instead of calling a function on the `Number`
+/// group like the compile-time tree-walking interpreter would.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum Operation {
+	/// Adds two numbers.
+	Plus,
+	/// Subtracts a number from another.
+	Minus,
+	/// Multiplies two numbers.
+	Times,
+	/// Divides a number by another.
+	DividedBy,
+	/// Checks whether two numbers or two booleans are equal.
+	Equals,
+	/// Checks whether a number is less than another.
+	LessThan,
+	/// Checks whether a number is greater than another.
+	GreaterThan,
+}
+
+impl Operation {
+	/// Returns the operation that a binary operator performs.
+	///
+	/// # Parameters
+	/// - `operator` - The type of the binary operator's token.
+	///
+	/// # Returns
+	/// The operation, or `None` if the operator isn't an arithmetic or comparison operator.
+	#[must_use]
+	pub const fn from_operator(operator: TokenType) -> Option<Self> {
+		Some(match operator {
+			TokenType::Plus => Self::Plus,
+			TokenType::Minus => Self::Minus,
+			TokenType::Asterisk => Self::Times,
+			TokenType::ForwardSlash => Self::DividedBy,
+			TokenType::DoubleEquals => Self::Equals,
+			TokenType::LessThan => Self::LessThan,
+			TokenType::GreaterThan => Self::GreaterThan,
+			_ => return None,
+		})
+	}
+
+	/// Returns the type of the result of this operation on registers of the given types.
+	///
+	/// # Parameters
+	/// - `left` - The type of the register on the left of the operator.
+	/// - `right` - The type of the register on the right of the operator.
+	///
+	/// # Returns
+	/// The type of the result, or `None` if the virtual machine can't perform this operation on values of these types, such as adding two pieces of text,
+	/// which is done by calling a function of their group instead.
+	const fn result_type(self, left: ValueType, right: ValueType) -> Option<ValueType> {
+		match (self, left, right) {
+			(Self::Plus | Self::Minus | Self::Times | Self::DividedBy, ValueType::Number, ValueType::Number) => Some(ValueType::Number),
+			(Self::LessThan | Self::GreaterThan | Self::Equals, ValueType::Number, ValueType::Number) | (Self::Equals, ValueType::Boolean, ValueType::Boolean) => {
+				Some(ValueType::Boolean)
+			},
+			_ => None,
+		}
+	}
+
+	/// Performs this operation on two numbers.
+	///
+	/// # Parameters
+	/// - `left` - The number on the left of the operator.
+	/// - `right` - The number on the right of the operator.
+	///
+	/// # Returns
+	/// The result of the operation.
+	fn on_numbers(self, left: f64, right: f64) -> Value {
+		match self {
+			Self::Plus => Value::Number(left + right),
+			Self::Minus => Value::Number(left - right),
+			Self::Times => Value::Number(left * right),
+			Self::DividedBy => Value::Number(left / right),
+			// Numbers are compared the same way as by the `Number.equals` builtin
+			Self::Equals => Value::Boolean((left - right).abs() < f64::EPSILON),
+			Self::LessThan => Value::Boolean(left < right),
+			Self::GreaterThan => Value::Boolean(left > right),
+		}
+	}
+
+	/// Performs this operation on two values.
+	///
+	/// # Parameters
+	/// - `left` - The value on the left of the operator.
+	/// - `right` - The value on the right of the operator.
+	///
+	/// # Returns
+	/// The result of the operation.
+	///
+	/// # Errors
+	/// If the operation isn't defined on values of the given types.
+	fn apply(self, left: &Value, right: &Value) -> anyhow::Result<Value> {
+		match (left, right) {
+			(Value::Number(left_number), Value::Number(right_number)) => Ok(self.on_numbers(*left_number, *right_number)),
+			(Value::Boolean(left_boolean), Value::Boolean(right_boolean)) if self == Self::Equals => Ok(Value::Boolean(left_boolean == right_boolean)),
+			_ => anyhow::bail!(
+				"The operation \"{}\" can't be performed on a value of type \"{}\" and a value of type \"{}\"",
+				format!("{self:?}").bold().cyan(),
+				left.type_name().bold().cyan(),
+				right.type_name().bold().cyan()
+			),
+		}
+	}
+}
+
+/// Performs an arithmetic or comparison operation on two numbers at compile-time, without calling a function on the `Number` group. This is used by the
+/// tree-walking interpreter, so that operations on known numbers outside of compiled bytecode are just as direct as operations inside of it.
+///
+/// # Parameters
+/// - `operator` - The type of the binary operator's token.
+/// - `left` - The expression on the left of the operator, after being evaluated at compile-time.
+/// - `right` - The expression on the right of the operator, after being evaluated at compile-time.
+/// - `context` - The global compiler context, which is used to resolve variable references.
+///
+/// # Returns
+/// The result of the operation, or `None` if the operator isn't an arithmetic or comparison operator or either side isn't a known number.
+pub fn evaluate_number_operation(operator: TokenType, left: &Expression, right: &Expression, context: &mut Context) -> Option<Expression> {
+	let operation = Operation::from_operator(operator)?;
+	let left_number = resolve(left, context)?.as_number().ok()?;
+	let right_number = resolve(right, context)?.as_number().ok()?;
+	Some(operation.on_numbers(left_number, right_number).into_expression())
+}
+
+/// An instruction of compile-time bytecode. Instructions refer to registers, constants and other instructions by index, so each one is a few bytes and
+/// running one never looks up a name or walks the AST.
+#[derive(Clone, Copy, Debug)]
+enum Instruction {
+	/// Loads a constant into a register.
+	Constant {
+		/// The register to load the constant into.
+		destination: Register,
+		/// The index of the constant in `Bytecode::constants`.
+		constant: u32,
+	},
+	/// Copies the value of a register into another register.
+	Move {
+		/// The register to copy the value into.
+		destination: Register,
+		/// The register to copy the value from.
+		source: Register,
+	},
+	/// Performs an operation on the values of two registers.
+	Operation {
+		/// The operation to perform.
+		operation: Operation,
+		/// The register to store the result in.
+		destination: Register,
+		/// The register with the value on the left of the operator.
+		left: Register,
+		/// The register with the value on the right of the operator.
+		right: Register,
+	},
+	/// Continues running at another instruction.
+	Jump {
+		/// The index of the instruction to continue at.
+		target: u32,
+	},
+	/// Continues running at another instruction if the value of a register is `false`.
+	JumpUnless {
+		/// The register with the condition, which must be a boolean.
+		condition: Register,
+		/// The index of the instruction to continue at if the condition is false.
+		target: u32,
+	},
+	/// Calls a builtin function by its index (see `builtin::builtin_index()`).
+	CallBuiltin {
+		/// The index of the builtin function.
+		builtin: u16,
+		/// The first of the registers that hold the arguments, which are consecutive.
+		arguments: Register,
+		/// The number of arguments.
+		count: u8,
+		/// The register to store the return value in.
+		destination: Register,
+		/// Whether the builtin function is tagged with `system_side_effects`, which is recorded so that calls that run this aren't memoized.
+		has_side_effects: bool,
+	},
+}
+
+/// A variable declared outside of the code that was compiled into bytecode, which the bytecode uses. The variable's value is loaded into its register
+/// before the bytecode runs, and is written back to the variable afterwards if the bytecode assigns to it.
+#[derive(Debug)]
+struct OuterVariable {
+	/// The name of the variable.
+	name: Name,
+	/// The ID of a scope that the variable is visible in, which is used to find its declaration.
+	scope_id: usize,
+	/// The register that holds the variable's value.
+	register: Register,
+	/// The value of the variable before the bytecode runs.
+	value: Value,
+	/// Whether the bytecode assigns to the variable.
+	is_assigned: bool,
+}
+
+/// Compiled compile-time bytecode, along with the constants and outer variables that it uses.
+#[derive(Debug, Default)]
+struct Bytecode {
+	/// The instructions, which are run in order starting with the first one, except where an instruction jumps.
+	instructions: Vec<Instruction>,
+	/// The constants that are loaded by `Instruction::Constant`.
+	constants: Vec<Value>,
+	/// The variables declared outside of the bytecode that it uses.
+	outer_variables: Vec<OuterVariable>,
+	/// The number of registers the bytecode uses.
+	register_count: usize,
+}
+
+impl Bytecode {
+	/// Runs this bytecode in the compile-time virtual machine.
+	///
+	/// # Parameters
+	/// - `context` - The global compiler context, which is used by the values that builtin functions return.
+	///
+	/// # Returns
+	/// The values of the registers when the bytecode finished running. Each instruction that's run is a step of compile-time evaluation (see
+	/// `Context::compile_time_step()`).
+	///
+	/// # Errors
+	/// If an operation was performed on values that it's not defined on, a condition wasn't a boolean, a builtin function returned an error, or
+	/// compile-time evaluation went over its budget.
+	fn run(&self, context: &mut Context) -> anyhow::Result<Vec<Value>> {
+		let mut registers = vec![Value::Boolean(false); self.register_count];
+		for variable in &self.outer_variables {
+			*register_mut(&mut registers, variable.register)? = variable.value.clone();
+		}
+
+		let mut position = 0;
+		while let Some(instruction) = self.instructions.get(position) {
+			context.compile_time_step()?;
+			position += 1;
+			match *instruction {
+				Instruction::Constant { destination, constant } => {
+					let value = self
+						.constants
+						.get(constant as usize)
+						.ok_or_else(|| anyhow::anyhow!("Attempted to load the constant {constant} in compile-time bytecode, but no such constant exists"))?
+						.clone();
+					*register_mut(&mut registers, destination)? = value;
+				},
+				Instruction::Move { destination, source } => {
+					let value = register(&registers, source)?.clone();
+					*register_mut(&mut registers, destination)? = value;
+				},
+				Instruction::Operation {
+					operation,
+					destination,
+					left,
+					right,
+				} => {
+					let value = operation.apply(register(&registers, left)?, register(&registers, right)?)?;
+					*register_mut(&mut registers, destination)? = value;
+				},
+				Instruction::Jump { target } => position = target as usize,
+				Instruction::JumpUnless { condition, target } => match register(&registers, condition)? {
+					Value::Boolean(true) => {},
+					Value::Boolean(false) => position = target as usize,
+					other => anyhow::bail!(
+						"The condition of a loop or if expression must be a {}, but it's a value of type \"{}\"",
+						"Boolean".bold().cyan(),
+						other.type_name().bold().cyan()
+					),
+				},
+				Instruction::CallBuiltin {
+					builtin,
+					arguments,
+					count,
+					destination,
+					has_side_effects,
+				} => {
+					let mut argument_expressions = (arguments..arguments + Register::from(count))
+						.map(|argument| Ok(register(&registers, argument)?.clone().into_expression()))
+						.collect::<anyhow::Result<Vec<_>>>()?;
+					if has_side_effects {
+						context.call_cache.record_side_effect();
+					}
+					let return_value = call_builtin_by_index(usize::from(builtin), &mut argument_expressions)?;
+					*register_mut(&mut registers, destination)? = Value::from_return_value(return_value, context);
+				},
+			}
+		}
+
+		Ok(registers)
+	}
+}
+
+/// Returns the value of a register.
+///
+/// # Parameters
+/// - `registers` - The registers of the virtual machine.
+/// - `index` - The register to get the value of.
+///
+/// # Returns
+/// The value of the register.
+///
+/// # Errors
+/// If the register doesn't exist, which means the bytecode was compiled incorrectly.
+fn register(registers: &[Value], index: Register) -> anyhow::Result<&Value> {
+	registers
+		.get(usize::from(index))
+		.ok_or_else(|| anyhow::anyhow!("Attempted to read the register {index} in compile-time bytecode, but no such register exists"))
+}
+
+/// Returns a mutable reference to the value of a register (see `register()`).
+///
+/// # Parameters
+/// - `registers` - The registers of the virtual machine.
+/// - `index` - The register to get the value of.
+///
+/// # Returns
+/// A mutable reference to the value of the register.
+///
+/// # Errors
+/// If the register doesn't exist, which means the bytecode was compiled incorrectly.
+fn register_mut(registers: &mut [Value], index: Register) -> anyhow::Result<&mut Value> {
+	registers
+		.get_mut(usize::from(index))
+		.ok_or_else(|| anyhow::anyhow!("Attempted to write the register {index} in compile-time bytecode, but no such register exists"))
+}
+
+/// Follows variable references to the value that they refer to. References to `true` and `false` aren't followed, because they're booleans.
+///
+/// # Parameters
+/// - `expression` - The expression to resolve.
+/// - `context` - The global compiler context, which is used to find the values of variables.
+///
+/// # Returns
+/// The value that the expression refers to, or `None` if a variable it refers to doesn't exist or has no value.
+fn resolve(expression: &Expression, context: &Context) -> Option<Expression> {
+	let mut resolved = expression.clone();
+	for _ in 0..MAX_REFERENCE_DEPTH {
+		let Expression::Literal(Literal(LiteralValue::VariableReference(variable_reference), ..)) = &resolved else {
+			break;
+		};
+		if matches!(variable_reference.name().cabin_name(), "true" | "false") {
+			break;
+		}
+		resolved = context
+			.scope_data
+			.get_variable_from_id(variable_reference.name(), variable_reference.scope_id())?
+			.value
+			.clone()?;
+	}
+	Some(resolved)
+}
+
+/// Compiles statements into compile-time bytecode. Only the statements and expressions that bytecode can express are compiled: Declarations,
+/// assignments, arithmetic and comparisons, `if` expressions without a value, `while` loops, and calls to builtin functions. Compiling anything else, or
+/// code that uses a variable whose value isn't known at compile-time, fails, so that the code is left to the tree-walking interpreter instead.
+struct Compiler<'context> {
+	/// The global compiler context.
+	context: &'context mut Context,
+	/// Whether builtin functions with system side effects can be called, which is the same as in `CompileTime::compile_time_evaluate()`.
+	with_side_effects: bool,
+	/// The bytecode compiled so far.
+	bytecode: Bytecode,
+	/// The registers of the variables that the bytecode can use so far, keyed on their names. Cabin doesn't allow shadowing, so a name always refers to
+	/// the same variable.
+	registers: HashMap<Name, Register>,
+	/// The type of the values in each register, indexed by register.
+	register_types: Vec<ValueType>,
+}
+
+impl Compiler<'_> {
+	/// Returns a new register that isn't used for anything yet.
+	///
+	/// # Parameters
+	/// - `value_type` - The type of the values that the register holds.
+	///
+	/// # Returns
+	/// The new register, or `None` if the bytecode already uses the maximum number of registers.
+	fn new_register(&mut self, value_type: ValueType) -> Option<Register> {
+		let register = Register::try_from(self.bytecode.register_count).ok()?;
+		self.bytecode.register_count += 1;
+		self.register_types.push(value_type);
+		Some(register)
+	}
+
+	/// Returns the type of the values that a register holds.
+	///
+	/// # Parameters
+	/// - `register` - The register.
+	///
+	/// # Returns
+	/// The type of the register's values.
+	fn register_type(&self, register: Register) -> ValueType {
+		self.register_types.get(usize::from(register)).copied().unwrap_or(ValueType::Other)
+	}
+
+	/// Adds an instruction to the bytecode.
+	///
+	/// # Parameters
+	/// - `instruction` - The instruction to add.
+	///
+	/// # Returns
+	/// The index of the instruction, which is used to change the target of a jump once it's known (see `jump_here()`).
+	fn emit(&mut self, instruction: Instruction) -> usize {
+		self.bytecode.instructions.push(instruction);
+		self.bytecode.instructions.len() - 1
+	}
+
+	/// Makes a jump instruction jump to the next instruction that's added.
+	///
+	/// # Parameters
+	/// - `jump` - The index of the jump instruction.
+	///
+	/// # Returns
+	/// `Some(())`, or `None` if the bytecode has too many instructions to jump to the next one.
+	fn jump_here(&mut self, jump: usize) -> Option<()> {
+		let here = u32::try_from(self.bytecode.instructions.len()).ok()?;
+		if let Some(Instruction::Jump { target } | Instruction::JumpUnless { target, .. }) = self.bytecode.instructions.get_mut(jump) {
+			*target = here;
+		}
+		Some(())
+	}
+
+	/// Loads a constant into a new register.
+	///
+	/// # Parameters
+	/// - `value` - The value of the constant.
+	///
+	/// # Returns
+	/// The register that the constant is loaded into.
+	fn constant(&mut self, value: Value) -> Option<Register> {
+		let constant = u32::try_from(self.bytecode.constants.len()).ok()?;
+		let value_type = value.value_type();
+		self.bytecode.constants.push(value);
+		let destination = self.new_register(value_type)?;
+		self.emit(Instruction::Constant { destination, constant });
+		Some(destination)
+	}
+
+	/// Returns the register of a variable. A variable that's declared outside of the compiled code is given a register that its current value is loaded
+	/// into when the bytecode runs.
+	///
+	/// # Parameters
+	/// - `name` - The name of the variable.
+	/// - `scope_id` - The ID of the scope that the variable is referred to in.
+	///
+	/// # Returns
+	/// The register of the variable, or `None` if the variable's value isn't known at compile-time.
+	fn variable(&mut self, name: Name, scope_id: usize) -> Option<Register> {
+		if let Some(register) = self.registers.get(&name) {
+			return Some(*register);
+		}
+
+		let declared_value = self.context.scope_data.get_variable_from_id(&name, scope_id)?.value.clone()?;
+		if self.context.parameter_names.iter().any(|(parameter_name, _)| parameter_name == &name) {
+			return None;
+		}
+		let value = Value::from_expression(&declared_value, self.context)?;
+		let register = self.new_register(value.value_type())?;
+		self.bytecode.outer_variables.push(OuterVariable {
+			name,
+			scope_id,
+			register,
+			value,
+			is_assigned: false,
+		});
+		self.registers.insert(name, register);
+		Some(register)
+	}
+
+	/// Compiles a list of statements.
+	///
+	/// # Parameters
+	/// - `statements` - The statements to compile.
+	///
+	/// # Returns
+	/// `Some(())`, or `None` if any of the statements can't be compiled.
+	fn statements(&mut self, statements: &[Statement]) -> Option<()> {
+		statements.iter().try_for_each(|statement| self.statement(statement))
+	}
+
+	/// Compiles a statement.
+	///
+	/// # Parameters
+	/// - `statement` - The statement to compile.
+	///
+	/// # Returns
+	/// `Some(())`, or `None` if the statement can't be compiled.
+	fn statement(&mut self, statement: &Statement) -> Option<()> {
+		match statement {
+			Statement::Declaration(declaration) if declaration.tags.is_empty() => {
+				let value = self.expression(&declaration.initial_value)?;
+				let destination = self.new_register(self.register_type(value))?;
+				self.emit(Instruction::Move { destination, source: value });
+				self.registers.insert(declaration.name, destination);
+			},
+			Statement::WhileLoop(while_loop) => self.while_loop(&while_loop.condition, &while_loop.body.statements)?,
+			Statement::Expression(Expression::IfStatement(if_expression)) => {
+				let if_body = &if_expression.body;
+				let else_body = if_expression.else_body.as_deref().unwrap_or_default();
+				if if_body.iter().chain(else_body).any(|body_statement| matches!(body_statement, Statement::Tail(_))) {
+					return None;
+				}
+
+				let condition = self.expression(&if_expression.condition)?;
+				let skip_body = self.emit(Instruction::JumpUnless { condition, target: 0 });
+				self.statements(if_body)?;
+				let skip_else_body = self.emit(Instruction::Jump { target: 0 });
+				self.jump_here(skip_body)?;
+				self.statements(else_body)?;
+				self.jump_here(skip_else_body)?;
+			},
+			Statement::Expression(expression) => {
+				self.expression(expression)?;
+			},
+			Statement::Declaration(_) | Statement::ReturnStatement(_) | Statement::Tail(_) | Statement::ForEachLoop(_) => return None,
+		}
+		Some(())
+	}
+
+	/// Compiles a `while` loop.
+	///
+	/// # Parameters
+	/// - `condition` - The condition of the loop.
+	/// - `body` - The statements in the body of the loop.
+	///
+	/// # Returns
+	/// `Some(())`, or `None` if the loop can't be compiled.
+	fn while_loop(&mut self, condition: &Expression, body: &[Statement]) -> Option<()> {
+		let start = u32::try_from(self.bytecode.instructions.len()).ok()?;
+		let condition_register = self.expression(condition)?;
+		let exit = self.emit(Instruction::JumpUnless {
+			condition: condition_register,
+			target: 0,
+		});
+		self.statements(body)?;
+		self.emit(Instruction::Jump { target: start });
+		self.jump_here(exit)
+	}
+
+	/// Compiles an expression.
+	///
+	/// # Parameters
+	/// - `expression` - The expression to compile.
+	///
+	/// # Returns
+	/// The register that holds the value of the expression, or `None` if the expression can't be compiled.
+	fn expression(&mut self, expression: &Expression) -> Option<Register> {
+		match expression {
+			Expression::Literal(Literal(LiteralValue::VariableReference(variable_reference), ..)) => match variable_reference.name().cabin_name() {
+				"true" => self.constant(Value::Boolean(true)),
+				"false" => self.constant(Value::Boolean(false)),
+				_ => self.variable(*variable_reference.name(), variable_reference.scope_id()),
+			},
+			Expression::Literal(Literal(LiteralValue::Object(_), ..)) => {
+				let value = Value::from_expression(expression, self.context)?;
+				self.constant(value)
+			},
+			Expression::BinaryExpression(binary_expression) => {
+				if binary_expression.operator == TokenType::Equal {
+					let Expression::Literal(Literal(LiteralValue::VariableReference(variable_reference), ..)) = &binary_expression.left else {
+						return None;
+					};
+					let destination = self.variable(*variable_reference.name(), variable_reference.scope_id())?;
+					let source = self.expression(&binary_expression.right)?;
+					// Operations on the variable were compiled for the type of value it held before, so it can't be given a value of another type
+					if self.register_type(source) != self.register_type(destination) {
+						return None;
+					}
+					self.emit(Instruction::Move { destination, source });
+					if let Some(outer_variable) = self.bytecode.outer_variables.iter_mut().find(|outer_variable| outer_variable.register == destination) {
+						outer_variable.is_assigned = true;
+					}
+					return Some(destination);
+				}
+
+				let operation = Operation::from_operator(binary_expression.operator)?;
+				let left = self.expression(&binary_expression.left)?;
+				let right = self.expression(&binary_expression.right)?;
+				let result_type = operation.result_type(self.register_type(left), self.register_type(right))?;
+				let destination = self.new_register(result_type)?;
+				self.emit(Instruction::Operation {
+					operation,
+					destination,
+					left,
+					right,
+				});
+				Some(destination)
+			},
+			Expression::FunctionCall(function_call) => self.builtin_call(function_call),
+			Expression::Literal(_) | Expression::IfStatement(_) | Expression::Run(_) | Expression::Block(_) => None,
+		}
+	}
+
+	/// Compiles a call to a builtin function. The function that's called must be known without running any of the compiled code, such as
+	/// `terminal.print`, so that the builtin can be looked up once here instead of every time the call runs.
+	///
+	/// # Parameters
+	/// - `function_call` - The function call to compile.
+	///
+	/// # Returns
+	/// The register that holds the return value of the call, or `None` if the call can't be compiled.
+	fn builtin_call(&mut self, function_call: &FunctionCall) -> Option<Register> {
+		if self.refers_to_register(&function_call.function) {
+			return None;
+		}
+
+		let function = resolve(&function_call.function.compile_time_evaluate(self.context, false).ok()?, self.context)?;
+		let Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) = &function else {
+			return None;
+		};
+		let (builtin, has_side_effects) = self.callable_builtin(function_declaration)?;
+
+		let count = u8::try_from(function_call.arguments.len()).ok()?;
+		let arguments = Register::try_from(self.bytecode.register_count).ok()?;
+		for _ in 0..count {
+			self.new_register(ValueType::Other)?;
+		}
+		for (destination, argument) in (arguments..).zip(&function_call.arguments) {
+			let source = self.expression(argument)?;
+			self.emit(Instruction::Move { destination, source });
+		}
+
+		let destination = self.new_register(ValueType::Other)?;
+		self.emit(Instruction::CallBuiltin {
+			builtin,
+			arguments,
+			count,
+			destination,
+			has_side_effects,
+		});
+		Some(destination)
+	}
+
+	/// Returns the index of the builtin function that a function declaration is, if bytecode can call it.
+	///
+	/// # Parameters
+	/// - `function_declaration` - The function declaration of the called function.
+	///
+	/// # Returns
+	/// The index of the builtin function and whether it has system side effects, or `None` if the function isn't a builtin, has system side effects
+	/// that aren't allowed here, reads input, or is `runtime_only`, which the tree-walking interpreter warns about.
+	fn callable_builtin(&self, function_declaration: &Arc<FunctionDeclaration>) -> Option<(u16, bool)> {
+		let mut has_side_effects = false;
+		for tag in function_declaration.tags.iter() {
+			match tag {
+				Expression::Literal(Literal(LiteralValue::VariableReference(variable_reference), ..)) if variable_reference.name().cabin_name() == "system_side_effects" => {
+					has_side_effects = true;
+				},
+				Expression::Literal(Literal(LiteralValue::Object(object), ..)) if object.name.cabin_name() == "RuntimeOnlyTag" => return None,
+				_ => {},
+			}
+		}
+		if (has_side_effects && !self.with_side_effects) || function_declaration.name.as_deref() == Some("input") {
+			return None;
+		}
+
+		let builtin = u16::try_from(builtin_index(&function_declaration.builtin_name()?)?).ok()?;
+		Some((builtin, has_side_effects))
+	}
+
+	/// Returns whether an expression that a function call calls refers to a variable that has a register. The called function of a builtin call is found
+	/// when the call is compiled, so it can't depend on values that change while the bytecode runs.
+	///
+	/// # Parameters
+	/// - `function` - The expression that a function call calls.
+	///
+	/// # Returns
+	/// Whether the expression refers to a variable with a register, or isn't a variable or field access at all.
+	fn refers_to_register(&self, function: &Expression) -> bool {
+		match function {
+			Expression::Literal(Literal(LiteralValue::VariableReference(variable_reference), ..)) => self.registers.contains_key(variable_reference.name()),
+			Expression::BinaryExpression(binary_expression) if binary_expression.operator == TokenType::Dot => self.refers_to_register(&binary_expression.left),
+			_ => true,
+		}
+	}
+}
+
+/// Runs a `while` loop at compile-time in the bytecode virtual machine. The loop is compiled into bytecode along with everything in its body, and then
+/// run without walking the AST at all, so loops that run many times (such as ones that build lookup tables) don't evaluate their body's AST again on
+/// every iteration. When the loop finishes, the variables declared outside of it that it assigned to are given their final values.
+///
+/// # Parameters
+/// - `condition` - The condition of the loop.
+/// - `body` - The statements in the body of the loop.
+/// - `context` - The global compiler context.
+/// - `with_side_effects` - Whether builtin functions with system side effects can be called (see `CompileTime::compile_time_evaluate()`).
+///
+/// # Returns
+/// Whether the loop was run. A loop isn't run if it uses anything that bytecode can't express, or a variable whose value isn't known at compile-time,
+/// in which case it's left to run at runtime.
+///
+/// # Errors
+/// If an error occurred while running the loop, such as an operation on values that it isn't defined on or an error from a builtin function.
+pub fn run_while_loop(condition: &Expression, body: &[Statement], context: &mut Context, with_side_effects: bool) -> anyhow::Result<bool> {
+	let mut compiler = Compiler {
+		context,
+		with_side_effects,
+		bytecode: Bytecode::default(),
+		registers: HashMap::new(),
+		register_types: Vec::new(),
+	};
+	if compiler.while_loop(condition, body).is_none() {
+		return Ok(false);
+	}
+
+	let bytecode = compiler.bytecode;
+	let mut registers = bytecode.run(context)?;
+	for variable in bytecode.outer_variables.iter().filter(|variable| variable.is_assigned) {
+		let value = std::mem::replace(register_mut(&mut registers, variable.register)?, Value::Boolean(false));
+		if context.scope_data.is_global_variable(&variable.name, variable.scope_id) {
+			context.call_cache.record_global_write();
+		}
+		context.scope_data.reassign_variable_from_id(&variable.name, value.into_expression(), variable.scope_id)?;
+	}
+	Ok(true)
+}
@@ -0,0 +1,122 @@
+use crate::{
+	formatter::ToCabin as _,
+	parser::expressions::{
+		literals::{Literal, LiteralValue},
+		util::name::Name,
+		Expression,
+	},
+};
+
+use std::{collections::HashMap, fmt::Write as _};
+
+/// A cache of the instances of the functions in a program. A function declaration is evaluated at compile-time each time the code that declares it is
+/// evaluated, such as each time the group that it's a method of is evaluated, and each evaluation asks for an instance of the function to transpile into
+/// C. Instances are keyed on the function and the concrete types of its parameters (see `parameter_key()`), so asking for the same instance again returns
+/// the existing one instead of emitting a duplicate C function, and code that refers to the function refers to the shared instance.
+///
+/// Each instance has its own ID, which is used in the name of its C function. The first instance of a function uses the ID of the function's declaration,
+/// and any later instances with different parameter types are given new IDs.
+#[derive(Debug, Default)]
+pub struct FunctionInstances {
+	/// The ID of each instance, keyed on the ID of the function's declaration, and then on the key of the instance's parameter types.
+	instances: HashMap<usize, HashMap<String, usize>>,
+	/// The name of each function that has been instantiated and the number of times that an instance of it was asked for, keyed on the ID of the
+	/// function's declaration.
+	requests: HashMap<usize, (String, usize)>,
+	/// The number of C functions that were left out of the generated C code because their code is identical to the code of another function, and so were
+	/// replaced with it (see `reachability::fold_identical_functions()`).
+	folded: usize,
+}
+
+/// The number of times that instances of a single function were asked for while the program was evaluated, for the instantiation table of `--timings`.
+pub struct FunctionInstantiation {
+	/// The name of the function, as written in the generated C code without its ID.
+	pub name: String,
+	/// The number of times an instance of the function was asked for.
+	pub requests: usize,
+	/// The number of distinct instances of the function that were created.
+	pub instances: usize,
+}
+
+impl FunctionInstances {
+	/// Returns the instance of a function with the given parameter types, creating it if it doesn't exist yet.
+	///
+	/// # Parameters
+	/// - `function_id` - The ID of the function's declaration.
+	/// - `name` - The name of the function, which is shown in the instantiation table of `--timings`.
+	/// - `parameter_key` - The key of the concrete types of the instance's parameters (see `parameter_key()`).
+	/// - `new_id` - Returns a new unique function ID, which is called if this is a new instance of a function that already has an instance.
+	///
+	/// # Returns
+	/// The ID of the instance, and whether the instance was created by this call, in which case its C function still needs to be emitted.
+	pub fn instantiate(&mut self, function_id: usize, name: &str, parameter_key: String, new_id: impl FnOnce() -> usize) -> (usize, bool) {
+		self.requests.entry(function_id).or_insert_with(|| (name.to_owned(), 0)).1 += 1;
+
+		let instances = self.instances.entry(function_id).or_default();
+		if let Some(instance_id) = instances.get(&parameter_key) {
+			return (*instance_id, false);
+		}
+
+		let instance_id = if instances.is_empty() { function_id } else { new_id() };
+		instances.insert(parameter_key, instance_id);
+		(instance_id, true)
+	}
+
+	/// Records that C functions were left out of the generated C code because their code is identical to another function's.
+	///
+	/// # Parameters
+	/// - `count` - The number of C functions that were left out.
+	pub const fn record_folded(&mut self, count: usize) {
+		self.folded += count;
+	}
+
+	/// Returns the number of C functions that were left out of the generated C code because their code is identical to another function's.
+	#[must_use]
+	pub const fn folded(&self) -> usize {
+		self.folded
+	}
+
+	/// Returns the number of times that instances of each function were asked for, with the functions that were asked for most often first.
+	///
+	/// # Returns
+	/// The instantiations of each function.
+	#[must_use]
+	pub fn instantiations(&self) -> Vec<FunctionInstantiation> {
+		let mut instantiations = self
+			.requests
+			.iter()
+			.map(|(function_id, (name, requests))| FunctionInstantiation {
+				name: name.clone(),
+				requests: *requests,
+				instances: self.instances.get(function_id).map_or(0, HashMap::len),
+			})
+			.collect::<Vec<_>>();
+		instantiations.sort_by(|first, second| second.requests.cmp(&first.requests).then_with(|| first.name.cmp(&second.name)));
+		instantiations
+	}
+}
+
+/// Returns the key of the concrete parameters of an instance of a function, which is used to find the instance in `FunctionInstances`. Two instances with
+/// the same key have parameters with the same names and types, so they're transpiled into the same C function. Types that refer to a variable are keyed on
+/// the variable's name and the scope that it's declared in, so that different groups with the same name don't share a key.
+///
+/// # Parameters
+/// - `parameters` - The names and evaluated types of the instance's parameters.
+///
+/// # Returns
+/// The key of the parameters.
+#[must_use]
+pub fn parameter_key(parameters: &[(Name, Expression)]) -> String {
+	let mut key = String::new();
+	for (name, parameter_type) in parameters {
+		match parameter_type {
+			Expression::Literal(Literal(LiteralValue::VariableReference(variable), ..)) => {
+				write!(key, "{}:{}@{};", name.cabin_name(), variable.name().cabin_name(), variable.scope_id()).unwrap_or_else(|_error| unreachable!());
+			},
+			_ => {
+				write!(key, "{}:{};", name.cabin_name(), parameter_type.to_cabin()).unwrap_or_else(|_error| unreachable!());
+			},
+		}
+	}
+	key
+}
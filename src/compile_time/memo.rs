@@ -0,0 +1,209 @@
+use crate::{
+	context::Context,
+	parser::expressions::{
+		literals::{object::InternalValue, Literal, LiteralValue},
+		Expression,
+	},
+};
+
+use std::{collections::HashMap, fmt::Write as _};
+
+/// The maximum number of variable references that are followed when resolving an argument to the value it refers to. This only guards against variables
+/// that refer to each other in a cycle; Real arguments are resolved in one or two steps.
+pub const MAX_REFERENCE_DEPTH: usize = 64;
+
+/// A memo cache of the results of function calls evaluated at compile-time. Calling a function at compile-time evaluates its entire body, so recursive
+/// compile-time helpers (such as a function that builds a lookup table from smaller tables) can take exponential time if the same calls are evaluated over
+/// and over. This cache stores the return value of each call, keyed on the function that was called and the values of its arguments, so that each distinct
+/// call is only evaluated once.
+///
+/// Only calls whose arguments are all fully known at compile-time are cached, and only calls to functions that aren't tagged with `system_side_effects`
+/// and that don't call any such functions while they're evaluated. This assumes that such functions are pure, meaning their return value depends only on
+/// their arguments, which holds for functions declared in the global scope as long as none of the global variables that they can read are reassigned. Since
+/// a global variable can be reassigned at compile-time, every reassignment of one clears the cache, and calls that reassign one aren't cached.
+#[derive(Debug, Default)]
+pub struct CallCache {
+	/// The cached return values, keyed on the ID of the called function, and then on the structural key of its arguments (see `argument_key()`).
+	entries: HashMap<usize, HashMap<String, Expression>>,
+	/// The number of calls whose return value was found in the cache.
+	hits: usize,
+	/// The number of cacheable calls whose return value wasn't in the cache, and so had to be evaluated.
+	misses: usize,
+	/// The number of calls to functions tagged with `system_side_effects` that have been made at compile-time. A call is only cached if this doesn't
+	/// change while it's evaluated, which means that it didn't call any functions with side effects.
+	side_effects: usize,
+	/// The number of times a global variable has been reassigned at compile-time. A call is only cached if this doesn't change while it's evaluated, for the
+	/// same reason as `side_effects`.
+	global_writes: usize,
+}
+
+impl CallCache {
+	/// Looks up the cached return value of a function call, and records the lookup as a hit or a miss.
+	///
+	/// # Parameters
+	/// - `function_id` - The ID of the function being called.
+	/// - `argument_key` - The structural key of the call's arguments, as returned by `argument_key()`.
+	///
+	/// # Returns
+	/// The cached return value, or `None` if this call hasn't been cached.
+	pub fn get(&mut self, function_id: usize, argument_key: &str) -> Option<Expression> {
+		let cached = self.entries.get(&function_id).and_then(|calls| calls.get(argument_key)).cloned();
+		if cached.is_some() {
+			self.hits += 1;
+		} else {
+			self.misses += 1;
+		}
+		cached
+	}
+
+	/// Caches the return value of a function call.
+	///
+	/// # Parameters
+	/// - `function_id` - The ID of the function that was called.
+	/// - `argument_key` - The structural key of the call's arguments, as returned by `argument_key()`.
+	/// - `return_value` - The value that the call returned.
+	pub fn insert(&mut self, function_id: usize, argument_key: String, return_value: Expression) {
+		self.entries.entry(function_id).or_default().insert(argument_key, return_value);
+	}
+
+	/// Records that a function tagged with `system_side_effects` was called at compile-time, so that none of the calls currently being evaluated are
+	/// cached.
+	pub const fn record_side_effect(&mut self) {
+		self.side_effects += 1;
+	}
+
+	/// Records that a global variable was reassigned at compile-time. Cached calls may have read the variable's old value, so the cache is cleared, and
+	/// none of the calls currently being evaluated are cached.
+	pub fn record_global_write(&mut self) {
+		self.global_writes += 1;
+		self.entries.clear();
+	}
+
+	/// Returns the number of times a global variable has been reassigned at compile-time. This should be compared before and after evaluating a call to
+	/// check whether the call reassigned any global variables.
+	#[must_use]
+	pub const fn global_writes(&self) -> usize {
+		self.global_writes
+	}
+
+	/// Returns the number of calls to functions with side effects that have been made at compile-time. This should be compared before and after
+	/// evaluating a call to check whether the call had any side effects.
+	#[must_use]
+	pub const fn side_effects(&self) -> usize {
+		self.side_effects
+	}
+
+	/// Returns a summary of how effective the cache was, to be shown alongside the compiler's timings.
+	///
+	/// # Returns
+	/// The summary, or `None` if no cacheable calls were made.
+	#[must_use]
+	pub fn summary(&self) -> Option<String> {
+		(self.hits + self.misses > 0).then(|| format!("{} cached, {} evaluated", self.hits, self.misses))
+	}
+}
+
+/// Returns a structural key for the arguments of a function call. Two calls with the same key have arguments with the same values, so a pure function
+/// returns the same value for both. The key is an exact description of the arguments' values rather than a hash of them, so different arguments can never
+/// share a key.
+///
+/// # Parameters
+/// - `arguments` - The arguments of the call, after being evaluated at compile-time.
+/// - `context` - The global compiler context, which is used to resolve variable references to their values.
+///
+/// # Returns
+/// The key of the arguments, or `None` if any of the arguments isn't fully known at compile-time, in which case the call can't be cached.
+pub fn argument_key(arguments: &[Expression], context: &mut Context) -> Option<String> {
+	let mut key = String::new();
+	for argument in arguments {
+		write_value_key(argument, &mut key, context)?;
+		key.push(';');
+	}
+	Some(key)
+}
+
+/// Returns whether the given value is fully known at compile-time, meaning it can be stored in the cache as the return value of a call.
+///
+/// # Parameters
+/// - `value` - The value to check.
+/// - `context` - The global compiler context, which is used to resolve variable references to their values.
+///
+/// # Returns
+/// Whether the value is fully known.
+pub fn is_fully_known(value: &Expression, context: &mut Context) -> bool {
+	write_value_key(value, &mut String::new(), context).is_some()
+}
+
+/// Writes the structural key of a single value into the given key (see `argument_key()`).
+///
+/// # Parameters
+/// - `value` - The value to write the key of.
+/// - `key` - The key to append to.
+/// - `context` - The global compiler context, which is used to resolve variable references to their values.
+///
+/// # Returns
+/// `Some(())` if the value was written, or `None` if the value isn't fully known at compile-time.
+fn write_value_key(value: &Expression, key: &mut String, context: &mut Context) -> Option<()> {
+	let mut resolved = value.clone();
+	for _ in 0..MAX_REFERENCE_DEPTH {
+		let Expression::Literal(Literal(LiteralValue::VariableReference(variable_reference), ..)) = &resolved else {
+			break;
+		};
+		resolved = context
+			.scope_data
+			.get_variable_from_id(variable_reference.name(), variable_reference.scope_id())?
+			.value
+			.clone()?;
+	}
+
+	let Expression::Literal(literal) = &resolved else {
+		return None;
+	};
+
+	if literal.is(&context.unknown_at_compile_time().clone(), context).ok()? {
+		return None;
+	}
+
+	match literal.value() {
+		LiteralValue::Object(object) => {
+			write!(key, "{}{{", object.name.cabin_name()).ok()?;
+
+			// Internal fields are stored in a hash map, so they're sorted to give the same key regardless of insertion order
+			let mut internal_fields = object.internal_fields.iter().collect::<Vec<_>>();
+			internal_fields.sort_by(|first, second| first.0.cmp(second.0));
+			for (name, internal_value) in internal_fields {
+				write!(key, "{name}=").ok()?;
+				match internal_value {
+					// Strings are prefixed with their length, so a string can't be mistaken for the rest of the key
+					InternalValue::String(string) => write!(key, "{}:{string}", string.len()).ok()?,
+					// The bits of the number are used so that numbers are only equal if they're exactly equal
+					InternalValue::Number(number) => write!(key, "{:x}", number.to_bits()).ok()?,
+					InternalValue::List(elements) => {
+						key.push('[');
+						for element in elements {
+							write_value_key(element, key, context)?;
+							key.push(',');
+						}
+						key.push(']');
+					},
+				}
+				key.push(',');
+			}
+
+			for field in &object.fields {
+				write!(key, "{}=", field.name.cabin_name()).ok()?;
+				write_value_key(field.value.as_ref()?, key, context)?;
+				key.push(',');
+			}
+
+			key.push('}');
+		},
+
+		// Functions can't be compared structurally, but each function declaration has a unique ID
+		LiteralValue::FunctionDeclaration(function_declaration) => write!(key, "action#{}", function_declaration.id).ok()?,
+
+		LiteralValue::VariableReference(_) | LiteralValue::Group(_) | LiteralValue::Either(_) => return None,
+	}
+
+	Some(())
+}
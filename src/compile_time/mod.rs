@@ -3,12 +3,26 @@ use crate::{
 	parser::{expressions::Expression, statements::Statement},
 };
 
+use std::{fmt::Write as _, sync::Arc};
+
 /// The type tree module, which handles detection of circular dependencies in compile-time code.
 pub mod type_tree;
 
 /// The builtin module, which handles running built-in functions at compile-time and transpiling built-in functions to C code.
 pub mod builtin;
 
+/// The memo module, which caches the return values of pure function calls evaluated at compile-time.
+pub mod memo;
+
+/// The bytecode module, which compiles loops that are evaluated at compile-time into bytecode and runs them in a virtual machine.
+pub mod bytecode;
+
+/// The profiler module, which counts the steps taken by compile-time evaluation, stops it when it goes over its budget, and reports where the time went.
+pub mod profiler;
+
+/// The instances module, which caches the instances of functions that are transpiled into C, so that each one is only emitted once.
+pub mod instances;
+
 /// An expression which can be evaluated at compile-time. This is a trait applied to all expressions.
 #[enum_dispatch::enum_dispatch]
 pub trait CompileTime {
@@ -24,8 +38,8 @@ pub trait CompileTime {
 	fn compile_time_evaluate(&self, context: &mut Context, with_side_effects: bool) -> anyhow::Result<Expression>;
 }
 
-// Allow calling `to_c` and `c_prelude` on boxed types `Box<T>` when `T` implements `C`
-impl<T: CompileTime> CompileTime for Box<T> {
+// Allow compile-time evaluating shared AST nodes `Arc<T>` when `T` implements `CompileTime`
+impl<T: CompileTime> CompileTime for Arc<T> {
 	fn compile_time_evaluate(&self, context: &mut Context, with_side_effects: bool) -> anyhow::Result<Expression> {
 		self.as_ref().compile_time_evaluate(context, with_side_effects)
 	}
@@ -50,6 +64,9 @@ pub trait CompileTimeStatement {
 /// is a transpiled language, meaning that after lexing and parsing the code, it is transpiled into C before being compiled and run. This trait provides that
 /// mechanism. This trait also is `enum_dispatch`ed, meaning `Expression` implements it by calling it on any individual variant; The same goes for `Statement`.
 /// Thus, all `Statement`s and `Expression`s must implement this.
+///
+/// The `CWriter` in the signatures of `write_c()` and `write_c_prelude()` is written with its full path, because `enum_dispatch` and `ambassador` copy the
+/// signatures into the modules of the types that they're derived for.
 #[enum_dispatch::enum_dispatch]
 #[ambassador::delegatable_trait]
 pub trait TranspileToC {
@@ -75,10 +92,40 @@ pub trait TranspileToC {
 	/// # Returns
 	/// The C prelude code for this expression as a string, or an `Err` if an error occurred when converting this AST node into C code.
 	fn c_prelude(&self, context: &mut Context) -> anyhow::Result<String>;
+
+	/// Writes the C code of this AST node into a writer, indented at the writer's current indentation level. This writes the same code that `to_c()`
+	/// returns; By default, it's implemented by calling `to_c()`, but nodes with large or deeply nested output override it to write their code (and the
+	/// code of their child nodes) directly, without building intermediate strings.
+	///
+	/// # Parameters
+	/// - `writer` - The writer to write the C code into.
+	/// - `context` - The global context of the program. This holds important global information such as the current scope and stored variables of the program.
+	///
+	/// # Errors
+	/// If an error occurred when converting this AST node into C code, or the code couldn't be written.
+	fn write_c(&self, writer: &mut crate::emitter::CWriter<'_>, context: &mut Context) -> anyhow::Result<()> {
+		let c = self.to_c(context)?;
+		writer.write_str(&c)?;
+		Ok(())
+	}
+
+	/// Writes the C prelude of this AST node into a writer, in the same way that `write_c()` writes the code returned by `to_c()`.
+	///
+	/// # Parameters
+	/// - `writer` - The writer to write the C prelude into.
+	/// - `context` - The global context of the program. This holds important global information such as the current scope and stored variables of the program.
+	///
+	/// # Errors
+	/// If an error occurred when converting this AST node into C code, or the code couldn't be written.
+	fn write_c_prelude(&self, writer: &mut crate::emitter::CWriter<'_>, context: &mut Context) -> anyhow::Result<()> {
+		let prelude = self.c_prelude(context)?;
+		writer.write_str(&prelude)?;
+		Ok(())
+	}
 }
 
-// Allow calling `to_c` and `c_prelude` on boxed types `Box<T>` when `T` implements `C`
-impl<T: TranspileToC> TranspileToC for Box<T> {
+// Allow calling `to_c`, `c_prelude`, `write_c`, and `write_c_prelude` on shared AST nodes `Arc<T>` when `T` implements `C`
+impl<T: TranspileToC> TranspileToC for Arc<T> {
 	fn to_c(&self, context: &mut Context) -> anyhow::Result<String> {
 		self.as_ref().to_c(context)
 	}
@@ -86,6 +133,14 @@ impl<T: TranspileToC> TranspileToC for Box<T> {
 	fn c_prelude(&self, context: &mut Context) -> anyhow::Result<String> {
 		self.as_ref().c_prelude(context)
 	}
+
+	fn write_c(&self, writer: &mut crate::emitter::CWriter<'_>, context: &mut Context) -> anyhow::Result<()> {
+		self.as_ref().write_c(writer, context)
+	}
+
+	fn write_c_prelude(&self, writer: &mut crate::emitter::CWriter<'_>, context: &mut Context) -> anyhow::Result<()> {
+		self.as_ref().write_c_prelude(writer, context)
+	}
 }
 
 // This was driving me crazy trying to find this issue - these need to be declared *after* the traits!
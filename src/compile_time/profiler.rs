@@ -0,0 +1,452 @@
+use crate::timings::{current_memory, format_bytes, format_duration};
+
+use std::{
+	collections::HashMap,
+	fmt::Write as _,
+	time::{Duration, Instant},
+};
+
+use colored::Colorize as _;
+
+/// The number of steps between checks of the compiler's memory against the memory budget. Measuring the memory reads a file from the operating system, so
+/// it isn't measured on every step.
+const MEMORY_CHECK_INTERVAL: u64 = 1024;
+
+/// The maximum number of rows shown in each table of the profile summary. Rows are shown in order of how many steps they took, so these are the ones most
+/// likely to be making compile-time evaluation slow.
+const SUMMARY_ROWS: usize = 16;
+
+/// The function ID of the root frame of every call stack, which is the evaluation of the program's global statements.
+const GLOBAL_FUNCTION_ID: usize = usize::MAX;
+
+/// The limits on how much work compile-time evaluation can do before it's stopped. Compile-time code can run anything, so without these, a runaway
+/// compile-time function just hangs the build. Budgets are configured in the `[compile-time]` table of `cabin.toml`:
+///
+/// ```toml
+/// [compile-time]
+/// max-steps = 10000000  # The number of statements and bytecode instructions that can be evaluated
+/// max-memory = 4096     # The memory that compile-time evaluation can add to the compiler's, in mebibytes
+/// ```
+///
+/// Both budgets are unlimited if they aren't configured.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct CompileTimeBudget {
+	/// The maximum number of steps that compile-time evaluation can take (see `CompileTimeProfiler::step()`).
+	pub max_steps: Option<u64>,
+	/// The maximum memory that compile-time evaluation can add to the compiler's process, in bytes. This is measured from when compile-time evaluation
+	/// starts, so the memory used by the compiler itself, the parsed program, and earlier checks by a long-running check server doesn't count towards it.
+	pub max_memory: Option<u64>,
+}
+
+impl CompileTimeBudget {
+	/// Reads the compile-time budget from a project's configuration. Budgets that aren't configured are unlimited.
+	///
+	/// # Parameters
+	/// - `config` - The project's configuration, as read from `cabin.toml`.
+	///
+	/// # Returns
+	/// The compile-time budget of the project.
+	///
+	/// # Errors
+	/// If the `[compile-time]` table isn't a table, or has a field that's unknown or isn't a positive integer.
+	pub fn from_config(config: &toml_edit::DocumentMut) -> anyhow::Result<Self> {
+		let mut budget = Self::default();
+		let Some(budget_item) = config.get("compile-time") else {
+			return Ok(budget);
+		};
+		let Some(budget_config) = budget_item.as_table_like() else {
+			anyhow::bail!("Error reading configuration: [compile-time] is present, but it is not a table");
+		};
+
+		for (field, value) in budget_config.iter() {
+			let limit = value
+				.as_integer()
+				.and_then(|limit| u64::try_from(limit).ok())
+				.filter(|limit| *limit > 0)
+				.ok_or_else(|| anyhow::anyhow!("Error reading configuration: field \"{field}\" is present in [compile-time], but it is not a positive integer"))?;
+			match field {
+				"max-steps" => budget.max_steps = Some(limit),
+				"max-memory" => budget.max_memory = Some(limit.saturating_mul(1024 * 1024)),
+				_ => anyhow::bail!("Error reading configuration: Unknown field \"{field}\" in [compile-time]"),
+			}
+		}
+
+		Ok(budget)
+	}
+}
+
+/// A call stack that compile-time evaluation has been in. Call stacks are stored as a tree, where each frame is a child of the frame that called it, so
+/// entering a function that's been called from the same place before only looks up a child of the current frame.
+#[derive(Debug)]
+struct Frame {
+	/// The ID of the function that this frame is evaluating, or `GLOBAL_FUNCTION_ID` for the root frame.
+	function_id: usize,
+	/// The name of the function that this frame is evaluating, as shown in the profile.
+	name: String,
+	/// The frame that called this frame, or `None` for the root frame.
+	parent: Option<usize>,
+	/// The frames that this frame has called, keyed on the IDs of their functions.
+	children: HashMap<usize, usize>,
+	/// The number of times that this call stack was entered.
+	calls: u64,
+	/// The number of steps taken in this call stack, not including the steps taken in the frames that it called.
+	steps: u64,
+	/// The number of objects created in this call stack, not including the objects created in the frames that it called.
+	allocations: u64,
+	/// The time spent in this call stack, not including the time spent in the frames that it called. This is only measured when profiling is enabled.
+	time: Duration,
+}
+
+/// The work done at a single source location, which is the line of a declaration in a function, while profiling.
+#[derive(Debug, Default, Clone, Copy)]
+struct LocationProfile {
+	/// The number of steps taken at this location.
+	steps: u64,
+	/// The number of objects created at this location.
+	allocations: u64,
+}
+
+/// The work done by a single function, which is the sum of the work done by all of the call stacks that end in it.
+#[derive(Debug, Default)]
+struct FunctionProfile {
+	/// The name of the function.
+	name: String,
+	/// The number of times that the function was called.
+	calls: u64,
+	/// The number of steps taken in the function, not including the functions that it called.
+	steps: u64,
+	/// The number of objects created in the function, not including the functions that it called.
+	allocations: u64,
+	/// The time spent in the function, not including the functions that it called.
+	time: Duration,
+}
+
+/// The profiler of compile-time evaluation. This counts the steps that compile-time evaluation takes in each call stack, where a step is a single
+/// statement evaluated by the tree-walking interpreter or a single instruction run by the bytecode virtual machine (see `bytecode`), and stops
+/// evaluation when it goes over the project's budget (see `CompileTimeBudget`).
+///
+/// Steps are always counted, because the budget needs them and counting them is cheap. When profiling is enabled with `--profile-compile-time`, the
+/// profiler also measures the time spent in each call stack and the work done at each source location, which is reported with `report()`.
+#[derive(Debug)]
+pub struct CompileTimeProfiler {
+	/// The limits on the work done by compile-time evaluation.
+	budget: CompileTimeBudget,
+	/// Whether profiling is enabled, in which case time and source locations are measured too.
+	is_enabled: bool,
+	/// Every call stack that compile-time evaluation has been in. The first frame is the root frame that all call stacks start at.
+	frames: Vec<Frame>,
+	/// The index of the frame that's currently being evaluated.
+	current_frame: usize,
+	/// The lines that the frames on the current call stack were at when they called the next frame, from the outermost frame to the innermost.
+	call_lines: Vec<usize>,
+	/// The line of the declaration that's currently being evaluated in the current frame, or 0 if none has been evaluated yet.
+	current_line: usize,
+	/// The total number of steps taken.
+	steps: u64,
+	/// The memory that the compiler's process used when the first step was taken, which the memory budget is measured from. This is `None` until the
+	/// first step, or if there's no memory budget or the operating system doesn't report the memory.
+	baseline_memory: Option<u64>,
+	/// The work done at each source location, keyed on the ID of the function and the line of the location. This is only recorded when profiling is
+	/// enabled.
+	locations: HashMap<(usize, usize), LocationProfile>,
+	/// The time that the current frame was last entered or returned to, which is used to measure the time spent in each frame.
+	last_switch: Instant,
+}
+
+impl Default for CompileTimeProfiler {
+	fn default() -> Self {
+		Self::new(CompileTimeBudget::default(), false)
+	}
+}
+
+impl CompileTimeProfiler {
+	/// Creates a new profiler for compile-time evaluation.
+	///
+	/// # Parameters
+	/// - `budget` - The limits on the work done by compile-time evaluation.
+	/// - `is_enabled` - Whether to measure time and source locations, so that the profile can be reported with `report()`.
+	///
+	/// # Returns
+	/// The new profiler, with only the root frame on its call stack.
+	#[must_use]
+	pub fn new(budget: CompileTimeBudget, is_enabled: bool) -> Self {
+		Self {
+			budget,
+			is_enabled,
+			frames: vec![Frame {
+				function_id: GLOBAL_FUNCTION_ID,
+				name: "<global>".to_owned(),
+				parent: None,
+				children: HashMap::new(),
+				calls: 1,
+				steps: 0,
+				allocations: 0,
+				time: Duration::ZERO,
+			}],
+			current_frame: 0,
+			call_lines: Vec::new(),
+			current_line: 0,
+			steps: 0,
+			baseline_memory: None,
+			locations: HashMap::new(),
+			last_switch: Instant::now(),
+		}
+	}
+
+	/// Records that a function's body is being evaluated, making it the current frame until `exit()` is called. Every call to this must be followed by a
+	/// call to `exit()`, even if evaluating the function fails.
+	///
+	/// # Parameters
+	/// - `function_id` - The ID of the function.
+	/// - `name` - Returns the name of the function, which is only called the first time that the function is called from the current frame.
+	pub fn enter(&mut self, function_id: usize, name: impl FnOnce() -> String) {
+		self.switch_frames();
+		let next_index = self.frames.len();
+		let parent = self.current_frame;
+		let child = self
+			.frames
+			.get_mut(parent)
+			.map_or(next_index, |frame| *frame.children.entry(function_id).or_insert(next_index));
+		if child == next_index {
+			self.frames.push(Frame {
+				function_id,
+				name: name(),
+				parent: Some(parent),
+				children: HashMap::new(),
+				calls: 0,
+				steps: 0,
+				allocations: 0,
+				time: Duration::ZERO,
+			});
+		}
+		if let Some(frame) = self.frames.get_mut(child) {
+			frame.calls += 1;
+		}
+
+		self.call_lines.push(self.current_line);
+		self.current_line = 0;
+		self.current_frame = child;
+	}
+
+	/// Records that the function that was last entered with `enter()` has finished being evaluated, making the frame that called it the current frame again.
+	pub fn exit(&mut self) {
+		self.switch_frames();
+		if let Some(parent) = self.frames.get(self.current_frame).and_then(|frame| frame.parent) {
+			self.current_frame = parent;
+		}
+		self.current_line = self.call_lines.pop().unwrap_or_default();
+	}
+
+	/// Records that a declaration is being evaluated, so that the steps taken from now on in the current frame are attributed to its line.
+	///
+	/// # Parameters
+	/// - `line` - The line of the declaration in its file.
+	pub const fn set_line(&mut self, line: usize) {
+		self.current_line = line;
+	}
+
+	/// Records a step of compile-time evaluation, which is a single statement evaluated by the tree-walking interpreter or a single instruction run by the
+	/// bytecode virtual machine, and checks that compile-time evaluation is still within its budget. This should be called through
+	/// `Context::compile_time_step()`, which adds the details of the hottest call stacks to the error if the budget is exceeded.
+	///
+	/// # Errors
+	/// If compile-time evaluation has gone over its step or memory budget.
+	pub fn step(&mut self) -> anyhow::Result<()> {
+		self.steps += 1;
+		if let Some(frame) = self.frames.get_mut(self.current_frame) {
+			frame.steps += 1;
+		}
+		if self.is_enabled {
+			self.current_location().steps += 1;
+		}
+
+		if let Some(max_steps) = self.budget.max_steps {
+			if self.steps > max_steps {
+				anyhow::bail!(
+					"Compile-time evaluation went over its budget of {} steps, so it was stopped. This usually means that code run at compile-time never finishes; \
+					 If it's just slow, raise \"{}\" in the [compile-time] table of cabin.toml.",
+					max_steps.to_string().bold().cyan(),
+					"max-steps".bold().cyan()
+				);
+			}
+		}
+
+		if let Some(max_memory) = self.budget.max_memory {
+			if self.steps == 1 {
+				self.baseline_memory = current_memory();
+			} else if self.steps.is_multiple_of(MEMORY_CHECK_INTERVAL) {
+				let growth = self.baseline_memory.zip(current_memory()).map(|(baseline, memory)| memory.saturating_sub(baseline));
+				if let Some(growth) = growth.filter(|growth| *growth > max_memory) {
+					anyhow::bail!(
+						"Compile-time evaluation went over its memory budget of {} (it has used {} more than when it started), so it was stopped. If the \
+						 program really needs this much memory at compile-time, raise \"{}\" in the [compile-time] table of cabin.toml.",
+						format_bytes(max_memory).bold().cyan(),
+						format_bytes(growth).bold().cyan(),
+						"max-memory".bold().cyan()
+					);
+				}
+			}
+		}
+
+		Ok(())
+	}
+
+	/// Records that an object was created at compile-time.
+	pub fn record_allocation(&mut self) {
+		if let Some(frame) = self.frames.get_mut(self.current_frame) {
+			frame.allocations += 1;
+		}
+		if self.is_enabled {
+			self.current_location().allocations += 1;
+		}
+	}
+
+	/// Returns a description of the call stack that took the most steps and of the call stack that's currently being evaluated, which is shown with an
+	/// error when compile-time evaluation goes over its budget.
+	///
+	/// # Returns
+	/// The description of the call stacks.
+	#[must_use]
+	pub fn budget_details(&self) -> String {
+		let hottest_frame = self.frames.iter().enumerate().max_by_key(|(_index, frame)| frame.steps).map_or(0, |(index, _frame)| index);
+		let hottest_steps = self.frames.get(hottest_frame).map_or(0, |frame| frame.steps);
+
+		let mut details = format!(
+			"The call stack that took the most steps at compile-time took {} of the {} steps taken, outermost first:\n",
+			hottest_steps.to_string().bold().cyan(),
+			self.steps.to_string().bold().cyan()
+		);
+		for (depth, frame) in self.stack_of(hottest_frame).iter().enumerate() {
+			writeln!(details, "\t{}{}", "  ".repeat(depth), frame.name.bold().white()).unwrap_or_else(|_error| unreachable!());
+		}
+
+		details.push_str("\nThe call stack that was being evaluated when compile-time evaluation was stopped, outermost first:\n");
+		let lines = self.call_lines.iter().chain(std::iter::once(&self.current_line));
+		for (depth, (frame, line)) in self.stack_of(self.current_frame).iter().zip(lines).enumerate() {
+			let location = if *line == 0 { String::new() } else { format!(" (at line {line})") };
+			writeln!(details, "\t{}{}{}", "  ".repeat(depth), frame.name.bold().white(), location.dimmed()).unwrap_or_else(|_error| unreachable!());
+		}
+
+		details.trim_end().to_owned()
+	}
+
+	/// Reports the profile of compile-time evaluation, as asked for by `--profile-compile-time`. A table of the functions and source locations that took
+	/// the most steps is printed, and every call stack is written to the given file in the folded stack format, with the number of steps taken in each
+	/// call stack as its weight. The folded stack format can be turned into a flamegraph by `inferno-flamegraph`, `flamegraph.pl`, or speedscope.
+	/// Nothing is reported if profiling isn't enabled. The table is printed even in quiet mode, because the profile is only recorded when it's explicitly
+	/// asked for.
+	///
+	/// # Parameters
+	/// - `path` - The path of the file to write the folded call stacks to. The file is overwritten if it already exists.
+	///
+	/// # Errors
+	/// If the file couldn't be written.
+	pub fn report(&mut self, path: &str) -> anyhow::Result<()> {
+		if !self.is_enabled {
+			return Ok(());
+		}
+		self.switch_frames();
+
+		self.print_functions();
+		self.print_locations();
+
+		let mut folded = String::new();
+		for (index, frame) in self.frames.iter().enumerate().filter(|(_index, frame)| frame.steps > 0) {
+			let stack = self.stack_of(index).iter().map(|stack_frame| stack_frame.name.replace([';', ' '], "_")).collect::<Vec<_>>();
+			writeln!(folded, "{} {}", stack.join(";"), frame.steps)?;
+		}
+		std::fs::write(path, folded).map_err(|error| anyhow::anyhow!("Error writing the compile-time profile to \"{path}\": {error}"))
+	}
+
+	/// Prints a table of the functions that took the most steps at compile-time.
+	fn print_functions(&self) {
+		let mut functions_by_id = HashMap::<usize, FunctionProfile>::new();
+		for frame in &self.frames {
+			let function = functions_by_id.entry(frame.function_id).or_default();
+			function.name.clone_from(&frame.name);
+			function.calls += frame.calls;
+			function.steps += frame.steps;
+			function.allocations += frame.allocations;
+			function.time += frame.time;
+		}
+		let mut functions = functions_by_id.into_values().collect::<Vec<_>>();
+		functions.sort_by(|first, second| second.steps.cmp(&first.steps).then_with(|| first.name.cmp(&second.name)));
+
+		println!(
+			"\n{} {}",
+			"Compile-Time Profile:".bold().green(),
+			format!("({} steps)", self.steps).truecolor(100, 100, 100)
+		);
+		println!(
+			"{}",
+			format!("\t{:<28}{:>10}{:>12}{:>14}{:>12}", "Function", "Calls", "Steps", "Allocations", "Time").bold()
+		);
+		for function in functions.iter().take(SUMMARY_ROWS) {
+			println!(
+				"\t{:<28}{:>10}{:>12}{:>14}{:>12}",
+				function.name,
+				function.calls,
+				function.steps,
+				function.allocations,
+				format_duration(function.time)
+			);
+		}
+		println!();
+	}
+
+	/// Prints a table of the source locations that took the most steps at compile-time.
+	fn print_locations(&self) {
+		let mut locations = self.locations.iter().filter(|((_function_id, line), _location)| *line != 0).collect::<Vec<_>>();
+		if locations.is_empty() {
+			return;
+		}
+		locations.sort_by(|first, second| second.1.steps.cmp(&first.1.steps).then_with(|| first.0.cmp(second.0)));
+
+		println!("{}", format!("\t{:<38}{:>12}{:>14}", "Location", "Steps", "Allocations").bold());
+		for ((function_id, line), location) in locations.into_iter().take(SUMMARY_ROWS) {
+			let function_name = self.frames.iter().find(|frame| frame.function_id == *function_id).map_or("", |frame| frame.name.as_str());
+			println!("\t{:<38}{:>12}{:>14}", format!("{function_name} line {line}"), location.steps, location.allocations);
+		}
+		println!();
+	}
+
+	/// Returns the frames of the call stack that ends at the given frame, starting from the root frame.
+	///
+	/// # Parameters
+	/// - `index` - The index of the innermost frame of the call stack.
+	///
+	/// # Returns
+	/// The frames of the call stack, outermost first.
+	fn stack_of(&self, index: usize) -> Vec<&Frame> {
+		let mut stack = Vec::new();
+		let mut next = Some(index);
+		while let Some(frame) = next.and_then(|frame_index| self.frames.get(frame_index)) {
+			stack.push(frame);
+			next = frame.parent;
+		}
+		stack.reverse();
+		stack
+	}
+
+	/// Returns the profile of the source location that's currently being evaluated.
+	///
+	/// # Returns
+	/// The profile of the current source location.
+	fn current_location(&mut self) -> &mut LocationProfile {
+		let function_id = self.frames.get(self.current_frame).map_or(GLOBAL_FUNCTION_ID, |frame| frame.function_id);
+		self.locations.entry((function_id, self.current_line)).or_default()
+	}
+
+	/// Charges the time since the last switch between frames to the current frame. This is called whenever the current frame changes, and does nothing if
+	/// profiling isn't enabled.
+	fn switch_frames(&mut self) {
+		if !self.is_enabled {
+			return;
+		}
+		let now = Instant::now();
+		if let Some(frame) = self.frames.get_mut(self.current_frame) {
+			frame.time += now.duration_since(self.last_switch);
+		}
+		self.last_switch = now;
+	}
+}
@@ -1,11 +1,47 @@
 use std::collections::HashMap;
 
+use crate::parser::expressions::util::name::Name;
+
 use colored::Colorize as _;
 
-use crate::parser::expressions::util::name::Name;
+/// A set of small non-negative integers, stored as one bit per integer. This is used for the dependencies of each node in a `VariableDependencyTreeSet`,
+/// so adding a dependency that's already there is a single bit check no matter how many dependencies the node has.
+#[derive(Clone, Debug, Default)]
+struct BitSet {
+	/// The bits of the set, 64 integers per word. Bit `n % 64` of word `n / 64` is set iff `n` is in the set.
+	words: Vec<u64>,
+}
+
+impl BitSet {
+	/// Adds an integer to this set.
+	///
+	/// # Parameters
+	/// - `value` - The integer to add.
+	fn insert(&mut self, value: usize) {
+		let word = value.div_euclid(64);
+		if self.words.len() <= word {
+			self.words.resize(word + 1, 0);
+		}
+		if let Some(bits) = self.words.get_mut(word) {
+			*bits |= 1 << value.rem_euclid(64);
+		}
+	}
+
+	/// Returns the integers in this set, in increasing order.
+	///
+	/// # Returns
+	/// An iterator over the integers in this set.
+	fn iter(&self) -> impl Iterator<Item = usize> + '_ {
+		self.words
+			.iter()
+			.enumerate()
+			.flat_map(|(word, bits)| (0..64).filter(move |bit| bits & (1 << bit) != 0).map(move |bit| word * 64 + bit))
+	}
+}
 
-/// A set of trees representing variable dependencies. Each tree is composed of `Name` nodes that represent variable names. The root of each tree is the name of the variable,
-/// and each child is a dependency of that variable. This is used to detect dependency cycles in the global scope. For example, in the program:
+/// A graph of the dependencies between the global statements of a program. Each node is a global statement, which depends on every global variable that's
+/// referenced anywhere inside of it. This is used to find the order that global variables need to be evaluated in at compile-time, to detect dependency
+/// cycles in the global scope, and to skip evaluating global variables that nothing uses. For example, in the program:
 ///
 /// ```cabin
 /// let x = y;
@@ -13,64 +49,124 @@ use crate::parser::expressions::util::name::Name;
 /// ```
 ///
 /// the variables x and y depend on each other. This would cause a stack overflow in the compiler, so we need to detect these cycles, which is the responsibility of this struct.
+///
+/// The graph is built while the program is parsed: A tree is created for each global statement (see `create_new_tree_and_set_current()`), and every
+/// variable referenced while it's open is added as a dependency of it. Variable names are interned into ids as they're seen, and each node stores the ids
+/// of its dependencies in a bitset, so building the graph takes constant time per reference. Cycles are found all at once afterwards by
+/// `evaluation_order()`, in time linear in the size of the graph.
+#[derive(Clone, Debug, Default)]
 pub struct VariableDependencyTreeSet {
-	/// The trees stored in this dependency set. This is stored as a `HashMap` where each key is the name of the root of the tree, and the value is the set of variables that it directly depends on.
-	/// To recursively check if one variable depends on another, use `depends_on()`.
-	nodes: HashMap<Name, Vec<Name>>,
+	/// The ids of the variable names that have been seen so far. Ids are given out in the order that names are first seen.
+	name_ids: HashMap<Name, usize>,
 
-	/// The current variable that is being dependency-tracked. This is a stack so that when multiple declarations occur simultaneously (such as a function where there are variables being declared in the
+	/// The node that declares each variable name, indexed by the name's id. This is `None` for names that aren't declared by a global statement, such as
+	/// local variables and function parameters, which are ignored when finding the order to evaluate the global statements in.
+	declarations: Vec<Option<usize>>,
+
+	/// The ids of the variable names that each node references, indexed by the node.
+	dependencies: Vec<BitSet>,
+
+	/// The nodes that are always evaluated, such as statements that aren't declarations, in the order that they were added (see `add_root()`).
+	roots: Vec<usize>,
+
+	/// Whether each node is a root that has to be evaluated in source order relative to the other such roots, because evaluating it can have side
+	/// effects (see `add_ordered_root()`), indexed by the node.
+	ordered: Vec<bool>,
+
+	/// The current nodes that are being dependency-tracked. This is a stack so that when multiple declarations occur simultaneously (such as a function where there are variables being declared in the
 	/// function body before the declaration for the function itself ends), we can pop back into the previous dependency tree.
-	current_stack: Vec<Name>,
+	current_stack: Vec<usize>,
 }
 
 impl VariableDependencyTreeSet {
 	/// Creates a new empty `VariableDependencyTreeSet`.
 	#[must_use]
 	pub fn new() -> Self {
-		Self {
-			nodes: HashMap::new(),
-			current_stack: Vec::new(),
-		}
+		Self::default()
 	}
 
-	/// Adds a variable as a dependency of the current variable. If the dependency depends on the current variable, this is a circular dependency, and an error is returned. If not,
-	/// `Ok(())` is returned.
+	/// Returns the id of a variable name, giving it a new id if it hasn't been seen yet.
 	///
 	/// # Parameters
-	/// - `dependency` - The variable to add as a dependency of the current variable.
+	/// - `name` - The variable name.
 	///
 	/// # Returns
-	/// an error if the dependency also depends on the current variable.
-	pub fn add_dependency(&mut self, dependency: Name) -> anyhow::Result<()> {
-		let current = self
-			.current_stack
-			.last()
-			.ok_or_else(|| anyhow::anyhow!("Attempted to add a dependency to the current variable dependency subgraph, but there is no current variable dependency subgraph"))?;
-
-		if &dependency != current && self.depends_on(&dependency, current) {
-			anyhow::bail!(
-  				"Variable dependency cycle detected: The variable \"{current}\" depends on the variable \"{dependency}\", but the variable \"{dependency}\" depends on the variable \"{current}\"",
-  				current = current.cabin_name().bold().cyan(),
-  				dependency = dependency.cabin_name().bold().cyan()
-  			);
+	/// The id of the name.
+	fn name_id(&mut self, name: Name) -> usize {
+		let next_id = self.name_ids.len();
+		let id = *self.name_ids.entry(name).or_insert(next_id);
+		if id == next_id {
+			self.declarations.push(None);
 		}
+		id
+	}
 
-		let dependencies = self.nodes.get_mut(current).unwrap_or_else(|| unreachable!());
-		if !dependencies.contains(&dependency) {
-			dependencies.push(dependency);
-		}
+	/// Adds a variable as a dependency of the current node. Adding a dependency that's already there does nothing. If no tree is open, this does nothing.
+	///
+	/// # Parameters
+	/// - `dependency` - The variable to add as a dependency of the current node.
+	pub fn add_dependency(&mut self, dependency: Name) {
+		let Some(current) = self.current_stack.last().copied() else {
+			return;
+		};
 
-		Ok(())
+		let id = self.name_id(dependency);
+		if let Some(dependencies) = self.dependencies.get_mut(current) {
+			dependencies.insert(id);
+		}
 	}
 
-	/// Creates a new dependency tree and sets it as the current dependency tree. The current dependency tree can be restored to the previous one with `close_tree()`, which should always be called
+	/// Creates a new node and sets it as the current dependency tree. The current dependency tree can be restored to the previous one with `close_tree()`, which should always be called
 	/// at some point after this.
 	///
+	/// # Returns
+	/// The new node, which is the number of nodes that were created before it.
+	pub fn create_new_tree_and_set_current(&mut self) -> usize {
+		let node = self.dependencies.len();
+		self.dependencies.push(BitSet::default());
+		self.ordered.push(false);
+		self.current_stack.push(node);
+		node
+	}
+
+	/// Records that a node declares the variable with the given name, so that nodes that reference the variable depend on it. If more than one node declares
+	/// the same name, the first one is used.
+	///
+	/// # Parameters
+	/// - `node` - The node that declares the variable.
+	/// - `name` - The name of the declared variable.
+	pub fn declare(&mut self, node: usize, name: Name) {
+		let id = self.name_id(name);
+		if let Some(declaration) = self.declarations.get_mut(id) {
+			declaration.get_or_insert(node);
+		}
+	}
+
+	/// Marks a node as always being evaluated, whether or not anything depends on it.
+	///
+	/// # Parameters
+	/// - `node` - The node to mark.
+	pub fn add_root(&mut self, node: usize) {
+		self.roots.push(node);
+	}
+
+	/// Marks a node as always being evaluated, and as having to be evaluated in source order relative to the other nodes marked with this, such as a
+	/// statement that prints something, or a declaration whose value is read from the user. Such a node is never moved before an ordered root that was
+	/// added before it, even if something before that root depends on it.
+	///
 	/// # Parameters
-	/// - `name` - The name of the root node for the new dependency tree.
-	pub fn create_new_tree_and_set_current(&mut self, name: Name) {
-		self.nodes.insert(name.clone(), Vec::new());
-		self.current_stack.push(name);
+	/// - `node` - The node to mark.
+	pub fn add_ordered_root(&mut self, node: usize) {
+		self.roots.push(node);
+		if let Some(ordered) = self.ordered.get_mut(node) {
+			*ordered = true;
+		}
+	}
+
+	/// Returns the number of nodes in the graph.
+	#[must_use]
+	pub const fn node_count(&self) -> usize {
+		self.dependencies.len()
 	}
 
 	/// Sets the current dependency tree to the previous one, or `None` if we are currently in the first dependency tree. If there is currently no dependency tree, an error is returned.
@@ -86,53 +182,112 @@ impl VariableDependencyTreeSet {
 		Ok(())
 	}
 
-	/// Recursively checks if one variable depends on another. This is used to detect cycles; When adding dependencies, this checks if the reverse dependency exists, i.e., when adding `y`
-	/// as a dependency of `x`, we check if `x` is already a dependency of `y`.
+	/// Returns the order to evaluate the nodes that are reachable from the roots in (see `add_root()`), so that every node is evaluated after the nodes it depends on.
+	/// Nodes that none of the roots depend on, directly or indirectly, aren't included. This finds the strongly connected components of the graph with an
+	/// iterative version of Tarjan's algorithm, which emits each component after every component that it depends on. Nodes in the same component depend on
+	/// each other in a cycle, so there's no order between them that satisfies every dependency; They're returned together, in the order they were created.
 	///
-	/// # Parameters
-	/// - `parent` - The name of the variable to check if depends on another
-	/// - `possible_child` - The name of the possibly dependency to check if it's actually a dependency.
+	/// The roots are visited in the order they were added, so ordered roots (see `add_ordered_root()`) are evaluated in source order. A dependency on an
+	/// ordered root that hasn't been reached yet is never followed from another root, since that would move it before the ordered roots in between; It's
+	/// evaluated in its own turn instead, which is fine for definitions such as functions that only use it once they're called. An ordered root that
+	/// depends on a later ordered root can't be evaluated in any order, so that's an error.
 	///
 	/// # Returns
-	/// `true` iff `parent` depends on `possible_child`. If there is no dependency tree stored for `parent`, `false` is returned. If there is no dependency graph stored for `possible_child`,
-	/// `false` is returned. If `parent` and `possible_child` are the same, `true` is returned.
-	fn depends_on(&self, parent: &Name, possible_child: &Name) -> bool {
-		if !self.nodes.contains_key(parent) {
-			return false;
-		}
+	/// The strongly connected components of the reachable nodes, each of which should be evaluated after all of the components before it.
+	///
+	/// # Errors
+	/// If an ordered root depends on an ordered root that was added after it.
+	pub fn evaluation_order(&self) -> anyhow::Result<Vec<Vec<usize>>> {
+		let successors = self
+			.dependencies
+			.iter()
+			.map(|dependencies| dependencies.iter().filter_map(|name| self.declarations.get(name).copied().flatten()).collect::<Vec<_>>())
+			.collect::<Vec<_>>();
 
-		if parent == possible_child {
-			return true;
-		}
+		let node_count = successors.len();
+		let mut indices = vec![None; node_count];
+		let mut low_links = vec![0; node_count];
+		let mut on_stack = vec![false; node_count];
+		let mut stack = Vec::new();
+		let mut components = Vec::new();
+		let mut next_index = 0;
 
-		for child in self.nodes.get(parent).unwrap() {
-			if self.depends_on(child, possible_child) {
-				return true;
+		for &root in &self.roots {
+			if root >= node_count || indices.get(root).copied().flatten().is_some() {
+				continue;
 			}
-		}
 
-		false
-	}
+			// Each entry is a node being visited and the position of its next successor to visit
+			let mut visiting = vec![(root, 0)];
+			indices[root] = Some(next_index);
+			low_links[root] = next_index;
+			next_index += 1;
+			stack.push(root);
+			on_stack[root] = true;
 
-	/// Returns all dependencies, including sub-dependencies, for the variable with the given name.
-	///
-	/// # Parameters
-	/// - `parent` - The name of the variable to get the dependencies of.
-	#[must_use]
-	pub fn dependencies(&self, parent: &Name) -> Vec<Name> {
-		let Some(parent_tree) = self.nodes.get(parent) else {
-			return Vec::new();
-		};
+			while let Some((visited, position)) = visiting.last_mut() {
+				let node = *visited;
+				if let Some(&successor) = successors[node].get(*position) {
+					*position += 1;
+					if indices[successor].is_none() && self.ordered.get(successor).copied().unwrap_or(false) {
+						if self.ordered.get(root).copied().unwrap_or(false) {
+							anyhow::bail!(
+								"The variable \"{}\" is used before it's declared, but its value can have side effects, so it can't be evaluated any earlier",
+								self.declared_name(successor).map_or("?", Name::cabin_name).bold().cyan()
+							);
+						}
+						continue;
+					}
+					if let Some(successor_index) = indices[successor] {
+						if on_stack[successor] {
+							low_links[node] = low_links[node].min(successor_index);
+						}
+					} else {
+						indices[successor] = Some(next_index);
+						low_links[successor] = next_index;
+						next_index += 1;
+						stack.push(successor);
+						on_stack[successor] = true;
+						visiting.push((successor, 0));
+					}
+					continue;
+				}
 
-		let mut dependencies = parent_tree.to_owned();
-		for dependency in parent_tree {
-			dependencies.push(dependency.clone());
-			for sub_dependency in self.dependencies(dependency) {
-				dependencies.push(sub_dependency);
+				visiting.pop();
+				if let Some((parent, _position)) = visiting.last() {
+					low_links[*parent] = low_links[*parent].min(low_links[node]);
+				}
+
+				if Some(low_links[node]) == indices[node] {
+					let mut component = Vec::new();
+					while let Some(member) = stack.pop() {
+						on_stack[member] = false;
+						component.push(member);
+						if member == node {
+							break;
+						}
+					}
+					component.sort_unstable();
+					components.push(component);
+				}
 			}
 		}
 
-		dependencies
+		Ok(components)
+	}
+
+	/// Returns the name of the variable that a node declares.
+	///
+	/// # Parameters
+	/// - `node` - The node.
+	///
+	/// # Returns
+	/// The name of the variable that the node declares, or `None` if it doesn't declare one.
+	fn declared_name(&self, node: usize) -> Option<Name> {
+		self.name_ids
+			.iter()
+			.find(|(_name, id)| self.declarations.get(**id).copied().flatten() == Some(node))
+			.map(|(name, _id)| *name)
 	}
 
 	/// Returns whether or not a dependency tree is currently being built.
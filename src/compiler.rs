@@ -1,21 +1,33 @@
-use crate::{compile_time::TranspileToC, context::Context, parser::Program};
+use crate::{
+	context::Context,
+	emitter::BlankLineCollapser,
+	parser::Program,
+	profile::{BuildProfile, ProfileGuidedStage},
+	timings,
+};
 
-use std::process::Stdio;
-
-use colored::Colorize as _;
+use std::{
+	fmt::Write as _,
+	process::Stdio,
+	sync::atomic::{AtomicUsize, Ordering},
+};
 
 /// A slice of possible C compilers that we can use to compile C code. This is in order of preference, i.e., first we prefer Clang because it is faster,
 /// has more features, etc., next gcc, and so on. These are iterated over and checked if any are installed. If the user has none of these, an error will
 /// be thrown when attempting to compile Cabin code.
 static COMPILERS: &[&str] = &["clang", "gcc", "zig"];
 
+/// The flags that are passed to the C compiler when compiling generated C code, regardless of the build profile (see `profile::BuildProfile`). These are part
+/// of the key of cached builds (see `cache::BuildCache`), so changing them invalidates the cache.
+pub static C_COMPILER_FLAGS: &[&str] = &["-w"];
+
 /// Returns the C compiler that the user has installed on their system. This is the name of the command, not a human readable name, so this will return something
 /// like `gcc` instead of `GNU C Compiler`. If the user doesn't have a C compiler installed, `None` is returned.
 ///
 /// # Returns
 /// The command name of the C compiler installed on the users system, or `None` if the user has no C compiler.
 #[must_use]
-fn get_c_compiler() -> Option<&'static str> {
+pub fn get_c_compiler() -> Option<&'static str> {
 	COMPILERS.iter().find(|compiler| which::which(compiler).is_ok()).copied()
 }
 
@@ -27,6 +39,76 @@ pub fn temp_dir() -> String {
 	std::env::temp_dir().to_str().unwrap().to_owned()
 }
 
+/// The minimum number of items that each thread is given by `transpile_each()`. Starting a thread and forking the context for it costs more than
+/// transpiling a few small items, so programs with only a few items are transpiled on the current thread.
+const MINIMUM_ITEMS_PER_THREAD: usize = 8;
+
+/// Transpiles each of the given items into C, in parallel when there are enough of them. Items are handed out to a pool of up to `context.jobs` threads one
+/// at a time, so threads that finish their items early take more, and each thread transpiles with its own fork of the context (see `Context::fork()`).
+/// The changes that each item makes to its thread's context are then applied to the given context in the order of the items, so the output and the
+/// resulting context are exactly the same regardless of how many threads are used.
+///
+/// # Parameters
+/// - `items` - The items to transpile, such as the functions or global declarations of a program.
+/// - `context` - The global compiler context.
+/// - `transpile_item` - Transpiles a single item. This is called once for each item, with either the given context or a fork of it.
+///
+/// # Returns
+/// The transpiled items, in the same order as the given items.
+///
+/// # Errors
+/// If any item fails to transpile, the error of the first such item is returned.
+pub fn transpile_each<T: Sync, O: Send>(items: &[T], context: &mut Context, transpile_item: impl Fn(&T, &mut Context) -> anyhow::Result<O> + Sync) -> anyhow::Result<Vec<O>> {
+	let threads = context.jobs.min(items.len().div_euclid(MINIMUM_ITEMS_PER_THREAD));
+	if threads <= 1 {
+		return items.iter().map(|item| transpile_item(item, context)).collect();
+	}
+
+	let next_item = AtomicUsize::new(0);
+	let forks = (0..threads).map(|_| context.fork()).collect::<Vec<_>>();
+	let mut results = std::thread::scope(|scope| {
+		let workers = forks
+			.into_iter()
+			.map(|mut fork| {
+				let next = &next_item;
+				let transpile = &transpile_item;
+				scope.spawn(move || {
+					let mut transpiled = Vec::new();
+					loop {
+						let index = next.fetch_add(1, Ordering::Relaxed);
+						let Some(item) = items.get(index) else {
+							break;
+						};
+						let groups_before = fork.groups.len();
+						let result = transpile(item, &mut fork);
+						let failed = result.is_err();
+						transpiled.push((index, result, fork.take_changes(groups_before)));
+						// Later items are never used once an item fails, so this thread stops here
+						if failed {
+							break;
+						}
+					}
+					transpiled
+				})
+			})
+			.collect::<Vec<_>>();
+
+		workers
+			.into_iter()
+			.flat_map(|worker| worker.join().unwrap_or_else(|panic| std::panic::resume_unwind(panic)))
+			.collect::<Vec<_>>()
+	});
+
+	// Items are handed out in order, so every item before the first failed one has been transpiled
+	results.sort_by_key(|(index, ..)| *index);
+	let mut outputs = Vec::with_capacity(items.len());
+	for (_index, result, changes) in results {
+		context.apply_changes(changes)?;
+		outputs.push(result?);
+	}
+	Ok(outputs)
+}
+
 /// Transpiles an abstract syntax tree (AST) into C code. This uses the `C` trait defined in `compile_time.rs` to transpile the AST.
 ///
 /// # Parameters
@@ -38,31 +120,66 @@ pub fn temp_dir() -> String {
 /// Transpiled C code as a string. This will be C code that has a `main` function and can be dumped right into a valid `C` file. If there
 /// was an error during transpilation, an `Err` is returned.
 pub fn transpile(compile_time_ast: &Program, context: &mut Context) -> anyhow::Result<String> {
-	let c_prelude = compile_time_ast
-		.c_prelude(context)
-		.map_err(|error| anyhow::anyhow!("{error}\n\t{}", "while generating C prelude for the program".dimmed()))?
-		.trim()
-		.to_owned()
-		+ "\n\n";
-	let c = c_prelude
-		+ &compile_time_ast
-			.to_c(context)
-			.map_err(|error| anyhow::anyhow!("{error}\n\twhile transpiling the program's global variables into C code"))?;
-	let pattern = regex_macro::regex!("\n\n+");
-	Ok(pattern.replace_all(&c, "\n\n").to_string())
+	let mut c = Vec::new();
+	transpile_to(compile_time_ast, context, &mut c)?;
+	Ok(String::from_utf8(c)?)
 }
 
-/// Writes outputted C code into the default file, which is in the OS-dependent temporary directory (see `temp_dir()`). This will error
-/// if there is some error writing the file, such as insufficient permissions. Otherwise, the path to the file written is returned.
+/// Transpiles an abstract syntax tree (AST) into C code like `transpile()`, but streams the code into the given output as it's generated instead of
+/// returning it, removing unnecessary blank lines along the way (see `emitter::BlankLineCollapser`).
 ///
 /// # Parameters
-/// - `c_code` - A string of valid C code. This can be retrieved using `transpile()`.
+/// - `compile_time_ast` - an AST that has already gone through compile-time evaluation.
+/// - `context` - The context of the program, which supplies global data such as the scopes and variables declared in the program.
+/// - `output` - The output to write the C code to. This should be buffered, because the code is written in many small pieces.
 ///
-/// # Returns
-/// The path to the C file written, or an `Err` if there was an error writing to the file (insufficient permissions, out of storage space, etc.)
-pub fn write_c(c_code: &str) -> anyhow::Result<String> {
-	std::fs::write(temp_dir() + "/cabin_output.c", c_code).map_err(|error| anyhow::anyhow!("Error writing transpiled C code to file: {error}"))?;
-	Ok(temp_dir() + "/cabin_output.c")
+/// # Errors
+/// If there was an error during transpilation, or the code couldn't be written to the output.
+pub fn transpile_to(compile_time_ast: &Program, context: &mut Context, output: impl std::io::Write) -> anyhow::Result<()> {
+	let mut collapser = BlankLineCollapser::new(output);
+	let mut write = || -> anyhow::Result<()> {
+		let program = compile_time_ast.split_c(context)?;
+		collapser.write_str(&program.header)?;
+		for function in &program.functions {
+			collapser.write_str(function)?;
+		}
+		collapser.trim_end();
+		collapser.write_str("\n\n")?;
+		collapser.write_str(&program.main)?;
+		Ok(())
+	};
+	let written = write();
+
+	// If the output failed, that's the cause of any error while writing, so it's reported instead
+	collapser.finish().map_err(|error| anyhow::anyhow!("Error writing transpiled C code: {error}"))?;
+	written
+}
+
+/// Transpiles an abstract syntax tree (AST) into C code, and streams the code into a file (see `transpile_to()`).
+///
+/// # Parameters
+/// - `compile_time_ast` - an AST that has already gone through compile-time evaluation.
+/// - `context` - The context of the program, which supplies global data such as the scopes and variables declared in the program.
+/// - `path` - The path of the file to write the C code to. The file is overwritten if it already exists.
+///
+/// # Errors
+/// If there was an error during transpilation, or the file couldn't be written.
+pub fn transpile_to_file(compile_time_ast: &Program, context: &mut Context, path: &str) -> anyhow::Result<()> {
+	let file = std::fs::File::create(path).map_err(|error| anyhow::anyhow!("Error writing transpiled C code to file: {error}"))?;
+	transpile_to(compile_time_ast, context, std::io::BufWriter::new(file))
+}
+
+/// Returns the path, without an extension, that uncached build outputs are written to. This is in the OS-dependent temporary directory (see `temp_dir()`),
+/// and includes the ID of the current process, so that multiple instances of the compiler running at once don't overwrite each other's outputs.
+#[must_use]
+pub fn temp_output_path() -> String {
+	format!("{}/cabin_output-{}", temp_dir(), std::process::id())
+}
+
+/// Returns the path of the file that uncached generated C code is written to, which is in the OS-dependent temporary directory (see `temp_output_path()`).
+#[must_use]
+pub fn temp_c_file() -> String {
+	temp_output_path() + ".c"
 }
 
 /// Compiles a C file and outputs the result as a native executable.
@@ -71,20 +188,26 @@ pub fn write_c(c_code: &str) -> anyhow::Result<String> {
 /// - `file_to_compile` - The path to the C file to compile. This file must exist and contain valid C code.
 /// - `output_path` - The file to output the C file to. This file will likely be overwritten if it already exists, but technically the behavior is dependent
 /// on the C compiler being used.
+/// - `profile` - The build profile to compile with, which determines the optimization flags passed to the C compiler.
 ///
 /// # Returns
 /// The path to the compiled C code. The path is guaranteed to be a valid path to a file that exists and is a native executable. The file will end with `.exe`
 /// on Windows, and have no extension on all other operating systems. If an error occurs, such as the C compiler throwing an error, an `Err` will be returned.
-pub fn compile_c_to(file_to_compile: &str, output_path: &str, context: &mut Context) -> anyhow::Result<String> {
+pub fn compile_c_to(file_to_compile: &str, output_path: &str, profile: &BuildProfile, context: &mut Context) -> anyhow::Result<String> {
 	let extension = get_native_executable_extension();
-	let status = std::process::Command::new(get_c_compiler().ok_or_else(|| anyhow::anyhow!("No C compiler found!"))?)
-		.arg("-w")
-		.arg("-o")
-		.arg(format!("{output_path}{extension}"))
-		.arg(file_to_compile)
-		.stderr(Stdio::null())
-		.status()
-		.map_err(|error| anyhow::anyhow!("Error during C compilation: Unable to spawn C compiler: {error}."))?;
+	let compiler = get_c_compiler().ok_or_else(|| anyhow::anyhow!("No C compiler found!"))?;
+	let arguments = profile.c_compiler_arguments(compiler)?;
+	let status = timings::phase("C compiler", || {
+		std::process::Command::new(compiler)
+			.args(arguments)
+			.args(C_COMPILER_FLAGS)
+			.arg("-o")
+			.arg(format!("{output_path}{extension}"))
+			.arg(file_to_compile)
+			.stderr(Stdio::null())
+			.status()
+	})
+	.map_err(|error| anyhow::anyhow!("Error during C compilation: Unable to spawn C compiler: {error}."))?;
 
 	if !status.success() {
 		context.encountered_compiler_bug = true;
@@ -94,6 +217,76 @@ pub fn compile_c_to(file_to_compile: &str, output_path: &str, context: &mut Cont
 	Ok(format!("{output_path}{extension}"))
 }
 
+/// Compiles a C file into a native executable using profile-guided optimization (PGO). This compiles the file twice: First into an instrumented executable,
+/// which is run by the given training command to record a profile of how the program behaves, and then into an optimized executable, using that profile to
+/// decide what to optimize. The optimized executable replaces the instrumented one at the output path.
+///
+/// # Parameters
+/// - `file_to_compile` - The path to the C file to compile. This file must exist and contain valid C code.
+/// - `output_path` - The file to output the executable to, without an extension. The same path is used for both builds, because GCC locates the profile
+/// data for a build using the names of its input and output files.
+/// - `profile` - The build profile to compile with.
+/// - `training_command` - A shell command that runs the instrumented executable on a representative workload. The path of the instrumented executable is
+/// available to the command in the `CABIN_PGO_EXECUTABLE` environment variable.
+///
+/// # Returns
+/// The path to the optimized executable.
+///
+/// # Errors
+/// If either build fails, the training command fails, or the profile data can't be processed.
+pub fn compile_c_with_pgo(file_to_compile: &str, output_path: &str, profile: &BuildProfile, training_command: &str, context: &mut Context) -> anyhow::Result<String> {
+	let compiler = get_c_compiler().ok_or_else(|| anyhow::anyhow!("No C compiler found!"))?;
+	let profile_directory = temp_output_path() + "-pgo";
+	std::fs::create_dir_all(&profile_directory).map_err(|error| anyhow::anyhow!("Error creating profile data directory: {error}"))?;
+
+	// Instrumented build
+	let mut instrumented_profile = profile.clone();
+	instrumented_profile.profile_guided = Some(ProfileGuidedStage::Generate(profile_directory.clone()));
+	let instrumented_executable =
+		compile_c_to(file_to_compile, output_path, &instrumented_profile, context).map_err(|error| anyhow::anyhow!("{error}\n\twhile building the instrumented executable"))?;
+
+	// Training
+	let (shell, shell_flag) = match get_os() {
+		Os::Windows => ("cmd", "/C"),
+		Os::Unix => ("sh", "-c"),
+	};
+	let status = std::process::Command::new(shell)
+		.arg(shell_flag)
+		.arg(training_command)
+		.env("CABIN_PGO_EXECUTABLE", &instrumented_executable)
+		.status()
+		.map_err(|error| anyhow::anyhow!("Error during profile-guided optimization: Unable to run the training command: {error}."))?;
+	if !status.success() {
+		anyhow::bail!("Error during profile-guided optimization: The training command failed with {status}.");
+	}
+
+	// Clang writes raw profiles that have to be merged into a single profile before they can be used; GCC reads the profile directory directly
+	let profile_data = if compiler == "clang" {
+		let merged_profile = format!("{profile_directory}/cabin.profdata");
+		let merge_status = std::process::Command::new("llvm-profdata")
+			.arg("merge")
+			.arg(format!("-output={merged_profile}"))
+			.arg(&profile_directory)
+			.status()
+			.map_err(|error| anyhow::anyhow!("Error during profile-guided optimization: Unable to run llvm-profdata, which is required to use --pgo with clang: {error}."))?;
+		if !merge_status.success() {
+			anyhow::bail!("Error during profile-guided optimization: Merging the profile data failed with {merge_status}.");
+		}
+		merged_profile
+	} else {
+		profile_directory.clone()
+	};
+
+	// Optimized build
+	let mut optimized_profile = profile.clone();
+	optimized_profile.profile_guided = Some(ProfileGuidedStage::Use(profile_data));
+	let optimized_executable =
+		compile_c_to(file_to_compile, output_path, &optimized_profile, context).map_err(|error| anyhow::anyhow!("{error}\n\twhile building the optimized executable"))?;
+
+	std::fs::remove_dir_all(&profile_directory)?;
+	Ok(optimized_executable)
+}
+
 /// Returns the operating system of the user, as specified by `Os`.
 #[must_use]
 pub fn get_os() -> Os {
@@ -1,6 +1,9 @@
 use crate::{
 	cli::theme::{Theme, ONE_MIDNIGHT},
+	compile_time::{instances::FunctionInstances, memo::CallCache, profiler::CompileTimeProfiler, type_tree::VariableDependencyTreeSet},
 	formatter::ColoredCabin,
+	lexer::Span,
+	modules::Module,
 	parser::{
 		expressions::{
 			literals::{function_declaration::FunctionDeclaration, group::GroupType, Literal},
@@ -9,14 +12,25 @@ use crate::{
 		},
 		Program,
 	},
+	regions::{AllocationRegion, OpenRegion, ParameterEscape},
 	scopes::ScopeData,
+	text::TextConstants,
 };
 
+use std::{collections::HashMap, num::NonZeroUsize, sync::Arc};
+
 /// Data about the current state of the compiler. This is a single-instance context variable that is passed to all
 /// parts of the compiler. This allows different, far apart parts of the program to communicate with one another.
 pub struct Context {
 	/// The name of the file that the compiler is currently compiling.
 	pub file_name: String,
+	/// The source code that the compiler is currently compiling, including the prelude. This is the buffer that tokens are tokenized from, and tokens
+	/// only store spans into it (see `lexer::Span`), so it must outlive the token stream. Pass this to `Token::value()` or `Span::text()` to get
+	/// the text of a token. This is shared with the copies of the context that the program is transpiled with on other threads (see `fork()`).
+	pub source_code: Arc<String>,
+	/// The modules of the program, which are the files that its source code was read from (see `modules::read_program()`). This is empty if the source
+	/// code wasn't read from files, such as when a single file is formatted.
+	pub modules: Arc<[Module]>,
 	/// The current scope data. This is used to manage the scope of variables and functions.
 	pub scope_data: ScopeData,
 
@@ -53,7 +67,7 @@ pub struct Context {
 	/// The current program that is being compiled. This is used to get the colored version of the program, which is used to pretty-print code snippets
 	/// to the console when errors occur. This is initially set to `None`, but is guaranteed to be present after parse-time, i.e., during compile-time
 	/// evaluation, transpilation, etc.
-	pub program: Option<Program>,
+	pub program: Option<Arc<Program>>,
 
 	/// The current "bad" identifier. When the developer references a variable that can't be found during compile-time
 	/// analysis, the literal stores the name of that variable here. Then, when printing a colored snippet of the
@@ -70,8 +84,9 @@ pub struct Context {
 	/// `theme()`.
 	theme: Theme,
 
-	/// The functions declared in the program. This is used to forward declare the functions in the compiled C code.
-	pub function_declarations: Vec<FunctionDeclaration>,
+	/// The functions declared in the program. This is used to forward declare the functions in the compiled C code. This is shared with the copies of the
+	/// context that the program is transpiled with on other threads until one of them changes it (see `fork()`).
+	pub function_declarations: Arc<Vec<FunctionDeclaration>>,
 
 	/// The groups declared in the program. This is used to forward declare the structs in the compiled C code.
 	pub groups: Vec<(String, GroupType)>,
@@ -80,6 +95,10 @@ pub struct Context {
 	/// ID. This is `None` until a main function is found.
 	pub main_function_name: Option<String>,
 
+	/// Descriptions of the items that were left out of the generated C code because the program can't reach them, such as `function print_12`. This is
+	/// empty until the program is transpiled (see `Program::split_c()`).
+	pub removed_c_items: Vec<String>,
+
 	/// Whether the error encountered is an error with the compiler. Whenever "unreachable" code is reached in the compiler, this is set to true before returning
 	/// an error from the enclosing function (generally with `anyhow::bail!`). When the compiler exits, a special message will be printed to the user indicating
 	/// that the error is a compiler bug and not an issue with their code, and that they should report it to the GitHub issues.
@@ -94,21 +113,78 @@ pub struct Context {
 	pub parameter_names: Vec<(Name, Literal)>,
 
 	pub transpiling_group_name: Option<Name>,
+
+	/// The dependencies between the global statements of the program, which are recorded as the program is parsed. This is used to evaluate the global
+	/// statements at compile-time in dependency order, and to skip the ones that nothing uses (see `Program::compile_time_evaluate()`).
+	pub dependencies: VariableDependencyTreeSet,
+
+	/// The cache of the return values of pure function calls that have been evaluated at compile-time (see `CallCache`).
+	pub call_cache: CallCache,
+
+	/// The profiler of compile-time evaluation, which counts the steps it takes and stops it when it goes over the project's budget (see
+	/// `CompileTimeProfiler`).
+	pub compile_time_profile: CompileTimeProfiler,
+
+	/// The instances of the functions of the program that are transpiled into C, keyed on each function and its parameter types (see
+	/// `FunctionInstances`).
+	pub function_instances: FunctionInstances,
+
+	/// The maximum number of threads that the compiler uses for work that it does in parallel, such as transpiling the functions of the program into C (see
+	/// `compiler::transpile_each()`). This is the number of CPUs available by default, and can be set with `--jobs`. With a single job, everything is done
+	/// on the current thread.
+	pub jobs: usize,
+
+	/// The regions that are open at the current point of transpilation, from the outermost to the innermost (see `regions::write_in_region()`).
+	pub open_regions: Vec<OpenRegion>,
+
+	/// The region that objects created at the current point of transpilation are allocated in (see `regions::write_reference()`).
+	pub allocation_region: AllocationRegion,
+
+	/// The region that the value of the innermost block or function body being transpiled is allocated in, which is the region that was current where
+	/// it started, since its value outlives its own region (see `regions::write_in_region()`).
+	pub tail_region: AllocationRegion,
+
+	/// How far each parameter of each function can escape a call to it, keyed by function id and parameter index. This is computed once before the program
+	/// is transpiled (see `regions::parameter_escapes()`), and shared with the copies of the context that the program is transpiled with on other threads.
+	pub parameter_escapes: Arc<HashMap<(usize, usize), ParameterEscape>>,
+
+	/// The Text whose value is known at compile-time that the transpiled program uses, which is written into the generated C code as a pool of constants
+	/// (see `TextConstants`).
+	pub text_constants: TextConstants,
+}
+
+/// The changes that transpiling one item of a program made to a forked context (see `Context::fork()`). Transpiling only changes a few parts of the
+/// context that other parts of the program depend on, so these are recorded for each item and applied to the original context in the order of the items,
+/// which gives the same context as transpiling every item on the original context one after another.
+pub struct ContextChanges {
+	/// The groups that were added to `Context::groups`.
+	groups: Vec<(String, GroupType)>,
+	/// The error details that were added to `Context::error_details`.
+	error_details: Vec<String>,
+	/// The warnings that were added to `Context::warnings`.
+	warnings: Vec<String>,
+	/// Whether `Context::encountered_compiler_bug` was set.
+	encountered_compiler_bug: bool,
+	/// The Text constants that were added to `Context::text_constants`.
+	text_constants: TextConstants,
 }
 
 impl Context {
-	/// Creates a new `Context` instance with the given file name and prelude line count.
+	/// Creates a new `Context` instance with the given file name and source code.
 	///
 	/// # Parameters
 	/// - `file_name` - The name of the file that the compiler is currently compiling.
-	/// - `prelude_line_count` - The number of lines in the prelude.
+	/// - `source_code` - The source code of the file, including the prelude (see `prelude::with_prelude`). This should be passed to
+	/// `prelude::tokenize_with_prelude` as `Arc::make_mut(&mut context.source_code)`.
 	///
 	/// # Returns
 	/// A new `Context` instance.
 	#[must_use]
-	pub fn new(file_name: String) -> Self {
+	pub fn new(file_name: String, source_code: String) -> Self {
 		Self {
 			file_name,
+			source_code: Arc::new(source_code),
+			modules: Arc::default(),
 			scope_data: ScopeData::global(),
 			is_parsing_type: false,
 			function_type_name: None,
@@ -117,18 +193,129 @@ impl Context {
 			current_bad_identifier: None,
 			theme: ONE_MIDNIGHT,
 			main_function_name: None,
+			removed_c_items: Vec::new(),
 			encountered_compiler_bug: false,
 			structs: Vec::new(),
 			generics_stack: Vec::new(),
 			error_details: Vec::new(),
-			function_declarations: Vec::new(),
+			function_declarations: Arc::default(),
 			groups: Vec::new(),
 			warnings: Vec::new(),
 			parameter_names: Vec::new(),
 			transpiling_group_name: None,
+			dependencies: VariableDependencyTreeSet::new(),
+			call_cache: CallCache::default(),
+			compile_time_profile: CompileTimeProfiler::default(),
+			function_instances: FunctionInstances::default(),
+			jobs: std::thread::available_parallelism().map_or(1, NonZeroUsize::get),
+			open_regions: Vec::new(),
+			allocation_region: AllocationRegion::Global,
+			tail_region: AllocationRegion::Global,
+			parameter_escapes: Arc::default(),
+			text_constants: TextConstants::default(),
+		}
+	}
+
+	/// Creates a copy of this context that part of the program can be transpiled with on another thread. The copy has the same scopes, groups, and
+	/// functions as this context, but no errors or warnings, so that the changes made to it can be collected with `take_changes()` and applied back to
+	/// this context with `apply_changes()`. The compile-time call cache, profiler, and dependency graph aren't copied, because they're only used before transpilation.
+	/// The source code, program, scopes, and functions are shared with this context rather than copied, since transpiling reads them but rarely changes
+	/// them; A fork that does change its scopes or functions copies them first.
+	///
+	/// # Returns
+	/// The copy of this context.
+	#[must_use]
+	pub fn fork(&self) -> Self {
+		Self {
+			file_name: self.file_name.clone(),
+			source_code: Arc::clone(&self.source_code),
+			modules: Arc::clone(&self.modules),
+			scope_data: self.scope_data.clone(),
+			is_parsing_type: self.is_parsing_type,
+			function_type_name: self.function_type_name,
+			is_evaluating_type: self.is_evaluating_type,
+			program: self.program.as_ref().map(Arc::clone),
+			current_bad_identifier: self.current_bad_identifier,
+			theme: self.theme.clone(),
+			main_function_name: self.main_function_name.clone(),
+			removed_c_items: Vec::new(),
+			encountered_compiler_bug: false,
+			structs: self.structs.clone(),
+			generics_stack: self.generics_stack.clone(),
+			error_details: Vec::new(),
+			function_declarations: Arc::clone(&self.function_declarations),
+			groups: self.groups.clone(),
+			warnings: Vec::new(),
+			parameter_names: self.parameter_names.clone(),
+			transpiling_group_name: self.transpiling_group_name,
+			dependencies: VariableDependencyTreeSet::new(),
+			call_cache: CallCache::default(),
+			compile_time_profile: CompileTimeProfiler::default(),
+			function_instances: FunctionInstances::default(),
+			jobs: 1,
+			open_regions: self.open_regions.clone(),
+			allocation_region: self.allocation_region,
+			tail_region: self.tail_region,
+			parameter_escapes: Arc::clone(&self.parameter_escapes),
+			text_constants: TextConstants::default(),
 		}
 	}
 
+	/// Collects the changes made to this forked context since it had the given number of groups (see `fork()`). The errors, warnings, Text constants, and
+	/// compiler bug flag are taken out of the context, but the new groups are left in it, so that later items transpiled with this context still see them.
+	///
+	/// # Parameters
+	/// - `groups_before` - The number of groups in this context before the changes were made.
+	///
+	/// # Returns
+	/// The changes, which can be applied to the original context with `apply_changes()`.
+	pub fn take_changes(&mut self, groups_before: usize) -> ContextChanges {
+		ContextChanges {
+			groups: self.groups.get(groups_before..).unwrap_or_default().to_vec(),
+			error_details: std::mem::take(&mut self.error_details),
+			warnings: std::mem::take(&mut self.warnings),
+			encountered_compiler_bug: std::mem::replace(&mut self.encountered_compiler_bug, false),
+			text_constants: std::mem::take(&mut self.text_constants),
+		}
+	}
+
+	/// Applies changes that were made to a fork of this context (see `fork()` and `take_changes()`). Groups are only ever added to the context if they're
+	/// not there already, so a group that was added by more than one fork is only added once.
+	///
+	/// # Parameters
+	/// - `changes` - The changes to apply.
+	///
+	/// # Errors
+	/// If the fork added a Text constant whose name is already used by a different value (see `TextConstants`).
+	pub fn apply_changes(&mut self, changes: ContextChanges) -> anyhow::Result<()> {
+		for group in changes.groups {
+			if !self.groups.iter().any(|existing| existing.0 == group.0) {
+				self.groups.push(group);
+			}
+		}
+		self.error_details.extend(changes.error_details);
+		self.warnings.extend(changes.warnings);
+		self.encountered_compiler_bug |= changes.encountered_compiler_bug;
+		self.text_constants.extend(changes.text_constants)
+	}
+
+	/// Returns the path of the file that the given position in the source code was read from (see `modules`), which is used to say which file an error
+	/// is in. Positions in the prelude, and positions in source code that wasn't read with `modules::read_program()`, are in the file that's being
+	/// compiled (see `file_name`).
+	///
+	/// # Parameters
+	/// - `position` - The byte index in the source code, such as the start of a token's span.
+	///
+	/// # Returns
+	/// The path of the file that the position is in.
+	#[must_use]
+	pub fn file_name_at(&self, position: usize) -> &str {
+		self.modules
+			.iter()
+			.find(|module| module.span.start <= position && position < module.span.end)
+			.map_or(&self.file_name, |module| &module.path)
+	}
+
 	/// Returns the theme that the user is using. This is used by various parts of the compiler to pretty-print code snippets that show where errors and warnings are.
 	/// This should never really change at any point during compilation, so the theme field is private and only accessible via an immutable reference returned from
 	/// this function.
@@ -149,7 +336,7 @@ impl Context {
 	pub fn unknown_at_compile_time(&self) -> &Literal {
 		let Some(Expression::Literal(literal)) = self
 			.scope_data
-			.get_variable(&Name("Parameter".to_owned()))
+			.get_variable(&Name::from("Parameter"))
 			.map(|declaration| declaration.value.as_ref().unwrap())
 		else {
 			unreachable!("Internal Error: The variable \"Parameter\" is not found in the current scope or is not a literal");
@@ -158,6 +345,20 @@ impl Context {
 		literal
 	}
 
+	/// Records a step of compile-time evaluation, and checks that compile-time evaluation is still within the project's budget (see
+	/// `CompileTimeProfiler::step()`). This should be called once for each statement evaluated at compile-time.
+	///
+	/// # Errors
+	/// If compile-time evaluation has gone over its budget. The call stacks that took the most steps are added to the error details.
+	pub fn compile_time_step(&mut self) -> anyhow::Result<()> {
+		let result = self.compile_time_profile.step();
+		if result.is_err() {
+			let details = self.compile_time_profile.budget_details();
+			self.add_error_details(details);
+		}
+		result
+	}
+
 	/// Adds a "note" to the context. When the program errors, all notes will be printed at the bottom. This is used by
 	/// AST nodes to print the part of the program where the error occurred and provide more detail on the error.
 	///
@@ -194,8 +395,13 @@ impl std::fmt::Display for Severity {
 #[derive(Debug)]
 /// An error that is associated with a specific token. All user errors encountered in source code should be thrown using this error type.
 pub struct TokenError {
-	/// The token that the error occurred on.
+	/// The line of the token that the error occurred on.
 	pub line: usize,
+	/// The column of the token that the error occurred on.
+	pub column: usize,
+	/// The span of the token that the error occurred on, which can be used to recover its text from `Context::source_code`. This is `None` if the
+	/// error occurred at the end of the token stream.
+	pub span: Option<Span>,
 	/// The severity of the error.
 	pub severity: Severity,
 	/// The error message.
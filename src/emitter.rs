@@ -0,0 +1,227 @@
+use std::{
+	fmt::{self, Write as _},
+	io,
+};
+
+/// A writer for generated C code, which indents every line written to it by its current indentation level. AST nodes write their C code into one of these
+/// with `TranspileToC::write_c()` and `TranspileToC::write_c_prelude()`, so that nested code can be indented as it's written instead of by splitting the
+/// code of each child node into lines and joining them back together.
+///
+/// Lines are indented lazily: The indentation of a line is written just before its first character, so ending a block's body with a newline and then
+/// dedenting writes the closing line at the outer indentation level.
+pub struct CWriter<'output> {
+	/// The output to write the indented code to. This is usually a `String`, or a `BlankLineCollapser` that streams the code into a file.
+	output: &'output mut dyn fmt::Write,
+	/// The number of tabs to indent each line with.
+	indentation: usize,
+	/// Whether the next character written starts a new line, and so should be indented first.
+	at_line_start: bool,
+	/// The number of bytes of code written through this writer so far, not including indentation.
+	written: usize,
+}
+
+impl<'output> CWriter<'output> {
+	/// Creates a new writer that writes into the given output, with no indentation.
+	///
+	/// # Parameters
+	/// - `output` - The output to write the code to.
+	///
+	/// # Returns
+	/// The created writer.
+	pub fn new(output: &'output mut dyn fmt::Write) -> Self {
+		Self {
+			output,
+			indentation: 0,
+			at_line_start: true,
+			written: 0,
+		}
+	}
+
+	/// Renders C code into a string. This is used by AST nodes that write their C code with a `CWriter`, to implement the string-returning methods of
+	/// `TranspileToC`.
+	///
+	/// # Parameters
+	/// - `write` - The function that writes the code, which is given a writer with no indentation.
+	///
+	/// # Returns
+	/// The written code.
+	///
+	/// # Errors
+	/// If `write` returns an error.
+	pub fn render(write: impl FnOnce(&mut CWriter<'_>) -> anyhow::Result<()>) -> anyhow::Result<String> {
+		let mut code = String::new();
+		write(&mut CWriter::new(&mut code))?;
+		Ok(code)
+	}
+
+	/// Writes code with one more level of indentation than the current one.
+	///
+	/// # Parameters
+	/// - `write` - The function that writes the indented code, which is given this writer.
+	///
+	/// # Returns
+	/// The value returned by `write`.
+	pub fn indented<T>(&mut self, write: impl FnOnce(&mut Self) -> T) -> T {
+		self.indentation += 1;
+		let value = write(self);
+		self.indentation -= 1;
+		value
+	}
+
+	/// Returns the number of bytes of code written through this writer so far, not including indentation. This can be compared before and after writing
+	/// a child node to check whether the node wrote any code.
+	#[must_use]
+	pub const fn written(&self) -> usize {
+		self.written
+	}
+
+	/// Ends the current line by writing a newline, unless nothing has been written on the current line yet.
+	///
+	/// # Errors
+	/// If the newline couldn't be written to the output.
+	pub fn end_line(&mut self) -> fmt::Result {
+		if self.at_line_start {
+			return Ok(());
+		}
+		self.write_char('\n')
+	}
+}
+
+impl fmt::Write for CWriter<'_> {
+	fn write_str(&mut self, code: &str) -> fmt::Result {
+		for line in code.split_inclusive('\n') {
+			if self.at_line_start {
+				for _ in 0..self.indentation {
+					self.output.write_char('\t')?;
+				}
+			}
+			self.output.write_str(line)?;
+			self.at_line_start = line.ends_with('\n');
+			self.written += line.len();
+		}
+		Ok(())
+	}
+}
+
+/// An output for generated C code that removes unnecessary blank lines as the code is written, and then streams the code into an `io::Write`, such as a
+/// buffered file. Whitespace at the very start of the code is removed, and any whitespace that spans three or more newlines is replaced with a single blank
+/// line, keeping only the indentation after its last newline. The generated code never needs more than one blank line in a row, and AST nodes often write
+/// empty lines for child nodes that have no code.
+///
+/// Only whitespace is buffered, so the memory this uses doesn't depend on the amount of code written.
+pub struct BlankLineCollapser<W: io::Write> {
+	/// The output to write the code to.
+	output: W,
+	/// The whitespace written since the last non-whitespace character. This isn't written to the output until the next non-whitespace character is
+	/// written, because it can't be collapsed until the number of newlines in it is known.
+	whitespace: String,
+	/// Whether any non-whitespace character has been written yet.
+	started: bool,
+	/// The first error returned by the output. `fmt::Write` can't return the error itself, so it's stored here, and nothing else is written once it's set.
+	error: Option<io::Error>,
+}
+
+impl<W: io::Write> BlankLineCollapser<W> {
+	/// Creates a new collapser that writes into the given output.
+	///
+	/// # Parameters
+	/// - `output` - The output to write the collapsed code to.
+	///
+	/// # Returns
+	/// The created collapser.
+	pub const fn new(output: W) -> Self {
+		Self {
+			output,
+			whitespace: String::new(),
+			started: false,
+			error: None,
+		}
+	}
+
+	/// Discards the whitespace written since the last non-whitespace character, which trims the end of the code written so far.
+	pub fn trim_end(&mut self) {
+		self.whitespace.clear();
+	}
+
+	/// Writes any remaining whitespace and flushes the output.
+	///
+	/// # Returns
+	/// The output that the code was written to.
+	///
+	/// # Errors
+	/// If any write to the output failed, or the output couldn't be flushed.
+	pub fn finish(mut self) -> io::Result<W> {
+		self.write_whitespace();
+		if let Some(error) = self.error {
+			return Err(error);
+		}
+		self.output.flush()?;
+		Ok(self.output)
+	}
+
+	/// Writes the buffered whitespace to the output, replacing it with a single blank line if it spans more than one.
+	fn write_whitespace(&mut self) {
+		if self.whitespace.matches('\n').count() >= 3 {
+			let indentation = self.whitespace.rsplit('\n').next().unwrap_or_default();
+			let collapsed = format!("\n\n{indentation}");
+			self.write_output(&collapsed);
+		} else {
+			let whitespace = std::mem::take(&mut self.whitespace);
+			self.write_output(&whitespace);
+		}
+		self.whitespace.clear();
+	}
+
+	/// Writes code to the output, unless writing has already failed.
+	///
+	/// # Parameters
+	/// - `code` - The code to write.
+	fn write_output(&mut self, code: &str) {
+		if self.error.is_none() {
+			if let Err(error) = self.output.write_all(code.as_bytes()) {
+				self.error = Some(error);
+			}
+		}
+	}
+}
+
+impl<W: io::Write> fmt::Write for BlankLineCollapser<W> {
+	fn write_str(&mut self, code: &str) -> fmt::Result {
+		let mut rest = code;
+		while !rest.is_empty() {
+			let (whitespace, after_whitespace) = rest.split_at(rest.find(|character: char| !character.is_whitespace()).unwrap_or(rest.len()));
+			if self.started {
+				self.whitespace.push_str(whitespace);
+			}
+			if after_whitespace.is_empty() {
+				break;
+			}
+
+			let (content, after_content) = after_whitespace.split_at(after_whitespace.find(char::is_whitespace).unwrap_or(after_whitespace.len()));
+			self.write_whitespace();
+			self.write_output(content);
+			self.started = true;
+			rest = after_content;
+		}
+
+		if self.error.is_some() {
+			return Err(fmt::Error);
+		}
+		Ok(())
+	}
+}
+
+/// Removes unnecessary blank lines from generated C code, in the same way as writing it through a `BlankLineCollapser`.
+///
+/// # Parameters
+/// - `code` - The code to remove blank lines from.
+///
+/// # Returns
+/// The code with unnecessary blank lines removed.
+#[must_use]
+pub fn collapse_blank_lines(code: &str) -> String {
+	// Writing into a `Vec` never fails, and the code is only split between characters
+	let mut collapser = BlankLineCollapser::new(Vec::new());
+	collapser.write_str(code).unwrap_or_else(|_error| unreachable!());
+	String::from_utf8(collapser.finish().unwrap_or_else(|_error| unreachable!())).unwrap_or_else(|_error| unreachable!())
+}
@@ -1,23 +1,103 @@
 use crate::{
 	context::Context,
-	parser::expressions::{literals::LiteralValue, Expression},
+	emitter::CWriter,
+	parser::{
+		expressions::{literals::LiteralValue, Expression},
+		statements::Statement,
+	},
 };
 
+use std::{
+	fmt::{self, Write as _},
+	sync::Arc,
+};
+
+/// The writer that Cabin code is formatted into. This is the same indenting writer that C code is emitted with (see `CWriter`): Every line that's
+/// written inside of `indented()` is indented one more level, so nested nodes are written straight into one output buffer at the right indentation,
+/// instead of each node building a string that its parent then splits into lines and indents again.
+pub type CabinWriter<'output> = CWriter<'output>;
+
 /// A trait for AST nodes to convert themselves into pretty, human-readable Cabin code. This is used for formatting cabin files, in which Cabin files are
 /// parsed and then use this trait to convert themselves into a pretty-string.
 #[enum_dispatch::enum_dispatch]
 #[ambassador::delegatable_trait]
 pub trait ToCabin {
-	/// Converts this AST node into pretty, human-readable, cabin code. This should recursively convert any sub-nodes and use their Cabin representations
-	/// in the return value of this. This is used for formatting Cabin files, in which the process is essentially just parsing Cabin code into an AST
-	/// and then converting the AST into Cabin using this trait.
-	fn to_cabin(&self) -> String;
-}
+	/// Writes this AST node as pretty, human-readable, cabin code. This should recursively write any sub-nodes into the same writer. This is used for
+	/// formatting Cabin files, in which the process is essentially just parsing Cabin code into an AST and then writing the AST as Cabin using this trait.
+	///
+	/// # Parameters
+	/// - `writer` - The writer to write the Cabin code into, which indents the code written inside of nested nodes.
+	///
+	/// # Errors
+	/// If writing to the writer failed, which can only happen if the output that the writer writes into fails.
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result;
 
-impl<T: ToCabin> ToCabin for Box<T> {
+	/// Converts this AST node into pretty, human-readable, cabin code (see `write_cabin()`).
+	///
+	/// # Returns
+	/// The Cabin code of this AST node.
 	fn to_cabin(&self) -> String {
-		self.as_ref().to_cabin()
+		self.try_to_cabin().unwrap_or_else(|_error| unreachable!())
+	}
+
+	/// Converts this AST node into Cabin code (see `write_cabin()`), returning an error instead of panicking if part of the node can't be written as
+	/// Cabin code. The formatter uses this, so that a node it can't write fails only the file that it's in.
+	///
+	/// # Returns
+	/// The Cabin code of this AST node.
+	///
+	/// # Errors
+	/// If part of the node has no Cabin code, such as a binary expression with an operator that isn't a binary operator.
+	fn try_to_cabin(&self) -> Result<String, fmt::Error> {
+		let mut cabin_code = String::new();
+		self.write_cabin(&mut CabinWriter::new(&mut cabin_code))?;
+		Ok(cabin_code)
+	}
+}
+
+impl<T: ToCabin> ToCabin for Arc<T> {
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		self.as_ref().write_cabin(writer)
+	}
+}
+
+/// Writes a list of statements as a body surrounded by braces, such as the body of a block or a function, with each statement on its own line and
+/// indented one level further than the braces.
+///
+/// # Parameters
+/// - `writer` - The writer to write the body into.
+/// - `statements` - The statements of the body.
+///
+/// # Errors
+/// If writing to the writer failed.
+pub fn write_body(writer: &mut CabinWriter<'_>, statements: &[Statement]) -> fmt::Result {
+	writer.write_str("{\n")?;
+	writer.indented(|body| {
+		statements.iter().try_for_each(|statement| {
+			statement.write_cabin(body)?;
+			body.write_char('\n')
+		})
+	})?;
+	writer.write_char('}')
+}
+
+/// Writes a list of items separated by the given separator.
+///
+/// # Parameters
+/// - `writer` - The writer to write the items into.
+/// - `items` - The items to write.
+/// - `separator` - The text to write between each pair of items, such as `", "`.
+///
+/// # Errors
+/// If writing to the writer failed.
+pub fn write_separated<'item, T: ToCabin + 'item>(writer: &mut CabinWriter<'_>, items: impl IntoIterator<Item = &'item T>, separator: &str) -> fmt::Result {
+	let mut current_separator = "";
+	for item in items {
+		writer.write_str(current_separator)?;
+		item.write_cabin(writer)?;
+		current_separator = separator;
 	}
+	Ok(())
 }
 
 /// A trait for abstract syntax tree (AST) nodes indicating that they can be pretty-printed to the console as syntax-highlighted code. This is used by AST
@@ -38,7 +118,7 @@ pub trait ColoredCabin {
 	fn to_colored_cabin(&self, context: &mut Context) -> String;
 }
 
-impl<T: ColoredCabin> ColoredCabin for Box<T> {
+impl<T: ColoredCabin> ColoredCabin for Arc<T> {
 	fn to_colored_cabin(&self, context: &mut Context) -> String {
 		self.as_ref().to_colored_cabin(context)
 	}
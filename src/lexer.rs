@@ -21,7 +21,7 @@ use strum::IntoEnumIterator as _;
 /// it is just called `Dot`. The names of the tokens should be written parser-agnostic, meaning they should have no "knowledge" of the actual use cases of the
 /// token in the language. This helps make parser changes easier, as we can repurpose token types without having to rename them and without causing confusion
 /// or ambiguity in what they refer to.
-#[derive(strum_macros::EnumIter, PartialEq, Eq, Debug, Clone)]
+#[derive(strum_macros::EnumIter, PartialEq, Eq, Debug, Clone, Copy)]
 pub enum TokenType {
 	/// The "tag opening" token type. This marks the start of a list of tags on a variable declaration. Please note that this only notes the *start* of such
 	/// a list, not the entire list. To be specific, this *only* matches the character sequence `#[`. All tokens after that sequenced are tokenized as normal, including
@@ -365,15 +365,16 @@ pub enum TokenType {
 }
 
 impl TokenType {
-	// TODO: This could pretty easily be refactored into a non-regex solution that would almost certainly be more performant;
-	// It would certainly be less clean and less concise, but it would be more performant, so we should consider this at some point.
-
 	/// Returns a regular expression pattern that matches the token type. This specifically checks if the given string *starts* with the token type.
 	/// The returned value is a lazily-evaluated static, so there is no performance loss to calling this repeatedly.
 	///
+	/// These patterns are the reference definition of each token type, but `tokenize` doesn't run them in the common case; It scans source code by hand
+	/// in a single pass (see `scan_token`), and only falls back to these patterns on non-ASCII text, where the Unicode semantics of `\w`, `\d`, and `\s`
+	/// matter. If you change a pattern here, be sure to update `scan_token` to match.
+	///
 	/// # Returns
 	/// A regular expression pattern that matches the token type.
-	fn pattern(&self) -> &'static regex_macro::Regex {
+	fn pattern(self) -> &'static regex_macro::Regex {
 		match self {
 			// Keywords
 			Self::KeywordEither => regex_macro::regex!(r"^either\b"),
@@ -468,76 +469,293 @@ impl std::fmt::Display for TokenType {
 	}
 }
 
+/// A range of bytes in the source code that was tokenized. Tokens don't own their text; Instead, they store the span of source code they were tokenized from,
+/// which can be used to recover the text from the source code buffer (see `Context::source_code`) whenever it's actually needed. This avoids allocating a
+/// string for every token, most of which (such as punctuation and keywords) never have their text read at all.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Span {
+	/// The byte index of the start of the span in the source code, inclusive.
+	pub start: usize,
+	/// The byte index of the end of the span in the source code, exclusive.
+	pub end: usize,
+}
+
+impl Span {
+	/// Returns the text that this span covers in the given source code. The given source code should be the same code that the span was tokenized from;
+	/// If the span is out of bounds of the given code or doesn't lie on character boundaries, the empty string is returned.
+	///
+	/// # Parameters
+	/// - `source_code` - The source code that this span was tokenized from.
+	///
+	/// # Returns
+	/// The text of the source code in this span.
+	#[must_use]
+	pub fn text<'source>(&self, source_code: &'source str) -> &'source str {
+		source_code.get(self.start..self.end).unwrap_or_default()
+	}
+}
+
 /// A token in source code.
-#[derive(Debug)]
+#[derive(Debug, Clone, PartialEq, Eq)]
 pub struct Token {
 	/// The type of the token.
 	pub token_type: TokenType,
-	/// The value of the token. This value is how the token originally appears in the source code *exactly*. There are some nuances to what is considered
-	/// part of the value; For example, all strings retain their quotes in this field. For information about what is considered part of the `value` for
-	/// a specific token type, refer to the documentation for that specific token type.
-	pub value: String,
-	/// The line number of the token. This is the line number as it appears in the source code passed to `tokenize`. It is up to the caller to do
-	/// arithmetic to find out the actual line number the token was written on, for example, with multiple files. Keep in mind that there is a global
-	/// prelude code (see `/prelude.cbn`) that is added to all Cabin projects, so that must be taken into account as well when error reporting with
-	/// this `line` field.
+	/// The span of source code that this token was tokenized from. The text of this span is how the token originally appears in the source code *exactly*.
+	/// There are some nuances to what is considered part of the text; For example, all strings retain their quotes. For information about what is
+	/// considered part of the text for a specific token type, refer to the documentation for that specific token type.
+	pub span: Span,
+	/// The line number of the token. This is the line number in the file that the token was written in; The prelude (see `/prelude.cbn`) is tokenized
+	/// separately from the user's code, so tokens in the user's code have the line numbers they appear on in their file, and tokens in the prelude have
+	/// the line numbers they appear on in the prelude.
 	pub line: usize,
 	/// The column number of the token.
 	pub column: usize,
 }
 
+impl Token {
+	/// Returns the value of this token, which is the text of the source code that it was tokenized from. See `Span::text()`.
+	///
+	/// # Parameters
+	/// - `source_code` - The source code that this token was tokenized from.
+	///
+	/// # Returns
+	/// The value of this token as it appears in the source code.
+	#[must_use]
+	pub fn value<'source>(&self, source_code: &'source str) -> &'source str {
+		self.span.text(source_code)
+	}
+}
+
+/// The keywords of the language, mapped to their token types. Keywords are lexically identical to identifiers, so the lexer scans an identifier first and then
+/// looks up the scanned text here to determine if it's actually a keyword. This is equivalent to checking each keyword pattern (such as `^if\b`) before
+/// the `Identifier` pattern, but only requires a single hash lookup per identifier.
+static KEYWORDS: phf::Map<&'static str, TokenType> = phf::phf_map! {
+	"otherwise" => TokenType::KeywordOtherwise,
+	"if" => TokenType::KeywordIf,
+	"action" => TokenType::KeywordAction,
+	"new" => TokenType::KeywordNew,
+	"group" => TokenType::KeywordGroup,
+	"its" => TokenType::KeywordTail,
+	"run" => TokenType::KeywordRuntime,
+	"return" => TokenType::KeywordReturn,
+	"either" => TokenType::KeywordEither,
+	"let" => TokenType::KeywordLet,
+	"foreach" => TokenType::KeywordForEach,
+	"in" => TokenType::KeywordIn,
+	"while" => TokenType::KeywordWhile,
+};
+
+/// Returns whether the given byte is an ASCII whitespace character, as matched by `\s` in the reference regular expressions. Note that this is not the same as
+/// `u8::is_ascii_whitespace()`, which doesn't consider the vertical tab character to be whitespace.
+const fn is_whitespace(byte: u8) -> bool {
+	matches!(byte, b' ' | b'\t' | b'\n' | b'\x0B' | b'\x0C' | b'\r')
+}
+
+/// Returns whether the given byte is an ASCII "word" character, as matched by `\w` in the reference regular expressions.
+const fn is_word(byte: u8) -> bool {
+	byte.is_ascii_alphanumeric() || byte == b'_'
+}
+
+/// Returns whether the given byte is an ASCII digit, as matched by `\d` in the reference regular expressions.
+const fn is_digit(byte: u8) -> bool {
+	byte.is_ascii_digit()
+}
+
+/// Advances from the given index in the given bytes for as long as the given predicate holds, and returns the index of the first byte that doesn't match it
+/// (or the length of the bytes if all remaining bytes match).
+fn scan_while(bytes: &[u8], mut index: usize, predicate: fn(u8) -> bool) -> usize {
+	while bytes.get(index).is_some_and(|byte| predicate(*byte)) {
+		index += 1;
+	}
+	index
+}
+
+/// Matches a token at the given byte index of the given code using the reference regular expressions (see `TokenType::pattern()`). This is used by
+/// `scan_token` as a fallback when it runs into non-ASCII text, which is rare enough that it's not worth reimplementing the Unicode rules by hand.
+///
+/// # Parameters
+/// - `code` - The entire source code being tokenized.
+/// - `start` - The byte index in `code` to match a token at.
+///
+/// # Returns
+/// The type of the matched token and the byte index just past its end, or `None` if no token type matches.
+fn scan_token_with_patterns(code: &str, start: usize) -> Option<(TokenType, usize)> {
+	let (token_type, value) = TokenType::find_match(code.get(start..)?)?;
+	Some((token_type, start + value.len()))
+}
+
+/// Scans a single token at the given byte index of the given code. This is the core of the lexer; It dispatches on the first byte of the token and then
+/// scans forward over the rest of it, so each byte of the source code is only looked at a constant number of times. The result is exactly what
+/// `TokenType::find_match` would return for the same code, but without running every token type's regular expression in turn.
+///
+/// As an optimization, runs of whitespace are returned as a single `Whitespace` token instead of one token per whitespace character. The caller is expected
+/// to account for this when tracking line and column numbers.
+///
+/// # Parameters
+/// - `code` - The entire source code being tokenized.
+/// - `start` - The byte index in `code` to scan a token at. This should be less than the length of `code`.
+///
+/// # Returns
+/// The type of the scanned token and the byte index just past its end, or `None` if the code at `start` isn't a recognized token.
+fn scan_token(code: &str, start: usize) -> Option<(TokenType, usize)> {
+	let bytes = code.as_bytes();
+	let byte_at = |index: usize| bytes.get(index).copied();
+	let is_non_ascii_at = |index: usize| byte_at(index).is_some_and(|byte| !byte.is_ascii());
+
+	let token = match byte_at(start)? {
+		// Operators and punctuation
+		b'#' => (byte_at(start + 1) == Some(b'[')).then_some((TokenType::TagOpening, start + 2))?,
+		b'*' => (TokenType::Asterisk, start + 1),
+		b'^' => (TokenType::Caret, start + 1),
+		b':' => (TokenType::Colon, start + 1),
+		b',' => (TokenType::Comma, start + 1),
+		b'.' => (TokenType::Dot, start + 1),
+		b'+' => (TokenType::Plus, start + 1),
+		b'-' => (TokenType::Minus, start + 1),
+		b';' => (TokenType::Semicolon, start + 1),
+		b'=' if byte_at(start + 1) == Some(b'=') => (TokenType::DoubleEquals, start + 2),
+		b'=' => (TokenType::Equal, start + 1),
+		b'/' if byte_at(start + 1) == Some(b'/') => (
+			TokenType::LineComment,
+			bytes.iter().skip(start).position(|byte| *byte == b'\n' || *byte == b'\r').map_or(bytes.len(), |offset| start + offset),
+		),
+		b'/' => (TokenType::ForwardSlash, start + 1),
+
+		// Groupings
+		b'<' => (TokenType::LeftAngleBracket, start + 1),
+		b'{' => (TokenType::LeftBrace, start + 1),
+		b'[' => (TokenType::LeftBracket, start + 1),
+		b'(' => (TokenType::LeftParenthesis, start + 1),
+		b'>' => (TokenType::RightAngleBracket, start + 1),
+		b'}' => (TokenType::RightBrace, start + 1),
+		b']' => (TokenType::RightBracket, start + 1),
+		b')' => (TokenType::RightParenthesis, start + 1),
+
+		// Literals
+		b'"' => (TokenType::String, start + 1 + code.get(start + 1..)?.find('"')? + 1),
+		b'0'..=b'9' => {
+			let mut end = scan_while(bytes, start + 1, is_digit);
+			if byte_at(end) == Some(b'.') && byte_at(end + 1).is_some_and(is_digit) {
+				end = scan_while(bytes, end + 2, is_digit);
+			} else if byte_at(end) == Some(b'.') && is_non_ascii_at(end + 1) {
+				return scan_token_with_patterns(code, start);
+			}
+
+			// A non-ASCII character here may be a Unicode digit that continues the number
+			if is_non_ascii_at(end) {
+				return scan_token_with_patterns(code, start);
+			}
+
+			(TokenType::Number, end)
+		},
+
+		// Identifiers and keywords
+		b'a'..=b'z' | b'A'..=b'Z' | b'_' => {
+			let end = scan_while(bytes, start + 1, is_word);
+
+			// A non-ASCII character here may be a Unicode word character that continues the identifier
+			if is_non_ascii_at(end) {
+				return scan_token_with_patterns(code, start);
+			}
+
+			(KEYWORDS.get(code.get(start..end)?).copied().unwrap_or(TokenType::Identifier), end)
+		},
+
+		// Whitespace, as well as the comparison operators, which currently must be preceded by whitespace
+		byte if is_whitespace(byte) => {
+			let end = scan_while(bytes, start + 1, is_whitespace);
+			match byte_at(end) {
+				Some(b'<') => (TokenType::LessThan, end + 1),
+				Some(b'>') => (TokenType::GreaterThan, end + 1),
+				Some(byte) if !byte.is_ascii() => return scan_token_with_patterns(code, start),
+				_ => (TokenType::Whitespace, end),
+			}
+		},
+
+		// Anything else is either non-ASCII text, which we let the patterns handle, or an unrecognized token
+		byte if !byte.is_ascii() => return scan_token_with_patterns(code, start),
+		_ => return None,
+	};
+
+	Some(token)
+}
+
 /// Tokenizes a string of Cabin source code into a vector of tokens. This is the first step in compiling Cabin source code. The returned vector of tokens
 /// should be passed into the Cabin parser, which will convert it into an abstract syntax tree.
 ///
+/// This is a single pass over the source code; See `scan_token` for how individual tokens are recognized. Tokens refer back to the given source code by
+/// their spans rather than owning their text, so the source code must be kept around for as long as the tokens are in use.
+///
 /// # Parameters
-/// - `code` - The Cabin source code. If the given code is not valid Cabin code, this function makes no guarantees to return an error, nor does it make
+/// - `code` - The Cabin source code. Any tabs in the code are replaced with four spaces before tokenizing, and the returned tokens' spans refer to the code
+/// after this replacement. If the given code is not valid Cabin code, this function makes no guarantees to return an error, nor does it make
 /// a guarantee to return an `Ok`. This includes semantic and syntactic errors. This function will only return an error if an unrecognized token is found;
 /// Meaning a piece of code is encountered that doesn't match any known token types. This could be a non-ASCII character or just generally any unused character
 /// in the language like `@`.
 ///
 /// # Returns
 /// A vector of tokens in the order they appeared in the given source code after tokenization, or an `Err` if an unrecognized token was found.
-/// 
+///
 /// # Errors
 /// If the given code string is not syntactically valid Cabin code. It needn't be semantically valid, but it must be comprised of the proper tokens.
-#[allow(clippy::missing_panics_doc)]
-pub fn tokenize(mut code: String) -> anyhow::Result<Vec<Token>> {
-	code = code.replace('\t', "    ");
+pub fn tokenize(code: &mut String) -> anyhow::Result<Vec<Token>> {
+	if code.contains('\t') {
+		*code = code.replace('\t', "    ");
+	}
+
+	tokenize_from(code, 0)
+}
 
+/// Tokenizes the Cabin source code in the given string after the given byte index. This is used to tokenize a file that's been appended to some code
+/// that's already been tokenized, such as the prelude (see `prelude::tokenize_with_prelude`), without tokenizing that code again.
+///
+/// Unlike `tokenize`, this doesn't replace tabs in the code, so any tabs must already have been replaced.
+///
+/// # Parameters
+/// - `source_code` - The source code to tokenize. The code before `start` isn't tokenized, but the returned tokens' spans are still relative to the start
+/// of this entire string.
+/// - `start` - The byte index in `source_code` to start tokenizing at. Line and column numbers are counted from this index, so the first token after it is
+/// on line 1.
+///
+/// # Returns
+/// A vector of the tokens after `start` in the given source code, or an `Err` if an unrecognized token was found.
+///
+/// # Errors
+/// If the code after `start` isn't comprised of valid Cabin tokens.
+#[allow(clippy::missing_panics_doc)]
+pub fn tokenize_from(source_code: &str, start: usize) -> anyhow::Result<Vec<Token>> {
 	let mut tokens = Vec::new();
 	let mut line = 1;
 	let mut column = 1;
+	let mut position = start;
 
-	// We only read tokens from the start of a string, so we repeatedly loop over the code and remove the tokenized text when we find tokens.
-	// This means we can just iterate while code isn't empty.
-	while !code.is_empty() {
-		// We've got a match - we found a token that matches the start of the code
-		if let Some((token_type, value)) = TokenType::find_match(&code) {
-			let length = value.len(); // This must be done early so that we aren't trying to get the length of a moved value
-			let newline_count = value.chars().filter(|char| *char == '\n').count();
-
-			// Add the token - ignore whitespace and comments!
-			if token_type != TokenType::Whitespace && token_type != TokenType::LineComment {
-				let token = Token { token_type, value, line, column };
-				tokens.push(token);
-			}
-			// If it is whitespace, Add to the newlines!
-			else {
-				line += newline_count;
-			}
-
-			// Update the column and the code so that the code cuts off the bit we just tokenized
-			column = if newline_count > 0 { 1 } else { column + length };
-			code = code.get(length..).unwrap().to_owned();
-		}
+	while position < source_code.len() {
 		// Unrecognized token - return an error!
-		else {
+		let Some((token_type, end)) = scan_token(source_code, position) else {
 			anyhow::bail!(
 				"{line}:{column}:{severity}:Unrecognized token: {code}",
 				severity = "error",
-				code = code.split('\n').next().unwrap()
+				code = source_code.get(position..).unwrap().split('\n').next().unwrap()
 			);
+		};
+
+		let span = Span { start: position, end };
+		let value = span.text(source_code);
+
+		// Ignore whitespace and comments, but add to the newlines! A whitespace token may be an entire run of whitespace, so the column is
+		// the number of characters after the last newline in it.
+		if token_type == TokenType::Whitespace || token_type == TokenType::LineComment {
+			line += value.bytes().filter(|byte| *byte == b'\n').count();
+			column = value.rfind('\n').map_or(column + value.len(), |index| value.len() - index);
+		}
+		// Add the token
+		else {
+			let next_column = if value.contains('\n') { 1 } else { column + value.len() };
+			tokens.push(Token { token_type, span, line, column });
+			column = next_column;
 		}
+
+		position = end;
 	}
 
 	// We'll only get here if we didn't get any errors, so we can just return the tokens wrapped in an `Ok`
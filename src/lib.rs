@@ -0,0 +1,77 @@
+//! # Cabin
+//!
+//! A dead simple, highly performant, and extremely safe programming language.
+//!
+//! ## Installation
+//!
+//! Cabin can be installed cross-platform with Cargo:
+//!
+//! ```bash
+//! cargo install cabin-language
+
+/// The `compile_time` module. Although lang2 is a compiled language, it has the ability to run
+/// arbitrary code at compile time, which requires an `compile_time`.
+pub mod compile_time;
+
+/// The lexer module, which tokenizes source code into a stream of tokens.
+pub mod lexer;
+
+/// The parser module, which parses a stream of tokens into an abstract syntax tree.
+pub mod parser;
+
+/// The scopes module, which manages the scope of variables and functions.
+pub mod scopes;
+
+/// The context module, which manages global state of the compiler.
+pub mod context;
+
+/// The "C Runner" module. This module handles transpiling ASTs to C code, compiling C code, running C code, removing compiled C code, etc.
+/// Basically everything after the `compile_time` step is going to go in here.
+pub mod compiler;
+
+/// The emitter module. This handles writing generated C code: Indenting it as it's written, removing unnecessary blank lines, and streaming it into files.
+pub mod emitter;
+
+/// The regions module. This handles allocating the objects of generated C code in regions, which are bump allocators that are freed all at once when the
+/// scope that they belong to ends.
+pub mod regions;
+
+/// The text module. This handles the runtime representation of `Text` in generated C code, and the pool of Text constants that are known at
+/// compile-time.
+pub mod text;
+
+/// The reachability module. This finds the parts of the generated C code that a program can reach from its entry point, so that the rest, such as unused
+/// parts of the prelude, can be left out of the program.
+pub mod reachability;
+
+/// The build profile module. This handles reading build profiles from a project's configuration, and turning them into flags for the C compiler.
+pub mod profile;
+
+/// The build cache module. This handles caching the generated C code and native executables of programs, so that programs that haven't changed since they
+/// were last built don't need to be compiled again.
+pub mod cache;
+
+/// The timings module. This handles recording how long each phase of the compiler takes and how much memory it uses, for the `--timings` flag.
+pub mod timings;
+
+/// The translation units module. This handles splitting generated C code into multiple translation units that share a header, and compiling them in
+/// parallel with a cache of compiled units, for the `--units` flag.
+pub mod units;
+
+/// The formatter module. This handles code formatting for Cabin code. The Cabin formatter is un-opinionated, and provides no configuration options. The formatting
+/// process is fairly straightforward; The code is parsed and then the AST is recursively turned back into Cabin code. Essentially, it's a transpiler into itself.
+pub mod formatter;
+
+/// The CLI module. This module handles tooling related to the CLI, such as pretty-printing code snippets and errors, configuration options, subcommands, etc.
+pub mod cli;
+
+/// The `util` module. This module handles utility operations like number formatting.
+pub mod util;
+
+/// The prelude module. This contains the Cabin prelude, which is a string of cabin code that's appended automatically to the beginning of all Cabin files prior
+/// to compilation, along with its tokens, which are generated when the compiler is built.
+pub mod prelude;
+
+/// The modules module. This handles programs made of more than one file: Reading the files of a project, tokenizing them in parallel, and ordering them
+/// by the dependencies between them.
+pub mod modules;
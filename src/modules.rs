@@ -0,0 +1,227 @@
+use crate::{
+	context::Context,
+	lexer::{tokenize_from, Span, Token, TokenType},
+	prelude::{PRELUDE, PRELUDE_SEPARATOR, PRELUDE_TOKENS},
+	util::map_in_parallel,
+};
+
+use std::collections::{HashMap, HashSet};
+
+/// The path of a project's configuration file. The directory that it's in is the root of the project.
+pub const CONFIG_FILE: &str = "./cabin.toml";
+
+/// The main file of a project whose configuration doesn't name one with the `main` field of its `[information]` table (see `entry_point()`).
+pub const DEFAULT_ENTRY_POINT: &str = "./src/main.cbn";
+
+/// A module of a program. Each Cabin file of a project is a module, and the modules are compiled together as one program: Every module declares its global
+/// variables in the same global scope as the prelude, so a module uses another module's declarations just by referring to them, without importing them.
+/// Cabin doesn't allow shadowing, so two modules can't declare global variables with the same name.
+#[derive(Clone, Debug)]
+pub struct Module {
+	/// The path of the file that this module was read from. This is used to say which file an error is in.
+	pub path: String,
+	/// The span of this module's code in the program's source code (see `Context::source_code`).
+	pub span: Span,
+}
+
+/// Returns the path of the main file of the project in the current directory, which is the `main` field of the `[information]` table of its configuration
+/// file, or `DEFAULT_ENTRY_POINT` if the field isn't given.
+///
+/// # Returns
+/// The path of the project's main file, or `None` if the current directory isn't a project, because it has no readable configuration file.
+fn entry_point() -> Option<String> {
+	let config: toml_edit::DocumentMut = std::fs::read_to_string(CONFIG_FILE).ok()?.parse().ok()?;
+	let main = config.get("information").and_then(|information| information.get("main")).and_then(toml_edit::Item::as_str);
+	Some(main.unwrap_or(DEFAULT_ENTRY_POINT).to_owned())
+}
+
+/// Returns the path of the file to compile when a command isn't given one, which is the main file of the project in the current directory (see
+/// `entry_point()`).
+///
+/// # Returns
+/// The path of the project's main file.
+pub fn main_file() -> String {
+	entry_point().unwrap_or_else(|| DEFAULT_ENTRY_POINT.to_owned())
+}
+
+/// Returns the paths of the files of the program whose main file is the given file. The entry point of the project in the current directory (see
+/// `entry_point()`) is compiled with every other Cabin file in the directory that it's in, including files in directories inside of it; Any other file is
+/// a program on its own, so compiling a single file never pulls in files that it wasn't written with.
+///
+/// # Parameters
+/// - `main_file` - The path of the program's main file, such as `./src/main.cbn`.
+///
+/// # Returns
+/// The paths of the program's files, starting with the main file and followed by the others in order of their paths.
+fn module_paths(main_file: &str) -> Vec<String> {
+	let Some(entry_point) = entry_point() else {
+		return vec![main_file.to_owned()];
+	};
+	let (Ok(main_path), Ok(entry_path)) = (std::fs::canonicalize(main_file), std::fs::canonicalize(&entry_point)) else {
+		return vec![main_file.to_owned()];
+	};
+	let Some(source_directory) = entry_path.parent().filter(|_| main_path == entry_path) else {
+		return vec![main_file.to_owned()];
+	};
+
+	let mut other_paths = walkdir::WalkDir::new(source_directory)
+		.into_iter()
+		.filter_map(Result::ok)
+		.filter(|entry| !entry.file_type().is_dir() && entry.path().extension().is_some_and(|extension| extension == "cbn"))
+		.filter(|entry| std::fs::canonicalize(entry.path()).is_ok_and(|path| path != main_path))
+		.map(|entry| entry.path().display().to_string())
+		.collect::<Vec<_>>();
+	other_paths.sort();
+
+	let mut paths = vec![main_file.to_owned()];
+	paths.extend(other_paths);
+	paths
+}
+
+/// Reads the files of the program whose main file is the given file (see `module_paths()`), and puts them together after the prelude into the source code
+/// of the program. The returned source code and modules should be stored in the context (see `Context::source_code` and `Context::modules`), and tokenized
+/// with `tokenize_modules()`. A program with a single file has the same source code as `prelude::with_prelude()` returns for that file.
+///
+/// Tabs in the files are replaced with four spaces, as with `lexer::tokenize()`.
+///
+/// # Parameters
+/// - `main_file` - The path of the program's main file.
+///
+/// # Returns
+/// The source code of the program, and the program's modules in the order of their paths, starting with the main file.
+///
+/// # Errors
+/// If any of the program's files couldn't be read.
+pub fn read_program(main_file: &str) -> anyhow::Result<(String, Vec<Module>)> {
+	let mut source_code = PRELUDE.to_owned() + PRELUDE_SEPARATOR;
+	let mut modules = Vec::new();
+	for path in module_paths(main_file) {
+		if !modules.is_empty() {
+			source_code.push_str(PRELUDE_SEPARATOR);
+		}
+		let module_code = std::fs::read_to_string(&path).map_err(|error| anyhow::anyhow!("Error reading {path}: {error}"))?;
+		let start = source_code.len();
+		source_code.push_str(&module_code.replace('\t', "    "));
+		modules.push(Module {
+			path,
+			span: Span { start, end: source_code.len() },
+		});
+	}
+	Ok((source_code, modules))
+}
+
+/// Tokenizes the modules of a program, in parallel on up to `context.jobs` threads. Each module is tokenized as its own file, so its tokens have the line
+/// numbers they appear on in its file. The tokens of the modules are then put together after the tokens of the prelude in the order of the dependencies
+/// between the modules (see `dependency_order()`), so the declarations of a module are parsed, and its global statements are run, before those of the
+/// modules that use it.
+///
+/// # Parameters
+/// - `context` - The global compiler context, with the source code and modules returned by `read_program()`.
+///
+/// # Returns
+/// The tokens of the prelude followed by the tokens of the program's modules.
+///
+/// # Errors
+/// If any module isn't comprised of valid Cabin tokens. The error says which file the unrecognized token is in.
+pub fn tokenize_modules(context: &Context) -> anyhow::Result<Vec<Token>> {
+	let module_tokens = map_in_parallel(&context.modules, context.jobs, &|module: &Module| {
+		tokenize_from(context.source_code.get(..module.span.end).unwrap_or_default(), module.span.start).map_err(|error| anyhow::anyhow!("{}:{error}", module.path))
+	})
+	.into_iter()
+	.collect::<anyhow::Result<Vec<_>>>()?;
+
+	let mut tokens = PRELUDE_TOKENS.to_vec();
+	for index in dependency_order(&module_tokens, &context.source_code) {
+		tokens.extend_from_slice(module_tokens.get(index).map_or(&[], Vec::as_slice));
+	}
+	Ok(tokens)
+}
+
+/// Returns the names of the global variables that a module declares, which are the names after each `let` that isn't inside of any braces.
+///
+/// # Parameters
+/// - `tokens` - The tokens of the module.
+/// - `source_code` - The source code that the tokens were tokenized from.
+///
+/// # Returns
+/// The names of the module's global variables.
+fn declared_names<'source>(tokens: &[Token], source_code: &'source str) -> Vec<&'source str> {
+	let mut depth = 0_usize;
+	let mut names = Vec::new();
+	for (token, next) in tokens.iter().zip(tokens.iter().skip(1)) {
+		match token.token_type {
+			TokenType::LeftBrace => depth += 1,
+			TokenType::RightBrace => depth = depth.saturating_sub(1),
+			TokenType::KeywordLet if depth == 0 && next.token_type == TokenType::Identifier => names.push(next.value(source_code)),
+			_ => {},
+		}
+	}
+	names
+}
+
+/// Returns the order to put the modules of a program in, so that each module comes after the modules that it uses. A module uses another module if it
+/// refers to any of the global variables declared in it (see `declared_names()`). Modules can use each other in a cycle, such as with mutually recursive
+/// functions, because the global statements of the whole program are still evaluated in the order of their own dependencies at compile-time (see
+/// `Program::compile_time_evaluate()`); The modules in a cycle still come after the modules that they use outside of the cycle, and the order within the
+/// cycle only depends on the paths of the modules.
+///
+/// # Parameters
+/// - `module_tokens` - The tokens of each module, starting with the program's main file.
+/// - `source_code` - The source code that the tokens were tokenized from.
+///
+/// # Returns
+/// The indices of the modules, in the order to put them in. The main file comes last unless another module uses it.
+fn dependency_order(module_tokens: &[Vec<Token>], source_code: &str) -> Vec<usize> {
+	let mut declaring_modules = HashMap::new();
+	for (index, tokens) in module_tokens.iter().enumerate() {
+		for name in declared_names(tokens, source_code) {
+			declaring_modules.entry(name).or_insert(index);
+		}
+	}
+
+	let dependencies = module_tokens
+		.iter()
+		.enumerate()
+		.map(|(index, tokens)| {
+			let mut used_modules = tokens
+				.iter()
+				.filter(|token| token.token_type == TokenType::Identifier)
+				.filter_map(|token| declaring_modules.get(token.value(source_code)).copied())
+				.filter(|used_module| *used_module != index)
+				.collect::<HashSet<_>>()
+				.into_iter()
+				.collect::<Vec<_>>();
+			used_modules.sort_unstable();
+			used_modules
+		})
+		.collect::<Vec<_>>();
+
+	let mut order = Vec::with_capacity(module_tokens.len());
+	let mut visited = vec![false; module_tokens.len()];
+	for root in (1..module_tokens.len()).chain(std::iter::once(0)) {
+		visit(root, &dependencies, &mut visited, &mut order);
+	}
+	order
+}
+
+/// Adds a module to the dependency order of a program after the modules that it uses (see `dependency_order()`), unless it's already been visited.
+///
+/// # Parameters
+/// - `module` - The index of the module.
+/// - `dependencies` - The indices of the modules that each module uses.
+/// - `visited` - Whether each module has been visited.
+/// - `order` - The modules in the order to put them in so far.
+fn visit(module: usize, dependencies: &[Vec<usize>], visited: &mut [bool], order: &mut Vec<usize>) {
+	let Some(is_visited) = visited.get_mut(module) else {
+		return;
+	};
+	if *is_visited {
+		return;
+	}
+	*is_visited = true;
+
+	for used_module in dependencies.get(module).into_iter().flatten() {
+		visit(*used_module, dependencies, visited, order);
+	}
+	order.push(module);
+}
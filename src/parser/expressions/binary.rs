@@ -1,82 +1,81 @@
 use crate::{
-	compile_time::{CompileTime, TranspileToC},
+	compile_time::{bytecode::evaluate_number_operation, CompileTime, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parser::{
 		expressions::{
-			function_call::FunctionCall,
-			literals::{variable_reference::VariableReference, Literal, LiteralValue},
+			function_call::{argument_to_c, FunctionCall},
+			literals::{either::tagged_either, function_declaration::FunctionDeclaration, variable_reference::VariableReference, Literal, LiteralValue},
 			run::ParentExpression,
 			util::{name::Name, types::Typed},
 			Expression,
 		},
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
+	regions::{allocating_in, allocation_region, assignment_region},
 };
 
-use std::collections::VecDeque;
+use std::{
+	fmt::{self, Write as _},
+	sync::Arc,
+};
 
 use colored::Colorize as _;
 
-/// A binary operation. More specifically, this represents not one operation, but a group of operations that share the same precedence.
-/// For example, the `+` and `-` operators share the same precedence, so they are grouped together in the `ADDITIVE` constant.
+/// The binding power of assignment (`=`), which binds the loosest of any binary operator. Assignment isn't available when parsing a type (see
+/// `Context::is_parsing_type`), so types are parsed with `COMPARISON` as their minimum binding power instead.
+const ASSIGNMENT: u8 = 1;
+
+/// The binding power of the comparison operators, such as `==`, `<` and `>`.
+const COMPARISON: u8 = 2;
+
+/// Returns how tightly the given binary operator binds its operands, or `None` if the token isn't a binary operator. Operators with a higher binding power
+/// are grouped first, so `a + b * c` is `a + (b * c)`, and operators with the same binding power are grouped from left to right, so `a - b - c` is
+/// `(a - b) - c`.
 ///
 /// # Parameters
-/// `<'this>` - The lifetime of this operation, to ensure that the contained reference to the precedent operation lives at least that long.
-struct BinaryOperation<'this> {
-	/// The operation that has the next highest precedence, or `None` if this operation has the highest precedence.
-	precedent: Option<&'this BinaryOperation<'this>>,
-	/// The token types that represent this operation, used to parse a binary expression.
-	token_types: &'this [TokenType],
+/// - `token_type` - The type of the token.
+///
+/// # Returns
+/// The binding power of the operator.
+const fn binding_power(token_type: TokenType) -> Option<u8> {
+	Some(match token_type {
+		TokenType::Equal => ASSIGNMENT,
+		TokenType::DoubleEquals | TokenType::LessThan | TokenType::GreaterThan => COMPARISON,
+		TokenType::Plus | TokenType::Minus => 3,
+		// TODO: Add modulo
+		TokenType::Asterisk | TokenType::ForwardSlash => 4,
+		// TODO: make this right-associative
+		TokenType::Caret => 5,
+		_ => return None,
+	})
 }
 
-// TODO: make this right-associative
-/// The exponentiation operation, which has the highest precedence. This covers the `^` operator.
-static EXPONENTIATION: BinaryOperation<'static> = BinaryOperation {
-	precedent: None,
-	token_types: &[TokenType::Caret],
-};
-
-// TODO: Add modulo
-/// The multiplicative operations, which have the second highest precedence. This covers the `*` and `/` operators.
-static MULTIPLICATIVE: BinaryOperation<'static> = BinaryOperation {
-	precedent: Some(&EXPONENTIATION),
-	token_types: &[TokenType::Asterisk, TokenType::ForwardSlash],
-};
-
-/// The additive operations, which have the third precedence. This covers the `+` and `-` operators.
-static ADDITIVE: BinaryOperation<'static> = BinaryOperation {
-	precedent: Some(&MULTIPLICATIVE),
-	token_types: &[TokenType::Plus, TokenType::Minus],
-};
-
-/// The comparison operations, such as "==", "<=", etc.
-static COMPARISON: BinaryOperation<'static> = BinaryOperation {
-	precedent: Some(&ADDITIVE),
-	token_types: &[TokenType::DoubleEquals, TokenType::LessThan, TokenType::GreaterThan],
-};
-
-/// The assignment operations, which have the lowest precedence. This covers the `=` operator.
-static ASSIGNMENT: BinaryOperation<'static> = BinaryOperation {
-	precedent: Some(&COMPARISON),
-	token_types: &[TokenType::Equal],
-};
-
-impl BinaryOperation<'_> {
-	/// Parses the precedent operation of this one if it exists, otherwise, parses a function call (which has higher precedence than any binary operation)
-	///
-	/// # Parameters
-	/// - `tokens` - The token stream to parse
-	/// - `current_scope` - The current scope
-	/// - `debug_info` - The debug information
-	fn parse_precedent(&self, tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Expression> {
-		if let Some(precedent) = self.precedent {
-			parse_binary_expression(precedent, tokens, context)
-		} else {
-			FunctionCall::parse(tokens, context)
-		}
-	}
+/// Marks a variable's value as unknown at compile-time, because it's been assigned a value that's only known at runtime. The variable keeps the type of
+/// the value it held before, so that it can still be transpiled, and the bytecode virtual machine won't run loops that use it (see
+/// `bytecode::run_while_loop()`).
+///
+/// # Parameters
+/// - `name` - The name of the variable.
+/// - `scope_id` - The id of the scope that the variable is referenced from.
+/// - `context` - The global compiler context.
+///
+/// # Errors
+/// If no variable with the given name exists in the scope, or the type of its previous value can't be determined.
+pub fn forget_value(name: &Name, scope_id: usize, context: &mut Context) -> anyhow::Result<()> {
+	let unknown = context.unknown_at_compile_time().clone();
+	let previous_value = context.scope_data.get_variable_from_id(name, scope_id).and_then(|variable| variable.value.clone());
+	let value_type = match previous_value {
+		Some(Expression::Literal(literal)) if literal.is(&unknown, context)? => None,
+		Some(value) => match value.get_type(context)? {
+			// Only types that are named can be used as a type annotation
+			value_type @ Literal(LiteralValue::VariableReference(_), ..) => Some(Expression::Literal(value_type)),
+			_ => None,
+		},
+		None => None,
+	};
+	context.scope_data.forget_variable_value_from_id(name, value_type, Expression::Literal(unknown), scope_id)
 }
 
 /// A binary expression node in the abstract syntax tree. This represents an operation that takes two operands in infix notation.
@@ -90,21 +89,28 @@ pub struct BinaryExpression {
 	pub right: Expression,
 }
 
-/// Parses a binary expression with the given operation.
+/// Parses a binary expression whose operators all bind at least as tightly as the given binding power, with precedence climbing: Each operand is parsed
+/// as a function call (which binds tighter than any binary operator), and then operators are consumed in a loop, with the right operand of each one
+/// parsed by a recursive call that only takes operators that bind tighter than it. A chain of operators with the same binding power is parsed by the loop
+/// rather than by recursion, so only operators of increasing binding power nest calls, and the stack depth doesn't grow with the length of an expression.
 ///
 /// # Parameters
-/// - `operation` - The operation to parse
+/// - `minimum_binding_power` - The lowest binding power of the operators to parse (see `binding_power()`).
 /// - `tokens` - The token stream to parse
 /// - `context` - Global data about the compiler's state
 ///
 /// # Returns
 /// A `Result` containing either the parsed expression or an `Error`.
-fn parse_binary_expression(operation: &BinaryOperation<'_>, tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Expression> {
-	let mut expression = operation.parse_precedent(tokens, context)?;
-	while tokens.next_is_one_of(operation.token_types) {
-		let operator = tokens.pop_type(tokens.peek().unwrap().token_type.clone()).unwrap_or_else(|_error| unreachable!());
-		let right = operation.parse_precedent(tokens, context)?;
-		expression = Expression::BinaryExpression(Box::new(BinaryExpression {
+fn parse_binary_expression(minimum_binding_power: u8, tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Expression> {
+	let mut expression = FunctionCall::parse(tokens, context)?;
+	while let Some((operator, operator_binding_power)) = tokens
+		.peek()
+		.and_then(|token| Some((token.token_type, binding_power(token.token_type)?)))
+		.filter(|(_operator, operator_binding_power)| *operator_binding_power >= minimum_binding_power)
+	{
+		tokens.pop_type(operator).unwrap_or_else(|_error| unreachable!());
+		let right = parse_binary_expression(operator_binding_power + 1, tokens, context)?;
+		expression = Expression::BinaryExpression(Arc::new(BinaryExpression {
 			left: expression,
 			operator,
 			right,
@@ -117,8 +123,8 @@ fn parse_binary_expression(operation: &BinaryOperation<'_>, tokens: &mut VecDequ
 impl Parse for BinaryExpression {
 	type Output = Expression;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
-		parse_binary_expression(if context.is_parsing_type { &COMPARISON } else { &ASSIGNMENT }, tokens, context)
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
+		parse_binary_expression(if context.is_parsing_type { COMPARISON } else { ASSIGNMENT }, tokens, context)
 	}
 }
 
@@ -187,10 +193,10 @@ impl CompileTime for BinaryExpression {
 				)
 			})?;
 
-			return Ok(Expression::BinaryExpression(Box::new(Self {
+			return Ok(Expression::BinaryExpression(Arc::new(Self {
 				left,
 				right,
-				operator: self.operator.clone(),
+				operator: self.operator,
 			})));
 		};
 
@@ -269,10 +275,10 @@ impl CompileTime for BinaryExpression {
 
 						Expression::Literal(literal) => {
 							if literal.is(&context.unknown_at_compile_time().clone(), context)? {
-								return Ok(Expression::BinaryExpression(Box::new(Self {
+								return Ok(Expression::BinaryExpression(Arc::new(Self {
 									left: Expression::Literal(Literal::new(LiteralValue::VariableReference(left_variable_reference.clone()))),
 									right: self.right.clone(),
-									operator: self.operator.clone(),
+									operator: self.operator,
 								})));
 							}
 
@@ -287,10 +293,10 @@ impl CompileTime for BinaryExpression {
 						// it couldn't be fully evaluated into an object at compile-time. In this case, we just return the
 						// binary expression
 						_ => {
-							return Ok(Expression::BinaryExpression(Box::new(Self {
+							return Ok(Expression::BinaryExpression(Arc::new(Self {
 								left: Expression::Literal(Literal::new(LiteralValue::VariableReference(left_variable_reference.clone()))),
 								right: self.right.clone(),
-								operator: self.operator.clone(),
+								operator: self.operator,
 							})))
 						},
 					}
@@ -310,31 +316,29 @@ impl CompileTime for BinaryExpression {
 			let Literal(LiteralValue::VariableReference(variable_reference), ..) = &left_literal else {
 				anyhow::bail!("Attempted to assign to non-identifier value");
 			};
+			if context.scope_data.is_global_variable(variable_reference.name(), context.scope_data.unique_id()) {
+				context.call_cache.record_global_write();
+			}
+			// A variable assigned a value that's only known at runtime no longer has the value it had before, so it can't be used at compile-time
 			if let Expression::Literal(right_literal) = &right {
-				if !right_literal.is(&context.unknown_at_compile_time().clone(), context)? {
+				if right_literal.is(&context.unknown_at_compile_time().clone(), context)? {
+					forget_value(variable_reference.name(), context.scope_data.unique_id(), context)?;
+				} else {
 					context.scope_data.reassign_variable(variable_reference.name(), right)?;
 				}
 			} else {
 				context.scope_data.reassign_variable(variable_reference.name(), right)?;
 			}
-			return Ok(Expression::BinaryExpression(Box::new(self.clone())));
+			return Ok(Expression::BinaryExpression(Arc::new(self.clone())));
 		}
 
 		// Other operators
-		let operator = Name(
-			match self.operator {
-				TokenType::Plus => "plus",
-				TokenType::Minus => "minus",
-				TokenType::Asterisk => "times",
-				TokenType::ForwardSlash => "divided_by",
-				TokenType::DoubleEquals => "equals",
-				_ => anyhow::bail!(
-					"The binary operator \"{operator}\" is not yet supported\n\twhile converting the binary operation \"{operator}\" to C code",
-					operator = format!("{:?}", self.operator).bold().cyan()
-				),
-			}
-			.to_owned(),
-		);
+		let Some(operator) = operator_method_name(self.operator).map(Name::from) else {
+			anyhow::bail!(
+				"The binary operator \"{operator}\" is not yet supported\n\twhile converting the binary operation \"{operator}\" to C code",
+				operator = format!("{:?}", self.operator).bold().cyan()
+			);
+		};
 
 		let right = self.right.compile_time_evaluate(context, with_side_effects).map_err(|error| {
 			anyhow::anyhow!(
@@ -343,27 +347,36 @@ impl CompileTime for BinaryExpression {
 			)
 		})?;
 
+		// Operations on known numbers are performed directly instead of by calling the operator's function on the `Number` group
+		if let Some(result) = evaluate_number_operation(self.operator, &Expression::Literal(left_literal.clone()), &right, context) {
+			return Ok(result);
+		}
+
 		if let Literal(LiteralValue::VariableReference(variable_reference), ..) = left_literal {
-			let left_value = &context
+			// Parameters aren't declared in the scope of the function body, so their values are only known at runtime
+			let Some(left_value) = context
 				.scope_data
 				.get_variable_from_id(variable_reference.name(), variable_reference.scope_id())
-				.ok_or_else(|| anyhow::anyhow!(""))?
-				.value
-				.as_ref()
-				.unwrap()
-				.clone();
+				.and_then(|variable| variable.value.clone())
+			else {
+				return Ok(Expression::BinaryExpression(Arc::new(Self {
+					left: Expression::Literal(Literal::new(LiteralValue::VariableReference(variable_reference))),
+					right,
+					operator: self.operator,
+				})));
+			};
 
-			left_literal = match left_value {
+			left_literal = match &left_value {
 				// If the left is an object, our literal is that object
-				Expression::Literal(Literal(LiteralValue::Object(object), ..)) => Literal::new(LiteralValue::Object(object.clone())),
+				Expression::Literal(Literal(LiteralValue::Object(object), ..)) => Literal::new(LiteralValue::Object(Arc::clone(object))),
 
 				// If its a parameter, we just return the binary expression
 				Expression::Literal(literal) => {
 					if literal.is(&context.unknown_at_compile_time().clone(), context)? {
-						return Ok(Expression::BinaryExpression(Box::new(Self {
+						return Ok(Expression::BinaryExpression(Arc::new(Self {
 							left: Expression::Literal(Literal::new(LiteralValue::VariableReference(variable_reference))),
 							right,
-							operator: self.operator.clone(),
+							operator: self.operator,
 						})));
 					}
 
@@ -372,10 +385,10 @@ impl CompileTime for BinaryExpression {
 
 				// If the left is any other expression, like a binary expression or a function call, that means that
 				_ => {
-					return Ok(Expression::BinaryExpression(Box::new(Self {
+					return Ok(Expression::BinaryExpression(Arc::new(Self {
 						left: Expression::Literal(Literal::new(LiteralValue::VariableReference(variable_reference))),
 						right,
-						operator: self.operator.clone(),
+						operator: self.operator,
 					})));
 				},
 			};
@@ -414,6 +427,186 @@ impl CompileTime for BinaryExpression {
 	}
 }
 
+/// Returns the C operator that a binary operator is transpiled to when its operands are scalar values (see `Name::unboxed_c_type()`).
+///
+/// # Parameters
+/// - `operator` - The type of the binary operator's token.
+///
+/// # Returns
+/// The C operator, or `None` if the operator isn't an arithmetic or comparison operator.
+const fn scalar_c_operator(operator: TokenType) -> Option<&'static str> {
+	Some(match operator {
+		TokenType::Plus => "+",
+		TokenType::Minus => "-",
+		TokenType::Asterisk => "*",
+		TokenType::ForwardSlash => "/",
+		TokenType::DoubleEquals => "==",
+		TokenType::LessThan => "<",
+		TokenType::GreaterThan => ">",
+		_ => return None,
+	})
+}
+
+/// Returns the scalar C type that an operand of a binary expression is lowered to, if its type is a scalar group (see `Name::unboxed_c_type()`) or an
+/// either with integer tags (see `tagged_either()`). An operand with a scalar type is transpiled to a plain C value, so it can be used directly with a C
+/// operator.
+///
+/// # Parameters
+/// - `operand` - The operand of the binary expression.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The scalar C type of the operand, or `None` if its type isn't scalar or couldn't be found. The tags of an either are typed as the either itself, so
+/// that only tags of the same either are compared to each other.
+pub fn scalar_c_type(operand: &Expression, context: &mut Context) -> Option<String> {
+	let type_name = operand_type_name(operand, context)?;
+	type_name
+		.unboxed_c_type()
+		.map(str::to_owned)
+		.or_else(|| tagged_either(type_name, context).map(|_either| type_name.c_name()))
+}
+
+/// Returns the name of the type of an operand of a binary expression.
+///
+/// # Parameters
+/// - `operand` - The operand of the binary expression.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The name of the operand's type, or `None` if its type couldn't be found or isn't a named type.
+fn operand_type_name(operand: &Expression, context: &mut Context) -> Option<Name> {
+	match operand.get_type(context) {
+		Ok(Literal(LiteralValue::VariableReference(type_reference), ..)) => Some(*type_reference.name()),
+		_ => None,
+	}
+}
+
+/// Returns whether an operand of a binary expression has the type of one of the compile-time parameters of the function that's being transpiled. A
+/// value of a generic type is a pointer to a value whose type isn't known in C.
+///
+/// # Parameters
+/// - `operand` - The operand of the binary expression.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// Whether the operand's type is generic.
+fn is_generic(operand: &Expression, context: &mut Context) -> bool {
+	operand_type_name(operand, context).is_some_and(|type_name| context.generics_stack.last().is_some_and(|generics| generics.contains(&type_name)))
+}
+
+/// Returns the name of the action that implements a binary operator on a group, such as `plus` for `+`.
+///
+/// # Parameters
+/// - `operator` - The type of the binary operator's token.
+///
+/// # Returns
+/// The name of the action, or `None` if the operator isn't implemented by an action.
+const fn operator_method_name(operator: TokenType) -> Option<&'static str> {
+	Some(match operator {
+		TokenType::Plus => "plus",
+		TokenType::Minus => "minus",
+		TokenType::Asterisk => "times",
+		TokenType::ForwardSlash => "divided_by",
+		TokenType::DoubleEquals => "equals",
+		TokenType::LessThan => "less_than",
+		TokenType::GreaterThan => "greater_than",
+		_ => return None,
+	})
+}
+
+/// Returns the action with the given name on the group of a value's type, such as the action that implements a binary operator on its left operand.
+///
+/// # Parameters
+/// - `operand` - The value, such as the left operand of a binary expression.
+/// - `method_name` - The name of the action, such as the one that implements an operator (see `operator_method_name()`).
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The declaration of the action, or `None` if the value's type isn't a group or the group has no such action.
+fn group_method(operand: &Expression, method_name: Name, context: &mut Context) -> Option<Arc<FunctionDeclaration>> {
+	let type_name = operand_type_name(operand, context)?;
+	let Expression::Literal(Literal(LiteralValue::Group(group), ..)) = context.scope_data.get_global_variable(&type_name)?.value.as_ref()? else {
+		return None;
+	};
+	match group.fields.iter().find(|field| field.name == method_name)?.value.as_ref()? {
+		Expression::Literal(Literal(LiteralValue::FunctionDeclaration(method), ..)) => Some(Arc::clone(method)),
+		_ => None,
+	}
+}
+
+/// Returns the action that a method call calls when the object it's called on isn't known at compile-time, which is the action with the accessed name
+/// on the group of the object's type. The action is then called directly, instead of through the object's field.
+///
+/// # Parameters
+/// - `function` - The function of the method call, such as `list.length`.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The declaration of the action and the object it's called on, or `None` if the function isn't a field access on an object whose type is a group with
+/// an action of that name.
+pub fn runtime_method(function: &Expression, context: &mut Context) -> Option<(Arc<FunctionDeclaration>, Expression)> {
+	let Expression::BinaryExpression(access) = function else {
+		return None;
+	};
+	if access.operator != TokenType::Dot {
+		return None;
+	}
+	let Expression::Literal(Literal(LiteralValue::VariableReference(method_name), ..)) = &access.right else {
+		return None;
+	};
+	let method = group_method(&access.left, *method_name.name(), context)?;
+	Some((method, access.left.clone()))
+}
+
+impl BinaryExpression {
+	/// Returns the C code of this binary expression when at least one of its operands is a scalar value (see `scalar_c_type()`). Scalars are plain C
+	/// values with no fields or actions at runtime, so every operation on them is lowered to a C operator, and an operation that can't be is an error.
+	/// A generic operand used with a scalar is unboxed to the scalar's type.
+	///
+	/// # Parameters
+	/// - `left` - The C code of the left operand.
+	/// - `right` - The C code of the right operand.
+	/// - `left_type` - The scalar C type of the left operand, if it's a scalar.
+	/// - `right_type` - The scalar C type of the right operand, if it's a scalar.
+	/// - `context` - The global compiler context.
+	///
+	/// # Returns
+	/// The C code of the operation.
+	///
+	/// # Errors
+	/// If the operator isn't supported on scalars, or the operands' types don't match.
+	fn scalar_operation_to_c(&self, left: &str, right: &str, left_type: Option<String>, right_type: Option<String>, context: &mut Context) -> anyhow::Result<String> {
+		let Some(operator) = scalar_c_operator(self.operator) else {
+			anyhow::bail!(
+				"The binary operator \"{operator}\" can't be used on scalar values\n\twhile converting the binary operation \"{operator}\" to C code",
+				operator = format!("{}", self.operator).bold().cyan()
+			);
+		};
+
+		let (left, right, left_type, right_type) = match (left_type, right_type) {
+			(Some(scalar), None) if is_generic(&self.right, context) => (left.to_owned(), format!("*({scalar}*) ({right})"), Some(scalar.clone()), Some(scalar)),
+			(None, Some(scalar)) if is_generic(&self.left, context) => (format!("*({scalar}*) ({left})"), right.to_owned(), Some(scalar.clone()), Some(scalar)),
+			(left_type, right_type) => (left.to_owned(), right.to_owned(), left_type, right_type),
+		};
+
+		// Only numbers support arithmetic and ordering, but any two scalars of the same type can be compared for equality
+		match (left_type, right_type) {
+			(Some(left_type), Some(right_type)) if left_type == right_type && (left_type == "double" || self.operator == TokenType::DoubleEquals) => {
+				Ok(format!("(({left}) {operator} ({right}))"))
+			},
+			_ => {
+				let type_name = |operand: &Expression, context: &mut Context| operand_type_name(operand, context).map_or("an unknown type", Name::cabin_name);
+				anyhow::bail!(
+					"The binary operator \"{operator}\" can't be used on values of types \"{}\" and \"{}\"\n\twhile converting the binary operation \"{operator}\" to C code",
+					type_name(&self.left, context).bold().cyan(),
+					type_name(&self.right, context).bold().cyan(),
+					operator = format!("{}", self.operator).bold().cyan()
+				);
+			},
+		}
+	}
+}
+
 impl ParentExpression for BinaryExpression {
 	fn evaluate_children_at_compile_time(&self, context: &mut Context) -> anyhow::Result<Expression> {
 		let left = self.left.compile_time_evaluate(context, true).map_err(|error| {
@@ -429,10 +622,10 @@ impl ParentExpression for BinaryExpression {
 			)
 		})?;
 
-		Ok(Expression::BinaryExpression(Box::new(Self {
+		Ok(Expression::BinaryExpression(Arc::new(Self {
 			left,
 			right,
-			operator: self.operator.clone(),
+			operator: self.operator,
 		})))
 	}
 }
@@ -440,33 +633,77 @@ impl ParentExpression for BinaryExpression {
 impl TranspileToC for BinaryExpression {
 	fn to_c(&self, context: &mut Context) -> anyhow::Result<String> {
 		let left = self.left.to_c(context)?;
-		let right = self.right.to_c(context)?;
 
-		if self.operator == TokenType::DoubleEquals {
-			return Ok(format!("({{ Number_u* this = ((Number_u*) {left}); this->equals_u(this, &{right}); }})"));
+		// Objects in an assigned value live as long as the variable that they're assigned to
+		let right = if self.operator == TokenType::Equal {
+			let region = assignment_region(&self.left, context);
+			allocating_in(context, region, |assignment_context| self.right.to_c(assignment_context))?
+		} else {
+			self.right.to_c(context)?
+		};
+
+		if self.operator == TokenType::Equal {
+			return Ok(format!("*{left} = {right}"));
 		}
 
+		// The right-hand side of a field access is the name of a field rather than a value, so only the type of the object matters
 		if self.operator == TokenType::Dot {
+			if scalar_c_type(&self.left, context).is_some() {
+				anyhow::bail!(
+					"Attempted to access \"{access}\" on a scalar value, which has no fields at runtime\n\twhile converting the binary access expression \"{access}\" to C code",
+					access = format!(".{right}").bold().cyan()
+				);
+			}
 			return Ok(format!("{left}->{right}"));
 		}
 
-		if self.operator == TokenType::Equal {
-			return Ok(format!("*{left} = {right}"));
+		// Operations on scalar values are plain C operators instead of calls, so the C compiler can fold and optimize them like any other arithmetic
+		let left_type = scalar_c_type(&self.left, context);
+		let right_type = scalar_c_type(&self.right, context);
+		if left_type.is_some() || right_type.is_some() {
+			return self.scalar_operation_to_c(&left, &right, left_type, right_type, context);
+		}
+
+		// Values of a generic type are pointers to values whose type isn't known in C, so they can only be compared by identity
+		if self.operator == TokenType::DoubleEquals && (is_generic(&self.left, context) || is_generic(&self.right, context)) {
+			return Ok(format!("(({left}) == ({right}))"));
 		}
 
-		let operator = match self.operator {
-			TokenType::Plus => "plus",
-			TokenType::Minus => "minus",
-			TokenType::Asterisk => "times",
-			TokenType::ForwardSlash => "divided_by",
-			TokenType::DoubleEquals => "equals",
-			_ => anyhow::bail!(
+		// Other operators call the function that implements them on the group of the left operand directly
+		let Some(method_name) = operator_method_name(self.operator).map(Name::from) else {
+			anyhow::bail!(
 				"The binary operator \"{operator}\" is not yet supported\n\twhile converting the binary operation \"{operator}\" to C code",
 				operator = format!("{:?}", self.operator).bold().cyan()
-			),
+			);
+		};
+		let Some(method) = group_method(&self.left, method_name, context) else {
+			anyhow::bail!(
+				"The binary operator \"{operator}\" can't be used on this value, because its type has no \"{method}\" action\n\twhile converting the binary operation \"{operator}\" to C code",
+				operator = format!("{}", self.operator).bold().cyan(),
+				method = method_name.cabin_name().bold().cyan()
+			);
 		};
+		if !method.is_non_void {
+			anyhow::bail!(
+				"The action \"{}\" that implements the binary operator \"{}\" doesn't return a value",
+				method_name.cabin_name().bold().cyan(),
+				format!("{}", self.operator).bold().cyan()
+			);
+		}
 
-		Ok(format!("CALL(({left}), {}, &{right})", Name(operator.to_owned()).c_name()))
+		let result_type = method.parameters.last().unwrap_or_else(|| unreachable!()).1.to_c(context)?;
+		let arguments = [
+			argument_to_c(&method, 0, &self.left, context.allocation_region, context)?,
+			argument_to_c(&method, 1, &self.right, context.allocation_region, context)?,
+		];
+		let function = Expression::Literal(Literal::new(LiteralValue::FunctionDeclaration(Arc::clone(&method)))).to_c(context)?;
+
+		// The result is used where the operation is, so objects in it are allocated in the current region
+		let region = allocation_region(context);
+		Ok(format!(
+			"({{ {result_type} result; {function}({}, {}, &result, {region}); result; }})",
+			arguments[0], arguments[1]
+		))
 	}
 
 	fn c_prelude(&self, context: &mut Context) -> anyhow::Result<String> {
@@ -476,33 +713,43 @@ impl TranspileToC for BinaryExpression {
 	}
 }
 
+/// Returns the Cabin code of a binary operator, including the spaces around it, which is how the formatter writes binary expressions.
+///
+/// # Parameters
+/// - `operator` - The type of the binary operator's token.
+///
+/// # Returns
+/// The Cabin code of the operator, or `None` if the token isn't a binary operator.
+const fn cabin_operator(operator: TokenType) -> Option<&'static str> {
+	Some(match operator {
+		TokenType::Plus => " + ",
+		TokenType::Minus => " - ",
+		TokenType::Asterisk => " * ",
+		TokenType::ForwardSlash => " / ",
+		TokenType::Caret => " ^ ",
+		TokenType::DoubleEquals => " == ",
+		TokenType::LessThan => " < ",
+		TokenType::GreaterThan => " > ",
+		TokenType::Dot => ".",
+		TokenType::Equal => " = ",
+		_ => return None,
+	})
+}
+
 impl ToCabin for BinaryExpression {
-	fn to_cabin(&self) -> String {
-		let operator = match self.operator {
-			TokenType::Plus => " + ",
-			TokenType::Minus => " - ",
-			TokenType::Asterisk => " * ",
-			TokenType::ForwardSlash => " / ",
-			TokenType::Dot => ".",
-			TokenType::Equal => " = ",
-			_ => panic!("Unsupported operator {:?}", self.operator),
-		};
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		// The parser only creates binary expressions with binary operators, so this is only reached for an AST that was built by hand
+		let operator = cabin_operator(self.operator).ok_or(fmt::Error)?;
 
-		format!("{}{}{}", self.left.to_cabin(), operator, self.right.to_cabin())
+		self.left.write_cabin(writer)?;
+		writer.write_str(operator)?;
+		self.right.write_cabin(writer)
 	}
 }
 
 impl ColoredCabin for BinaryExpression {
 	fn to_colored_cabin(&self, context: &mut Context) -> String {
-		let operator = match self.operator {
-			TokenType::Plus => " + ",
-			TokenType::Minus => " - ",
-			TokenType::Asterisk => " * ",
-			TokenType::ForwardSlash => " / ",
-			TokenType::Dot => ".",
-			TokenType::DoubleEquals => " == ",
-			_ => panic!("Unsupported operator {:?}", self.operator),
-		};
+		let operator = cabin_operator(self.operator).unwrap_or(" ? ");
 
 		format!("{}{}{}", self.left.to_colored_cabin(context), operator, self.right.to_colored_cabin(context))
 	}
@@ -514,19 +761,19 @@ pub struct AccessExpression;
 impl Parse for AccessExpression {
 	type Output = Expression;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		let mut expression = Expression::Literal(Literal::new(LiteralValue::parse(tokens, context)?)); // There should be no map_err here
 		while tokens.next_is(TokenType::Dot) {
 			tokens.pop(TokenType::Dot, context)?;
 			let current_line = tokens.current_line();
 			let current_column = tokens.current_column();
 			let right = Expression::Literal(Literal::new(LiteralValue::VariableReference(VariableReference::with_position(
-				Name(tokens.pop(TokenType::Identifier, context)?),
+				Name::from(tokens.pop(TokenType::Identifier, context)?),
 				context.scope_data.unique_id(),
 				current_line,
 				current_column,
 			))));
-			expression = Expression::BinaryExpression(Box::new(BinaryExpression {
+			expression = Expression::BinaryExpression(Arc::new(BinaryExpression {
 				left: expression,
 				operator: TokenType::Dot,
 				right,
@@ -1,21 +1,24 @@
 use crate::{
 	compile_time::{CompileTime, CompileTimeStatement, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	emitter::CWriter,
+	formatter::{write_body, CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parser::{
 		expressions::{
 			run::{ParentExpression, ParentStatement},
+			function_call::call_argument_regions,
 			util::types::Typed,
 			Expression,
 		},
 		statements::Statement,
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
+	regions::{allocating_in, write_in_region},
 	scopes::ScopeType,
 };
 
-use std::{collections::VecDeque, fmt::Write as _};
+use std::fmt::{self, Write as _};
 
 use colored::Colorize as _;
 
@@ -34,7 +37,7 @@ pub struct Block {
 impl Parse for Block {
 	type Output = Self;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		tokens
 			.pop(TokenType::LeftBrace, context)
 			.map_err(|error| anyhow::anyhow!("{error}\n\t{}", "while attempting to parse the opening left brace at the start of a block".dimmed()))?;
@@ -69,7 +72,10 @@ impl CompileTime for Block {
 			statements: self
 				.statements
 				.iter()
-				.map(|statement| statement.compile_time_evaluate_statement(context, with_side_effects))
+				.map(|statement| {
+					context.compile_time_step()?;
+					statement.compile_time_evaluate_statement(context, with_side_effects)
+				})
 				.collect::<anyhow::Result<Vec<_>>>()
 				.map_err(|error| anyhow::anyhow!("{error}\n\t{}", "while evaluating a block expression at compile-time".dimmed()))?,
 			inner_scope_id: self.inner_scope_id,
@@ -145,32 +151,42 @@ impl TranspileToC for Block {
 	}
 
 	fn to_c(&self, context: &mut Context) -> anyhow::Result<String> {
-		let mut c = "({".to_owned();
+		CWriter::render(|writer| self.write_c(writer, context))
+	}
 
+	fn write_c(&self, writer: &mut CWriter<'_>, context: &mut Context) -> anyhow::Result<()> {
+		writer.write_str("({")?;
 		if !self.statements.is_empty() {
-			c.push('\n');
+			writer.write_char('\n')?;
 		}
 
-		for statement in &self.statements {
-			for line in statement.to_c(context)?.lines() {
-				writeln!(c, "\t{line}").unwrap();
-			}
-		}
-		c.push_str("})");
-		Ok(c)
+		writer.indented(|indented| {
+			write_in_region(indented, context, self.inner_scope_id, |body, block_context| {
+				let argument_regions = call_argument_regions(&self.statements, block_context);
+				for statement in &self.statements {
+					// The block's value outlives the block's own region, and so can the arguments of a call that the block was converted from
+					let region = match statement {
+						Statement::Tail(_) => block_context.tail_region,
+						Statement::Declaration(declaration) => argument_regions
+							.iter()
+							.find(|(name, _region)| name == &declaration.name)
+							.map_or(block_context.allocation_region, |(_name, region)| *region),
+						_ => block_context.allocation_region,
+					};
+					allocating_in(block_context, region, |statement_context| statement.write_c(body, statement_context))?;
+					body.end_line()?;
+				}
+				Ok(())
+			})
+		})?;
+		writer.write_str("})")?;
+		Ok(())
 	}
 }
 
 impl ToCabin for Block {
-	fn to_cabin(&self) -> String {
-		format!(
-			"{{\n{}\n}}",
-			self.statements
-				.iter()
-				.flat_map(|statement| statement.to_cabin().lines().map(|line| format!("\t{line}")).collect::<Vec<_>>())
-				.collect::<Vec<_>>()
-				.join("\n")
-		)
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		write_body(writer, &self.statements)
 	}
 }
 
@@ -1,27 +1,36 @@
 use crate::{
 	cli::theme::Styled,
-	compile_time::{builtin::call_builtin_at_compile_time, CompileTime, CompileTimeStatement, TranspileToC},
+	compile_time::{
+		builtin::call_builtin_at_compile_time,
+		memo::{argument_key, is_fully_known},
+		CompileTime, CompileTimeStatement, TranspileToC,
+	},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	emitter::CWriter,
+	formatter::{write_separated, CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parse_list,
 	parser::{
 		expressions::{
-			binary::AccessExpression,
+			binary::{runtime_method, scalar_c_type, AccessExpression},
 			block::Block,
-			literals::{object::Object, LiteralValue},
+			literals::{either::is_passed_by_value, function_declaration::FunctionDeclaration, object::Object, LiteralValue},
 			run::ParentExpression,
 			util::{name::Name, tags::TagList, types::Typed},
 			Expression,
 		},
 		statements::{declaration::Declaration, tail::TailStatement, Statement},
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
+	regions::{allocating_in, allocation_region, argument_region, tail_region, write_reference, AllocationRegion},
 	scopes::ScopeType,
 	var, void,
 };
 
-use std::collections::VecDeque;
+use std::{
+	fmt::{self, Write as _},
+	sync::Arc,
+};
 
 use colored::Colorize as _;
 
@@ -44,7 +53,7 @@ pub struct FunctionCall {
 impl Parse for FunctionCall {
 	type Output = Expression;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		let mut literal = AccessExpression::parse(tokens, context)?;
 
 		while tokens.next_is(TokenType::LeftParenthesis) || tokens.next_is(TokenType::LeftAngleBracket) {
@@ -58,7 +67,7 @@ impl Parse for FunctionCall {
 					});
 				}
 				tokens.pop(TokenType::RightParenthesis, context)?;
-				literal = Expression::FunctionCall(Box::new(Self {
+				literal = Expression::FunctionCall(Arc::new(Self {
 					function: literal,
 					arguments,
 					has_been_converted_to_block: false,
@@ -75,7 +84,7 @@ impl Parse for FunctionCall {
 					});
 				}
 				tokens.pop(TokenType::RightAngleBracket, context)?;
-				literal = Expression::FunctionCall(Box::new(Self {
+				literal = Expression::FunctionCall(Arc::new(Self {
 					function: literal,
 					arguments,
 					has_been_converted_to_block: false,
@@ -127,7 +136,7 @@ impl CompileTime for FunctionCall {
 		}
 
 		let Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) = &function else {
-			return Ok(Expression::FunctionCall(Box::new(Self {
+			return Ok(Expression::FunctionCall(Arc::new(Self {
 				function,
 				arguments,
 				has_been_converted_to_block: true,
@@ -138,14 +147,14 @@ impl CompileTime for FunctionCall {
 		let mut is_runtime_only = None;
 		for tag in function_declaration.tags.iter() {
 			if let Expression::Literal(Literal(LiteralValue::VariableReference(identifier, ..), ..)) = tag {
-				if identifier.name() == &Name("system_side_effects".to_owned()) {
+				if identifier.name() == &Name::from("system_side_effects") {
 					has_system_side_effects = true;
 				}
 			}
 
 			if let Expression::Literal(Literal(LiteralValue::Object(table), ..)) = tag {
 				if table.name.cabin_name() == "RuntimeOnlyTag" {
-					let reason_value = table.get_field(&Name("reason".to_owned())).unwrap_or_else(|| unreachable!());
+					let reason_value = table.get_field(&Name::from("reason")).unwrap_or_else(|| unreachable!());
 					let reason = reason_value
 						.as_string()
 						.map_err(|error| anyhow::anyhow!("{error}\n\twhile evaluating a runtime_only tag for a function call at compile-time"))?;
@@ -154,6 +163,10 @@ impl CompileTime for FunctionCall {
 			}
 		}
 
+		if has_system_side_effects {
+			context.call_cache.record_side_effect();
+		}
+
 		if function_declaration.name == Some("input".to_owned()) {
 			anyhow::bail!("input");
 		}
@@ -192,7 +205,7 @@ impl CompileTime for FunctionCall {
 			for tag in function_declaration.tags.iter() {
 				if let Expression::Literal(Literal(LiteralValue::Object(table), ..)) = tag {
 					if table.name.cabin_name() == "BuiltinTag" {
-						let internal_name_value = table.get_field(&Name("internal_name".to_owned())).unwrap_or_else(|| unreachable!());
+						let internal_name_value = table.get_field(&Name::from("internal_name")).unwrap_or_else(|| unreachable!());
 						let internal_name = internal_name_value.as_string().map_err(|error| {
 							context.encountered_compiler_bug = true;
 							anyhow::anyhow!("{error}\n\t{}", "while evaluating a built-in tag for a function call at compile-time".dimmed())
@@ -207,19 +220,57 @@ impl CompileTime for FunctionCall {
 
 		// Not builtin
 		if let Some(body) = &function_declaration.body {
-			// Evaluate the statements
-			for statement in body {
+			// Pure calls with fully known arguments are memoized, so calling them again with the same arguments doesn't evaluate the body again. Only
+			// functions declared in the global scope are memoized, because nested functions can use the variables of the function they're declared in,
+			// which aren't part of the memo key.
+			let is_declared_globally = function_declaration
+				.inner_scope_id
+				.and_then(|scope_id| context.scope_data.get_scope_from_id(scope_id))
+				.is_some_and(|scope| scope.depth() == 1);
+			let memo_key = if has_system_side_effects || !is_declared_globally {
+				None
+			} else {
+				argument_key(&arguments, context)
+			};
+			if let Some(key) = &memo_key {
+				if let Some(return_value) = context.call_cache.get(function_declaration.id, key) {
+					return Ok(return_value);
+				}
+			}
+			let side_effects_before_call = context.call_cache.side_effects();
+			let global_writes_before_call = context.call_cache.global_writes();
+
+			// Evaluate the statements. The function is always exited in the profiler, even if evaluating it fails, so that the call stack reported with
+			// the error is the one that failed
+			context.compile_time_profile.enter(function_declaration.id, || {
+				function_declaration.name.clone().unwrap_or_else(|| format!("anonymous_{}", function_declaration.id))
+			});
+			let evaluated_body = body.iter().try_for_each(|statement| {
+				context.compile_time_step()?;
 				statement
 					.compile_time_evaluate_statement(context, with_side_effects)
-					.map_err(|error| anyhow::anyhow!("{error}\n\t{}", "while evaluating the body of a function call at compile-time".dimmed()))?;
-			}
+					.map(drop)
+					.map_err(|error| anyhow::anyhow!("{error}\n\t{}", "while evaluating the body of a function call at compile-time".dimmed()))
+			});
+			context.compile_time_profile.exit();
+			evaluated_body?;
 
 			// Get the return value
 			let return_value = context
 				.scope_data
-				.get_variable_from_id(&Name("return_address".to_owned()), function_declaration.inner_scope_id.unwrap())
+				.get_variable_from_id(&Name::from("return_address"), function_declaration.inner_scope_id.unwrap())
 				.map_or_else(|| void!(), |declaration| declaration.clone().value.unwrap());
 
+			// Calls that turned out to have side effects, reassigned global variables, or didn't produce a fully known value, can't be reused
+			if let Some(key) = memo_key {
+				if context.call_cache.side_effects() == side_effects_before_call
+					&& context.call_cache.global_writes() == global_writes_before_call
+					&& is_fully_known(&return_value, context)
+				{
+					context.call_cache.insert(function_declaration.id, key, return_value.clone());
+				}
+			}
+
 			// Return the return value
 			return Ok(return_value);
 		}
@@ -236,7 +287,7 @@ impl CompileTime for FunctionCall {
 impl ParentExpression for FunctionCall {
 	fn evaluate_children_at_compile_time(&self, context: &mut Context) -> anyhow::Result<Expression> {
 		if self.has_been_converted_to_block {
-			return Ok(Expression::FunctionCall(Box::new(self.clone())));
+			return Ok(Expression::FunctionCall(Arc::new(self.clone())));
 		}
 
 		let mut function = self.function.compile_time_evaluate(context, false).map_err(|error| {
@@ -269,8 +320,19 @@ impl ParentExpression for FunctionCall {
 				})?;
 		}
 
+		// A method called on an object that isn't known at compile-time calls the action on the object's group directly, with the object as `this`
+		if let Some((method, this)) = runtime_method(&function, context) {
+			if method.parameters.first().is_some_and(|(name, _type)| name == &Name::from("this")) {
+				arguments.insert(0, this);
+			}
+			function = Expression::Literal(Literal::new(LiteralValue::FunctionDeclaration(method)));
+		}
+
 		let Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) = &mut function else {
-			unreachable!("{function:?}")
+			anyhow::bail!(
+				"Attempted to call \"{}\", which isn't a function or an action on the group of the object it's accessed on",
+				function.to_colored_cabin(context)
+			);
 		};
 
 		context.scope_data.enter_new_scope(ScopeType::Block);
@@ -280,7 +342,7 @@ impl ParentExpression for FunctionCall {
 		// Parameters
 		for (argument, (parameter_name, parameter_type)) in arguments.iter_mut().zip(&function_declaration.parameters) {
 			statements.push(Statement::Declaration(Declaration {
-				name: parameter_name.clone(),
+				name: *parameter_name,
 				declared_scope_id: context.scope_data.unique_id(),
 				tags: TagList::default(),
 				type_annotation: Some(parameter_type.clone()),
@@ -288,9 +350,7 @@ impl ParentExpression for FunctionCall {
 				line_start: 0,
 			}));
 
-			context
-				.scope_data
-				.declare_new_variable(parameter_name.clone(), None, argument.clone(), TagList::default())?;
+			context.scope_data.declare_new_variable(*parameter_name, None, argument.clone(), TagList::default())?;
 
 			*argument = var!(parameter_name.cabin_name(), context.scope_data.unique_id());
 		}
@@ -318,26 +378,26 @@ impl ParentExpression for FunctionCall {
 
 			// Declare the return address variable
 			statements.push(Statement::Declaration(Declaration {
-				name: Name("return_address".to_owned()),
+				name: Name::from("return_address"),
 				declared_scope_id: block_scope_id,
 				tags: TagList::default(),
-				initial_value: Expression::Literal(Literal::new(LiteralValue::Object(Object::named(return_type_identifier.name().to_owned())))),
+				initial_value: Expression::Literal(Literal::new(LiteralValue::Object(Arc::new(Object::named(return_type_identifier.name().to_owned()))))),
 				line_start: 0,
 				type_annotation: Some(return_type.clone()),
 			}));
 
 			// Declare the return address variable into the scope
 			context.scope_data.declare_new_variable(
-				Name("return_address".to_owned()),
+				Name::from("return_address"),
 				Some(function_declaration.parameters.last().unwrap().1.clone()),
-				Expression::Literal(Literal::new(LiteralValue::Object(Object::named(return_type_identifier.name().to_owned())))),
+				Expression::Literal(Literal::new(LiteralValue::Object(Arc::new(Object::named(return_type_identifier.name().to_owned()))))),
 				TagList::default(),
 			)?;
 
-			function_declaration.parameters = Vec::new();
+			Arc::make_mut(function_declaration).parameters = Vec::new();
 
 			// Add the function call itself
-			statements.push(Statement::Expression(Expression::FunctionCall(Box::new(Self {
+			statements.push(Statement::Expression(Expression::FunctionCall(Arc::new(Self {
 				function: function.clone(),
 				arguments,
 				has_been_converted_to_block: true,
@@ -350,8 +410,8 @@ impl ParentExpression for FunctionCall {
 		}
 		// Void function
 		else {
-			function_declaration.parameters = Vec::new();
-			statements.push(Statement::Expression(Expression::FunctionCall(Box::new(Self {
+			Arc::make_mut(function_declaration).parameters = Vec::new();
+			statements.push(Statement::Expression(Expression::FunctionCall(Arc::new(Self {
 				function: function.clone(),
 				arguments,
 				has_been_converted_to_block: true,
@@ -372,6 +432,91 @@ impl ParentExpression for FunctionCall {
 	}
 }
 
+/// Returns whether an argument of a function call is passed by value rather than by pointer, which is the case for scalar and tagged either values
+/// (see `parameter_c_type()`).
+///
+/// # Parameters
+/// - `function_declaration` - The function that's called.
+/// - `index` - The index of the argument.
+/// - `argument` - The argument.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// Whether the argument is passed by value.
+fn is_argument_passed_by_value(function_declaration: &FunctionDeclaration, index: usize, argument: &Expression, context: &mut Context) -> bool {
+	// A call that's been converted to a block has no parameters left, but its arguments are variables declared with the types of the parameters
+	let parameter_c_type = match function_declaration.parameters.get(index) {
+		Some((_name, parameter_type)) => parameter_type.to_c(context).ok(),
+		None => scalar_c_type(argument, context),
+	};
+	parameter_c_type.is_some_and(|c_type| is_passed_by_value(&c_type, context))
+}
+
+/// Returns the C code of an argument passed to a function, which is the argument's value if it's passed by value, or a pointer to it otherwise. Objects
+/// created for the argument are allocated in the region that the escape analysis of the function picks for it (see `regions::argument_region()`).
+///
+/// # Parameters
+/// - `function_declaration` - The function that's called.
+/// - `index` - The index of the argument.
+/// - `argument` - The argument.
+/// - `result_region` - The region that the return value of the call is allocated in.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The C code of the argument.
+///
+/// # Errors
+/// If the argument couldn't be transpiled.
+pub fn argument_to_c(function_declaration: &FunctionDeclaration, index: usize, argument: &Expression, result_region: AllocationRegion, context: &mut Context) -> anyhow::Result<String> {
+	if is_argument_passed_by_value(function_declaration, index, argument, context) {
+		return argument.to_c(context);
+	}
+
+	let region = argument_region(function_declaration.id, index, result_region, context);
+	allocating_in(context, region, |argument_context| {
+		// Scalars are plain C values, so they're boxed when passed to a parameter that takes a pointer, such as one of type `Anything`
+		if let Some(scalar_type) = scalar_c_type(argument, argument_context) {
+			let value = argument.to_c(argument_context)?;
+			return Ok(format!("cabin_allocate({}, ({scalar_type}) {{ {value} }})", allocation_region(argument_context)));
+		}
+		CWriter::render(|writer| write_reference(argument, writer, argument_context))
+	})
+}
+
+/// Returns the regions that the arguments of a call are allocated in, if the given statements are the block that the call was converted to at
+/// compile-time. Such a block declares each argument as a variable named after its parameter before calling the function, so the declarations are
+/// allocated where the escape analysis of the function puts the arguments (see `regions::argument_region()`).
+///
+/// # Parameters
+/// - `statements` - The statements of a block.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The names of the parameters of the called function and the regions to allocate their arguments in, which is empty if the block doesn't call a
+/// function that's known when transpiling.
+pub fn call_argument_regions(statements: &[Statement], context: &Context) -> Vec<(Name, AllocationRegion)> {
+	let Some(function_id) = statements.iter().find_map(|statement| match statement {
+		Statement::Expression(Expression::FunctionCall(call)) if call.has_been_converted_to_block => match &call.function {
+			Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function), ..)) => Some(function.id),
+			_ => None,
+		},
+		_ => None,
+	}) else {
+		return Vec::new();
+	};
+	let Some(function) = context.function_declarations.iter().find(|function| function.id == function_id) else {
+		return Vec::new();
+	};
+
+	function
+		.parameters
+		.iter()
+		.enumerate()
+		.filter(|(_index, (name, _type))| name != &Name::from("return_address"))
+		.map(|(index, (name, _type))| (*name, argument_region(function_id, index, context.tail_region, context)))
+		.collect()
+}
+
 impl TranspileToC for FunctionCall {
 	fn to_c(&self, context: &mut Context) -> anyhow::Result<String> {
 		let function = self.function.to_c(context)?;
@@ -380,7 +525,7 @@ impl TranspileToC for FunctionCall {
 			anyhow::bail!("Function call is not a declaration in C");
 		};
 
-		let arguments = self
+		let mut arguments = self
 			.arguments
 			.iter()
 			.enumerate()
@@ -388,11 +533,16 @@ impl TranspileToC for FunctionCall {
 				if index == self.arguments.len() - 1 && function_declaration.is_non_void {
 					Ok("&return_address_u".to_owned())
 				} else {
-					Ok(format!("&{}", arg.to_c(context)?))
+					argument_to_c(function_declaration, index, arg, context.tail_region, context)
 				}
 			})
 			.collect::<anyhow::Result<Vec<_>>>()?;
 
+		// A call is lowered to a block whose value is the return value, so the return value is allocated in the block's tail region
+		if function_declaration.is_non_void {
+			arguments.push(tail_region(context));
+		}
+
 		Ok(format!("{}({})", function, arguments.join(", ")))
 	}
 
@@ -408,12 +558,11 @@ impl TranspileToC for FunctionCall {
 }
 
 impl ToCabin for FunctionCall {
-	fn to_cabin(&self) -> String {
-		format!(
-			"{}({})",
-			self.function.to_cabin(),
-			self.arguments.iter().map(|argument| argument.to_cabin()).collect::<Vec<_>>().join(", ")
-		)
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		self.function.write_cabin(writer)?;
+		writer.write_char('(')?;
+		write_separated(writer, &self.arguments, ", ")?;
+		writer.write_char(')')
 	}
 }
 
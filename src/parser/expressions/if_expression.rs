@@ -1,12 +1,22 @@
 use crate::{
 	compile_time::{CompileTime, CompileTimeStatement, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	formatter::{write_body, CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parser::{
-		expressions::{run::ParentExpression, util::types::Typed, Expression},
+		expressions::{
+			binary::scalar_c_type,
+			literals::{
+				either::{tagged_either, variant_tag_c_name},
+				object::InternalValue,
+				Literal, LiteralValue,
+			},
+			run::ParentExpression,
+			util::types::Typed,
+			Expression,
+		},
 		statements::Statement,
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 	void_literal,
 };
@@ -15,7 +25,10 @@ use crate::{
 // `string = format!("{string}...")`, because it avoids an extra allocation. We have a clippy warning turned on for this very
 // purpose. We assign this to `_` to indicate clearly that it's just a trait and not used explicitly anywhere outside of bringing its
 // methods into scope.
-use std::{collections::VecDeque, fmt::Write as _};
+use std::{
+	fmt::{self, Write as _},
+	sync::Arc,
+};
 
 use colored::Colorize as _;
 
@@ -26,17 +39,126 @@ use super::{literals::Literal, run::ParentStatement, util::name::Name};
 #[derive(Clone, Debug)]
 pub struct IfExpression {
 	/// The condition of the if statement. This should evaluate to a boolean value.
-	condition: Expression,
+	pub condition: Expression,
 	/// The body of the if statement. This is executed if the condition is true.
-	body: Vec<Statement>,
+	pub body: Vec<Statement>,
 	/// The body of the else statement. This is executed if the condition is false.
-	else_body: Option<Vec<Statement>>,
+	pub else_body: Option<Vec<Statement>>,
+}
+
+/// A chain of `if` expressions that each compare the same variable to a different variant of a tagged either, such as `if color == Color.red { ... }
+/// otherwise { if color == Color.green { ... } }`. These are transpiled to a C `switch` over the variable's tag, which the C compiler can emit as a jump
+/// table instead of comparing the tag to every variant in turn.
+struct VariantSwitch<'chain> {
+	/// The C code of the variable that's compared to each variant.
+	scrutinee: String,
+	/// The C name of the tag of each compared variant, and the body that's run when the variable is that variant.
+	cases: Vec<(String, &'chain [Statement])>,
+	/// The body of the last `otherwise` in the chain, which is run when the variable is none of the compared variants.
+	default: Option<&'chain [Statement]>,
+}
+
+impl IfExpression {
+	/// Returns the `switch` that this `if` expression and the `if` expressions chained in its `otherwise` bodies can be transpiled to (see
+	/// `VariantSwitch`). Chains with a single comparison are left as conditionals, and so are chains whose bodies have tail statements, because a C
+	/// `switch` is a statement and has no value.
+	///
+	/// # Parameters
+	/// - `context` - The global compiler context.
+	///
+	/// # Returns
+	/// The `switch` of this chain, or `None` if it can't be transpiled to one.
+	///
+	/// # Errors
+	/// If the variable compared in the chain couldn't be transpiled to C.
+	fn variant_switch(&self, context: &mut Context) -> anyhow::Result<Option<VariantSwitch<'_>>> {
+		let mut switch = VariantSwitch {
+			scrutinee: String::new(),
+			cases: Vec::new(),
+			default: None,
+		};
+
+		let mut link = self;
+		loop {
+			let Some((scrutinee, tag)) = variant_comparison(&link.condition, context)? else {
+				return Ok(None);
+			};
+			if (!switch.cases.is_empty() && scrutinee != switch.scrutinee) || switch.cases.iter().any(|(case_tag, _body)| case_tag == &tag) || has_tail(&link.body) {
+				return Ok(None);
+			}
+			switch.scrutinee = scrutinee;
+			switch.cases.push((tag, &link.body));
+
+			match link.else_body.as_deref() {
+				Some([Statement::Expression(Expression::IfStatement(next_link))]) => link = next_link,
+				default => {
+					if default.is_some_and(has_tail) {
+						return Ok(None);
+					}
+					switch.default = default;
+					break;
+				},
+			}
+		}
+
+		Ok((switch.cases.len() > 1).then_some(switch))
+	}
+}
+
+/// Returns the variable and the variant that a condition compares, if the condition is a comparison between a variable and a variant of a tagged either
+/// (see `tagged_either()`).
+///
+/// # Parameters
+/// - `condition` - The condition of an `if` expression.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The C code of the variable and the C name of the variant's tag, or `None` if the condition isn't such a comparison.
+///
+/// # Errors
+/// If the variable couldn't be transpiled to C.
+fn variant_comparison(condition: &Expression, context: &mut Context) -> anyhow::Result<Option<(String, String)>> {
+	let Expression::BinaryExpression(comparison) = condition else {
+		return Ok(None);
+	};
+	if comparison.operator != TokenType::DoubleEquals {
+		return Ok(None);
+	}
+
+	// The variable is only evaluated once by a `switch`, so only variables are compared rather than expressions that could have side effects
+	let (variable, Expression::Literal(Literal(LiteralValue::Object(variant), ..))) = (match (&comparison.left, &comparison.right) {
+		(variable @ Expression::Literal(Literal(LiteralValue::VariableReference(_), ..)), variant)
+		| (variant, variable @ Expression::Literal(Literal(LiteralValue::VariableReference(_), ..))) => (variable, variant),
+		_ => return Ok(None),
+	}) else {
+		return Ok(None);
+	};
+
+	let Some(InternalValue::String(variant_name)) = variant.get_internal_field("variant") else {
+		return Ok(None);
+	};
+	if tagged_either(variant.name, context).is_none() || scalar_c_type(variable, context) != Some(variant.name.c_name()) {
+		return Ok(None);
+	}
+
+	Ok(Some((variable.to_c(context)?, variant_tag_c_name(variant.name, variant_name))))
+}
+
+/// Returns whether a body has a tail statement, which gives the body a value.
+///
+/// # Parameters
+/// - `body` - The statements of the body.
+///
+/// # Returns
+/// Whether any of the statements are tail statements.
+fn has_tail(body: &[Statement]) -> bool {
+	body.iter().any(|statement| matches!(statement, Statement::Tail(_)))
 }
 
 impl Parse for IfExpression {
 	type Output = Self;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		tokens.pop(TokenType::KeywordIf, context)?;
 		let condition = Expression::parse(tokens, context)?;
 		tokens.pop(TokenType::LeftBrace, context)?;
@@ -82,7 +204,7 @@ impl CompileTime for IfExpression {
 		};
 
 		if let Expression::Literal(literal) = &if_expression.condition {
-			let true_expression = context.scope_data.get_global_variable(&Name("true".to_owned())).unwrap().value.as_ref().unwrap().clone();
+			let true_expression = context.scope_data.get_global_variable(&Name::from("true")).unwrap().value.as_ref().unwrap().clone();
 			let true_literal = true_expression.as_literal(context).unwrap();
 
 			if literal.is(true_literal, context)? {
@@ -119,12 +241,26 @@ impl ParentExpression for IfExpression {
 			})
 			.transpose()?;
 
-		Ok(Expression::IfStatement(Box::new(Self { condition, body, else_body })))
+		Ok(Expression::IfStatement(Arc::new(Self { condition, body, else_body })))
 	}
 }
 
 impl TranspileToC for IfExpression {
 	fn to_c(&self, context: &mut Context) -> anyhow::Result<String> {
+		if let Some(switch) = self.variant_switch(context)? {
+			let mut c = format!("({{ switch ({}) {{", switch.scrutinee);
+			for (tag, case_body) in switch.cases {
+				let body = case_body.iter().map(|statement| statement.to_c(context)).collect::<anyhow::Result<Vec<_>>>()?.join("\n");
+				write!(c, "\n\tcase {tag}: {{ {body} }} break;")?;
+			}
+			if let Some(default_body) = switch.default {
+				let default = default_body.iter().map(|statement| statement.to_c(context)).collect::<anyhow::Result<Vec<_>>>()?.join("\n");
+				write!(c, "\n\tdefault: {{ {default} }} break;")?;
+			}
+			c.push_str("\n} })");
+			return Ok(c);
+		}
+
 		let condition = self.condition.to_c(context)?;
 		let body = self.body.iter().map(|statement| statement.to_c(context)).collect::<anyhow::Result<Vec<_>>>()?.join("\n");
 		let else_body = self
@@ -158,22 +294,16 @@ impl TranspileToC for IfExpression {
 }
 
 impl ToCabin for IfExpression {
-	fn to_cabin(&self) -> String {
-		let mut cabin_code = format!("if {} {{", self.condition.to_cabin());
-		for statement in &self.body {
-			for line in statement.to_cabin().lines() {
-				write!(cabin_code, "\t{line}").unwrap();
-			}
-		}
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		writer.write_str("if ")?;
+		self.condition.write_cabin(writer)?;
+		writer.write_char(' ')?;
+		write_body(writer, &self.body)?;
 		if let Some(else_body) = &self.else_body {
-			cabin_code.push_str("\totherwise {");
-			for statement in else_body {
-				for line in statement.to_cabin().lines() {
-					write!(cabin_code, "\t{line}").unwrap();
-				}
-			}
+			writer.write_str(" otherwise ")?;
+			write_body(writer, else_body)?;
 		}
-		cabin_code
+		Ok(())
 	}
 }
 
@@ -2,22 +2,25 @@ use crate::{
 	cli::theme::Styled,
 	compile_time::{CompileTime, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	object, parse_list,
 	parser::{
 		expressions::{
-			literals::{Literal, LiteralValue},
+			literals::{object::InternalValue, Literal, LiteralValue},
 			run::ParentExpression,
 			util::{name::Name, types::Typed},
 			Expression,
 		},
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 	var_literal,
 };
 
-use std::{collections::VecDeque, fmt::Write as _};
+use std::{
+	fmt::{self, Write as _},
+	sync::Arc,
+};
 
 use colored::Colorize as _;
 
@@ -37,12 +40,147 @@ impl Either {
 	pub fn variants(&self) -> &[(Name, Expression)] {
 		&self.variants
 	}
+
+	/// Names the variants of this `either` after the variable that it's declared as, so that each variant is an object of the `either`'s type rather than a
+	/// plain `Object`. Each variant also stores its own name in the internal field `variant`, which is what distinguishes variants from each other when
+	/// they're transpiled to C.
+	///
+	/// # Parameters
+	/// - `either_name` - The name of the variable that this `either` is declared as.
+	pub fn name_variants(&mut self, either_name: Name) {
+		for (variant_name, variant) in &mut self.variants {
+			if let Expression::Literal(Literal(LiteralValue::Object(shared_object), ..)) = variant {
+				let object = Arc::make_mut(shared_object);
+				object.name = either_name;
+				object.add_internal_field("variant".to_owned(), InternalValue::String(variant_name.cabin_name().to_owned()));
+			}
+		}
+	}
+
+	/// Returns the C integer type that the tags of this `either` are stored in, which is the smallest unsigned integer type that has a distinct value for
+	/// every variant.
+	///
+	/// # Returns
+	/// The C integer type of this `either`'s tags.
+	#[must_use]
+	pub fn tag_c_type(&self) -> &'static str {
+		match self.variants.len() {
+			0..=0x100 => "uint8_t",
+			0x101..=0x1_0000 => "uint16_t",
+			_ => "uint32_t",
+		}
+	}
+
+	/// Returns the C definition of the tags of this `either`, which are the constants of an anonymous `enum` numbered densely from zero in the order that
+	/// the variants were declared, so that a `switch` over them can be compiled into a jump table. The type of the `either` itself is a `typedef` of its
+	/// tag type (see `tag_c_type()`) rather than of the `enum`, because C enums are always at least as large as an `int`.
+	///
+	/// # Parameters
+	/// - `either_name` - The name of the variable that this `either` is declared as.
+	///
+	/// # Returns
+	/// The `typedef` of the `either`'s type, followed by the `enum` of its tags.
+	#[must_use]
+	pub fn tags_to_c(&self, either_name: Name) -> String {
+		let mut c = format!("typedef {} {};\nenum {{", self.tag_c_type(), either_name.c_name());
+		for (tag, (variant_name, _variant)) in self.variants.iter().enumerate() {
+			write!(c, "\n\t{} = {tag},", variant_tag_c_name(either_name, variant_name.cabin_name())).unwrap_or_else(|_error| unreachable!());
+		}
+		c.push_str("\n};");
+		c
+	}
+
+	/// Returns the C names of the tags of this `either`, in the order that its variants were declared.
+	///
+	/// # Parameters
+	/// - `either_name` - The name of the variable that this `either` is declared as.
+	///
+	/// # Returns
+	/// The C name of each variant's tag (see `variant_tag_c_name()`).
+	#[must_use]
+	pub fn tag_c_names(&self, either_name: Name) -> Vec<String> {
+		self.variants
+			.iter()
+			.map(|(variant_name, _variant)| variant_tag_c_name(either_name, variant_name.cabin_name()))
+			.collect()
+	}
+}
+
+/// Returns the `either` that values of the given type are variants of, if their type is an `either` that's lowered to integer tags. The variants of
+/// `Boolean` are lowered to C's `bool` instead (see `Name::unboxed_c_type()`), so it isn't returned here.
+///
+/// # Parameters
+/// - `type_name` - The name of the type, which is the name of the global variable that the `either` is declared as.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The `either` declaration, or `None` if the type isn't an `either` with integer tags.
+#[must_use]
+pub fn tagged_either(type_name: Name, context: &Context) -> Option<&Either> {
+	if type_name.unboxed_c_type().is_some() {
+		return None;
+	}
+
+	match context.scope_data.get_global_variable(&type_name)?.value.as_ref()? {
+		Expression::Literal(Literal(LiteralValue::Either(either), ..)) => Some(either),
+		_ => None,
+	}
+}
+
+/// Returns the C name of the constant that a variant of an `either` is tagged with, such as `Color_u_red_u` for the variant `red` of `Color`. The name is
+/// prefixed with the name of the `either` because C enum constants all share a single namespace.
+///
+/// # Parameters
+/// - `either_name` - The name of the variable that the `either` is declared as.
+/// - `variant_name` - The name of the variant.
+///
+/// # Returns
+/// The C name of the variant's tag.
+#[must_use]
+pub fn variant_tag_c_name(either_name: Name, variant_name: &str) -> String {
+	format!("{}_{}", either_name.c_name(), Name::from(variant_name).c_name())
+}
+
+/// Returns the C type that a parameter of the given type is declared with. Scalar values (see `Name::unboxed_c_type()`) and tagged `either` values are
+/// plain C values that fit in a register, so they're passed by value; Every other value is passed by pointer. The return address of a function is always
+/// a pointer, because the function writes its return value through it.
+///
+/// # Parameters
+/// - `parameter_name` - The name of the parameter.
+/// - `c_type` - The C type of the parameter's values.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The C type of the parameter itself.
+#[must_use]
+pub fn parameter_c_type(parameter_name: Name, c_type: String, context: &Context) -> String {
+	if parameter_name != Name::from("return_address") && is_passed_by_value(&c_type, context) {
+		c_type
+	} else {
+		format!("{c_type}*")
+	}
+}
+
+/// Returns whether values of the given C type are passed to functions by value rather than by pointer (see `parameter_c_type()`).
+///
+/// # Parameters
+/// - `c_type` - The C type of the values.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// Whether the values are passed by value.
+#[must_use]
+pub fn is_passed_by_value(c_type: &str, context: &Context) -> bool {
+	c_type.ends_with("_u") && {
+		let type_name = Name::from_c(c_type);
+		type_name.unboxed_c_type().is_some() || tagged_either(type_name, context).is_some()
+	}
 }
 
 impl Parse for Either {
 	type Output = Self;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		tokens.pop(TokenType::KeywordEither, context).map_err(|error| {
 			anyhow::anyhow!(
 				"{error}\n\t{}",
@@ -68,7 +206,7 @@ impl Parse for Either {
 		let mut variants = Vec::new();
 		if !tokens.next_is(TokenType::RightBrace) {
 			parse_list!(tokens, context, {
-				variants.push(Name(tokens.pop(TokenType::Identifier, context).map_err(|error| {
+				variants.push(Name::from(tokens.pop(TokenType::Identifier, context).map_err(|error| {
 					anyhow::anyhow!("{error}\n\t{}", format!("while attempting to parse an {} variant", "either".bold().cyan()).dimmed())
 				})?));
 			});
@@ -119,13 +257,12 @@ impl TranspileToC for Either {
 }
 
 impl ToCabin for Either {
-	fn to_cabin(&self) -> String {
-		let mut cabin = "either {".to_owned();
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		writer.write_str("either {")?;
 		for variant in self.variants() {
-			write!(cabin, "\t{}", variant.0.cabin_name()).unwrap();
+			write!(writer, "\t{}", variant.0.cabin_name())?;
 		}
-		cabin.push('}');
-		cabin
+		writer.write_char('}')
 	}
 }
 
@@ -1,19 +1,24 @@
 use crate::{
-	compile_time::{builtin::builtin_to_c, CompileTime, CompileTimeStatement, TranspileToC},
+	compile_time::{builtin::builtin_to_c, instances::parameter_key, CompileTime, CompileTimeStatement, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	emitter::CWriter,
+	formatter::{write_body, CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parse_list,
 	parser::{
 		expressions::{
-			literals::{Literal, LiteralValue},
+			literals::{
+				either::{is_passed_by_value, parameter_c_type},
+				Literal, LiteralValue,
+			},
 			run::ParentExpression,
 			util::{name::Name, tags::TagList, types::Typed},
 			Expression,
 		},
 		statements::Statement,
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
+	regions::{allocating_in, write_in_region, AllocationRegion, RETURN_REGION},
 	scopes::ScopeType,
 	util::IntegerSuffix,
 	var_literal, void,
@@ -23,7 +28,10 @@ use crate::{
 // `string = format!("{string}...")`, because it avoids an extra allocation. We have a clippy warning turned on for this very
 // purpose. We assign this to `_` to indicate clearly that it's just a trait and not used explicitly anywhere outside of bringing its
 // methods into scope.
-use std::{fmt::Write as _, sync::atomic::AtomicUsize};
+use std::{
+	fmt::{self, Write as _},
+	sync::{atomic::AtomicUsize, Arc},
+};
 
 use colored::Colorize as _;
 
@@ -64,7 +72,7 @@ static FUNCTION_ID: AtomicUsize = AtomicUsize::new(0);
 impl Parse for FunctionDeclaration {
 	type Output = Self;
 
-	fn parse(tokens: &mut std::collections::VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		tokens.pop(TokenType::KeywordAction, context)?;
 
 		// Parameters
@@ -73,7 +81,7 @@ impl Parse for FunctionDeclaration {
 			tokens.pop(TokenType::LeftParenthesis, context)?;
 			if !tokens.next_is(TokenType::RightParenthesis) {
 				parse_list!(tokens, context, {
-					let name = Name(tokens.pop(TokenType::Identifier, context)?);
+					let name = Name::from(tokens.pop(TokenType::Identifier, context)?);
 					tokens
 						.pop(TokenType::Colon, context)
 						.map_err(|error| anyhow::anyhow!("{error}\n\t{}", "while attempting to parse the colon before a function parameter's type".dimmed()))?;
@@ -134,7 +142,7 @@ impl Typed for FunctionDeclaration {
 impl CompileTime for FunctionDeclaration {
 	fn compile_time_evaluate(&self, context: &mut Context, with_side_effects: bool) -> anyhow::Result<Expression> {
 		if self.has_been_compile_time_evaluated {
-			return Ok(Expression::Literal(Literal::new(LiteralValue::FunctionDeclaration(Box::new(self.clone())))));
+			return Ok(Expression::Literal(Literal::new(LiteralValue::FunctionDeclaration(Arc::new(self.clone())))));
 		}
 
 		let parameters = self
@@ -145,22 +153,22 @@ impl CompileTime for FunctionDeclaration {
 					.compile_time_evaluate(context, with_side_effects)
 					.map_err(|error| anyhow::anyhow!("{error}\n\t{}", "while evaluating a declared function's parameter types at compile-time".dimmed()))?;
 				evaluated.require_literal(context)?;
-				Ok((name.clone(), evaluated))
+				Ok((*name, evaluated))
 			})
 			.collect::<anyhow::Result<Vec<_>>>()?;
 
 		context.parameter_names = self
 			.parameters
 			.iter()
-			.map(|parameter| (parameter.0.clone(), parameter.1.as_literal(context).unwrap().clone()))
+			.map(|parameter| (parameter.0, parameter.1.as_literal(context).unwrap().clone()))
 			.collect();
 		if let Expression::Literal(Literal(LiteralValue::VariableReference(variable_reference), ..)) = &self.return_type {
-			if variable_reference.name() != &Name("Void".to_owned()) {
-				let return_parameter = (Name("return_address".to_owned()), self.return_type.as_literal(context).unwrap().clone());
+			if variable_reference.name() != &Name::from("Void") {
+				let return_parameter = (Name::from("return_address"), self.return_type.as_literal(context).unwrap().clone());
 				context.parameter_names.push(return_parameter);
 			}
 		} else {
-			let return_parameter = (Name("return_address".to_owned()), self.return_type.as_literal(context).unwrap().clone());
+			let return_parameter = (Name::from("return_address"), self.return_type.as_literal(context).unwrap().clone());
 			context.parameter_names.push(return_parameter);
 		}
 
@@ -215,33 +223,43 @@ impl CompileTime for FunctionDeclaration {
 
 		function.make_void();
 
-		if !context.function_declarations.iter().any(|forward| forward.id == self.id) {
-			let mut cloned_function = function.clone();
-			cloned_function.parameters = cloned_function
-				.parameters
-				.into_iter()
-				.map(|(parameter_name, parameter_type)| {
-					(
-						parameter_name,
-						if let Expression::Literal(Literal(LiteralValue::VariableReference(type_name, ..), ..)) = &parameter_type {
-							if context.generics_stack.last().cloned().unwrap_or_else(Vec::new).contains(type_name.name()) {
-								void!()
-							} else {
-								parameter_type
-							}
+		// Generic parameters are passed as `void*`, so instances that only differ in the types bound to them share the same C function
+		let mut cloned_function = function.clone();
+		cloned_function.parameters = cloned_function
+			.parameters
+			.into_iter()
+			.map(|(parameter_name, parameter_type)| {
+				(
+					parameter_name,
+					if let Expression::Literal(Literal(LiteralValue::VariableReference(type_name, ..), ..)) = &parameter_type {
+						if context.generics_stack.last().cloned().unwrap_or_else(Vec::new).contains(type_name.name()) {
+							void!()
 						} else {
 							parameter_type
-						},
-					)
-				})
-				.collect();
+						}
+					} else {
+						parameter_type
+					},
+				)
+			})
+			.collect();
 
-			context.function_declarations.push(cloned_function);
+		// Each distinct instance is emitted once, and code that refers to the function refers to its instance
+		let (instance_id, is_new_instance) = context.function_instances.instantiate(
+			self.id,
+			self.name.as_deref().unwrap_or("unnamed_function"),
+			parameter_key(&cloned_function.parameters),
+			|| FUNCTION_ID.fetch_add(1, std::sync::atomic::Ordering::Relaxed),
+		);
+		function.id = instance_id;
+		if is_new_instance {
+			cloned_function.id = instance_id;
+			Arc::make_mut(&mut context.function_declarations).push(cloned_function);
 		}
 
 		context.parameter_names = Vec::new();
 
-		Ok(Expression::Literal(Literal::new(LiteralValue::FunctionDeclaration(Box::new(function)))))
+		Ok(Expression::Literal(Literal::new(LiteralValue::FunctionDeclaration(Arc::new(function)))))
 	}
 }
 
@@ -252,6 +270,89 @@ impl ParentExpression for FunctionDeclaration {
 }
 
 impl FunctionDeclaration {
+	/// Returns whether this function declaration has already been evaluated at compile-time. An evaluated function declaration evaluates to itself, so callers
+	/// that hold it behind a shared pointer can reuse that pointer instead of evaluating it again.
+	///
+	/// # Returns
+	/// Whether this function declaration has already been evaluated at compile-time.
+	#[must_use]
+	pub const fn has_been_compile_time_evaluated(&self) -> bool {
+		self.has_been_compile_time_evaluated
+	}
+
+	/// Returns whether this function is a builtin function, which is a function with a `builtin` tag whose body is generated by the compiler (see
+	/// `builtin::builtin_to_c()`). Builtin functions are transpiled to `static inline` functions in the program's header, so that every call to one can
+	/// be inlined by the C compiler (see `Program::split_c()`).
+	///
+	/// # Returns
+	/// Whether this function is a builtin function.
+	#[must_use]
+	pub fn is_builtin(&self) -> bool {
+		self.tags
+			.iter()
+			.any(|tag| matches!(tag, Expression::Literal(Literal(LiteralValue::Object(table), ..)) if table.name.cabin_name() == "BuiltinTag"))
+	}
+
+	/// Returns the internal name of this function's builtin, which is the name stored in its `builtin` tag that identifies the builtin in
+	/// `builtin::BUILTINS`.
+	///
+	/// # Returns
+	/// The internal name of this function's builtin, or `None` if this function isn't a builtin function.
+	#[must_use]
+	pub fn builtin_name(&self) -> Option<String> {
+		self.tags.iter().find_map(|tag| match tag {
+			Expression::Literal(Literal(LiteralValue::Object(table), ..)) if table.name.cabin_name() == "BuiltinTag" => {
+				table.get_field(&Name::from("internal_name")).and_then(|internal_name| internal_name.as_string().ok())
+			},
+			_ => None,
+		})
+	}
+
+	/// Returns the C parameters of this function, each as its type followed by its name. Parameters with generic types are `void*`, and a function that
+	/// returns a value takes the region to allocate its return value in as its last parameter (see `regions::RETURN_REGION`).
+	///
+	/// # Parameters
+	/// - `context` - The global compiler context.
+	///
+	/// # Returns
+	/// The C parameters of this function.
+	///
+	/// # Errors
+	/// If the type of a parameter couldn't be transpiled.
+	pub fn c_parameters(&self, context: &mut Context) -> anyhow::Result<Vec<String>> {
+		let mut parameters = self
+			.parameters
+			.iter()
+			.map(|(name, type_annotation)| {
+				let c_type = type_annotation.to_c(context)?;
+				let parameter_type = if context.generics_stack.last().is_some_and(|generics| generics.contains(&Name::from_c(&c_type))) {
+					"void*".to_owned()
+				} else {
+					parameter_c_type(*name, c_type, context)
+				};
+				Ok(format!("{parameter_type} {}", name.c_name()))
+			})
+			.collect::<anyhow::Result<Vec<_>>>()?;
+		if self.is_non_void {
+			parameters.push(format!("cabin_region* {RETURN_REGION}"));
+		}
+		Ok(parameters)
+	}
+
+	/// Returns the C storage class that this function is declared with, which is `static inline` for builtin functions (see `is_builtin()`), and
+	/// nothing for every other function, which can be called from any translation unit.
+	///
+	/// # Returns
+	/// The storage class of this function, followed by a space if there is one.
+	#[must_use]
+	pub fn c_storage_class(&self) -> &'static str {
+		if self.is_builtin() {
+			"static inline "
+		} else {
+			""
+		}
+	}
+
 	/// Converts this function into a void function. This changes the return type to `void`, and adds a new parameter that's a pointer to the return value address.
 	///
 	/// Whether this function is void or not can be retrieved with the `is_non_void` field.
@@ -264,15 +365,15 @@ impl FunctionDeclaration {
 		}
 
 		self.is_non_void = if let Expression::Literal(Literal(LiteralValue::VariableReference(return_type_name, ..), ..)) = &self.return_type {
-			if return_type_name.name() == &Name("Void".to_owned()) {
+			if return_type_name.name() == &Name::from("Void") {
 				false
 			} else {
-				self.parameters.push((Name("return_address".to_owned()), self.return_type.clone()));
+				self.parameters.push((Name::from("return_address"), self.return_type.clone()));
 				self.return_type = void!();
 				true
 			}
 		} else {
-			self.parameters.push((Name("return_address".to_owned()), self.return_type.clone()));
+			self.parameters.push((Name::from("return_address"), self.return_type.clone()));
 			self.return_type = void!();
 			true
 		};
@@ -281,28 +382,12 @@ impl FunctionDeclaration {
 
 impl TranspileToC for FunctionDeclaration {
 	fn to_c(&self, context: &mut Context) -> anyhow::Result<String> {
-		if let Some(name) = context.function_type_name.clone() {
+		if let Some(name) = context.function_type_name {
 			Ok(format!(
 				"{return_type}* (*{name})({parameters})",
 				name = name.c_name(),
 				return_type = self.return_type.to_c(context)?,
-				parameters = self
-					.parameters
-					.iter()
-					.map(|(parameter_name, type_annotation)| Ok(format!(
-						"{}* {parameter_name}",
-						{
-							let c_type = type_annotation.to_c(context)?;
-							if context.generics_stack.last().cloned().unwrap_or_else(Vec::new).contains(&Name::from_c(&c_type)) {
-								"void".to_owned()
-							} else {
-								c_type
-							}
-						},
-						parameter_name = parameter_name.c_name()
-					)))
-					.collect::<anyhow::Result<Vec<_>>>()?
-					.join(", ")
+				parameters = self.c_parameters(context)?.join(", ")
 			)
 			.lines()
 			.map(|line| format!("\t{line}"))
@@ -314,6 +399,10 @@ impl TranspileToC for FunctionDeclaration {
 	}
 
 	fn c_prelude(&self, context: &mut Context) -> anyhow::Result<String> {
+		CWriter::render(|writer| self.write_c_prelude(writer, context))
+	}
+
+	fn write_c_prelude(&self, writer: &mut CWriter<'_>, context: &mut Context) -> anyhow::Result<()> {
 		let parameter_prelude = self
 			.parameters
 			.iter()
@@ -333,37 +422,15 @@ impl TranspileToC for FunctionDeclaration {
 
 		let annotation_prelude = self.tags.iter().map(|tag| tag.c_prelude(context)).collect::<anyhow::Result<Vec<_>>>()?.join("\n");
 
-		let parameters = self
-			.parameters
-			.iter()
-			.map(|(name, type_annotation)| {
-				Ok(format!(
-					"{}* {}",
-					{
-						let c_type = type_annotation.to_c(context)?;
-						if context.generics_stack.last().cloned().unwrap_or_else(Vec::new).contains(&Name::from_c(&c_type)) {
-							"void".to_owned()
-						} else {
-							c_type
-						}
-					},
-					name.c_name()
-				))
-			})
-			.collect::<anyhow::Result<Vec<_>>>()?;
-
-		let mut body = self
-			.body
-			.as_ref()
-			.map(|body| body.iter().map(|statement| statement.to_c(context)).collect::<anyhow::Result<Vec<_>>>())
-			.transpose()?
-			.unwrap_or_else(|| vec![String::new()]);
+		let parameters = self.c_parameters(context)?;
 
+		// Builtin functions have their bodies generated by the compiler instead
+		let mut builtin_body = None;
 		for tag in self.tags.iter() {
 			if let Expression::Literal(Literal(LiteralValue::Object(table), ..)) = tag {
 				// Builtin function
 				if table.name.cabin_name() == "BuiltinTag" {
-					let internal_name_value = table.get_field(&Name("internal_name".to_owned())).unwrap_or_else(|| unreachable!());
+					let internal_name_value = table.get_field(&Name::from("internal_name")).unwrap_or_else(|| unreachable!());
 					let internal_name = internal_name_value.as_string().map_err(|error| {
 						anyhow::anyhow!(
 							"{error}\n\t{}",
@@ -372,45 +439,85 @@ impl TranspileToC for FunctionDeclaration {
 						)
 					})?;
 					let parameter_names = self.parameters.iter().map(|parameter| parameter.0.c_name()).collect::<Vec<_>>();
-					body = builtin_to_c(&internal_name, parameter_names.as_slice())?
-						.lines()
-						.map(|line| line.to_owned())
-						.collect::<Vec<_>>();
+					builtin_body = Some(builtin_to_c(&internal_name, parameter_names.as_slice())?);
 					break;
 				}
 			}
 		}
 
-		let _annotations = self.tags.iter().map(|tag| tag.to_c(context)).collect::<anyhow::Result<Vec<_>>>()?;
-
-		let self_prelude = format!(
-			"void {name}_{id}({parameters}) {{\n{body}\n}}",
+		writeln!(writer, "{}", [parameter_prelude, return_type_prelude, body_prelude, annotation_prelude].join("\n"))?;
+		writeln!(
+			writer,
+			"{storage_class}void {name}_{id}({parameters}) {{",
+			storage_class = self.c_storage_class(),
 			name = self.name.as_ref().unwrap_or(&"unnamed_function".to_owned()),
 			id = self.id,
 			parameters = parameters.join(", "),
-			body = body.join("\n").lines().map(|line| format!("\t{line}")).collect::<Vec<_>>().join("\n"),
-		);
-		Ok([parameter_prelude, return_type_prelude, body_prelude, annotation_prelude, self_prelude].join("\n"))
+		)?;
+		// Parameters that are passed by value are plain C values in the body, so their types are needed to lower operations on them (see
+		// `scalar_c_type()`) while it's transpiled
+		let mut by_value_parameters = Vec::new();
+		for (name, type_annotation) in &self.parameters {
+			if name != &Name::from("return_address") && is_passed_by_value(&type_annotation.to_c(context)?, context) {
+				by_value_parameters.push((*name, type_annotation.as_literal(context)?.clone()));
+			}
+		}
+		let outer_parameters = std::mem::replace(&mut context.parameter_names, by_value_parameters);
+
+		let start = writer.written();
+		let written = writer.indented(|body| {
+			if let Some(builtin_c) = &builtin_body {
+				body.write_str(builtin_c)?;
+			} else {
+				let write_body = |statements: &mut CWriter<'_>, body_context: &mut Context| {
+					for (index, statement) in self.body.iter().flatten().enumerate() {
+						if index != 0 {
+							statements.write_char('\n')?;
+						}
+						statement.write_c(statements, body_context)?;
+					}
+					Ok(())
+				};
+				// The body's value is returned to the caller, so it's allocated in the region that the caller passed for it
+				let return_region = if self.is_non_void { AllocationRegion::Return } else { AllocationRegion::Global };
+				allocating_in(context, return_region, |body_context| match self.inner_scope_id {
+					Some(scope_id) => write_in_region(body, body_context, scope_id, write_body),
+					None => write_body(body, body_context),
+				})?;
+			}
+			body.end_line()?;
+			Ok::<_, anyhow::Error>(())
+		});
+		context.parameter_names = outer_parameters;
+		written?;
+
+		// An empty body is still written as an empty line
+		if writer.written() == start {
+			writer.write_char('\n')?;
+		}
+		writer.write_char('}')?;
+
+		let _annotations = self.tags.iter().map(|tag| tag.to_c(context)).collect::<anyhow::Result<Vec<_>>>()?;
+
+		Ok(())
 	}
 }
 
 impl ToCabin for FunctionDeclaration {
-	fn to_cabin(&self) -> String {
-		let mut cabin_code = "function(".to_owned();
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		writer.write_str("function(")?;
 		for (parameter_name, parameter_type) in &self.parameters {
-			write!(cabin_code, "{}: {},", parameter_name.cabin_name(), parameter_type.to_cabin()).unwrap();
+			write!(writer, "{}: ", parameter_name.cabin_name())?;
+			parameter_type.write_cabin(writer)?;
+			writer.write_char(',')?;
 		}
-		write!(cabin_code, "): {}", self.return_type.to_cabin()).unwrap();
+		writer.write_str("): ")?;
+		self.return_type.write_cabin(writer)?;
 		if let Some(body) = &self.body {
-			cabin_code.push('{');
-			for statement in body {
-				for line in statement.to_cabin().lines() {
-					write!(cabin_code, "\t{line}").unwrap();
-				}
-			}
-			cabin_code.push('}');
+			writer.write_char(' ')?;
+			write_body(writer, body)?;
 		}
-		cabin_code
+		Ok(())
 	}
 }
 
@@ -1,8 +1,8 @@
 use crate::{
 	compile_time::{CompileTime, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parse_list,
 	parser::{
 		expressions::{
@@ -11,9 +11,10 @@ use crate::{
 			util::{name::Name, tags::TagList, types::Typed},
 			Expression,
 		},
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 	scopes::{DeclarationData, ScopeType},
+	text::{TEXT_FIELDS, TEXT_RUNTIME},
 	var_literal,
 };
 
@@ -24,12 +25,124 @@ use colored::Colorize as _;
 // purpose. We assign this to `_` to indicate clearly that it's just a trait and not used explicitly anywhere outside of bringing its
 // methods into scope.
 use std::{
-	fmt::Write as _,
-	sync::atomic::{AtomicUsize, Ordering},
+	fmt::{self, Write as _},
+	sync::{
+		atomic::{AtomicUsize, Ordering},
+		Arc,
+	},
 };
 
 use super::Literal;
 
+/// The C functions that implement lists, which are written right after the definition of the `List` struct. A list stores pointers to its elements in a
+/// single contiguous ring buffer: `start` is the index in `data` of the first element, and the elements wrap around to the front of the buffer when they
+/// reach the end of it. This makes both appending and prepending amortized constant-time, while indexing stays a single array access. List literals point
+/// `data` at a buffer that the list doesn't own, which is copied into an owned buffer the first time the list grows.
+///
+/// These are `static inline` because the header they're in is included by every translation unit (see `units.rs`).
+const LIST_RUNTIME: &str = r#"
+static inline void cabin_list_resize(List_u* list, int capacity) {
+	void** data = malloc(capacity * sizeof(void*));
+	for (int index = 0; index < list->size; index++) {
+		data[index] = list->data[(list->start + index) % list->capacity];
+	}
+	if (list->owns_data) {
+		free(list->data);
+	}
+	list->data = data;
+	list->capacity = capacity;
+	list->start = 0;
+	list->owns_data = true;
+}
+
+static inline void cabin_list_reserve_one(List_u* list) {
+	if (list->size == list->capacity) {
+		cabin_list_resize(list, list->capacity < 4 ? 8 : list->capacity * 2);
+	}
+}
+
+static inline void cabin_list_append(List_u* list, void* element) {
+	cabin_list_reserve_one(list);
+	list->data[(list->start + list->size) % list->capacity] = element;
+	list->size++;
+}
+
+static inline void cabin_list_prepend(List_u* list, void* element) {
+	cabin_list_reserve_one(list);
+	list->start = (list->start + list->capacity - 1) % list->capacity;
+	list->data[list->start] = element;
+	list->size++;
+}
+
+static inline void** cabin_list_slot(List_u* list, double index) {
+	if (index < 0 || index >= list->size || index != (int) index) {
+		fprintf(stderr, "Error: List index %g is out of bounds for a list of length %d\n", index, list->size);
+		exit(1);
+	}
+	return &list->data[(list->start + (int) index) % list->capacity];
+}
+
+static inline void cabin_list_make_contiguous(List_u* list) {
+	if (list->start + list->size > list->capacity) {
+		cabin_list_resize(list, list->capacity);
+	}
+}"#;
+
+/// The C functions that implement open files, which are written right after the definition of the `File` struct. A file is read through a large stdio
+/// buffer, and lines are read into a line buffer owned by the file that's reused for every line. Text read from a file owns its bytes, because it can
+/// outlive the next read, such as when a line is stored in a list; Lines of up to 23 bytes are stored inline in the Text (see `TEXT_FIELDS`), so reading
+/// a file one short line at a time doesn't allocate anything for each line.
+const FILE_RUNTIME: &str = r#"
+#define CABIN_FILE_BUFFER_SIZE (1 << 16)
+
+static inline File_u cabin_file_open(const char* path) {
+	File_u file = { 0 };
+	file.handle = fopen(path, "rb");
+	if (file.handle == NULL) {
+		fprintf(stderr, "Error: Couldn't open the file \"%s\"\n", path);
+		exit(1);
+	}
+	setvbuf(file.handle, NULL, _IOFBF, CABIN_FILE_BUFFER_SIZE);
+	return file;
+}
+
+static inline bool cabin_file_next_line(File_u* file, Text_u* line) {
+	ssize_t length = file->handle == NULL ? -1 : getline(&file->line, &file->line_capacity, file->handle);
+	if (length < 0) {
+		cabin_text_borrow(line, "", 0);
+		return false;
+	}
+	if (length > 0 && file->line[length - 1] == '\n') {
+		file->line[--length] = '\0';
+		if (length > 0 && file->line[length - 1] == '\r') {
+			file->line[--length] = '\0';
+		}
+	}
+	*line = cabin_text_from(file->line, length);
+	return true;
+}
+
+static inline void cabin_file_read_chunk(File_u* file, double size, Text_u* chunk) {
+	size_t capacity = size < 0 ? 0 : (size_t) size;
+	Text_u text = { 0 };
+	cabin_text_reserve(&text, capacity);
+	char* data = text.storage == CABIN_TEXT_INLINE ? text.inline_value : text.internal_value;
+	size_t length = file->handle == NULL ? 0 : fread(data, 1, capacity, file->handle);
+	data[length] = '\0';
+	text.length = length;
+	*chunk = text;
+}
+
+static inline void cabin_file_close(File_u* file) {
+	if (file->handle != NULL) {
+		fclose(file->handle);
+		file->handle = NULL;
+	}
+	free(file->line);
+	file->line = NULL;
+	file->line_capacity = 0;
+}"#;
+
 /// A type declaration. This is equivalent to a struct or interface declaration in other languages.
 #[derive(Clone, Debug)]
 pub struct GroupDeclaration {
@@ -72,7 +185,7 @@ pub enum GroupType {
 impl Parse for GroupDeclaration {
 	type Output = Self;
 
-	fn parse(tokens: &mut std::collections::VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		tokens.pop(TokenType::KeywordGroup, context)?;
 
 		// Compile-time Parameters
@@ -83,7 +196,7 @@ impl Parse for GroupDeclaration {
 				tokens.pop(TokenType::LeftAngleBracket, context)?;
 				if !tokens.next_is(TokenType::RightAngleBracket) {
 					parse_list!(tokens, context, {
-						let name = Name(tokens.pop(TokenType::Identifier, context)?);
+						let name = Name::from(tokens.pop(TokenType::Identifier, context)?);
 						compile_time_parameters.push(name);
 					});
 				}
@@ -103,7 +216,7 @@ impl Parse for GroupDeclaration {
 			for parameter in generic_parameters {
 				context
 					.scope_data
-					.declare_new_variable(parameter.clone(), None, Expression::Literal(context.unknown_at_compile_time().clone()), TagList::default())?;
+					.declare_new_variable(*parameter, None, Expression::Literal(context.unknown_at_compile_time().clone()), TagList::default())?;
 			}
 		}
 
@@ -119,7 +232,7 @@ impl Parse for GroupDeclaration {
 					.unwrap_or_default();
 
 				// Field name
-				let name = Name(tokens.pop(TokenType::Identifier, context)?);
+				let name = Name::from(tokens.pop(TokenType::Identifier, context)?);
 
 				// Explicit type tag
 				let mut type_annotation = tokens
@@ -138,14 +251,14 @@ impl Parse for GroupDeclaration {
 						let mut value = Expression::parse(tokens, context).map_err(|error| anyhow::anyhow!("{error}\n\twhile parsing value of field \"{}\"", name.cabin_name()))?;
 
 						if let Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) = &mut value {
-							function_declaration.name = Some(name.cabin_name());
+							Arc::make_mut(function_declaration).name = Some(name.cabin_name().to_owned());
 						}
 
 						// Infer type tag
 						if type_annotation.is_none() {
 							type_annotation = match &value {
 								Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) => {
-									Some(Expression::Literal(Literal::new(LiteralValue::FunctionDeclaration(function_declaration.clone()))))
+									Some(Expression::Literal(Literal::new(LiteralValue::FunctionDeclaration(Arc::clone(function_declaration)))))
 								},
 								_ => None,
 							};
@@ -206,7 +319,7 @@ impl Typed for GroupDeclaration {
 impl CompileTime for GroupDeclaration {
 	fn compile_time_evaluate(&self, context: &mut Context, with_side_effects: bool) -> anyhow::Result<Expression> {
 		if self.group_type == GroupType::Either {
-			return Ok(Expression::Literal(Literal::new(LiteralValue::Group(self.clone()))));
+			return Ok(Expression::Literal(Literal::new(LiteralValue::Group(Arc::new(self.clone())))));
 		};
 
 		if let Some(generics) = &self.compile_time_parameters {
@@ -263,8 +376,12 @@ impl CompileTime for GroupDeclaration {
 					});
 
 					// if the field is a function, give it the tags
+					// The function was registered to be transpiled when it was evaluated, before it had the tags, so the registered copy is given them too
 					if let Ok(Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..))) = &mut evaluated_value {
-						function_declaration.tags = field.tags.clone();
+						Arc::make_mut(function_declaration).tags = field.tags.clone();
+						if let Some(registered) = Arc::make_mut(&mut context.function_declarations).iter_mut().find(|registered| registered.id == function_declaration.id) {
+							registered.tags = field.tags.clone();
+						}
 					}
 
 					// Return the evaluated field value
@@ -284,14 +401,14 @@ impl CompileTime for GroupDeclaration {
 			context.generics_stack.pop().unwrap();
 		}
 
-		Ok(Expression::Literal(Literal::new(LiteralValue::Group(Self {
+		Ok(Expression::Literal(Literal::new(LiteralValue::Group(Arc::new(Self {
 			fields,
 			compile_time_parameters: self.compile_time_parameters.clone(),
 			inner_scope_id: self.inner_scope_id,
 			group_type: GroupType::Group,
 			tags: self.tags.clone(),
 			id: self.id,
-		}))))
+		})))))
 	}
 }
 
@@ -301,10 +418,7 @@ impl TranspileToC for GroupDeclaration {
 	}
 
 	fn c_prelude(&self, context: &mut Context) -> anyhow::Result<String> {
-		let name = context
-			.transpiling_group_name
-			.clone()
-			.map_or_else(|| format!("anonymous_group_{}", self.id), |name| name.c_name());
+		let name = context.transpiling_group_name.map_or_else(|| format!("anonymous_group_{}", self.id), |name| name.c_name());
 		let mut prelude = vec![format!("// group {name}", name = Name::from_c(&name).cabin_name())];
 		if let Some(compile_time_parameters) = &self.compile_time_parameters {
 			context.generics_stack.push(compile_time_parameters.clone());
@@ -327,6 +441,13 @@ impl TranspileToC for GroupDeclaration {
 			context.generics_stack.pop().unwrap();
 		}
 
+		// Scalar groups are typedefs of their scalar type rather than structs (see `Name::unboxed_c_type()`)
+		if let Some(scalar_type) = Name::from_c(&name).unboxed_c_type() {
+			prelude.push(format!("// (lowered to {scalar_type})"));
+			context.transpiling_group_name = None;
+			return Ok(prelude.join("\n"));
+		}
+
 		if let Some(compile_time_parameters) = &self.compile_time_parameters {
 			context.generics_stack.push(compile_time_parameters.clone());
 		}
@@ -337,7 +458,7 @@ impl TranspileToC for GroupDeclaration {
 
 		for field in &self.fields {
 			if let Expression::Literal(Literal(LiteralValue::FunctionDeclaration(_), ..)) = field.type_annotation.as_ref().unwrap() {
-				context.function_type_name = Some(field.name.clone());
+				context.function_type_name = Some(field.name);
 				let function_type_c = field.type_annotation.as_ref().unwrap().to_c(context)?;
 				prelude.push(format!("{};", function_type_c.get(0..function_type_c.len() - 1).unwrap()));
 				context.function_type_name = None;
@@ -347,9 +468,9 @@ impl TranspileToC for GroupDeclaration {
 		}
 
 		match name.as_str() {
-			"Text_u" => prelude.push("\tchar* internal_value;".to_owned()),
-			"Number_u" => prelude.push("\tfloat internal_value;".to_owned()),
-			"List_u" => prelude.push("\tint size;\n\tint capacity;\n\tvoid** data;".to_owned()),
+			"Text_u" => prelude.push(TEXT_FIELDS.to_owned()),
+			"List_u" => prelude.push("\tint size;\n\tint capacity;\n\tint start;\n\tbool owns_data;\n\tvoid** data;".to_owned()),
+			"File_u" => prelude.push("\tFILE* handle;\n\tchar* line;\n\tsize_t line_capacity;".to_owned()),
 
 			// TODO: C doesn't allow empty structs. For now, the temporary fix is just to add this useless char field (char is the smallest data type). However,
 			// this will cause empty structs to have more size than they otherwise would. What should we do here?
@@ -365,6 +486,12 @@ impl TranspileToC for GroupDeclaration {
 		}
 
 		prelude.push("};".to_owned());
+		match name.as_str() {
+			"Text_u" => prelude.push(TEXT_RUNTIME.to_owned()),
+			"List_u" => prelude.push(LIST_RUNTIME.to_owned()),
+			"File_u" => prelude.push(FILE_RUNTIME.to_owned()),
+			_ => {},
+		}
 		context.transpiling_group_name = None;
 
 		Ok(prelude.join("\n"))
@@ -372,17 +499,17 @@ impl TranspileToC for GroupDeclaration {
 }
 
 impl ToCabin for GroupDeclaration {
-	fn to_cabin(&self) -> String {
-		let mut cabin_code = "group {".to_owned();
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		writer.write_str("group {")?;
 		for field in &self.fields {
-			write!(cabin_code, "\t{}", field.name.cabin_name()).unwrap();
-			write!(cabin_code, ": {}", field.type_annotation.as_ref().unwrap().to_cabin()).unwrap();
+			write!(writer, "\t{}: ", field.name.cabin_name())?;
+			field.type_annotation.as_ref().unwrap().write_cabin(writer)?;
 			if let Some(value) = &field.value {
-				write!(cabin_code, " = {}", value.to_cabin().lines().collect::<Vec<_>>().join("\n\t")).unwrap();
+				writer.write_str(" = ")?;
+				writer.indented(|value_writer| value.write_cabin(value_writer))?;
 			}
 		}
-		cabin_code.push('}');
-		cabin_code
+		writer.write_char('}')
 	}
 }
 
@@ -1,10 +1,16 @@
-use std::sync::atomic::{AtomicUsize, Ordering};
+use std::{
+	fmt,
+	sync::{
+		atomic::{AtomicUsize, Ordering},
+		Arc,
+	},
+};
 
 use crate::{
 	compile_time::{ambassador_impl_TranspileToC, CompileTime, TranspileToC},
 	context::Context,
-	formatter::{ambassador_impl_ColoredCabin, ambassador_impl_ToCabin, ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	formatter::{ambassador_impl_ColoredCabin, ambassador_impl_ToCabin, CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	object_literal, parse_list,
 	parser::{
 		expressions::{
@@ -22,7 +28,7 @@ use crate::{
 			},
 			Expression,
 		},
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 };
 
@@ -111,6 +117,13 @@ impl Literal {
 // Ensure that when literals are evaluated at compile-time, they keep the same virtual address
 impl CompileTime for Literal {
 	fn compile_time_evaluate(&self, context: &mut Context, with_side_effects: bool) -> anyhow::Result<Expression> {
+		// Function declarations that have already been evaluated evaluate to themselves, so we can share the existing node instead of copying its body
+		if let LiteralValue::FunctionDeclaration(function_declaration) = self.value() {
+			if function_declaration.has_been_compile_time_evaluated() {
+				return Ok(Expression::Literal(self.clone()));
+			}
+		}
+
 		let Expression::Literal(Self(value, ..)) = self.value().compile_time_evaluate(context, with_side_effects)? else {
 			context.encountered_compiler_bug = true;
 			anyhow::bail!("Literal after compile-time evaluation is not a literal");
@@ -135,7 +148,7 @@ impl ParentExpression for Literal {
 impl Parse for Literal {
 	type Output = Self;
 
-	fn parse(tokens: &mut std::collections::VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		Ok(Self::new(LiteralValue::parse(tokens, context)?))
 	}
 }
@@ -152,11 +165,11 @@ pub enum LiteralValue {
 	/// An identifier literal.
 	VariableReference(VariableReference),
 	/// A table literal.
-	Object(Object),
+	Object(Arc<Object>),
 	/// A group literal.
-	Group(GroupDeclaration),
+	Group(Arc<GroupDeclaration>),
 	/// A function declaration literal.
-	FunctionDeclaration(Box<FunctionDeclaration>),
+	FunctionDeclaration(Arc<FunctionDeclaration>),
 
 	Either(Either),
 }
@@ -164,7 +177,7 @@ pub enum LiteralValue {
 impl Parse for LiteralValue {
 	type Output = Self;
 
-	fn parse(tokens: &mut std::collections::VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		Ok(match tokens.peek().ok_or_else(|| anyhow::anyhow!("Expected literal but found end of input"))?.token_type {
 			// Number literals
 			TokenType::Number => {
@@ -210,10 +223,10 @@ impl Parse for LiteralValue {
 
 			// Other expressions
 			TokenType::Identifier => Self::VariableReference(VariableReference::parse(tokens, context)?),
-			TokenType::KeywordNew => Self::Object(Object::parse(tokens, context)?),
-			TokenType::KeywordGroup => Self::Group(GroupDeclaration::parse(tokens, context)?),
+			TokenType::KeywordNew => Self::Object(Arc::new(Object::parse(tokens, context)?)),
+			TokenType::KeywordGroup => Self::Group(Arc::new(GroupDeclaration::parse(tokens, context)?)),
 			TokenType::KeywordEither => Self::Either(Either::parse(tokens, context)?),
-			TokenType::KeywordAction => Self::FunctionDeclaration(Box::new(FunctionDeclaration::parse(tokens, context)?)),
+			TokenType::KeywordAction => Self::FunctionDeclaration(Arc::new(FunctionDeclaration::parse(tokens, context)?)),
 
 			// Not a literal
 			_ => anyhow::bail!("Expected literal but found {}", tokens.peek().unwrap().token_type),
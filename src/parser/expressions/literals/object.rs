@@ -2,23 +2,32 @@ use crate::{
 	cli::theme::Styled,
 	compile_time::{CompileTime, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	emitter::CWriter,
+	formatter::{write_separated, CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parse_list,
 	parser::{
 		expressions::{
-			literals::{Literal, LiteralValue, Name},
+			literals::{
+				either::{tagged_either, variant_tag_c_name},
+				Literal, LiteralValue, Name,
+			},
 			run::ParentExpression,
 			util::{tags::TagList, types::Typed},
 			Expression,
 		},
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
+	regions::{allocation_region, write_reference},
 	scopes::DeclarationData,
 	var_literal,
 };
 
-use std::{collections::HashMap, fmt::Write as _, sync::atomic::AtomicUsize};
+use std::{
+	collections::HashMap,
+	fmt::{self, Write as _},
+	sync::{atomic::AtomicUsize, Arc},
+};
 
 use colored::Colorize as _;
 
@@ -70,7 +79,7 @@ impl Object {
 	pub fn new() -> Self {
 		Self {
 			fields: Vec::new(),
-			name: Name(String::new()),
+			name: Name::from(""),
 			internal_fields: HashMap::new(),
 			anonymous_id: None,
 			has_been_compile_time_evaluated: false,
@@ -89,8 +98,10 @@ impl Object {
 	pub fn named(name: Name) -> Self {
 		Self {
 			fields: Vec::new(),
-			internal_fields: if name == Name("Text".to_owned()) {
+			internal_fields: if name == Name::from("Text") {
 				HashMap::from([("internal_value".to_owned(), InternalValue::String("uninitialized".to_owned()))])
+			} else if name == Name::from("Number") {
+				HashMap::from([("internal_value".to_owned(), InternalValue::Number(0.0))])
 			} else {
 				HashMap::new()
 			},
@@ -104,7 +115,7 @@ impl Object {
 	pub fn make_anonymous(&mut self) {
 		let id = TABLE_ID.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
 		self.anonymous_id = Some(id);
-		self.name = Name("<anonymous>".to_owned());
+		self.name = Name::from("<anonymous>");
 	}
 
 	/// Returns whether this is an anonymous object, i.e., an object created with `new Object`.
@@ -183,23 +194,24 @@ impl Object {
 impl Parse for Object {
 	type Output = Self;
 
-	fn parse(tokens: &mut std::collections::VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		tokens.pop(TokenType::KeywordNew, context)?;
-		let type_name = tokens.pop(TokenType::Identifier, context)?;
+		let type_name = Name::from(tokens.pop(TokenType::Identifier, context)?);
+		context.dependencies.add_dependency(type_name);
 		tokens.pop(TokenType::LeftBrace, context)?;
 
 		let mut object = Self::new();
 
 		// Name
-		object.name = Name(type_name);
-		if object.name == Name("Object".to_owned()) {
+		object.name = type_name;
+		if object.name == Name::from("Object") {
 			object.make_anonymous();
 		}
 
 		if !tokens.next_is(TokenType::RightBrace) {
 			parse_list!(tokens, context, {
 				let tags = TagList::parse(tokens, context)?;
-				let field_name = Name(tokens.pop(TokenType::Identifier, context)?);
+				let field_name = Name::from(tokens.pop(TokenType::Identifier, context)?);
 				tokens.pop(TokenType::Equal, context).map_err(|error| {
 					anyhow::anyhow!(
 						"{error}\n\twhile parsing the equal sign before parsing the field \"{}\"'s value on an object literal",
@@ -208,8 +220,9 @@ impl Parse for Object {
 				})?;
 				let mut value = Expression::parse(tokens, context).map_err(|error| anyhow::anyhow!("Error parsing value of field \"{}\": {error}", field_name.cabin_name()))?;
 				if let Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) = &mut value {
-					function_declaration.tags = tags.clone();
-					function_declaration.name = Some(field_name.cabin_name());
+					let function = Arc::make_mut(function_declaration);
+					function.tags = tags.clone();
+					function.name = Some(field_name.cabin_name().to_owned());
 				}
 				object.add_field(DeclarationData {
 					name: field_name,
@@ -222,7 +235,7 @@ impl Parse for Object {
 
 		tokens.pop(TokenType::RightBrace, context)?;
 
-		if object.name == Name("List".to_owned()) {
+		if object.name == Name::from("List") {
 			object.add_internal_field("data".to_owned(), InternalValue::List(Vec::new()));
 		}
 
@@ -232,6 +245,7 @@ impl Parse for Object {
 
 impl CompileTime for Object {
 	fn compile_time_evaluate(&self, context: &mut Context, with_side_effects: bool) -> anyhow::Result<Expression> {
+		context.compile_time_profile.record_allocation();
 		let mut new_object = Self::new();
 		for field in &self.fields {
 			// Value
@@ -286,7 +300,7 @@ impl CompileTime for Object {
 
 			// Add the field
 			new_object.add_field(DeclarationData {
-				name: field.name.clone(),
+				name: field.name,
 				value: Some(new_value),
 				tags: compile_time_annotations,
 				type_annotation: None,
@@ -320,7 +334,7 @@ impl CompileTime for Object {
 			for field in &group_declaration.fields {
 				if let Some(field_value) = &field.value {
 					new_object.add_field(DeclarationData {
-						name: field.name.clone(),
+						name: field.name,
 						type_annotation: None,
 						value: Some(field_value.clone()),
 						tags: field.tags.clone(),
@@ -329,7 +343,7 @@ impl CompileTime for Object {
 			}
 		}
 
-		new_object.name = self.name.clone();
+		new_object.name = self.name;
 		new_object.internal_fields = self.internal_fields.clone();
 		new_object.anonymous_id = self.anonymous_id;
 		new_object.has_been_compile_time_evaluated = true;
@@ -343,7 +357,7 @@ impl CompileTime for Object {
 			context.groups.push((format!("object_{}", new_object.anonymous_id.as_ref().unwrap()), GroupType::Group));
 		}
 
-		Ok(Expression::Literal(Literal::new(LiteralValue::Object(new_object))))
+		Ok(Expression::Literal(Literal::new(LiteralValue::Object(Arc::new(new_object)))))
 	}
 }
 
@@ -365,117 +379,169 @@ impl Typed for Object {
 
 impl TranspileToC for Object {
 	fn c_prelude(&self, context: &mut Context) -> anyhow::Result<String> {
-		let mut prelude = String::new();
+		CWriter::render(|writer| self.write_c_prelude(writer, context))
+	}
+
+	fn to_c(&self, context: &mut Context) -> anyhow::Result<String> {
+		CWriter::render(|writer| self.write_c(writer, context))
+	}
 
+	fn write_c_prelude(&self, writer: &mut CWriter<'_>, context: &mut Context) -> anyhow::Result<()> {
 		// Anonymous Tables
 		if self.is_anonymous() {
-			write!(prelude, "struct {} {{", self.c_name())?;
-			for field in &self.fields {
-				match field.value.as_ref().unwrap() {
-					Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) => prelude.push_str(
-						&("\n".to_owned()
-							+ &format!(
-								"{return_type} (*{name})({parameters});",
-								name = field.name.c_name(),
-								return_type = {
-									let mut raw = function_declaration.return_type.to_c(context)?;
-									if &raw != "void" {
-										raw += "*";
-									}
-									raw
-								},
-								parameters = function_declaration
-									.parameters
-									.iter()
-									.map(|(name, type_annotation)| Ok(format!("{}* {name}", type_annotation.to_c(context)?, name = name.c_name())))
-									.collect::<anyhow::Result<Vec<_>>>()?
-									.join(", ")
-							)
-							.lines()
-							.map(|line| format!("\t{line}"))
-							.collect::<Vec<_>>()
-							.join("\n")),
-					),
-
-					Expression::Literal(Literal(LiteralValue::Group(group), ..)) => write!(prelude, "\n\tGroup_{}* {};", group.id, field.name.c_name())?,
-					Expression::Literal(Literal(LiteralValue::Object(object), ..)) => write!(prelude, "\n\ttable_{}* {};", object.anonymous_id.unwrap(), field.name.c_name())?,
-
-					_ => {
-						// let Type::Group(field_type, field_id) = field.value.as_ref().unwrap().get_type(context)?;
-						// let group_type = context.scope_data.get_variable_from_id(&field_type, field_id).unwrap().value.as_ref().unwrap().clone();
-
-						// write!(prelude, "\n\t{}* {};", group_type.to_c(context)?, field.name.c_name())?;
-						todo!()
-					},
-				};
-			}
+			write!(writer, "struct {} {{", self.c_name())?;
+			writer.indented(|body| {
+				for field in &self.fields {
+					match field.value.as_ref().unwrap() {
+						Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) => write!(
+							body,
+							"\n{return_type} (*{name})({parameters});",
+							name = field.name.c_name(),
+							return_type = {
+								let mut raw = function_declaration.return_type.to_c(context)?;
+								if &raw != "void" {
+									raw += "*";
+								}
+								raw
+							},
+							parameters = function_declaration.c_parameters(context)?.join(", ")
+						)?,
+
+						Expression::Literal(Literal(LiteralValue::Group(group), ..)) => write!(body, "\nGroup_{}* {};", group.id, field.name.c_name())?,
+						Expression::Literal(Literal(LiteralValue::Object(object), ..)) => write!(body, "\ntable_{}* {};", object.anonymous_id.unwrap(), field.name.c_name())?,
+
+						_ => {
+							// let Type::Group(field_type, field_id) = field.value.as_ref().unwrap().get_type(context)?;
+							// let group_type = context.scope_data.get_variable_from_id(&field_type, field_id).unwrap().value.as_ref().unwrap().clone();
+
+							// write!(body, "\n{}* {};", group_type.to_c(context)?, field.name.c_name())?;
+							todo!()
+						},
+					};
+				}
 
-			if self.fields.is_empty() {
-				prelude.push_str("\n\tchar empty;");
-			}
+				if self.fields.is_empty() {
+					body.write_str("\nchar empty;")?;
+				}
+				Ok::<_, anyhow::Error>(())
+			})?;
 
-			writeln!(prelude, "\n}};\n")?;
+			writer.write_str("\n};\n\n")?;
 		}
 
 		for field in &self.fields {
-			prelude.push_str(&field.value.as_ref().unwrap().c_prelude(context)?);
+			field.value.as_ref().unwrap().write_c_prelude(writer, context)?;
 		}
 
-		Ok(prelude)
+		Ok(())
 	}
 
-	fn to_c(&self, context: &mut Context) -> anyhow::Result<String> {
-		let mut fields = Vec::new();
+	fn write_c(&self, writer: &mut CWriter<'_>, context: &mut Context) -> anyhow::Result<()> {
+		// Scalar objects are plain C values, which are written as compound literals so that their address can still be taken
+		if let Some(scalar_type) = self.name.unboxed_c_type() {
+			let value = match (scalar_type, self.get_internal_field("internal_value"), self.get_internal_field("variant")) {
+				("double", Some(InternalValue::Number(internal_value)), _) => internal_value.to_string(),
+				("bool", _, Some(InternalValue::String(variant))) => variant.clone(),
+				_ => {
+					context.encountered_compiler_bug = true;
+					anyhow::bail!(
+						"Attempted to convert an object of the scalar group \"{}\" to C, but the object has no internal {} value",
+						self.name.cabin_name().bold().cyan(),
+						scalar_type.bold().cyan()
+					);
+				},
+			};
 
-		// Explicit fields
-		for field in &self.fields {
-			fields.push(
-				format!(".{name} = &{value}\n", name = field.name.c_name(), value = field.value.as_ref().unwrap().to_c(context)?)
-					.lines()
-					.map(|line| format!("\t{line}"))
-					.collect::<Vec<_>>()
-					.join("\n"),
-			);
+			write!(writer, "({}) {{ {value} }}", self.c_name())?;
+			return Ok(());
 		}
 
-		if self.name == Name("Number".to_owned()) {
-			let Some(InternalValue::Number(internal_value)) = self.get_internal_field("internal_value") else {
-				unreachable!();
-			};
-
-			fields.push(format!("\t.internal_value = {internal_value}"));
+		// Variants of other eithers are their tags, which are also written as compound literals
+		if let Some(InternalValue::String(variant)) = self.get_internal_field("variant") {
+			if tagged_either(self.name, context).is_some() {
+				write!(writer, "({}) {{ {} }}", self.c_name(), variant_tag_c_name(self.name, variant))?;
+				return Ok(());
+			}
 		}
 
-		if self.name == Name("Text".to_owned()) {
+		// Text that's known at compile-time is a constant in the program's pool of Text, so identical Text is only stored once (see `TextConstants`)
+		if self.name == Name::from("Text") {
 			let Some(InternalValue::String(internal_value)) = self.get_internal_field("internal_value") else {
 				unreachable!();
 			};
-
-			fields.push(format!("\t.internal_value = \"{internal_value}\""));
+			writer.write_str(&context.text_constants.constant(internal_value)?)?;
+			return Ok(());
 		}
 
-		if fields.is_empty() {
-			fields.push("\t.empty = '0'".to_owned());
-		}
+		writeln!(writer, "({}) {{", self.c_name())?;
+		writer.indented(|fields| {
+			let mut separator = "";
 
-		Ok(format!("({}) {{\n{}\n}}", self.c_name(), fields.join(",\n")))
+			// Explicit fields
+			for field in &self.fields {
+				write!(fields, "{separator}.{name} = ", name = field.name.c_name())?;
+				write_reference(field.value.as_ref().unwrap(), fields, context)?;
+				separator = ",\n";
+			}
+
+			// List literals point at a buffer of their elements that they don't own, which is copied the first time the list grows. The buffer is
+			// allocated in the same region as the list itself, because a compound literal would only live until the end of the enclosing block
+			if let Some(InternalValue::List(elements)) = self.get_internal_field("data") {
+				write!(
+					fields,
+					"{separator}.size = {length},\n.capacity = {length},\n.start = 0,\n.owns_data = false,\n.data = ",
+					length = elements.len()
+				)?;
+				if elements.is_empty() {
+					fields.write_str("NULL")?;
+				} else {
+					write!(fields, "(void**) cabin_allocate({}, (void*[]) {{", allocation_region(context))?;
+					let mut element_separator = " ";
+					for element in elements {
+						fields.write_str(element_separator)?;
+						write_reference(element, fields, context)?;
+						element_separator = ", ";
+					}
+					fields.write_str(" })")?;
+				}
+				separator = ",\n";
+			}
+
+			// Files are opened at runtime by `File.open`, so a file that hasn't been opened yet has no handle
+			if self.name == Name::from("File") {
+				write!(fields, "{separator}.handle = NULL")?;
+				separator = ",\n";
+			}
+
+			if separator.is_empty() {
+				fields.write_str(".empty = '0'")?;
+			}
+
+			// This is written at the fields' indentation so that a field whose value ends with a newline leaves an indented blank line
+			fields.write_char('\n')?;
+			Ok::<_, anyhow::Error>(())
+		})?;
+		writer.write_char('}')?;
+		Ok(())
 	}
 }
 
 impl ToCabin for Object {
-	fn to_cabin(&self) -> String {
-		let mut table_cabin = self.name.cabin_name() + " {";
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		write!(writer, "{} {{", self.name.cabin_name())?;
 		for field in &self.fields {
 			if !field.tags.is_empty() {
-				write!(table_cabin, "#[{}]", field.tags.iter().map(|tag| tag.to_cabin()).collect::<Vec<_>>().join(", ")).unwrap();
+				writer.write_str("#[")?;
+				write_separated(writer, field.tags.iter(), ", ")?;
+				writer.write_char(']')?;
 			}
-			write!(table_cabin, "\n\t{} = {}", field.name.cabin_name(), field.value.as_ref().unwrap().to_cabin()).unwrap();
+			write!(writer, "\n\t{} = ", field.name.cabin_name())?;
+			field.value.as_ref().unwrap().write_cabin(writer)?;
 		}
 		if !self.fields.is_empty() {
-			table_cabin.push('\n');
+			writer.write_char('\n')?;
 		}
-		table_cabin.push('}');
-		table_cabin
+		writer.write_char('}')
 	}
 }
 
@@ -2,7 +2,7 @@ use crate::{
 	cli::theme::Styled,
 	compile_time::{CompileTime, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
 	lexer::TokenType,
 	parser::{
 		expressions::{
@@ -11,10 +11,12 @@ use crate::{
 			util::{name::Name, types::Typed},
 			Expression,
 		},
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 };
 
+use std::fmt::{self, Write as _};
+
 use colored::Colorize as _;
 
 /// An identifier that references a variable.
@@ -104,7 +106,7 @@ impl VariableReference {
 			.get_variable_from_id(self.name(), context.scope_data.unique_id())
 			.cloned()
 			.ok_or_else(|| {
-				context.current_bad_identifier = Some(self.name().clone());
+				context.current_bad_identifier = Some(*self.name());
 				let program = context.colored_program();
 				context.add_error_details(format!(
 					"In this part of the program, you refer to a variable \"{}\", but no variable with that name exists here:\n\n{}:\n\n{}\n\n{}",
@@ -154,11 +156,12 @@ impl VariableReference {
 
 impl Parse for VariableReference {
 	type Output = Self;
-	fn parse(tokens: &mut std::collections::VecDeque<crate::lexer::Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		let line_number = tokens.current_line();
 		let column_number = tokens.current_column();
-		let identifier_name = tokens.pop(TokenType::Identifier, context)?;
-		Ok(Self::with_position(Name(identifier_name), context.scope_data.unique_id(), line_number, column_number))
+		let identifier_name = Name::from(tokens.pop(TokenType::Identifier, context)?);
+		context.dependencies.add_dependency(identifier_name);
+		Ok(Self::with_position(identifier_name, context.scope_data.unique_id(), line_number, column_number))
 	}
 }
 
@@ -192,11 +195,10 @@ impl Typed for VariableReference {
 			.clone();
 
 		Ok(if let Some(type_annotation) = identifier_variable.type_annotation {
-			let Expression::Literal(Literal(LiteralValue::VariableReference(_variable_reference), ..)) = type_annotation else {
+			let Expression::Literal(type_literal @ Literal(LiteralValue::VariableReference(_), ..)) = type_annotation else {
 				anyhow::bail!("Type of object is not an identifier");
 			};
-			// Type::Group(variable_reference.name().to_owned(), variable_reference.scope_id())
-			todo!()
+			type_literal
 		} else {
 			identifier_variable.value.as_ref().unwrap().get_type(context)?
 		})
@@ -214,8 +216,8 @@ impl TranspileToC for VariableReference {
 }
 
 impl ToCabin for VariableReference {
-	fn to_cabin(&self) -> String {
-		self.name().cabin_name()
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		writer.write_str(self.name().cabin_name())
 	}
 }
 
@@ -19,12 +19,15 @@ pub mod function_call;
 /// The `literals` module, which handles literal values.
 pub mod literals;
 
+use std::{fmt, sync::Arc};
+
 use colored::Colorize as _;
 
 use crate::{
 	compile_time::{CompileTime, CompileTimeStatement, TranspileToC},
 	context::Context,
-	lexer::{Token, TokenType},
+	formatter::CabinWriter,
+	lexer::TokenType,
 	object,
 	parser::{
 		expressions::{
@@ -37,7 +40,7 @@ use crate::{
 			util::{name::Name, types::Typed},
 		},
 		statements::Statement,
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 };
 
@@ -51,23 +54,23 @@ use crate::{
 #[derive(Clone, Debug)]
 pub enum Expression {
 	Literal(Literal),
-	FunctionCall(Box<FunctionCall>),
-	BinaryExpression(Box<BinaryExpression>),
-	IfStatement(Box<IfExpression>),
-	Run(Box<RunExpression>),
+	FunctionCall(Arc<FunctionCall>),
+	BinaryExpression(Arc<BinaryExpression>),
+	IfStatement(Arc<IfExpression>),
+	Run(Arc<RunExpression>),
 	Block(Block),
 }
 
 impl Parse for Expression {
 	type Output = Self;
 
-	fn parse(tokens: &mut std::collections::VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		match tokens.peek().ok_or_else(|| anyhow::anyhow!("Unexpected EOF"))?.token_type {
 			// If expressions
-			TokenType::KeywordIf => Ok(Self::IfStatement(Box::new(IfExpression::parse(tokens, context)?))),
+			TokenType::KeywordIf => Ok(Self::IfStatement(Arc::new(IfExpression::parse(tokens, context)?))),
 
 			// Run expression
-			TokenType::KeywordRuntime => Ok(Self::Run(Box::new(RunExpression::parse(tokens, context)?))),
+			TokenType::KeywordRuntime => Ok(Self::Run(Arc::new(RunExpression::parse(tokens, context)?))),
 
 			// Block
 			TokenType::LeftBrace => Ok(Self::Block(Block::parse(tokens, context)?)),
@@ -109,7 +112,7 @@ impl Expression {
 			anyhow::bail!("Attempted to get an expression as a string, but it's not a string, it's a {self:?}\n");
 		};
 
-		if table.name != Name("Text".to_owned()) {
+		if table.name != Name::from("Text") {
 			anyhow::bail!(
 				"Attempted to get an expression as Text, and it is an object, but the object is not an instance of Text, it's an instance of {}",
 				table.name.cabin_name().bold().cyan()
@@ -140,7 +143,7 @@ impl Expression {
 			anyhow::bail!("Attempted to get an expression as a number, but it's not a number, it's a {self:?}");
 		};
 
-		if table.name != Name("Number".to_owned()) {
+		if table.name != Name::from("Number") {
 			anyhow::bail!("Attempted to get an expression as a number, and it is a table, but the table is not Number: {self:?}");
 		}
 
@@ -164,11 +167,11 @@ impl Expression {
 			anyhow::bail!("Attempted to get an expression as a list, but it's not a list, it's a {self:?}");
 		};
 
-		if object.name != Name("List".to_owned()) {
+		if object.name != Name::from("List") {
 			anyhow::bail!("Attempted to get an expression as a list, and it is a table, but the table is not List.");
 		}
 
-		let Some(internal_value) = object.get_internal_field_mut("internal_list") else {
+		let Some(internal_value) = Arc::make_mut(object).get_internal_field_mut("internal_list") else {
 			anyhow::bail!("Attempted to get an expression as a list, and it is a Number table, but it has no internal_list");
 		};
 
@@ -1,16 +1,19 @@
 use crate::{
 	compile_time::{CompileTime, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parser::{
 		expressions::{util::types::Typed, Expression},
 		statements::Statement,
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 };
 
-use std::collections::VecDeque;
+use std::{
+	fmt::{self, Write as _},
+	sync::Arc,
+};
 
 use colored::Colorize as _;
 
@@ -28,7 +31,7 @@ pub struct RunExpression {
 impl Parse for RunExpression {
 	type Output = Self;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		tokens.pop(TokenType::KeywordRuntime, context)?;
 		Ok(Self {
 			expression: Expression::parse(tokens, context)?,
@@ -66,8 +69,9 @@ impl TranspileToC for RunExpression {
 }
 
 impl ToCabin for RunExpression {
-	fn to_cabin(&self) -> String {
-		format!("run {}", self.expression.to_cabin())
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		writer.write_str("run ")?;
+		self.expression.write_cabin(writer)
 	}
 }
 
@@ -89,7 +93,7 @@ pub trait ParentExpression {
 
 impl ParentExpression for RunExpression {
 	fn evaluate_children_at_compile_time(&self, context: &mut Context) -> anyhow::Result<Expression> {
-		Ok(Expression::Run(Box::new(Self {
+		Ok(Expression::Run(Arc::new(Self {
 			expression: self
 				.expression
 				.compile_time_evaluate(context, true)
@@ -98,7 +102,7 @@ impl ParentExpression for RunExpression {
 	}
 }
 
-impl<T: ParentExpression> ParentExpression for Box<T> {
+impl<T: ParentExpression> ParentExpression for Arc<T> {
 	fn evaluate_children_at_compile_time(&self, context: &mut Context) -> anyhow::Result<Expression> {
 		self.as_ref().evaluate_children_at_compile_time(context)
 	}
@@ -116,7 +120,7 @@ pub trait ParentStatement {
 	fn evaluate_statement_children_at_compile_time(&self, context: &mut Context) -> anyhow::Result<Statement>;
 }
 
-impl<T: ParentStatement> ParentStatement for Box<T> {
+impl<T: ParentStatement> ParentStatement for Arc<T> {
 	fn evaluate_statement_children_at_compile_time(&self, context: &mut Context) -> anyhow::Result<Statement> {
 		self.as_ref().evaluate_statement_children_at_compile_time(context)
 	}
@@ -12,10 +12,10 @@ macro_rules! object {
 		}
 	) => {{
 		let mut table = $crate::parser::expressions::literals::object::Object::new();
-		table.name = $crate::parser::expressions::util::name::Name(stringify!($name).to_owned());
+		table.name = $crate::parser::expressions::util::name::Name::from(stringify!($name));
 		$($(
 			table.add_field(DeclarationData {
-				name: Name(stringify!($field_name).to_owned()),
+				name: Name::from(stringify!($field_name)),
 				value: $field_value.into(),
 				tags: TagList::default(),
 				type_annotation: None,
@@ -26,7 +26,7 @@ macro_rules! object {
 			table.add_internal_field(stringify!($internal_name).to_owned(), $internal_value);
 		)*)?
 
-		$crate::parser::expressions::Expression::Literal($crate::parser::expressions::literals::Literal::new($crate::parser::expressions::literals::LiteralValue::Object(table)))
+		$crate::parser::expressions::Expression::Literal($crate::parser::expressions::literals::Literal::new($crate::parser::expressions::literals::LiteralValue::Object(std::sync::Arc::new(table))))
 	}};
 }
 
@@ -85,10 +85,10 @@ macro_rules! object_literal {
 		}
 	) => {{
 		let mut table = $crate::parser::expressions::literals::object::Object::new();
-		table.name = Name(stringify!($name).to_owned());
+		table.name = Name::from(stringify!($name));
 		$($(
 			table.add_field(DeclarationData {
-				name: Name(stringify!($field_name).to_owned()),
+				name: Name::from(stringify!($field_name)),
 				value: $field_value.into(),
 				tags: TagList::default(),
 				type_annotation: None,
@@ -99,7 +99,7 @@ macro_rules! object_literal {
 			table.add_internal_field(stringify!($internal_name).to_owned(), $internal_value);
 		)*)?
 
-		$crate::parser::expressions::literals::LiteralValue::Object(table)
+		$crate::parser::expressions::literals::LiteralValue::Object(std::sync::Arc::new(table))
 	}};
 }
 
@@ -109,7 +109,7 @@ macro_rules! var {
 	($name: expr, $scope_id: expr) => {
 		$crate::parser::expressions::Expression::Literal($crate::parser::expressions::literals::Literal::new(
 			$crate::parser::expressions::literals::LiteralValue::VariableReference($crate::parser::expressions::literals::variable_reference::VariableReference::new(
-				$crate::parser::expressions::util::name::Name($name.to_owned()),
+				$crate::parser::expressions::util::name::Name::from($name),
 				$scope_id,
 			)),
 		))
@@ -121,7 +121,7 @@ macro_rules! var {
 macro_rules! var_literal {
 	($name: expr, $scope_id: expr) => {
 		$crate::parser::expressions::literals::Literal::new($crate::parser::expressions::literals::LiteralValue::VariableReference(
-			$crate::parser::expressions::literals::variable_reference::VariableReference::new($crate::parser::expressions::util::name::Name($name.to_owned()), $scope_id),
+			$crate::parser::expressions::literals::variable_reference::VariableReference::new($crate::parser::expressions::util::name::Name::from($name), $scope_id),
 		))
 	};
 }
@@ -132,7 +132,7 @@ macro_rules! global_var {
 	($name: expr) => {
 		$crate::parser::expressions::Expression::Literal($crate::parser::expressions::literals::Literal::new(
 			$crate::parser::expressions::literals::LiteralValue::VariableReference($crate::parser::expressions::literals::variable_reference::VariableReference::new(
-				$crate::parser::expressions::util::name::Name($name.to_owned()),
+				$crate::parser::expressions::util::name::Name::from($name),
 				0,
 			)),
 		))
@@ -1,20 +1,153 @@
 use crate::{cli::theme::Styled, context::Context, formatter::ColoredCabin};
 
+use std::{
+	collections::HashMap,
+	sync::{OnceLock, PoisonError, RwLock},
+};
+
 use colored::Colorize as _;
 
+/// The number of interned strings that fit in the first bucket of the interner is `2^FIRST_BUCKET_BITS`, and each bucket after it holds twice as many as
+/// the one before it (see `Interner::slot()`).
+const FIRST_BUCKET_BITS: u32 = 6;
+
+/// The number of buckets in the interner, which is enough to hold a string for every possible `u32` id (see `Interner::slot()`).
+const BUCKET_COUNT: usize = 27;
+
+/// The global table of interned names. Each distinct name string is stored exactly once for the lifetime of the compiler, and `Name`s are just indices into
+/// `buckets`. This makes `Name` a `Copy` type that's compared and hashed as a single integer, which matters because names are hashed and compared constantly
+/// during scope lookups at compile-time.
+///
+/// Getting the string of a name, which is done constantly when comparing names and transpiling, doesn't take a lock: The strings are stored in buckets
+/// that are never moved or freed once they're allocated, and each slot in them is written exactly once, before the id of the slot is handed out. Only
+/// interning a string takes a lock.
+struct Interner {
+	/// The interned strings, indexed by the id of the `Name` that refers to them (see `Interner::slot()`).
+	buckets: [OnceLock<Box<[OnceLock<&'static str>]>>; BUCKET_COUNT],
+	/// The ids of the interned strings, used to look up whether a string has already been interned. Ids are given out in order, so the number of
+	/// interned strings is also the next id.
+	ids: RwLock<HashMap<&'static str, u32>>,
+}
+
+impl Interner {
+	/// Returns where the string of the name with the given id is stored in `buckets`. Bucket `n` holds `2^(FIRST_BUCKET_BITS + n)` strings, so the
+	/// bucket is found from the position of the highest bit of the id offset by the size of the first bucket.
+	///
+	/// # Parameters
+	/// - `id` - The id of the name.
+	///
+	/// # Returns
+	/// The index of the bucket, the index of the slot in the bucket, and the length of the bucket.
+	fn slot(id: u32) -> (usize, usize, usize) {
+		let position = u64::from(id) + (1 << FIRST_BUCKET_BITS);
+		let highest_bit = u64::BITS - 1 - position.leading_zeros();
+		let index = |value: u64| usize::try_from(value).unwrap_or_else(|_error| unreachable!());
+		(index(u64::from(highest_bit - FIRST_BUCKET_BITS)), index(position - (1 << highest_bit)), index(1 << highest_bit))
+	}
+
+	/// Returns the interned string of a name without taking a lock.
+	///
+	/// # Parameters
+	/// - `id` - The id of the name.
+	///
+	/// # Returns
+	/// The string, or `None` if no string has been interned with the given id.
+	fn get(&self, id: u32) -> Option<&'static str> {
+		let (bucket, slot, _length) = Self::slot(id);
+		self.buckets.get(bucket)?.get()?.get(slot)?.get().copied()
+	}
+
+	/// Interns a string, or returns the id that it was already interned with.
+	///
+	/// # Parameters
+	/// - `name` - The string to intern.
+	///
+	/// # Returns
+	/// The id of the interned string.
+	fn intern(&self, name: &str) -> u32 {
+		let existing_id = self.ids.read().unwrap_or_else(PoisonError::into_inner).get(name).copied();
+		if let Some(id) = existing_id {
+			return id;
+		}
+
+		// Check again after taking the write lock, in case another thread interned this name in the meantime
+		let mut ids = self.ids.write().unwrap_or_else(PoisonError::into_inner);
+		if let Some(id) = ids.get(name) {
+			return *id;
+		}
+
+		let id = u32::try_from(ids.len()).unwrap_or_else(|_error| unreachable!("Internal Error: Too many distinct names were interned"));
+		let interned: &'static str = Box::leak(name.to_owned().into_boxed_str());
+		let (bucket, slot, length) = Self::slot(id);
+		self.buckets
+			.get(bucket)
+			.and_then(|bucket| bucket.get_or_init(|| (0..length).map(|_| OnceLock::new()).collect()).get(slot))
+			.unwrap_or_else(|| unreachable!())
+			.set(interned)
+			.unwrap_or_else(|_error| unreachable!());
+		ids.insert(interned, id);
+		drop(ids);
+		id
+	}
+}
+
+/// Returns the global name interner, creating it if it doesn't exist yet. This is global rather than a thread-local so that `Name`s can be freely shared
+/// between threads.
+///
+/// # Returns
+/// A reference to the global interner.
+fn interner() -> &'static Interner {
+	static INTERNER: OnceLock<Interner> = OnceLock::new();
+	INTERNER.get_or_init(|| Interner {
+		buckets: std::array::from_fn(|_| OnceLock::new()),
+		ids: RwLock::new(HashMap::new()),
+	})
+}
+
 /// An identifier name in the language defined by the user. This is used when the user names a variable or
 /// function, etc. The incentive to use this over a regular String is that these get converted into different
 /// identifiers when transpiled to C to avoid name clashing. For example, when writing anonymous tables, Cabin
 /// automatically inserts typedef structs called `table_0`, `table_1`. etc., so If a user were to name their variable
 /// `table_0` it would cause a name clash. Thus, all identifiers parsed should be represented with this form.
 ///
-/// The string field stored in this is private, but it represents the original name as specified by the Cabin
-/// developer before transforming it into the C version. To avoid confusion, this is private, and you can use the
-/// `c_name` and `cabin_name` functions to specifically get the version you want. Generally, you'd want the original
-/// name for reporting error messages, such as "Variable {name} not found", and you'd want the C name when transpiling
-/// the source code into C.
-#[derive(Debug, Clone, PartialEq, Eq, PartialOrd, Ord, Hash)]
-pub struct Name(pub String);
+/// Names are interned: The id stored in this is private, and refers to the original name as specified by the Cabin
+/// developer in the global interner. Use `Name::from()` to create a name from a string, and use the `c_name` and
+/// `cabin_name` functions to specifically get the version you want. Generally, you'd want the original name for
+/// reporting error messages, such as "Variable {name} not found", and you'd want the C name when transpiling the
+/// source code into C.
+#[derive(Clone, Copy, PartialEq, Eq, Hash)]
+pub struct Name(u32);
+
+impl From<&str> for Name {
+	fn from(name: &str) -> Self {
+		Self(interner().intern(name))
+	}
+}
+
+impl From<String> for Name {
+	fn from(name: String) -> Self {
+		Self::from(name.as_str())
+	}
+}
+
+impl PartialOrd for Name {
+	fn partial_cmp(&self, other: &Self) -> Option<std::cmp::Ordering> {
+		Some(self.cmp(other))
+	}
+}
+
+impl Ord for Name {
+	/// Names are ordered by the strings they represent, not by the order they were interned in, so that sorting names is deterministic.
+	fn cmp(&self, other: &Self) -> std::cmp::Ordering {
+		self.cabin_name().cmp(other.cabin_name())
+	}
+}
+
+impl std::fmt::Debug for Name {
+	fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+		f.debug_tuple("Name").field(&self.cabin_name()).finish()
+	}
+}
 
 impl Name {
 	/// Returns the name of this `Name` as string **after converting it into a unique C identifier**. This should
@@ -23,19 +156,39 @@ impl Name {
 	///
 	/// This is exactly equivalent to calling `to_c(&mut context)` on the name, except that `to_c` will wrap it in an
 	/// `Ok()`.
-	pub fn c_name(&self) -> String {
-		match self.0.as_str() {
+	#[must_use]
+	pub fn c_name(self) -> String {
+		match self.cabin_name() {
 			"Void" => "void".to_owned(),
 			"unique" => "int".to_owned(),
-			_ => format!("{}_u", self.0),
+			name => format!("{name}_u"),
+		}
+	}
+
+	/// Returns the C scalar type that values of the group with this name are lowered to, if the group is a scalar group. Scalar groups aren't
+	/// transpiled to structs; Instead, their C name (such as `Number_u`) is a `typedef` of the scalar type, and their values are plain C values. Values
+	/// are passed to functions by value, and are only boxed into a pointer when they're passed where any type is accepted, such as to a parameter of
+	/// type `Anything`.
+	///
+	/// # Returns
+	/// The scalar C type of this group, or `None` if values of this group are transpiled to structs.
+	#[must_use]
+	pub fn unboxed_c_type(self) -> Option<&'static str> {
+		match self.cabin_name() {
+			"Number" => Some("double"),
+			"Boolean" => Some("bool"),
+			_ => None,
 		}
 	}
 
 	/// Returns the name of this `Name` as a string **as originally specified in the Cabin source code.** This should be
 	/// used for things like communicating to the user, such as error messages that need to display information about a
 	/// variable. **Do not use this when transpiling to C; Use `c_name()` or `to_c(context)` instead**.
-	pub fn cabin_name(&self) -> String {
-		self.0.clone()
+	///
+	/// Interned names are never freed, so the returned string lives for the rest of the program. This doesn't take a lock (see `Interner`).
+	#[must_use]
+	pub fn cabin_name(self) -> &'static str {
+		interner().get(self.0).unwrap_or_default()
 	}
 
 	/// Creates a name from its C representation. The default name constructor creates a name from it's Cabin name, so this allows going the other direction and converting
@@ -45,13 +198,13 @@ impl Name {
 	///
 	/// ```rust
 	/// let name = Name::from_c(/* any name */);
-	/// assert_eq!(name, Name(name.cabin_name()));
+	/// assert_eq!(name, Name::from(name.cabin_name()));
 	/// ```
 	///
 	/// # Parameters
 	/// - `c` - The string representation of the C version of the name.
 	pub fn from_c(c: &str) -> Self {
-		Self(c.get(0..c.len() - 2).unwrap().to_owned())
+		Self::from(c.get(0..c.len() - 2).unwrap())
 	}
 }
 
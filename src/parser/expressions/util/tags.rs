@@ -1,14 +1,11 @@
 use crate::{
 	context::Context,
-	lexer::{Token, TokenType},
+	lexer::TokenType,
 	parse_list,
-	parser::{expressions::Expression, Parse, TokenQueue},
+	parser::{expressions::Expression, Parse, TokenCursor, TokenQueue},
 };
 
-use std::{
-	collections::VecDeque,
-	ops::{Deref, DerefMut},
-};
+use std::ops::{Deref, DerefMut};
 
 /// A list of tags. Tags are values that can be present on declarations, such as variable declarations, group fields, etc. Tags do
 /// not modify the value in any way, they are simply markers that can be checked at compile-time and runtime.
@@ -54,7 +51,7 @@ impl DerefMut for TagList {
 impl Parse for TagList {
 	type Output = Self;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		let mut tags = Vec::new();
 		if tokens.next_is(TokenType::TagOpening) {
 			tokens.pop(TokenType::TagOpening, context).unwrap_or_else(|_error| unreachable!());
@@ -16,7 +16,7 @@ pub trait Typed {
 	fn get_type(&self, context: &mut Context) -> anyhow::Result<Literal>;
 }
 
-impl<T: Typed> Typed for Box<T> {
+impl<T: Typed> Typed for Arc<T> {
 	fn get_type(&self, context: &mut Context) -> anyhow::Result<Literal> {
 		self.as_ref().get_type(context)
 	}
@@ -25,3 +25,5 @@ impl<T: Typed> Typed for Box<T> {
 pub use ambassador_impl_Typed;
 
 use crate::{context::Context, parser::expressions::literals::Literal};
+
+use std::sync::Arc;
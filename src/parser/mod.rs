@@ -1,16 +1,30 @@
 use crate::{
-	compile_time::{builtin::IS_FIRST_PRINT, CompileTimeStatement, TranspileToC},
+	compile_time::{
+		builtin::{flush_compile_time_output, IS_FIRST_PRINT, OUTPUT_RUNTIME},
+		type_tree::VariableDependencyTreeSet,
+		CompileTimeStatement, TranspileToC,
+	},
+	compiler::transpile_each,
 	context::{Context, Severity, TokenError},
-	formatter::{ColoredCabin, ToCabin},
+	emitter::{collapse_blank_lines, CWriter},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
 	lexer::{Token, TokenType},
 	parser::{
 		expressions::{
-			literals::{group::GroupType, Literal, LiteralValue},
+			literals::{
+				either::tagged_either,
+				group::GroupType,
+				Literal, LiteralValue,
+			},
 			util::name::Name,
 			Expression,
 		},
 		statements::Statement,
 	},
+	prelude::PRELUDE,
+	reachability::{fold_identical_functions, reachable_items, removed_items, CItem},
+	regions::{parameter_escapes, REGION_RUNTIME},
+	timings,
 };
 
 use colored::Colorize as _;
@@ -19,7 +33,10 @@ use colored::Colorize as _;
 // `string = format!("{string}...")`, because it avoids an extra allocation. We have a clippy warning turned on for this very
 // purpose. We assign this to `_` to indicate clearly that it's just a trait and not used explicitly anywhere outside of bringing its
 // methods into scope.
-use std::{fmt::Write as _, sync::atomic::Ordering};
+use std::{
+	fmt::{self, Write as _},
+	sync::{atomic::Ordering, Arc},
+};
 
 /// The expressions module, which handles AST nodes that represent expressions.
 pub mod expressions;
@@ -36,17 +53,59 @@ pub struct Program {
 impl Parse for Program {
 	type Output = Self;
 
-	fn parse(tokens: &mut std::collections::VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
+		// Each global statement is a node in the dependency graph, which depends on every variable referenced while it's parsed
+		context.dependencies = VariableDependencyTreeSet::new();
+		let has_prelude = context.source_code.starts_with(PRELUDE);
+
 		let mut statements = Vec::new();
-		while !tokens.is_empty() {
-			statements.push(Statement::parse(tokens, context).map_err(|error| anyhow::anyhow!("{error}\n\twhile attempting to parse the program's global declarations"))?);
+		while let Some(first_token) = tokens.peek() {
+			let is_prelude = has_prelude && first_token.span.start < PRELUDE.len();
+			let node = context.dependencies.create_new_tree_and_set_current();
+			let statement = Statement::parse(tokens, context).map_err(|error| anyhow::anyhow!("{error}\n\twhile attempting to parse the program's global declarations"))?;
+			context.dependencies.close_tree()?;
+
+			// The prelude is always evaluated, because the compiler uses parts of it implicitly, such as the groups of literals. Statements that aren't
+			// declarations and declarations with values that aren't definitions are the code that the program runs, so they're evaluated in source
+			// order, and the main function is called by it.
+			match &statement {
+				Statement::Declaration(declaration) => {
+					context.dependencies.declare(node, declaration.name);
+					if !is_prelude && !is_definition(&declaration.initial_value) {
+						context.dependencies.add_ordered_root(node);
+					} else if is_prelude || declaration.name == Name::from("main") {
+						context.dependencies.add_root(node);
+					}
+				},
+				_ if is_prelude => context.dependencies.add_root(node),
+				_ => context.dependencies.add_ordered_root(node),
+			}
+			statements.push(statement);
 		}
 		let program = Self { statements };
-		context.program = Some(program.clone());
+		context.program = Some(Arc::new(program.clone()));
 		Ok(program)
 	}
 }
 
+/// Returns whether the value of a global declaration is a definition, such as a function, group, either or object, which has no side effects to evaluate
+/// and can refer to other definitions cyclically.
+///
+/// # Parameters
+/// - `value` - The value of the declaration.
+///
+/// # Returns
+/// Whether the value is a definition.
+fn is_definition(value: &Expression) -> bool {
+	matches!(
+		value,
+		Expression::Literal(Literal(
+			LiteralValue::FunctionDeclaration(_) | LiteralValue::Group(_) | LiteralValue::Either(_) | LiteralValue::Object(_),
+			..
+		))
+	)
+}
+
 impl Program {
 	/// Converts this program, as an AST, into a "compile-time evaluated" AST program. This loops over every statement and expression in the program and evaluates
 	/// it at compile-time if possible. This should be used before transpiling to C.
@@ -58,13 +117,10 @@ impl Program {
 	/// # Returns
 	/// A new program struct that's been evaluated at compile-time, or an error if there was an error evaluating compile-time code.
 	pub fn compile_time_evaluate(&self, context: &mut Context, with_side_effects: bool) -> anyhow::Result<Self> {
+		let statements = self.evaluate_statements(context, with_side_effects);
+		flush_compile_time_output()?;
 		let program = Self {
-			statements: self
-				.statements
-				.iter()
-				.map(|statement| statement.compile_time_evaluate_statement(context, with_side_effects))
-				.collect::<anyhow::Result<Vec<Statement>>>()
-				.map_err(|error| anyhow::anyhow!("{error}\n\t{}", "while evaluating the program's global variables at compile-time".dimmed()))?,
+			statements: statements.map_err(|error| anyhow::anyhow!("{error}\n\t{}", "while evaluating the program's global variables at compile-time".dimmed()))?,
 		};
 
 		if !IS_FIRST_PRINT.load(Ordering::Relaxed) {
@@ -73,82 +129,179 @@ impl Program {
 
 		Ok(program)
 	}
-}
 
-impl TranspileToC for Program {
-	fn to_c(&self, context: &mut Context) -> anyhow::Result<String> {
-		let mut c = "int main(int argc, char** argv) {\n".to_owned();
+	/// Evaluates the global statements of this program at compile-time, in the order given by the dependency graph that was built while parsing it (see
+	/// `VariableDependencyTreeSet`). Each global variable is evaluated after the variables it references, and global variables that aren't used by the
+	/// prelude, the program's statements, or its main function aren't evaluated at all, and are left out of the evaluated program. Statements that can have
+	/// side effects, which are the program's statements and the declarations whose values aren't definitions (see `is_definition()`), are always evaluated
+	/// in source order. The evaluated statements
+	/// are returned in the order they were evaluated in, so a global variable is also declared in the generated C code before the code that uses it, even
+	/// if it's declared after that code in the program.
+	///
+	/// If the dependency graph wasn't built from this program, every statement is evaluated in order instead.
+	///
+	/// # Parameters
+	/// - `context` - The global compiler context.
+	/// - `with_side_effects` - Whether to evaluate code that has side effects.
+	///
+	/// # Returns
+	/// The evaluated statements.
+	///
+	/// # Errors
+	/// If a statement couldn't be evaluated, global variables that aren't functions or types depend on each other in a cycle, or a statement uses a global
+	/// variable with side effects that's declared after it.
+	fn evaluate_statements(&self, context: &mut Context, with_side_effects: bool) -> anyhow::Result<Vec<Statement>> {
+		if context.dependencies.node_count() != self.statements.len() {
+			return self
+				.statements
+				.iter()
+				.map(|statement| {
+					context.compile_time_step()?;
+					statement.compile_time_evaluate_statement(context, with_side_effects)
+				})
+				.collect();
+		}
 
-		let declarations = self
-			.statements
-			.iter()
-			.enumerate()
-			.filter_map(|(index, statement)| {
-				if let Statement::Declaration(declaration) = statement {
-					Some((declaration, index))
-				} else {
-					None
+		let mut evaluated = Vec::new();
+		for component in context.dependencies.evaluation_order()? {
+			// Functions and types can refer to each other in a cycle, because their contents aren't needed to evaluate them, but other values can't
+			let declarations = component
+				.iter()
+				.filter_map(|index| match self.statements.get(*index) {
+					Some(Statement::Declaration(declaration)) => Some(declaration),
+					_ => None,
+				})
+				.collect::<Vec<_>>();
+			if let [first, second, ..] = declarations.as_slice() {
+				if !declarations.iter().all(|declaration| is_definition(&declaration.initial_value)) {
+					anyhow::bail!(
+						"Variable dependency cycle detected: The variable \"{first}\" depends on the variable \"{second}\", but the variable \"{second}\" depends on the variable \"{first}\"",
+						first = first.name.cabin_name().bold().cyan(),
+						second = second.name.cabin_name().bold().cyan()
+					);
 				}
-			})
-			.collect::<Vec<_>>();
-
-		let mut declared_variables = Vec::new();
+			}
 
-		// For each variable declaration in the global scope,
-		for (declaration, _index) in &declarations {
-			if declaration.name == Name("return_address".to_owned()) {
-				continue;
+			for statement in component.into_iter().filter_map(|index| self.statements.get(index)) {
+				context.compile_time_step()?;
+				evaluated.push(statement.compile_time_evaluate_statement(context, with_side_effects)?);
 			}
-			// Add the declaration itself
-			if !declared_variables.contains(&declaration.name) {
-				let value = context
-					.scope_data
-					.get_scope_from_id(declaration.declared_scope_id)
-					.ok_or_else(|| anyhow::anyhow!("Expected scope to exist for declaration"))?
-					.get_variable_direct(&declaration.name)
-					.cloned()
-					.ok_or_else(|| anyhow::anyhow!("Variable {} not found", declaration.name.cabin_name()))?
-					.value
-					.unwrap();
+		}
 
-				if let Expression::Literal(Literal(LiteralValue::Group(_) | LiteralValue::FunctionDeclaration(_) | LiteralValue::Either(_), ..)) = value {
-					continue;
-				}
+		Ok(evaluated)
+	}
+
+	/// Transpiles this program into C, split into the declarations that all C code in the program depends on, the definitions of the program's functions,
+	/// and the C `main` function that runs the program's global statements. The parts are kept separate so that the function definitions can be compiled
+	/// in separate translation units that all include the declarations as a header (see `units::TranslationUnits`). Builtin functions are the exception:
+	/// They're defined in the header as `static inline` functions, so that calls to them from any translation unit can be inlined.
+	///
+	/// Only the parts of the program that the C `main` function can reach are included (see `reachability::reachable_items()`). Groups, functions, and
+	/// global variables with values that have no side effects are left out if nothing that runs uses them, which is most of the prelude in small programs.
+	/// Functions with identical code are folded into one shared instance first (see `reachability::fold_identical_functions()`). The items that were left
+	/// out are listed in a comment at the end of the header, and stored in `context.removed_c_items`.
+	///
+	/// # Parameters
+	/// - `context` - The global compiler context.
+	///
+	/// # Returns
+	/// The split program, or an error if part of the program couldn't be transpiled.
+	pub fn split_c(&self, context: &mut Context) -> anyhow::Result<SplitProgram> {
+		context.parameter_escapes = Arc::new(parameter_escapes(context));
+		let mut items = self
+			.c_prelude_items(context)
+			.map_err(|error| anyhow::anyhow!("{error}\n\t{}", "while generating C prelude for the program".dimmed()))?;
+		let main_start = items.len();
+		items.extend(
+			self.c_main_items(context)
+				.map_err(|error| anyhow::anyhow!("{error}\n\twhile transpiling the program's global variables into C code"))?,
+		);
+
+		// Text constants are only all known once everything that uses them has been transpiled, and they're defined in the header before the main function
+		let text_constants = context.text_constants.items();
+		let constant_count = text_constants.len();
+		items.splice(main_start..main_start, text_constants);
+		let main_start = main_start + constant_count;
 
-				// C itself
-				declaration
-					.to_c(context)?
-					.lines()
-					.map(|line| Ok(writeln!(c, "\t{line}")?))
-					.collect::<anyhow::Result<Vec<_>>>()?;
-				declared_variables.push(declaration.name.clone());
+		let folded = fold_identical_functions(&mut items);
+		context.function_instances.record_folded(folded);
+		timings::record_instantiations(context.function_instances.instantiations(), context.function_instances.folded());
+
+		let reachable = reachable_items(&items);
+		context.removed_c_items = removed_items(&items, &reachable);
+
+		let mut header = unindent::unindent(
+			"
+			#include <fcntl.h>
+			#include <stdbool.h>
+			#include <stdint.h>
+			#include <stdio.h>
+			#include <stdlib.h>
+			#include <string.h>
+			#include <sys/mman.h>
+			#include <sys/stat.h>
+			#include <sys/types.h>
+			#include <unistd.h>
+
+			static void* this = NULL;
+		",
+		);
+		writeln!(header, "\n{REGION_RUNTIME}\n{OUTPUT_RUNTIME}")?;
+
+		let mut types = Vec::new();
+		let mut definitions = String::new();
+		let mut functions = Vec::new();
+		let mut builtins = Vec::new();
+		let mut main = String::new();
+		for (index, (item, _reachable)) in items.into_iter().zip(reachable).enumerate().filter(|(_index, (_item, is_reachable))| *is_reachable) {
+			match item.kind {
+				_ if index >= main_start => main.push_str(&item.code),
+				"type" => types.push(item.code),
+				"function" => functions.push(item.code),
+				"builtin" => builtins.push(item.code),
+				_ => definitions.push_str(&item.code),
 			}
 		}
 
-		let done_indices = declarations.iter().map(|(_name, index)| *index).collect::<Vec<_>>();
+		// Each function item is its forward declaration followed by its definition, and the forward declarations go in the header
+		let mut forward_declarations = Vec::new();
+		for function in &mut functions {
+			let definition = function.split_off(function.find('\n').map_or(function.len(), |newline| newline + 1));
+			forward_declarations.push(std::mem::replace(function, definition));
+		}
 
-		// Transpile the statements
-		for (index, statement) in self.statements.iter().enumerate() {
-			if !done_indices.contains(&index) {
-				statement
-					.to_c(context)?
-					.lines()
-					.map(|line| Ok(writeln!(c, "\t{line}")?))
-					.collect::<anyhow::Result<Vec<_>>>()?;
-			}
+		// Builtin functions are defined in the header too, so that every translation unit sees their bodies and can inline them
+		for mut builtin in builtins {
+			let definition = builtin.split_off(builtin.find('\n').map_or(builtin.len(), |newline| newline + 1));
+			forward_declarations.push(builtin);
+			definitions.push_str(&definition);
+			definitions.push('\n');
 		}
-		if let Some(main_function) = &context.main_function_name {
-			writeln!(c, "{main_function}();").unwrap();
+
+		writeln!(header, "{}\n{}\n{definitions}", types.join("\n"), forward_declarations.concat())?;
+		if !context.removed_c_items.is_empty() {
+			header.push_str("// Unreachable items left out of this program:\n");
+			for removed in &context.removed_c_items {
+				writeln!(header, "// - {removed}")?;
+			}
 		}
-		c.push('}');
-		c = regex_macro::regex!("(\\s*\r?\n){3,}").replace_all(&c, "\n\n").to_string();
 
-		Ok(c)
+		Ok(SplitProgram {
+			header,
+			functions,
+			main: format!("int main(int argc, char** argv) {{\n\tcabin_output_start();\n\n{main}}}"),
+		})
 	}
 
-	fn c_prelude(&self, context: &mut Context) -> anyhow::Result<String> {
-		let mut prelude = String::new();
-
+	/// Transpiles the items of this program's C prelude, which are the definitions of its groups, the `typedef`s of its groups, and its functions, in the
+	/// order that they're written in (see `split_c()`).
+	///
+	/// # Parameters
+	/// - `context` - The global compiler context.
+	///
+	/// # Returns
+	/// The items of the prelude, or an error if part of the prelude couldn't be transpiled.
+	fn c_prelude_items(&self, context: &mut Context) -> anyhow::Result<Vec<CItem>> {
 		let declarations = self
 			.statements
 			.iter()
@@ -163,6 +316,7 @@ impl TranspileToC for Program {
 			.collect::<Vec<_>>();
 
 		let mut declared_variables = Vec::new();
+		let mut group_declarations = Vec::new();
 
 		// For each variable declaration in the global scope,
 		for (declaration, _index) in &declarations {
@@ -184,17 +338,24 @@ impl TranspileToC for Program {
 				}
 
 				if let Expression::Literal(Literal(LiteralValue::Group(..), ..)) = value {
-					declaration
-						.c_prelude(context)?
-						.lines()
-						.map(|line| Ok(writeln!(prelude, "{line}")?))
-						.collect::<anyhow::Result<Vec<_>>>()?;
+					group_declarations.push(*declaration);
 				}
 
-				declared_variables.push(declaration.name.clone());
+				declared_variables.push(declaration.name);
 			}
 		}
 
+		let mut items = Vec::new();
+		let group_preludes = transpile_each(&group_declarations, context, |declaration, item_context| declaration.c_prelude(item_context))?;
+		for (declaration, declaration_prelude) in group_declarations.iter().zip(group_preludes) {
+			items.push(CItem {
+				kind: "group",
+				symbols: vec![declaration.name.c_name()],
+				code: declaration_prelude.lines().map(|line| format!("{line}\n")).collect(),
+				is_root: false,
+			});
+		}
+
 		#[allow(clippy::filter_map_identity)] // This is much clearer with `filter_map()`; IMHO using `flatten()` is much more confusing here
 		let done_indices = declarations
 			.iter()
@@ -220,77 +381,207 @@ impl TranspileToC for Program {
 			.collect::<Vec<_>>();
 
 		// Transpile the statements
-		for (index, statement) in self.statements.iter().enumerate() {
-			if !done_indices.contains(&index) {
-				if let Statement::Declaration(declaration) = statement {
-					if let Expression::Literal(Literal(LiteralValue::Group(..), ..)) = &declaration.initial_value {
-						statement
-							.to_c(context)?
-							.lines()
-							.map(|line| Ok(writeln!(prelude, "{line}")?))
-							.collect::<anyhow::Result<Vec<_>>>()?;
-					}
-				}
-			}
+		let group_statements = declarations
+			.iter()
+			.filter(|(declaration, index)| !done_indices.contains(index) && matches!(&declaration.initial_value, Expression::Literal(Literal(LiteralValue::Group(..), ..))))
+			.map(|(declaration, _index)| *declaration)
+			.collect::<Vec<_>>();
+		let group_statements_c = transpile_each(&group_statements, context, |declaration, item_context| declaration.to_c(item_context))?;
+		for (declaration, statement_c) in group_statements.iter().zip(group_statements_c) {
+			items.push(CItem {
+				kind: "group",
+				symbols: vec![declaration.name.c_name()],
+				code: statement_c.lines().map(|line| format!("{line}\n")).collect(),
+				is_root: false,
+			});
 		}
 
-		let mut forward_declarations = Vec::new();
-
 		// Typedef the groups (structs)
 		for (group, group_type) in &context.groups {
-			forward_declarations.push(format!(
+			let mut item = CItem {
+				kind: "type",
+				symbols: vec![group.clone()],
+				code: String::new(),
+				is_root: false,
+			};
+
+			// Scalar groups are plain C values, and the variants of a scalar either are constants of that type
+			if let Some(scalar_type) = Name::from_c(group).unboxed_c_type() {
+				item.code = format!("typedef {scalar_type} {group};");
+				if group_type == &GroupType::Either && scalar_type == "bool" {
+					item.symbols.extend(["true_u".to_owned(), "false_u".to_owned()]);
+					write!(item.code, "\nstatic const {group} true_u = true;\nstatic const {group} false_u = false;")?;
+				}
+				items.push(item);
+				continue;
+			}
+
+			// The variants of other eithers are integer tags
+			if group_type == &GroupType::Either {
+				if let Some(either) = tagged_either(Name::from_c(group), context) {
+					item.symbols.extend(either.tag_c_names(Name::from_c(group)));
+					item.code = either.tags_to_c(Name::from_c(group));
+					items.push(item);
+					continue;
+				}
+			}
+
+			item.code = format!(
 				"typedef {} {group} {group};",
 				match group_type {
 					GroupType::Group => "struct",
 					GroupType::Either => "enum",
 				},
-			));
+			);
+			items.push(item);
 		}
 
 		// Forward-declare the functions (and define them)
-		for function in context.function_declarations.clone() {
-			forward_declarations.push(format!(
-				"void {name}({parameters});",
-				name = format!("{}_{}", function.name.as_ref().unwrap(), function.id),
-				parameters = function
-					.parameters
-					.iter()
-					.map(|parameter| Ok(format!("{}* {}", parameter.1.to_c(context)?, parameter.0.cabin_name())))
-					.collect::<anyhow::Result<Vec<_>>>()?
-					.join(", ")
-			));
-
-			prelude.push_str(&function.c_prelude(context)?);
+		let functions = Arc::clone(&context.function_declarations);
+		let function_c = transpile_each(&functions, context, |function, item_context| {
+			let name = format!("{}_{}", function.name.as_ref().unwrap(), function.id);
+			let forward_declaration = format!(
+				"{storage_class}void {name}({parameters});\n",
+				storage_class = function.c_storage_class(),
+				parameters = function.c_parameters(item_context)?.join(", ")
+			);
+			Ok(CItem {
+				kind: if function.is_builtin() { "builtin" } else { "function" },
+				symbols: vec![name],
+				code: forward_declaration + &function.c_prelude(item_context)?,
+				is_root: false,
+			})
+		})?;
+		items.extend(function_c);
+
+		Ok(items)
+	}
+
+	/// Transpiles the statements of this program's C `main` function, which are its global statements and the declarations of its global variables that
+	/// aren't groups or functions, followed by the call to the program's main function (see `split_c()`). Declarations with values that are literals have
+	/// no side effects, so they're left out if nothing uses them; Every other statement is a root of the program.
+	///
+	/// # Parameters
+	/// - `context` - The global compiler context.
+	///
+	/// # Returns
+	/// The items of the C `main` function, or an error if a statement couldn't be transpiled.
+	fn c_main_items(&self, context: &mut Context) -> anyhow::Result<Vec<CItem>> {
+		let declarations = self
+			.statements
+			.iter()
+			.enumerate()
+			.filter_map(|(index, statement)| {
+				if let Statement::Declaration(declaration) = statement {
+					Some((declaration, index, statement))
+				} else {
+					None
+				}
+			})
+			.collect::<Vec<_>>();
+
+		let mut declared_variables = Vec::new();
+
+		// The statements to transpile into the main function, with the names of the ones that have no side effects. These are collected first and then
+		// transpiled together, so that they can be transpiled in parallel.
+		let mut main_statements = Vec::new();
+
+		// For each variable declaration in the global scope,
+		for (declaration, _index, statement) in &declarations {
+			if declaration.name == Name::from("return_address") {
+				continue;
+			}
+			// Add the declaration itself
+			if !declared_variables.contains(&declaration.name) {
+				let value = context
+					.scope_data
+					.get_scope_from_id(declaration.declared_scope_id)
+					.ok_or_else(|| anyhow::anyhow!("Expected scope to exist for declaration"))?
+					.get_variable_direct(&declaration.name)
+					.cloned()
+					.ok_or_else(|| anyhow::anyhow!("Variable {} not found", declaration.name.cabin_name()))?
+					.value
+					.unwrap();
+
+				if let Expression::Literal(Literal(LiteralValue::Group(_) | LiteralValue::FunctionDeclaration(_) | LiteralValue::Either(_), ..)) = value {
+					continue;
+				}
+
+				main_statements.push((*statement, matches!(value, Expression::Literal(_)).then_some(declaration.name)));
+				declared_variables.push(declaration.name);
+			}
 		}
 
-		// Generate the final prelude
-		prelude = format!(
-			"{}\n\n{forward_declarations}\n\n{prelude}",
-			unindent::unindent(
-				"
-				#include <stdio.h>
-				#include <stdlib.h>
-				#include <sys/stat.h>
-				#include <sys/types.h>
-
-				static void* this = NULL;
-			"
-			),
-			forward_declarations = forward_declarations.join("\n"),
-		);
-		prelude = regex_macro::regex!("(\\s*\r?\n){3,}").replace_all(&prelude, "\n\n").to_string();
+		let done_indices = declarations.iter().map(|(_name, index, _statement)| *index).collect::<Vec<_>>();
 
-		Ok(prelude)
+		// Add the statements
+		for (index, statement) in self.statements.iter().enumerate() {
+			if !done_indices.contains(&index) {
+				main_statements.push((statement, None));
+			}
+		}
+
+		// C itself
+		let statements_c = transpile_each(&main_statements, context, |(statement, _name), item_context| statement.to_c(item_context))?;
+		let mut items = main_statements
+			.iter()
+			.zip(statements_c)
+			.map(|((_statement, name), statement_c)| {
+				let mut code = String::new();
+				CWriter::new(&mut code).indented(|indented| {
+					indented.write_str(&statement_c)?;
+					indented.end_line()
+				})?;
+				Ok(CItem {
+					kind: "global variable",
+					symbols: name.iter().map(|variable| variable.c_name()).collect(),
+					code,
+					is_root: name.is_none(),
+				})
+			})
+			.collect::<anyhow::Result<Vec<_>>>()?;
+		if let Some(main_function) = &context.main_function_name {
+			items.push(CItem {
+				kind: "call",
+				symbols: Vec::new(),
+				code: format!("{main_function}();\n"),
+				is_root: true,
+			});
+		}
+
+		Ok(items)
+	}
+}
+
+/// A program transpiled into C, split into its declarations, its function definitions, and its C `main` function (see `Program::split_c()`).
+pub struct SplitProgram {
+	/// The includes, type definitions, and forward declarations of the program's groups and functions. Every function definition and the program's main
+	/// function can be compiled with just these declarations.
+	pub header: String,
+	/// The definitions of the program's functions, in the order that they're forward-declared in the header.
+	pub functions: Vec<String>,
+	/// The C `main` function, which runs the program's global statements and then calls its main function.
+	pub main: String,
+}
+
+impl TranspileToC for Program {
+	fn to_c(&self, context: &mut Context) -> anyhow::Result<String> {
+		Ok(collapse_blank_lines(&self.split_c(context)?.main))
+	}
+
+	fn c_prelude(&self, context: &mut Context) -> anyhow::Result<String> {
+		let program = self.split_c(context)?;
+		Ok(collapse_blank_lines(&(program.header + program.functions.concat().as_str())))
 	}
 }
 
 impl ToCabin for Program {
-	fn to_cabin(&self) -> String {
-		let mut cabin_code = String::new();
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
 		for statement in &self.statements {
-			write!(cabin_code, "{}\n\n", statement.to_cabin()).unwrap();
+			statement.write_cabin(writer)?;
+			writer.write_str("\n\n")?;
 		}
-		cabin_code
+		Ok(())
 	}
 }
 
@@ -316,12 +607,12 @@ impl ColoredCabin for Program {
 /// Parses a token stream into an abstract syntax tree.
 ///
 /// # Parameters
-/// - `tokens` - A mutable reference to a token stream.
+/// - `tokens` - The tokens of the program, which are read in place with a `TokenCursor` rather than copied.
 ///
 /// # Returns
 /// A `Result` containing either an `AST` or an `Error`.
-pub fn parse(tokens: &mut std::collections::VecDeque<Token>, context: &mut Context) -> anyhow::Result<Program> {
-	Program::parse(tokens, context)
+pub fn parse(tokens: &[Token], context: &mut Context) -> anyhow::Result<Program> {
+	Program::parse(&mut TokenCursor::new(tokens), context)
 }
 
 /// A trait for parsing a token stream into an abstract syntax tree node using a specific rule.
@@ -336,11 +627,11 @@ pub trait Parse {
 	///
 	/// # Returns
 	/// A `Result` containing either an abstract syntax tree node or an `Error`.
-	fn parse(tokens: &mut std::collections::VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output>;
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output>;
 }
 
-/// A trait for treating a collection of tokens as a queue of tokens that can be parsed. This is
-/// traditionally implemented for `VecDeque<Token>`.
+/// A trait for treating a collection of tokens as a queue of tokens that can be parsed. This is implemented for `TokenCursor`, which is what the
+/// parser reads tokens with.
 pub trait TokenQueue {
 	/// Removes and returns the next token's value in the queue if the token matches the given token type. If it
 	/// does not (or the token stream is empty), an error is returned.
@@ -348,9 +639,12 @@ pub trait TokenQueue {
 	/// # Parameters
 	/// - `token_type` - The type of token to pop.
 	///
+	/// The value is borrowed from the source code stored in the context (see `Context::source_code`), so callers that need to keep it around while
+	/// continuing to use the context mutably should convert it with `.to_owned()`. Callers that don't need the value at all don't pay for an allocation.
+	///
 	/// # Returns
 	/// A `Result` containing either the value of the popped token or an `Error`.
-	fn pop(&mut self, token_type: TokenType, context: &mut Context) -> Result<String, TokenError>;
+	fn pop<'context>(&mut self, token_type: TokenType, context: &'context Context) -> Result<&'context str, TokenError>;
 
 	/// Removes and returns the next token's type in the queue if the token matches the given token type. If it
 	/// does not (or the token stream is empty), an error is returned.
@@ -380,7 +674,7 @@ pub trait TokenQueue {
 	/// # Returns
 	/// Whether the next token in the queue matches one of the given token types.
 	fn next_is_one_of(&self, token_types: &[TokenType]) -> bool {
-		token_types.iter().any(|token_type| self.next_is(token_type.clone()))
+		self.peek().is_some_and(|token| token_types.contains(&token.token_type))
 	}
 
 	/// Returns the line number, as given in the original source code, that the *next* token is written on. This
@@ -394,15 +688,48 @@ pub trait TokenQueue {
 	fn current_column(&self) -> usize;
 }
 
-impl TokenQueue for std::collections::VecDeque<Token> {
+/// A cursor over the tokens of a program, which is how the parser reads them (see `Parse`). The tokens are borrowed rather than owned, so popping a
+/// token only moves the cursor forward, and looking at the next token is a bounds-checked index into the slice.
+pub struct TokenCursor<'tokens> {
+	/// The tokens being parsed.
+	tokens: &'tokens [Token],
+	/// The index of the next token to parse.
+	position: usize,
+}
+
+impl<'tokens> TokenCursor<'tokens> {
+	/// Creates a cursor at the start of the given tokens.
+	///
+	/// # Parameters
+	/// - `tokens` - The tokens to parse.
+	///
+	/// # Returns
+	/// The new cursor.
+	#[must_use]
+	pub const fn new(tokens: &'tokens [Token]) -> Self {
+		Self { tokens, position: 0 }
+	}
+
+	/// Moves the cursor past the next token, and returns it. If there are no tokens left, `None` is returned and the cursor isn't moved.
+	///
+	/// # Returns
+	/// The token that the cursor moved past.
+	fn advance(&mut self) -> Option<&'tokens Token> {
+		let token = self.tokens.get(self.position)?;
+		self.position += 1;
+		Some(token)
+	}
+}
+
+impl TokenQueue for TokenCursor<'_> {
 	fn peek(&self) -> Option<&Token> {
-		self.front()
+		self.tokens.get(self.position)
 	}
 
-	fn pop(&mut self, token_type: TokenType, context: &mut Context) -> Result<String, TokenError> {
-		if let Some(token) = self.pop_front() {
+	fn pop<'context>(&mut self, token_type: TokenType, context: &'context Context) -> Result<&'context str, TokenError> {
+		if let Some(token) = self.advance() {
 			if token.token_type == token_type {
-				return Ok(token.value);
+				return Ok(token.value(&context.source_code));
 			}
 
 			return Err(TokenError {
@@ -412,21 +739,25 @@ impl TokenQueue for std::collections::VecDeque<Token> {
 					format!("{}", token.token_type).bold().cyan()
 				),
 				line: token.line,
+				column: token.column,
+				span: Some(token.span),
 				severity: Severity::Error,
-				filename: context.file_name.clone(),
+				filename: context.file_name_at(token.span.start).to_owned(),
 			});
 		}
 
 		Err(TokenError {
 			message: format!("Expected {token_type} but found EOF"),
 			line: 0,
+			column: 0,
+			span: None,
 			severity: Severity::Error,
 			filename: context.file_name.clone(),
 		})
 	}
 
 	fn pop_type(&mut self, token_type: TokenType) -> anyhow::Result<TokenType> {
-		if let Some(token) = self.pop_front() {
+		if let Some(token) = self.advance() {
 			if token.token_type == token_type {
 				return Ok(token.token_type);
 			}
@@ -440,7 +771,7 @@ impl TokenQueue for std::collections::VecDeque<Token> {
 	}
 
 	fn next_is(&self, token_type: TokenType) -> bool {
-		self.peek().map_or(false, |token| token.token_type == token_type)
+		self.peek().is_some_and(|token| token.token_type == token_type)
 	}
 
 	fn current_line(&self) -> usize {
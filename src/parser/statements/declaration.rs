@@ -1,11 +1,10 @@
 use colored::Colorize;
-use std::collections::VecDeque;
 
 use crate::{
 	compile_time::{CompileTime, CompileTimeStatement, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parser::{
 		expressions::{
 			literals::{
@@ -13,7 +12,7 @@ use crate::{
 			}, run::{ParentExpression, ParentStatement}, util::{tags::TagList, name::Name, types::Typed}, Expression
 		},
 		statements::Statement,
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 };
 
@@ -21,7 +20,10 @@ use crate::{
 // `string = format!("{string}...")`, because it avoids an extra allocation. We have a clippy warning turned on for this very
 // purpose. We assign this to `_` to indicate clearly that it's just a trait and not used explicitly anywhere outside of bringing its
 // methods into scope.
-use std::fmt::Write as _;
+use std::{
+	fmt::{self, Write as _},
+	sync::Arc,
+};
 
 /// A variable declaration
 #[derive(Clone, Debug)]
@@ -48,7 +50,7 @@ pub struct Declaration {
 impl Parse for Declaration {
 	type Output = Self;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		// Tags
 		let tags = tokens
 			.next_is(TokenType::TagOpening)
@@ -60,7 +62,7 @@ impl Parse for Declaration {
 
 		// Name
 		tokens.pop(TokenType::KeywordLet, context)?;
-		let name = Name(tokens.pop(TokenType::Identifier, context)?);
+		let name = Name::from(tokens.pop(TokenType::Identifier, context)?);
 
 		// Type
 		context.is_parsing_type = true;
@@ -85,16 +87,17 @@ impl Parse for Declaration {
 		match &mut value {
 			// Add names to the function declarations on a group
 			Expression::Literal(Literal(LiteralValue::Group(group), ..)) => {
-				for field in &mut group.fields {
+				for field in &mut Arc::make_mut(group).fields {
 					if let Some(Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..))) = &mut field.value {
-						function_declaration.name = Some(format!("{}_{}", name.cabin_name(), function_declaration.name.as_ref().unwrap()));
+						let function = Arc::make_mut(function_declaration);
+						function.name = Some(format!("{}_{}", name.cabin_name(), function.name.as_ref().unwrap()));
 					}
 				}
 			},
 
 			// Add names to function declaration
 			Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) => {
-				function_declaration.name = Some(name.cabin_name());
+				Arc::make_mut(function_declaration).name = Some(name.cabin_name().to_owned());
 			},
 			_ => (),
 		};
@@ -102,13 +105,13 @@ impl Parse for Declaration {
 		let cabin_value_node = value.clone();
 
 		if let Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) = &mut value {
-			function_declaration.tags = tags.clone();
+			Arc::make_mut(function_declaration).tags = tags.clone();
 		}
 
 		// Add the variable into the scope
 		context
 			.scope_data
-			.declare_new_variable(name.clone(), type_annotation.clone(), value, tags.clone())
+			.declare_new_variable(name, type_annotation.clone(), value, tags.clone())
 			.map_err(|error| anyhow::anyhow!("{error}\n\twhile attempting to declare a new variable called \"{}\"", name.cabin_name()))?;
 
 		Ok(Self {
@@ -124,6 +127,10 @@ impl Parse for Declaration {
 
 impl CompileTimeStatement for Declaration {
 	fn compile_time_evaluate_statement(&self, context: &mut Context, with_side_effects: bool) -> anyhow::Result<Statement> {
+		// Declarations created by the compiler, such as the parameters of a function call, aren't in the source code
+		if self.line_start != 0 {
+			context.compile_time_profile.set_line(self.line_start);
+		}
 
 		// Evaluate the value of the declared variable
 		let mut value = context
@@ -150,6 +157,11 @@ impl CompileTimeStatement for Declaration {
 				)
 			})?;
 
+		// The variants of an either are typed as the either they belong to, so that they can be transpiled to its tags (or to values of its scalar type)
+		if let Expression::Literal(Literal(LiteralValue::Either(either), ..)) = &mut value {
+			either.name_variants(self.name);
+		}
+
 		// Evaluate tags
 		let tags = {
 			let tags = if let Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) = &value {
@@ -160,7 +172,7 @@ impl CompileTimeStatement for Declaration {
 
 			// Groups need special tag handling
 			if let Expression::Literal(Literal(LiteralValue::Group(group), ..)) = &mut value {
-				group.tags = tags.clone();
+				Arc::make_mut(group).tags = tags.clone();
 			}
 
 			tags
@@ -171,7 +183,7 @@ impl CompileTimeStatement for Declaration {
 
 		// Add to context structs
 		if let Expression::Literal(Literal(LiteralValue::Group(_), ..)) = &value {
-			context.structs.push((self.name.clone(), context.scope_data.unique_id()));
+			context.structs.push((self.name, context.scope_data.unique_id()));
 		}
 
 		// Explicit type tag
@@ -262,7 +274,7 @@ impl CompileTimeStatement for Declaration {
 			}
 		}
 
-		if self.name == Name("main".to_owned()) {
+		if self.name == Name::from("main") {
 			let Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function_declaration), ..)) = &cabin_value_node else {
 				anyhow::bail!("Main variable is not a function");
 			};
@@ -271,7 +283,7 @@ impl CompileTimeStatement for Declaration {
 
 		// Return the evaluated declaration
 		Ok(Statement::Declaration(Self {
-			name: self.name.clone(),
+			name: self.name,
 			declared_scope_id: self.declared_scope_id,
 			tags,
 			type_annotation: Some(type_annotation),
@@ -319,10 +331,7 @@ impl TranspileToC for Declaration {
 					},
 					name = self.name.c_name(),
 					parameters = function_declaration
-						.parameters
-						.iter()
-						.map(|parameter| Ok(format!("{}*", parameter.1.to_c(context)?)))
-						.collect::<anyhow::Result<Vec<_>>>()?
+						.c_parameters(context)?
 						.join(", "),
 					value = value.to_c(context)?
 				)
@@ -362,7 +371,7 @@ impl TranspileToC for Declaration {
 			.unwrap();
 
 		if let Expression::Literal(Literal(LiteralValue::Group(_), ..))  = &value {
-			context.transpiling_group_name = Some(self.name.clone());
+			context.transpiling_group_name = Some(self.name);
 		}
 
 		value.c_prelude(context).map_err(|error| {
@@ -413,7 +422,7 @@ impl ParentStatement for Declaration {
 
 		// Add to context structs
 		if let Expression::Literal(Literal(LiteralValue::Group(_), ..)) = &value {
-			context.structs.push((self.name.clone(), context.scope_data.unique_id()));
+			context.structs.push((self.name, context.scope_data.unique_id()));
 		}
 
 		// Explicit type annotation
@@ -500,7 +509,7 @@ impl ParentStatement for Declaration {
 
 		// Return the evaluated declaration
 		Ok(Statement::Declaration(Self {
-			name: self.name.clone(),
+			name: self.name,
 			declared_scope_id: self.declared_scope_id,
 			tags,
 			type_annotation: Some(type_annotation),
@@ -511,13 +520,15 @@ impl ParentStatement for Declaration {
 }
 
 impl ToCabin for Declaration {
-	fn to_cabin(&self) -> String {
-		let mut cabin_code = format!("let {}", self.name.cabin_name());
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		write!(writer, "let {}", self.name.cabin_name())?;
 		if let Some(type_annotation) = &self.type_annotation {
-			write!(cabin_code, ": {}", type_annotation.to_cabin()).unwrap();
+			writer.write_str(": ")?;
+			type_annotation.write_cabin(writer)?;
 		}
-		write!(cabin_code, " = {};", self.initial_value.to_cabin()).unwrap();
-		cabin_code
+		writer.write_str(" = ")?;
+		self.initial_value.write_cabin(writer)?;
+		writer.write_char(';')
 	}
 }
 
@@ -1,20 +1,21 @@
-use std::collections::VecDeque;
+use std::fmt::{self, Write as _};
 
 use crate::{
 	cli::theme::Styled,
 	compile_time::{CompileTime, CompileTimeStatement, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
 	global_var,
-	lexer::{Token, TokenType},
+	lexer::TokenType,
 	parser::{
 		expressions::{
 			block::Block,
-			util::{name::Name, tags::TagList},
+			literals::{Literal, LiteralValue},
+			util::{name::Name, tags::TagList, types::Typed as _},
 			Expression,
 		},
 		statements::Statement,
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 };
 
@@ -22,27 +23,27 @@ use crate::{
 #[derive(Debug, Clone)]
 pub struct ForEachLoop {
 	/// The name of the variable binding created in the for loop.
-	name: Name,
+	pub name: Name,
 
 	/// The expression being iterated over. This must be a `List`.
-	iterator: Expression,
+	pub iterator: Expression,
 
 	/// The body of the for loop.
-	body: Block,
+	pub body: Block,
 }
 
 impl Parse for ForEachLoop {
 	type Output = Self;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		tokens.pop(TokenType::KeywordForEach, context)?;
-		let name = Name(tokens.pop(TokenType::Identifier, context)?);
+		let name = Name::from(tokens.pop(TokenType::Identifier, context)?);
 		tokens.pop(TokenType::KeywordIn, context)?;
 		let iterator = Expression::parse(tokens, context)?;
 		let body = Block::parse(tokens, context)?;
 		context
 			.scope_data
-			.declare_new_variable_from_id(name.clone(), None, global_var!("Parameter"), TagList::default(), body.inner_scope_id)?;
+			.declare_new_variable_from_id(name, None, global_var!("Parameter"), TagList::default(), body.inner_scope_id)?;
 		Ok(Self { name, iterator, body })
 	}
 }
@@ -54,11 +55,7 @@ impl CompileTimeStatement for ForEachLoop {
 			unreachable!()
 		};
 
-		Ok(Statement::ForEachLoop(Self {
-			name: self.name.clone(),
-			iterator,
-			body,
-		}))
+		Ok(Statement::ForEachLoop(Self { name: self.name, iterator, body }))
 	}
 }
 
@@ -68,24 +65,53 @@ impl TranspileToC for ForEachLoop {
 	}
 
 	fn to_c(&self, context: &mut Context) -> anyhow::Result<String> {
+		let iterator = self.iterator.to_c(context)?;
+		let block = self.body.to_c(context)?;
+		let body = block.get(2..block.len() - 1).unwrap();
+
+		// The variable holding the iterator is declared in the same C block as the loop, so it's named after the loop's scope to keep it distinct from the
+		// iterators of other loops in the same block
+		let scope_id = self.body.inner_scope_id;
+
+		// An open file is iterated one line at a time, reading each line through the file's line buffer, so the file is never in memory all at once. The
+		// loop reads the file to its end, so the file is closed afterwards.
+		if self.iterates_over_file(context) {
+			return Ok(format!(
+				"File_u file_{scope_id} = {iterator};\nfor (Text_u {name}; cabin_file_next_line(&file_{scope_id}, &{name});) {{{body}\ncabin_file_close(&file_{scope_id});",
+				name = self.name.c_name(),
+			));
+		}
+
+		// The list is iterated directly through its buffer, which is made contiguous first so that the loop doesn't need to wrap around it
 		Ok(format!(
-			"List_u* collection = {};\nfor (int index = 0; index < collection->size; index++) {}",
-			self.iterator.to_c(context)?,
-			{
-				let body = self.body.to_c(context)?;
-				format!(
-					"{{\n\tvoid* {name};\n\tcollection->get_u(collection, index, &{name});{}",
-					body.get(2..body.len() - 1).unwrap().to_owned(),
-					name = self.name.c_name(),
-				)
-			}
+			"List_u* collection_{scope_id} = {iterator};\ncabin_list_make_contiguous(collection_{scope_id});\nfor (void** element = collection_{scope_id}->data + collection_{scope_id}->start, **end = element + collection_{scope_id}->size; element < end; element++) {{\n\tvoid* {name} = *element;{body}",
+			name = self.name.c_name(),
 		))
 	}
 }
 
+impl ForEachLoop {
+	/// Returns whether this loop iterates over the lines of an open `File` rather than the elements of a `List`. Loops whose iterator's type can't be
+	/// determined are treated as iterating over a list.
+	///
+	/// # Parameters
+	/// - `context` - The global data about the program, which is used to find the type of the iterator.
+	///
+	/// # Returns
+	/// Whether the iterator of this loop is a `File`.
+	fn iterates_over_file(&self, context: &mut Context) -> bool {
+		self.iterator
+			.get_type(context)
+			.is_ok_and(|iterator_type| matches!(iterator_type, Literal(LiteralValue::VariableReference(type_name), ..) if type_name.name() == &Name::from("File")))
+	}
+}
+
 impl ToCabin for ForEachLoop {
-	fn to_cabin(&self) -> String {
-		format!("foreach {} in {} {}", self.name.cabin_name(), self.iterator.to_cabin(), self.body.to_cabin())
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		write!(writer, "foreach {} in ", self.name.cabin_name())?;
+		self.iterator.write_cabin(writer)?;
+		writer.write_char(' ')?;
+		self.body.write_cabin(writer)
 	}
 }
 
@@ -1,15 +1,17 @@
 use crate::{
 	compile_time::{CompileTimeStatement, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parser::{
 		expressions::{run::ParentExpression, run::ParentStatement, Expression},
 		statements::{declaration::Declaration, return_statement::ReturnStatement, tail::TailStatement},
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 };
 
+use std::fmt::{self, Write as _};
+
 use colored::Colorize as _;
 
 use self::{foreach::ForEachLoop, while_loop::WhileLoop};
@@ -43,7 +45,7 @@ pub enum Statement {
 impl Parse for Statement {
 	type Output = Self;
 
-	fn parse(tokens: &mut std::collections::VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		let parsed = Ok(match tokens.peek().ok_or_else(|| anyhow::anyhow!("Unexpected EOF"))?.token_type {
 			TokenType::KeywordLet | TokenType::TagOpening => Self::Declaration(Declaration::parse(tokens, context)?),
 			TokenType::KeywordReturn => Self::ReturnStatement(ReturnStatement::parse(tokens, context)?),
@@ -114,14 +116,17 @@ impl TranspileToC for Statement {
 }
 
 impl ToCabin for Statement {
-	fn to_cabin(&self) -> String {
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
 		match self {
-			Self::Declaration(declaration) => declaration.to_cabin(),
-			Self::ReturnStatement(return_statement) => return_statement.to_cabin(),
-			Self::Expression(expression) => format!("{};", expression.to_cabin()),
-			Self::Tail(tail) => tail.to_cabin(),
-			Self::ForEachLoop(foreach) => foreach.to_cabin(),
-			Self::WhileLoop(while_loop) => while_loop.to_cabin(),
+			Self::Declaration(declaration) => declaration.write_cabin(writer),
+			Self::ReturnStatement(return_statement) => return_statement.write_cabin(writer),
+			Self::Expression(expression) => {
+				expression.write_cabin(writer)?;
+				writer.write_char(';')
+			},
+			Self::Tail(tail) => tail.write_cabin(writer),
+			Self::ForEachLoop(foreach) => foreach.write_cabin(writer),
+			Self::WhileLoop(while_loop) => while_loop.write_cabin(writer),
 		}
 	}
 }
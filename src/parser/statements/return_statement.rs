@@ -1,17 +1,20 @@
 use crate::{
 	compile_time::{CompileTime, CompileTimeStatement, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parser::{
 		expressions::{binary::BinaryExpression, Expression},
 		statements::Statement,
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 	var,
 };
 
-use std::collections::VecDeque;
+use std::{
+	fmt::{self, Write as _},
+	sync::Arc,
+};
 
 use colored::Colorize as _;
 
@@ -28,7 +31,7 @@ pub struct ReturnStatement {
 impl Parse for ReturnStatement {
 	type Output = Self;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		tokens.pop(TokenType::KeywordReturn, context)?;
 		if tokens.next_is(TokenType::Semicolon) {
 			Ok(Self {
@@ -56,7 +59,7 @@ impl CompileTimeStatement for ReturnStatement {
 		// This is a false positive warning - `Option::map_or_else()` will cause an ownership error here
 		#[allow(clippy::option_if_let_else)]
 		if let Some(expression) = evaluated {
-			Ok(Statement::Expression(Expression::BinaryExpression(Box::new(BinaryExpression {
+			Ok(Statement::Expression(Expression::BinaryExpression(Arc::new(BinaryExpression {
 				left: var!("return_address", self.scope_id),
 				operator: TokenType::Equal,
 				right: expression,
@@ -87,8 +90,9 @@ impl TranspileToC for ReturnStatement {
 }
 
 impl ToCabin for ReturnStatement {
-	fn to_cabin(&self) -> String {
-		format!("return {}", self.expression.as_ref().map_or(String::new(), |expression| expression.to_cabin()))
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		writer.write_str("return ")?;
+		self.expression.as_ref().map_or(Ok(()), |expression| expression.write_cabin(writer))
 	}
 }
 
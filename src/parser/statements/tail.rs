@@ -2,12 +2,12 @@ use crate::{
 	cli::theme::Styled,
 	compile_time::{CompileTime, CompileTimeStatement, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
-	parser::{expressions::Expression, statements::Statement, Parse, TokenQueue},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
+	parser::{expressions::Expression, statements::Statement, Parse, TokenCursor, TokenQueue},
 };
 
-use std::collections::VecDeque;
+use std::fmt::{self, Write as _};
 
 use colored::Colorize as _;
 
@@ -29,7 +29,7 @@ impl CompileTimeStatement for TailStatement {
 impl Parse for TailStatement {
 	type Output = Self;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		tokens.pop(TokenType::KeywordTail, context).map_err(|error| {
 			anyhow::anyhow!(anyhow::anyhow!(
 				"{error}\n\t{}",
@@ -59,8 +59,10 @@ impl TranspileToC for TailStatement {
 }
 
 impl ToCabin for TailStatement {
-	fn to_cabin(&self) -> String {
-		format!("its {};", self.expression.to_cabin())
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		writer.write_str("its ")?;
+		self.expression.write_cabin(writer)?;
+		writer.write_char(';')
 	}
 }
 
@@ -1,16 +1,21 @@
-use std::collections::VecDeque;
+use std::fmt::{self, Write as _};
 
 use colored::Colorize;
 
 use crate::{
-	compile_time::{CompileTimeStatement, TranspileToC},
+	compile_time::{bytecode::run_while_loop, CompileTimeStatement, TranspileToC},
 	context::Context,
-	formatter::{ColoredCabin, ToCabin},
-	lexer::{Token, TokenType},
+	formatter::{CabinWriter, ColoredCabin, ToCabin},
+	lexer::TokenType,
 	parser::{
-		expressions::{block::Block, Expression},
+		expressions::{
+			binary::forget_value,
+			block::Block,
+			literals::{variable_reference::VariableReference, Literal, LiteralValue},
+			Expression,
+		},
 		statements::Statement,
-		Parse, TokenQueue,
+		Parse, TokenCursor, TokenQueue,
 	},
 };
 
@@ -18,15 +23,15 @@ use crate::{
 #[derive(Debug, Clone)]
 pub struct WhileLoop {
 	/// The condition of the while loop
-	condition: Expression,
+	pub condition: Expression,
 	/// The body of the while loop
-	body: Block,
+	pub body: Block,
 }
 
 impl Parse for WhileLoop {
 	type Output = Self;
 
-	fn parse(tokens: &mut VecDeque<Token>, context: &mut Context) -> anyhow::Result<Self::Output> {
+	fn parse(tokens: &mut TokenCursor<'_>, context: &mut Context) -> anyhow::Result<Self::Output> {
 		tokens.pop(TokenType::KeywordWhile, context)?;
 		let condition = Expression::parse(tokens, context)?;
 		let body = Block::parse(tokens, context)?;
@@ -35,11 +40,94 @@ impl Parse for WhileLoop {
 }
 
 impl CompileTimeStatement for WhileLoop {
-	fn compile_time_evaluate_statement(&self, _context: &mut Context, _with_side_effects: bool) -> anyhow::Result<Statement> {
+	fn compile_time_evaluate_statement(&self, context: &mut Context, with_side_effects: bool) -> anyhow::Result<Statement> {
+		// A loop that only uses values known at compile-time is run in the bytecode virtual machine, and then removed from the program, because the
+		// variables it assigns to now have their final values
+		let has_run = run_while_loop(&self.condition, &self.body.statements, context, with_side_effects)
+			.map_err(|error| anyhow::anyhow!("{error}\n\t{}", "while running a while loop at compile-time".dimmed()))?;
+		if has_run {
+			return Ok(Statement::Expression(Expression::Block(Block {
+				statements: Vec::new(),
+				inner_scope_id: self.body.inner_scope_id,
+			})));
+		}
+
+		// The loop runs at runtime, so the variables that it assigns to no longer have the values that they had before it
+		let mut assigned = Vec::new();
+		assigned_variables(&self.body.statements, &mut assigned);
+		for variable in assigned {
+			if context.scope_data.get_variable_from_id(variable.name(), variable.scope_id()).is_some() {
+				forget_value(variable.name(), variable.scope_id(), context)?;
+			}
+		}
+
 		Ok(Statement::WhileLoop(self.clone()))
 	}
 }
 
+/// Finds the variables that are assigned to in a list of statements, including in the blocks, `if` expressions and loops nested in them. Functions
+/// declared in the statements aren't searched, because their bodies don't run where they're declared.
+///
+/// # Parameters
+/// - `statements` - The statements to search.
+/// - `assigned` - The list to add the variables that are assigned to to.
+fn assigned_variables(statements: &[Statement], assigned: &mut Vec<VariableReference>) {
+	for statement in statements {
+		match statement {
+			Statement::Declaration(declaration) => expression_assigned_variables(&declaration.initial_value, assigned),
+			Statement::Expression(expression) => expression_assigned_variables(expression, assigned),
+			Statement::Tail(tail) => expression_assigned_variables(&tail.expression, assigned),
+			Statement::ReturnStatement(return_statement) => {
+				if let Some(expression) = &return_statement.expression {
+					expression_assigned_variables(expression, assigned);
+				}
+			},
+			Statement::ForEachLoop(for_each_loop) => {
+				expression_assigned_variables(&for_each_loop.iterator, assigned);
+				assigned_variables(&for_each_loop.body.statements, assigned);
+			},
+			Statement::WhileLoop(while_loop) => {
+				expression_assigned_variables(&while_loop.condition, assigned);
+				assigned_variables(&while_loop.body.statements, assigned);
+			},
+		}
+	}
+}
+
+/// Finds the variables that are assigned to in an expression (see `assigned_variables()`).
+///
+/// # Parameters
+/// - `expression` - The expression to search.
+/// - `assigned` - The list to add the variables that are assigned to to.
+fn expression_assigned_variables(expression: &Expression, assigned: &mut Vec<VariableReference>) {
+	match expression {
+		Expression::BinaryExpression(binary) => {
+			if binary.operator == TokenType::Equal {
+				if let Expression::Literal(Literal(LiteralValue::VariableReference(variable_reference), ..)) = &binary.left {
+					assigned.push(variable_reference.clone());
+				}
+			} else {
+				expression_assigned_variables(&binary.left, assigned);
+			}
+			expression_assigned_variables(&binary.right, assigned);
+		},
+		Expression::FunctionCall(function_call) => {
+			expression_assigned_variables(&function_call.function, assigned);
+			for argument in &function_call.arguments {
+				expression_assigned_variables(argument, assigned);
+			}
+		},
+		Expression::IfStatement(if_expression) => {
+			expression_assigned_variables(&if_expression.condition, assigned);
+			assigned_variables(&if_expression.body, assigned);
+			assigned_variables(if_expression.else_body.as_deref().unwrap_or_default(), assigned);
+		},
+		Expression::Run(run_expression) => expression_assigned_variables(&run_expression.expression, assigned),
+		Expression::Block(block) => assigned_variables(&block.statements, assigned),
+		Expression::Literal(_) => {},
+	}
+}
+
 impl TranspileToC for WhileLoop {
 	fn c_prelude(&self, context: &mut Context) -> anyhow::Result<String> {
 		Ok([self.condition.c_prelude(context)?, self.body.c_prelude(context)?].join("\n"))
@@ -54,8 +142,11 @@ impl TranspileToC for WhileLoop {
 }
 
 impl ToCabin for WhileLoop {
-	fn to_cabin(&self) -> String {
-		format!("while {} {}", self.condition.to_cabin(), self.body.to_cabin())
+	fn write_cabin(&self, writer: &mut CabinWriter<'_>) -> fmt::Result {
+		writer.write_str("while ")?;
+		self.condition.write_cabin(writer)?;
+		writer.write_char(' ')?;
+		self.body.write_cabin(writer)
 	}
 }
 
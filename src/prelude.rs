@@ -0,0 +1,55 @@
+use crate::lexer::{tokenize_from, Span, Token, TokenType};
+
+/// The Cabin prelude. This is a string of cabin code that's appended automatically to the beginning of all Cabin files prior to compilation. It includes basic necessities such as
+/// IO, file handling, basic data types like strings and numbers, etc.
+///
+/// This is the prelude as it was tokenized by the build script, which means its tabs have already been replaced with spaces.
+pub const PRELUDE: &str = include_str!(concat!(env!("OUT_DIR"), "/prelude.cbn"));
+
+/// The tokens of the prelude. The prelude is tokenized by the build script when the compiler is built (see `/build.rs`), so it doesn't need to be tokenized
+/// again every time the compiler is run. The spans of these tokens refer to the start of `PRELUDE`.
+pub static PRELUDE_TOKENS: &[Token] = include!(concat!(env!("OUT_DIR"), "/prelude_tokens.rs"));
+
+/// The code that separates the prelude from the user's code in the source code passed to the compiler.
+pub const PRELUDE_SEPARATOR: &str = "\n\n";
+
+/// Prepends the prelude to the given source code. The returned code should be stored in the context (see `Context::source_code`) and tokenized with
+/// `tokenize_with_prelude`.
+///
+/// # Parameters
+/// - `source_code` - The user's source code.
+///
+/// # Returns
+/// The prelude followed by the given source code.
+#[must_use]
+pub fn with_prelude(source_code: &str) -> String {
+	PRELUDE.to_owned() + PRELUDE_SEPARATOR + source_code
+}
+
+/// Tokenizes source code that was created with `with_prelude`. The prelude's tokens are taken from the table generated by the build script, so only the
+/// user's code after it is actually tokenized. The user's code is tokenized as its own file, so its tokens have the line numbers they appear on in the
+/// user's file, rather than line numbers offset by the length of the prelude.
+///
+/// # Parameters
+/// - `code` - The source code to tokenize, which must start with the prelude. Any tabs in the code are replaced with four spaces before tokenizing, as
+/// with `tokenize`.
+///
+/// # Returns
+/// The tokens of the prelude followed by the tokens of the user's code, or an `Err` if an unrecognized token was found in the user's code.
+///
+/// # Errors
+/// If the user's code isn't comprised of valid Cabin tokens, or the given code doesn't start with the prelude.
+pub fn tokenize_with_prelude(code: &mut String) -> anyhow::Result<Vec<Token>> {
+	// The prelude doesn't contain any tabs, so replacing them here only affects the user's code, and the prelude's token spans remain valid
+	if code.contains('\t') {
+		*code = code.replace('\t', "    ");
+	}
+
+	if !code.starts_with(PRELUDE) {
+		anyhow::bail!("Attempted to tokenize code with the prelude, but the code doesn't start with the prelude");
+	}
+
+	let mut tokens = PRELUDE_TOKENS.to_vec();
+	tokens.extend(tokenize_from(code, PRELUDE.len() + PRELUDE_SEPARATOR.len())?);
+	Ok(tokens)
+}
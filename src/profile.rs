@@ -0,0 +1,249 @@
+/// The names of the profiles that are built into the compiler. These can be configured in `cabin.toml` like any other profile, but they have defaults, so
+/// they don't need to be.
+const BUILT_IN_PROFILES: &[&str] = &["debug", "release"];
+
+/// An optimization level for the C compiler. These correspond to the `-O` flags accepted by all of the supported C compilers.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum OptimizationLevel {
+	/// No optimizations (`-O0`). This gives the fastest compile times and the best debugging experience.
+	None,
+	/// Basic optimizations (`-O1`).
+	Basic,
+	/// Most optimizations that don't trade size for speed (`-O2`).
+	Most,
+	/// All optimizations (`-O3`). This gives the best runtime performance, at the cost of longer compile times and larger binaries.
+	All,
+	/// Optimizations for binary size (`-Os`).
+	Size,
+	/// Aggressive optimizations for binary size (`-Oz`).
+	MinimumSize,
+}
+
+impl OptimizationLevel {
+	/// Returns the C compiler flag for this optimization level.
+	const fn flag(self) -> &'static str {
+		match self {
+			Self::None => "-O0",
+			Self::Basic => "-O1",
+			Self::Most => "-O2",
+			Self::All => "-O3",
+			Self::Size => "-Os",
+			Self::MinimumSize => "-Oz",
+		}
+	}
+
+	/// Parses an optimization level from the value of an `opt-level` field in a profile. This accepts the same values as Cargo: `0` through `3`, `"s"` and `"z"`.
+	///
+	/// # Parameters
+	/// - `value` - The value of the `opt-level` field.
+	///
+	/// # Returns
+	/// The optimization level, or `None` if the value isn't a valid optimization level.
+	fn from_value(value: &toml_edit::Item) -> Option<Self> {
+		if let Some(level) = value.as_integer() {
+			return match level {
+				0 => Some(Self::None),
+				1 => Some(Self::Basic),
+				2 => Some(Self::Most),
+				3 => Some(Self::All),
+				_ => None,
+			};
+		}
+
+		match value.as_str()? {
+			"0" => Some(Self::None),
+			"1" => Some(Self::Basic),
+			"2" => Some(Self::Most),
+			"3" => Some(Self::All),
+			"s" => Some(Self::Size),
+			"z" => Some(Self::MinimumSize),
+			_ => None,
+		}
+	}
+}
+
+/// A stage of a profile-guided optimization (PGO) build. A PGO build compiles the program twice: First with instrumentation that records how the program
+/// behaves while a training workload runs, and then again using that recorded profile to guide optimizations.
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+pub enum ProfileGuidedStage {
+	/// Build an instrumented executable that writes profile data into the given directory when it's run.
+	Generate(String),
+	/// Build an optimized executable using the profile data at the given path. For Clang, this is the merged `.profdata` file; For GCC, this is the directory
+	/// that the instrumented executable wrote its profile data into.
+	Use(String),
+}
+
+/// A build profile, which controls how the generated C code is compiled into a native executable. Profiles are configured in the `[profile.<name>]` tables of
+/// `cabin.toml`, using fields that are similar to Cargo's profiles:
+///
+/// ```toml
+/// [profile.release]
+/// opt-level = 3          # 0, 1, 2, 3, "s", or "z"
+/// target-cpu = "native"  # Passed to the C compiler as -march
+/// lto = true             # Link-time optimization
+/// static = true          # Link the executable statically
+/// debug = false          # Include debug information
+/// ```
+///
+/// The `debug` and `release` profiles have defaults, so they can be used without being configured. Any fields that a configured profile leaves out keep
+/// their default values.
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+pub struct BuildProfile {
+	/// The name of the profile, such as `debug` or `release`.
+	pub name: String,
+	/// The optimization level to compile with.
+	pub optimization_level: OptimizationLevel,
+	/// The CPU to generate code for, which is passed to the C compiler as `-march`. If this is `None`, the C compiler's default target is used.
+	pub target_cpu: Option<String>,
+	/// Whether to enable link-time optimization.
+	pub lto: bool,
+	/// Whether to link the executable statically.
+	pub static_linking: bool,
+	/// Whether to include debug information in the executable.
+	pub debug_info: bool,
+	/// The stage of the profile-guided optimization build that this is, if this is part of one. This isn't configured in `cabin.toml`; It's set by
+	/// `cabin build --pgo`.
+	pub profile_guided: Option<ProfileGuidedStage>,
+}
+
+impl BuildProfile {
+	/// Creates the default profile with the given name. The `release` profile is fully optimized by default; All other profiles, including `debug`, are
+	/// unoptimized and include debug information by default.
+	///
+	/// # Parameters
+	/// - `name` - The name of the profile.
+	///
+	/// # Returns
+	/// The default profile with the given name.
+	#[must_use]
+	pub fn default_for(name: &str) -> Self {
+		let is_release = name == "release";
+		Self {
+			name: name.to_owned(),
+			optimization_level: if is_release { OptimizationLevel::All } else { OptimizationLevel::None },
+			target_cpu: None,
+			lto: false,
+			static_linking: false,
+			debug_info: !is_release,
+			profile_guided: None,
+		}
+	}
+
+	/// Reads the profile with the given name from a project's configuration. Fields that the profile doesn't configure keep their defaults (see
+	/// `default_for()`).
+	///
+	/// # Parameters
+	/// - `config` - The project's configuration, as read from `cabin.toml`.
+	/// - `name` - The name of the profile to read.
+	///
+	/// # Returns
+	/// The profile with the given name.
+	///
+	/// # Errors
+	/// If the profile isn't configured and isn't one of the built-in profiles, or if it has a field that's unknown or has the wrong type.
+	pub fn from_config(config: &toml_edit::DocumentMut, name: &str) -> anyhow::Result<Self> {
+		let mut profile = Self::default_for(name);
+
+		let Some(profile_item) = config.get("profile").and_then(|profiles| profiles.get(name)) else {
+			if BUILT_IN_PROFILES.contains(&name) {
+				return Ok(profile);
+			}
+			anyhow::bail!("Error reading configuration: No profile named \"{name}\" was found; Add a [profile.{name}] table to cabin.toml to create one");
+		};
+
+		let Some(profile_config) = profile_item.as_table_like() else {
+			anyhow::bail!("Error reading configuration: [profile.{name}] is present, but it is not a table");
+		};
+
+		for (field, value) in profile_config.iter() {
+			match field {
+				"opt-level" => {
+					profile.optimization_level = OptimizationLevel::from_value(value)
+						.ok_or_else(|| anyhow::anyhow!("Error reading configuration: field \"opt-level\" in [profile.{name}] must be 0, 1, 2, 3, \"s\", or \"z\""))?;
+				},
+				"target-cpu" => {
+					profile.target_cpu = Some(
+						value
+							.as_str()
+							.ok_or_else(|| anyhow::anyhow!("Error reading configuration: field \"target-cpu\" is present in [profile.{name}], but it is not a string"))?
+							.to_owned(),
+					);
+				},
+				"lto" => profile.lto = bool_field(value, field, name)?,
+				"static" => profile.static_linking = bool_field(value, field, name)?,
+				"debug" => profile.debug_info = bool_field(value, field, name)?,
+				_ => anyhow::bail!("Error reading configuration: Unknown field \"{field}\" in [profile.{name}]"),
+			}
+		}
+
+		Ok(profile)
+	}
+
+	/// Returns the arguments to pass to the given C compiler to build with this profile. These don't include the input or output files.
+	///
+	/// # Parameters
+	/// - `compiler` - The command name of the C compiler, as returned by `compiler::get_c_compiler()`.
+	///
+	/// # Returns
+	/// The arguments to pass to the C compiler.
+	///
+	/// # Errors
+	/// If this profile uses a feature that the given compiler doesn't support.
+	pub fn c_compiler_arguments(&self, compiler: &str) -> anyhow::Result<Vec<String>> {
+		let mut arguments = Vec::new();
+
+		// Zig is a toolchain rather than just a C compiler, and compiles C through its Clang-compatible `cc` subcommand
+		if compiler == "zig" {
+			arguments.push("cc".to_owned());
+		}
+
+		arguments.push(self.optimization_level.flag().to_owned());
+
+		if let Some(target_cpu) = &self.target_cpu {
+			arguments.push(format!("-march={target_cpu}"));
+		}
+
+		if self.lto {
+			arguments.push("-flto".to_owned());
+		}
+
+		if self.static_linking {
+			arguments.push("-static".to_owned());
+		}
+
+		if self.debug_info {
+			arguments.push("-g".to_owned());
+		}
+
+		if let Some(stage) = &self.profile_guided {
+			if compiler == "zig" {
+				anyhow::bail!("Error during C compilation: Profile-guided optimization isn't supported when compiling with zig; Install clang or gcc to use --pgo");
+			}
+
+			arguments.push(match stage {
+				ProfileGuidedStage::Generate(directory) => format!("-fprofile-generate={directory}"),
+				ProfileGuidedStage::Use(path) => format!("-fprofile-use={path}"),
+			});
+		}
+
+		Ok(arguments)
+	}
+}
+
+/// Reads a boolean field from a profile in a project's configuration.
+///
+/// # Parameters
+/// - `value` - The value of the field.
+/// - `field` - The name of the field, which is used in the error message.
+/// - `profile` - The name of the profile, which is used in the error message.
+///
+/// # Returns
+/// The value of the field.
+///
+/// # Errors
+/// If the value isn't a boolean.
+fn bool_field(value: &toml_edit::Item, field: &str, profile: &str) -> anyhow::Result<bool> {
+	value
+		.as_bool()
+		.ok_or_else(|| anyhow::anyhow!("Error reading configuration: field \"{field}\" is present in [profile.{profile}], but it is not a boolean"))
+}
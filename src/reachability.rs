@@ -0,0 +1,153 @@
+use std::collections::{HashMap, HashSet};
+
+/// A piece of generated C code that can be left out of the program if nothing reachable uses it, such as the definition of a struct, a function, or a
+/// global variable whose value has no side effects.
+pub struct CItem {
+	/// What kind of item this is, such as `"function"`. This is only used to describe the item when it's left out of the program.
+	pub kind: &'static str,
+	/// The C identifiers that this item defines. Reachable code that mentions any of these makes this item reachable.
+	pub symbols: Vec<String>,
+	/// The C code of the item, which is searched for the identifiers of the other items that it uses.
+	pub code: String,
+	/// Whether this item is always part of the program, such as a statement with side effects in the C `main` function.
+	pub is_root: bool,
+}
+
+/// Returns the C identifiers in a piece of C code, in the order that they appear. Identifiers inside of string literals and comments are included too,
+/// which can only make more items reachable than necessary, never fewer.
+///
+/// # Parameters
+/// - `code` - The C code to find identifiers in.
+///
+/// # Returns
+/// An iterator over the identifiers in the code.
+fn identifiers(code: &str) -> impl Iterator<Item = &str> {
+	code.split(|character: char| !(character.is_ascii_alphanumeric() || character == '_'))
+		.filter(|word| word.starts_with(|character: char| character.is_ascii_alphabetic() || character == '_'))
+}
+
+/// Replaces identifiers in a piece of C code.
+///
+/// # Parameters
+/// - `code` - The C code to rename identifiers in.
+/// - `rename` - Returns the replacement for an identifier, or `None` to keep it as it is.
+///
+/// # Returns
+/// The code with the identifiers replaced.
+fn rename_identifiers<'replacement>(code: &str, rename: impl Fn(&str) -> Option<&'replacement str>) -> String {
+	let is_identifier_character = |character: char| character.is_ascii_alphanumeric() || character == '_';
+	let mut renamed = String::with_capacity(code.len());
+	let mut rest = code;
+	while !rest.is_empty() {
+		let (other, after_other) = rest.split_at(rest.find(is_identifier_character).unwrap_or(rest.len()));
+		renamed.push_str(other);
+		let (word, after_word) = after_other.split_at(after_other.find(|character: char| !is_identifier_character(character)).unwrap_or(after_other.len()));
+		renamed.push_str(rename(word).unwrap_or(word));
+		rest = after_word;
+	}
+	renamed
+}
+
+/// Folds functions with identical C code into a single shared instance. Two instances of different functions can transpile into exactly the same C code
+/// apart from their names, such as instances of similar methods of different groups; Every reference to a duplicate is replaced with a reference to the
+/// first function with the same code, so the duplicate becomes unreachable and is left out of the program (see `reachable_items()`). Functions are
+/// compared with their own name replaced, so recursive functions are folded too, and folding repeats until no more functions are identical, since
+/// folding callees can make their callers identical.
+///
+/// Folded functions have the same address in C, so C code comparing pointers to them would see them as equal; The generated code never does this.
+///
+/// # Parameters
+/// - `items` - The items of the program. Only items with the kind `"function"` are folded, but references are replaced in every item.
+///
+/// # Returns
+/// The number of functions that were folded into another function.
+pub fn fold_identical_functions(items: &mut [CItem]) -> usize {
+	let mut folded = HashSet::new();
+	loop {
+		let mut canonical = HashMap::new();
+		let mut renames = HashMap::new();
+		for (index, item) in items.iter().enumerate() {
+			let Some(symbol) = item.symbols.first().filter(|_symbol| item.kind == "function" && !folded.contains(&index)) else {
+				continue;
+			};
+			// `$` can't appear in generated identifiers, so this key can't be confused with a reference to another function
+			let key = rename_identifiers(&item.code, |identifier| (identifier == symbol).then_some("$"));
+			if let Some(canonical_symbol) = canonical.get(&key) {
+				renames.insert(symbol.clone(), String::clone(canonical_symbol));
+				folded.insert(index);
+			} else {
+				canonical.insert(key, symbol.clone());
+			}
+		}
+
+		if renames.is_empty() {
+			return folded.len();
+		}
+		for (index, item) in items.iter_mut().enumerate() {
+			if !folded.contains(&index) && identifiers(&item.code).any(|identifier| renames.contains_key(identifier)) {
+				item.code = rename_identifiers(&item.code, |identifier| renames.get(identifier).map(String::as_str));
+			}
+		}
+	}
+}
+
+/// Finds the items that are reachable from the root items, which are the items that are always part of the program, such as the statements of the C
+/// `main` function that have side effects. An item is reachable if it's a root or reachable code mentions one of its symbols, so an item that isn't reachable isn't referred to by anything in the
+/// program, and leaving it out can't change what the program does or stop it from compiling.
+///
+/// References are found in the transpiled C code of each item rather than in the AST it was transpiled from, because the C code is exactly what has to
+/// compile: Values that were resolved at compile-time, such as the methods of a group called directly, are only referred to by the C names that they
+/// were transpiled into. Each item's code is only searched once it becomes reachable, so this takes time linear in the size of the reachable code.
+///
+/// # Parameters
+/// - `items` - The items of the program.
+///
+/// # Returns
+/// Whether each item is reachable, in the same order as the given items.
+#[must_use]
+pub fn reachable_items(items: &[CItem]) -> Vec<bool> {
+	let mut definitions = HashMap::<&str, Vec<usize>>::new();
+	for (index, item) in items.iter().enumerate() {
+		for symbol in &item.symbols {
+			definitions.entry(symbol.as_str()).or_default().push(index);
+		}
+	}
+
+	let mut reachable = items.iter().map(|item| item.is_root).collect::<Vec<_>>();
+	let mut unvisited = (0..items.len()).filter(|index| reachable[*index]).collect::<Vec<_>>();
+	while let Some(item) = unvisited.pop().and_then(|index| items.get(index)) {
+		for identifier in identifiers(&item.code) {
+			for &index in definitions.get(identifier).into_iter().flatten() {
+				if !reachable[index] {
+					reachable[index] = true;
+					unvisited.push(index);
+				}
+			}
+		}
+	}
+
+	reachable
+}
+
+/// Returns descriptions of the items that were left out of a program because they weren't reachable (see `reachable_items()`), such as
+/// `function print_12`. These are listed in a comment in the generated C code, so that the removed items can be seen with `--emit-c`. Items that define
+/// the same first symbol, such as the `typedef` and the definition of a struct, are only listed once.
+///
+/// # Parameters
+/// - `items` - The items of the program.
+/// - `reachable` - Whether each item is reachable, as returned by `reachable_items()`.
+///
+/// # Returns
+/// The descriptions of the removed items, in the order of the items.
+#[must_use]
+pub fn removed_items(items: &[CItem], reachable: &[bool]) -> Vec<String> {
+	let mut listed = HashSet::new();
+	let mut removed = Vec::new();
+	for (item, _reachable) in items.iter().zip(reachable).filter(|(_item, is_reachable)| !**is_reachable) {
+		let symbol = item.symbols.first().map_or("", String::as_str);
+		if listed.insert(symbol) {
+			removed.push(format!("{} {symbol}", item.kind));
+		}
+	}
+	removed
+}
@@ -0,0 +1,660 @@
+use crate::{
+	compile_time::TranspileToC,
+	context::Context,
+	emitter::CWriter,
+	lexer::TokenType,
+	parser::{
+		expressions::{
+			literals::{
+				object::{InternalValue, Object},
+				Literal, LiteralValue,
+			},
+			util::name::Name,
+			Expression,
+		},
+		statements::Statement,
+	},
+};
+
+use std::{
+	collections::{HashMap, HashSet},
+	fmt::Write as _,
+};
+
+/// The C runtime for regions, which is written into the header of every program (see `Program::split_c()`). A region is a bump allocator made of
+/// a list of chunks: Allocating bumps a pointer into the newest chunk, and a new chunk at least twice the size of the last one is added when it runs out of
+/// space. Nothing in a region is freed individually; The whole region is freed at once when the scope that it belongs to ends.
+///
+/// Region variables are declared with `__attribute__((cleanup))`, so a region is freed however its scope is left, including by returning from the
+/// function. The generated C already relies on GNU C for statement expressions, so this doesn't add a new requirement on the C compiler.
+pub const REGION_RUNTIME: &str = r#"
+#define CABIN_REGION_ALIGNMENT 16
+#define CABIN_REGION_CHUNK_SIZE 4096
+
+typedef struct cabin_region_chunk {
+	struct cabin_region_chunk* previous;
+	size_t capacity;
+} cabin_region_chunk;
+
+typedef struct cabin_region {
+	char* cursor;
+	char* end;
+	cabin_region_chunk* chunks;
+} cabin_region;
+
+static cabin_region cabin_global_region = { 0 };
+
+static void* cabin_region_grow(cabin_region* region, size_t size) {
+	size_t capacity = region->chunks == NULL ? CABIN_REGION_CHUNK_SIZE : region->chunks->capacity * 2;
+	if (capacity < size) {
+		capacity = size;
+	}
+	cabin_region_chunk* chunk = malloc(sizeof(cabin_region_chunk) + capacity);
+	if (chunk == NULL) {
+		fprintf(stderr, "Error: Out of memory\n");
+		exit(1);
+	}
+	chunk->previous = region->chunks;
+	chunk->capacity = capacity;
+	region->chunks = chunk;
+	region->cursor = (char*) (chunk + 1) + size;
+	region->end = (char*) (chunk + 1) + capacity;
+	return chunk + 1;
+}
+
+static inline void* cabin_region_allocate(cabin_region* region, size_t size) {
+	size = (size + CABIN_REGION_ALIGNMENT - 1) & ~(size_t) (CABIN_REGION_ALIGNMENT - 1);
+	if ((size_t) (region->end - region->cursor) < size) {
+		return cabin_region_grow(region, size);
+	}
+	void* allocation = region->cursor;
+	region->cursor += size;
+	return allocation;
+}
+
+static inline void* cabin_region_copy(cabin_region* region, const void* value, size_t size) {
+	return memcpy(cabin_region_allocate(region, size), value, size);
+}
+
+static inline void cabin_region_free(cabin_region* region) {
+	while (region->chunks != NULL) {
+		cabin_region_chunk* previous = region->chunks->previous;
+		free(region->chunks);
+		region->chunks = previous;
+	}
+	region->cursor = NULL;
+	region->end = NULL;
+}
+
+#define cabin_allocate(region, ...) ((__typeof__(__VA_ARGS__)*) cabin_region_copy((region), &(__VA_ARGS__), sizeof(__VA_ARGS__)))
+"#;
+
+/// The C expression for the region that lives until the program exits. Values that escape every open region are allocated here.
+const GLOBAL_REGION: &str = "&cabin_global_region";
+
+/// The name of the last C parameter of every function that returns a value, which is the region that the caller allocates the return value in. Objects
+/// in a returned value are allocated here, so that they live as long as the value that the caller stores the result in.
+pub const RETURN_REGION: &str = "return_region";
+
+/// A region that objects can be allocated in.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub enum AllocationRegion {
+	/// The region that lives until the program exits.
+	#[default]
+	Global,
+	/// The region of the open scope with the given id.
+	Scope(usize),
+	/// The region that the caller of the function being transpiled passed for its return value (see `RETURN_REGION`).
+	Return,
+}
+
+/// A region that's open at the current point of transpilation.
+#[derive(Clone, Debug)]
+pub struct OpenRegion {
+	/// The id of the scope that this region belongs to. The region is freed when this scope ends.
+	scope_id: usize,
+	/// Whether anything has been allocated in this region. Regions that nothing is allocated in aren't declared in the C code at all.
+	used: bool,
+}
+
+/// Returns the name of the C variable that holds the region of the given scope.
+///
+/// # Parameters
+/// - `scope_id` - The id of the scope.
+///
+/// # Returns
+/// The name of the scope's region variable.
+fn region_variable(scope_id: usize) -> String {
+	format!("region_{scope_id}")
+}
+
+/// Writes C code that runs in a new region belonging to the given scope, such as the body of a block or function. Objects created by the code are
+/// allocated in the region unless they escape it (see `assignment_region()` and `argument_region()`), and the region is declared at the start of the code only if anything was
+/// allocated in it. The value of the scope escapes it, so the region that was current before is the scope's tail region (see `Context::tail_region`).
+///
+/// The code is written into a string first, because whether the region is needed is only known once it has been written.
+///
+/// # Parameters
+/// - `writer` - The writer to write the code to.
+/// - `context` - The global compiler context.
+/// - `scope_id` - The id of the scope that the region belongs to.
+/// - `write` - The function that writes the code, which is given a writer at the same indentation as `writer`.
+///
+/// # Errors
+/// If `write` returns an error, or the code couldn't be written.
+pub fn write_in_region(
+	writer: &mut CWriter<'_>,
+	context: &mut Context,
+	scope_id: usize,
+	write: impl FnOnce(&mut CWriter<'_>, &mut Context) -> anyhow::Result<()>,
+) -> anyhow::Result<()> {
+	context.open_regions.push(OpenRegion { scope_id, used: false });
+	let previous_allocation_region = std::mem::replace(&mut context.allocation_region, AllocationRegion::Scope(scope_id));
+	let previous_tail_region = std::mem::replace(&mut context.tail_region, previous_allocation_region);
+	let rendered = CWriter::render(|code_writer| write(code_writer, context));
+	context.allocation_region = previous_allocation_region;
+	context.tail_region = previous_tail_region;
+	let region = context.open_regions.pop().unwrap_or_else(|| unreachable!());
+
+	let code = rendered?;
+	if region.used {
+		writeln!(writer, "cabin_region {} __attribute__((cleanup(cabin_region_free))) = {{ 0 }};", region_variable(scope_id))?;
+	}
+	writer.write_str(&code)?;
+	Ok(())
+}
+
+/// Runs a function with objects being allocated in the given region.
+///
+/// # Parameters
+/// - `context` - The global compiler context.
+/// - `region` - The region to allocate objects in.
+/// - `function` - The function to run.
+///
+/// # Returns
+/// The value returned by `function`.
+pub fn allocating_in<T>(context: &mut Context, region: AllocationRegion, function: impl FnOnce(&mut Context) -> T) -> T {
+	let previous_allocation_region = std::mem::replace(&mut context.allocation_region, region);
+	let value = function(context);
+	context.allocation_region = previous_allocation_region;
+	value
+}
+
+/// Returns the region that values stored in the given scope are allocated in, which is the nearest open region of the scope itself or one of its
+/// ancestors, or the global region if there's none.
+///
+/// # Parameters
+/// - `scope_id` - The id of the scope.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The region of the scope.
+fn open_region_of(scope_id: usize, context: &Context) -> AllocationRegion {
+	let mut current = Some(scope_id);
+	while let Some(current_id) = current {
+		if context.open_regions.iter().any(|region| region.scope_id == current_id) {
+			return AllocationRegion::Scope(current_id);
+		}
+		current = context.scope_data.get_scope_from_id(current_id).and_then(|scope| scope.parent);
+	}
+	AllocationRegion::Global
+}
+
+/// Returns the region that a value assigned to the given target is allocated in. This is the escape analysis for assignments: A value assigned to a
+/// variable declared in an outer scope outlives the scope that it's created in, so it's allocated in the region of the variable's scope instead, and a
+/// value returned from a function through its return address is allocated in the region that the caller passed for it.
+///
+/// # Parameters
+/// - `target` - The left-hand side of the assignment.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The region to allocate the assigned value in, which is the global region if the value could be stored anywhere, such as when it's assigned to a field
+/// of an object.
+#[must_use]
+pub fn assignment_region(target: &Expression, context: &Context) -> AllocationRegion {
+	if let Expression::Literal(Literal(LiteralValue::VariableReference(variable), ..)) = target {
+		if variable.name() == &Name::from("return_address") {
+			return AllocationRegion::Return;
+		}
+	}
+	declaring_scope(target, context).map_or(AllocationRegion::Global, |scope_id| open_region_of(scope_id, context))
+}
+
+/// Returns the scope that the variable assigned to by an assignment is declared in.
+///
+/// # Parameters
+/// - `target` - The left-hand side of the assignment.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The id of the scope that the target variable is declared in, or `None` if the target isn't a variable.
+fn declaring_scope(target: &Expression, context: &Context) -> Option<usize> {
+	let Expression::Literal(Literal(LiteralValue::VariableReference(variable), ..)) = target else {
+		return None;
+	};
+
+	let mut current = Some(variable.scope_id());
+	while let Some(scope_id) = current {
+		let scope = context.scope_data.get_scope_from_id(scope_id)?;
+		if scope.get_variable_direct(variable.name()).is_some() {
+			return Some(scope_id);
+		}
+		current = scope.parent;
+	}
+	None
+}
+
+/// Writes a pointer to a value, for a place that stores the value by reference, such as a field of an object or an element of a list. Objects that are
+/// created in place are allocated in the current region, because the compound literal that C would otherwise create for them only lives until the end of
+/// the enclosing block. Other values, such as variables, functions, and Text constants, are referenced directly.
+///
+/// # Parameters
+/// - `value` - The value to write a pointer to.
+/// - `writer` - The writer to write the C code to.
+/// - `context` - The global compiler context.
+///
+/// # Errors
+/// If the value couldn't be transpiled.
+pub fn write_reference(value: &Expression, writer: &mut CWriter<'_>, context: &mut Context) -> anyhow::Result<()> {
+	// Text that's known at compile-time is a constant that lives as long as the program, so it's referenced rather than copied (see `TextConstants`)
+	let is_text_constant = matches!(value, Expression::Literal(Literal(LiteralValue::Object(object), ..)) if object.name == Name::from("Text"));
+	if is_text_constant || !matches!(value, Expression::Literal(Literal(LiteralValue::Object(_), ..))) {
+		writer.write_char('&')?;
+		return value.write_c(writer, context);
+	}
+
+	write!(writer, "cabin_allocate({}, ", allocation_region(context))?;
+	value.write_c(writer, context)?;
+	writer.write_char(')')?;
+	Ok(())
+}
+
+/// Returns a pointer to the region that objects are currently being allocated in (see `allocating_in()`), as a C expression, and marks the region
+/// as used so that it's declared.
+///
+/// # Parameters
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The C expression for a pointer to the current region.
+pub fn allocation_region(context: &mut Context) -> String {
+	region_to_c(context.allocation_region, context)
+}
+
+/// Returns a pointer to the region that the value of the innermost scope being transpiled is allocated in (see `Context::tail_region`), as a C
+/// expression, and marks the region as used so that it's declared. This is passed to calls as the region of their return value, since a call is
+/// lowered to a block whose value is the return value.
+///
+/// # Parameters
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The C expression for a pointer to the tail region.
+pub fn tail_region(context: &mut Context) -> String {
+	region_to_c(context.tail_region, context)
+}
+
+/// Returns a pointer to a region as a C expression, and marks the region as used so that it's declared.
+///
+/// # Parameters
+/// - `region` - The region.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The C expression for a pointer to the region.
+fn region_to_c(region: AllocationRegion, context: &mut Context) -> String {
+	match region {
+		AllocationRegion::Scope(scope_id) => {
+			if let Some(open_region) = context.open_regions.iter_mut().rev().find(|region| region.scope_id == scope_id) {
+				open_region.used = true;
+			}
+			format!("&{}", region_variable(scope_id))
+		},
+		AllocationRegion::Return => RETURN_REGION.to_owned(),
+		AllocationRegion::Global => GLOBAL_REGION.to_owned(),
+	}
+}
+
+/// How far a parameter of a function can escape the call, which decides the region that the caller allocates the argument for it in (see
+/// `argument_region()`). The variants are ordered from the least to the most escaping.
+#[derive(Clone, Copy, Debug, PartialEq, Eq, PartialOrd, Ord)]
+pub enum ParameterEscape {
+	/// The parameter is only used during the call, so the argument can be allocated in the caller's innermost region.
+	None,
+	/// The parameter can be part of the return value, so the argument has to live as long as the return value does.
+	Returned,
+	/// The parameter can be stored somewhere that outlives the call, such as a global variable or a list, so the argument has to live until the program
+	/// exits.
+	Stored,
+}
+
+/// Returns the region that an argument of a call is allocated in. This is the caller's innermost region, unless the escape analysis of the callee's body
+/// finds that the callee can return the argument, in which case it's allocated where the return value is, or store it, in which case it's allocated in
+/// the global region. Parameters that weren't analyzed (see `parameter_escapes()`) are treated as stored.
+///
+/// # Parameters
+/// - `function_id` - The id of the called function.
+/// - `index` - The index of the parameter that the argument is for.
+/// - `result_region` - The region that the return value of the call is allocated in.
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// The region to allocate the argument in.
+#[must_use]
+pub fn argument_region(function_id: usize, index: usize, result_region: AllocationRegion, context: &Context) -> AllocationRegion {
+	match context.parameter_escapes.get(&(function_id, index)).copied().unwrap_or(ParameterEscape::Stored) {
+		ParameterEscape::None => context.allocation_region,
+		ParameterEscape::Returned => result_region,
+		ParameterEscape::Stored => AllocationRegion::Global,
+	}
+}
+
+/// Runs the escape analysis on every parameter of every function declared in the program, which is done once before the program is transpiled and
+/// stored in `Context::parameter_escapes` for `argument_region()` to look up.
+///
+/// # Parameters
+/// - `context` - The global compiler context.
+///
+/// # Returns
+/// How far each parameter can escape a call to its function, keyed by function id and parameter index.
+#[must_use]
+pub fn parameter_escapes(context: &Context) -> HashMap<(usize, usize), ParameterEscape> {
+	let mut analysis = EscapeAnalysis::new(context);
+	for function in context.function_declarations.iter() {
+		for index in 0..function.parameters.len() {
+			analysis.parameter(function.id, index);
+		}
+	}
+	analysis.results
+}
+
+/// The escape analysis of the parameters of functions. A parameter escapes if its value, or any value that might contain it, reaches the function's
+/// return value or a place that outlives the call. Values are tracked through the local variables that they're assigned to, and through the parameters of
+/// the functions that they're passed to. The analysis is conservative: Anything that it can't follow, such as a call to a function that isn't known when
+/// transpiling, or recursion, is treated as storing the value.
+struct EscapeAnalysis<'context> {
+	/// The global compiler context, which holds the declarations of the program's functions.
+	context: &'context Context,
+	/// The results for the parameters that have been analyzed, keyed by function id and parameter index.
+	results: HashMap<(usize, usize), ParameterEscape>,
+	/// The parameters that are currently being analyzed, which are treated as stored if they're reached again through recursion.
+	in_progress: HashSet<(usize, usize)>,
+}
+
+impl<'context> EscapeAnalysis<'context> {
+	/// Creates a new escape analysis.
+	///
+	/// # Parameters
+	/// - `context` - The global compiler context.
+	fn new(context: &'context Context) -> Self {
+		Self {
+			context,
+			results: HashMap::new(),
+			in_progress: HashSet::new(),
+		}
+	}
+
+	/// Returns how far a parameter of a function can escape a call to it.
+	///
+	/// # Parameters
+	/// - `function_id` - The id of the function's instance.
+	/// - `index` - The index of the parameter.
+	///
+	/// # Returns
+	/// How far the parameter can escape.
+	fn parameter(&mut self, function_id: usize, index: usize) -> ParameterEscape {
+		if let Some(result) = self.results.get(&(function_id, index)) {
+			return *result;
+		}
+		if !self.in_progress.insert((function_id, index)) {
+			return ParameterEscape::Stored;
+		}
+
+		let context = self.context;
+		let result = match context.function_declarations.iter().find(|function| function.id == function_id) {
+			Some(function) => match (function.builtin_name(), &function.body, function.parameters.get(index)) {
+				// Builtins that add a value to a list store it
+				(Some(builtin), ..) => {
+					if matches!(builtin.as_str(), "List.append" | "List.prepend" | "List.set") {
+						ParameterEscape::Stored
+					} else {
+						ParameterEscape::None
+					}
+				},
+				(None, Some(body), Some((name, _type))) => {
+					let mut aliases = HashSet::from([*name]);
+					let mut escape = ParameterEscape::None;
+
+					// Aliases found later in the body can flow into statements before them through loops, so the body is analyzed until no new aliases
+					// are found
+					loop {
+						let alias_count = aliases.len();
+						escape = escape.max(self.statements(body, function.inner_scope_id, &mut aliases, true));
+						if escape == ParameterEscape::Stored || aliases.len() == alias_count {
+							break;
+						}
+					}
+					escape
+				},
+				_ => ParameterEscape::Stored,
+			},
+			None => ParameterEscape::Stored,
+		};
+
+		self.in_progress.remove(&(function_id, index));
+		self.results.insert((function_id, index), result);
+		result
+	}
+
+	/// Returns how far the values in `aliases` can escape through a list of statements, and adds the local variables that they're assigned to to
+	/// `aliases`.
+	///
+	/// # Parameters
+	/// - `statements` - The statements.
+	/// - `function_scope` - The id of the inner scope of the function being analyzed.
+	/// - `aliases` - The variables that can hold the analyzed value.
+	/// - `is_function_body` - Whether the statements are the body of the function itself, whose tail is its return value.
+	///
+	/// # Returns
+	/// How far the values can escape.
+	fn statements(&mut self, statements: &[Statement], function_scope: Option<usize>, aliases: &mut HashSet<Name>, is_function_body: bool) -> ParameterEscape {
+		let mut escape = ParameterEscape::None;
+		for statement in statements {
+			escape = escape.max(match statement {
+				Statement::Declaration(declaration) => {
+					if mentions(&declaration.initial_value, aliases) {
+						aliases.insert(declaration.name);
+					}
+					self.expression(&declaration.initial_value, function_scope, aliases)
+				},
+				Statement::Expression(expression) => self.expression(expression, function_scope, aliases),
+				Statement::Tail(tail) => {
+					let returned = if is_function_body && mentions(&tail.expression, aliases) {
+						ParameterEscape::Returned
+					} else {
+						ParameterEscape::None
+					};
+					returned.max(self.expression(&tail.expression, function_scope, aliases))
+				},
+				Statement::ReturnStatement(return_statement) => match &return_statement.expression {
+					Some(expression) if mentions(expression, aliases) => ParameterEscape::Returned.max(self.expression(expression, function_scope, aliases)),
+					Some(expression) => self.expression(expression, function_scope, aliases),
+					None => ParameterEscape::None,
+				},
+				Statement::WhileLoop(while_loop) => self
+					.expression(&while_loop.condition, function_scope, aliases)
+					.max(self.statements(&while_loop.body.statements, function_scope, aliases, false)),
+				Statement::ForEachLoop(foreach) => {
+					if mentions(&foreach.iterator, aliases) {
+						aliases.insert(foreach.name);
+					}
+					self.expression(&foreach.iterator, function_scope, aliases)
+						.max(self.statements(&foreach.body.statements, function_scope, aliases, false))
+				},
+			});
+			if escape == ParameterEscape::Stored {
+				break;
+			}
+		}
+		escape
+	}
+
+	/// Returns how far the values in `aliases` can escape through an expression, and adds the local variables that they're assigned to to `aliases`.
+	///
+	/// # Parameters
+	/// - `expression` - The expression.
+	/// - `function_scope` - The id of the inner scope of the function being analyzed.
+	/// - `aliases` - The variables that can hold the analyzed value.
+	///
+	/// # Returns
+	/// How far the values can escape.
+	fn expression(&mut self, expression: &Expression, function_scope: Option<usize>, aliases: &mut HashSet<Name>) -> ParameterEscape {
+		match expression {
+			Expression::Literal(Literal(LiteralValue::Object(object), ..)) => {
+				let mut escape = ParameterEscape::None;
+				for value in object.fields.iter().filter_map(|field| field.value.as_ref()).chain(list_elements(object)) {
+					escape = escape.max(self.expression(value, function_scope, aliases));
+				}
+				escape
+			},
+			Expression::Literal(_) => ParameterEscape::None,
+			Expression::BinaryExpression(binary) if binary.operator == TokenType::Equal => {
+				let assigned = if mentions(&binary.right, aliases) {
+					self.assignment(&binary.left, function_scope, aliases)
+				} else {
+					ParameterEscape::None
+				};
+				assigned.max(self.expression(&binary.right, function_scope, aliases))
+			},
+			Expression::BinaryExpression(binary) => self.expression(&binary.left, function_scope, aliases).max(self.expression(&binary.right, function_scope, aliases)),
+			Expression::FunctionCall(call) => {
+				let mut escape = self.expression(&call.function, function_scope, aliases);
+				let callee = match &call.function {
+					Expression::Literal(Literal(LiteralValue::FunctionDeclaration(function), ..)) => Some(function.id),
+					_ => None,
+				};
+				for (index, argument) in call.arguments.iter().enumerate() {
+					if mentions(argument, aliases) {
+						escape = escape.max(callee.map_or(ParameterEscape::Stored, |function_id| match self.parameter(function_id, index) {
+							// A value returned from a call is part of the call's value, which is followed by the expression that uses it
+							ParameterEscape::Returned => ParameterEscape::None,
+							other => other,
+						}));
+					}
+					escape = escape.max(self.expression(argument, function_scope, aliases));
+				}
+				if callee.is_none() && mentions(&call.function, aliases) {
+					escape = ParameterEscape::Stored;
+				}
+				escape
+			},
+			Expression::IfStatement(if_expression) => self
+				.expression(&if_expression.condition, function_scope, aliases)
+				.max(self.statements(&if_expression.body, function_scope, aliases, false))
+				.max(if_expression.else_body.as_ref().map_or(ParameterEscape::None, |else_body| self.statements(else_body, function_scope, aliases, false))),
+			Expression::Run(run) => self.expression(&run.expression, function_scope, aliases),
+			Expression::Block(block) => self.statements(&block.statements, function_scope, aliases, false),
+		}
+	}
+
+	/// Returns how far a value escapes by being assigned to the given target. A value assigned to a local variable of the function is tracked through
+	/// the variable, a value assigned to its return address is returned, and a value assigned anywhere else is stored.
+	///
+	/// # Parameters
+	/// - `target` - The left-hand side of the assignment.
+	/// - `function_scope` - The id of the inner scope of the function being analyzed.
+	/// - `aliases` - The variables that can hold the analyzed value.
+	///
+	/// # Returns
+	/// How far the assigned value escapes.
+	fn assignment(&self, target: &Expression, function_scope: Option<usize>, aliases: &mut HashSet<Name>) -> ParameterEscape {
+		let Expression::Literal(Literal(LiteralValue::VariableReference(variable), ..)) = target else {
+			return ParameterEscape::Stored;
+		};
+		if variable.name() == &Name::from("return_address") {
+			return ParameterEscape::Returned;
+		}
+
+		let is_local = declaring_scope(target, self.context).is_some_and(|declared_scope| {
+			let mut current = Some(declared_scope);
+			while let Some(scope_id) = current {
+				if Some(scope_id) == function_scope {
+					return true;
+				}
+				current = self.context.scope_data.get_scope_from_id(scope_id).and_then(|scope| scope.parent);
+			}
+			false
+		});
+		if is_local {
+			aliases.insert(*variable.name());
+			ParameterEscape::None
+		} else {
+			ParameterEscape::Stored
+		}
+	}
+}
+
+/// Returns the elements of an object if it's a list literal.
+///
+/// # Parameters
+/// - `object` - The object.
+///
+/// # Returns
+/// The elements of the list, which is empty if the object isn't a list.
+fn list_elements(object: &Object) -> impl Iterator<Item = &Expression> {
+	match object.get_internal_field("data") {
+		Some(InternalValue::List(elements)) => elements.as_slice(),
+		_ => &[],
+	}
+	.iter()
+}
+
+/// Returns whether an expression refers to any of the given variables anywhere inside of it, other than inside of nested function declarations.
+///
+/// # Parameters
+/// - `expression` - The expression.
+/// - `names` - The names of the variables.
+///
+/// # Returns
+/// Whether the expression refers to any of the variables.
+fn mentions(expression: &Expression, names: &HashSet<Name>) -> bool {
+	match expression {
+		Expression::Literal(Literal(LiteralValue::VariableReference(variable), ..)) => names.contains(variable.name()),
+		Expression::Literal(Literal(LiteralValue::Object(object), ..)) => object
+			.fields
+			.iter()
+			.filter_map(|field| field.value.as_ref())
+			.chain(list_elements(object))
+			.any(|value| mentions(value, names)),
+		Expression::Literal(_) => false,
+		Expression::BinaryExpression(binary) => mentions(&binary.left, names) || mentions(&binary.right, names),
+		Expression::FunctionCall(call) => mentions(&call.function, names) || call.arguments.iter().any(|argument| mentions(argument, names)),
+		Expression::IfStatement(if_expression) => {
+			mentions(&if_expression.condition, names)
+				|| statements_mention(&if_expression.body, names)
+				|| if_expression.else_body.as_ref().is_some_and(|else_body| statements_mention(else_body, names))
+		},
+		Expression::Run(run) => mentions(&run.expression, names),
+		Expression::Block(block) => statements_mention(&block.statements, names),
+	}
+}
+
+/// Returns whether a list of statements refers to any of the given variables anywhere inside of it (see `mentions()`).
+///
+/// # Parameters
+/// - `statements` - The statements.
+/// - `names` - The names of the variables.
+///
+/// # Returns
+/// Whether the statements refer to any of the variables.
+fn statements_mention(statements: &[Statement], names: &HashSet<Name>) -> bool {
+	statements.iter().any(|statement| match statement {
+		Statement::Declaration(declaration) => mentions(&declaration.initial_value, names),
+		Statement::Expression(expression) => mentions(expression, names),
+		Statement::Tail(tail) => mentions(&tail.expression, names),
+		Statement::ReturnStatement(return_statement) => return_statement.expression.as_ref().is_some_and(|expression| mentions(expression, names)),
+		Statement::WhileLoop(while_loop) => mentions(&while_loop.condition, names) || statements_mention(&while_loop.body.statements, names),
+		Statement::ForEachLoop(foreach) => mentions(&foreach.iterator, names) || statements_mention(&foreach.body.statements, names),
+	})
+}
@@ -3,7 +3,7 @@ use crate::parser::expressions::{
 	Expression,
 };
 
-use std::{collections::HashMap, fmt::Debug};
+use std::{collections::HashMap, fmt::Debug, sync::Arc};
 
 #[derive(Clone, Debug)]
 /// Information about a variable declaration
@@ -20,7 +20,7 @@ pub struct DeclarationData {
 
 /// A type of scope in the language. Currently, this is only used for debugging purposes, as scopes are able to be printed as a string representation,
 /// and doing so will show their type. However, in the future, this may be used for other purposes, so it's good to leave here regardless
-#[derive(Debug)]
+#[derive(Debug, Clone)]
 pub enum ScopeType {
 	/// The function declaration scope type. This is used for the body of a function declaration. Note that this is not in any way related to a scope that
 	/// a function is declared in, but represents the scope *inside* of a function's body.
@@ -42,6 +42,7 @@ pub enum ScopeType {
 /// meaning that this scope also inherits variables from its parent. One important thing to note is that Cabin doesn't support any kind of shadowing -
 /// meaning globally declared variables are available in *every* scope. No matter what scope you're in, you can be 100% certain there is a `String`
 /// variable defined, and that it is exactly what you expect it to be. This is important for resolving things like `Boolean`s.
+#[derive(Clone)]
 pub struct Scope {
 	/// The index of the scope which is the parent to this one. This is the scope's direct parent, i.e., the scope in which this one is declared in. This
 	/// is represented as an index into a `ScopeData`'s `scopes` vector, because trying to create a tree data structure in Rust with regular semantics
@@ -62,9 +63,13 @@ pub struct Scope {
 
 	/// The variables declared in this scope. Note that this only holds the variables declared in this exact specific scope, and does not count the
 	/// variables declared in any parent scope, even though those are accessible in the language from this one. To get a variable from anywhere up
-	/// the parent tree, use `scope.get_variable`, which will traverse up the scope tree and check all parents.
+	/// the parent tree, use `ScopeData::get_variable`, which will resolve the variable in this scope or any of its parents.
 	variables: HashMap<Name, DeclarationData>,
 
+	/// The number of ancestors this scope has; The global scope has a depth of 0, its children have a depth of 1, and so on. This is used by `ScopeData` to
+	/// check whether one scope is an ancestor of another without walking the parent chain any further than it has to.
+	depth: usize,
+
 	/// The index of this scope. This is represented as an index into a `ScopeData`'s `scopes` vector, because trying to create a tree data structure
 	/// in Rust with regular semantics can get *really* tricky - You need to either resort to lots of unsafe code with raw pointers (and probably pinning),
 	/// or use some fancy reference counting wrappers like `Rc<RefCell<Scope>>` and `Weak<RefCell<Scope>>`. Even in doing so, the implementation is not
@@ -77,9 +82,15 @@ pub struct Scope {
 }
 
 impl Scope {
+	/// Returns the number of ancestors this scope has. The global scope has a depth of 0, its children have a depth of 1, and so on.
+	#[must_use]
+	pub const fn depth(&self) -> usize {
+		self.depth
+	}
+
 	/// Returns the information about a variable declared in this scope with the given name. Note that this only checks variables declared exactly
 	/// in this scope, and does not check parents of this scope, meaning this cannot give accurate information about whether a variable exists in
-	/// the current scope; To get a variable from the current scope, use `get_variable()`, which traverses up the scope tree and recursively checks parents.
+	/// the current scope; To get a variable from the current scope, use `ScopeData::get_variable()`, which also checks the parents of the scope.
 	///
 	/// # Parameters
 	/// - `name` - The name of the variable declared in this scope to get information about
@@ -92,26 +103,6 @@ impl Scope {
 		self.variables.get(name)
 	}
 
-	/// Returns the information about a variable that exists in this scope with the given name. Note that this will also traverse up the scope tree and check
-	/// parent scopes for a variable with the given name if this scope doesn't have a variable with the given name. To get information about a variable that
-	/// was declared specifically in this scope, use `get_variable_direct()`. If the function traverses all the way to the global scope and the variable is
-	/// not found, `None` is returned.
-	///
-	/// # Parameters
-	/// - `<'scopes>` - The lifetime of the scopes slice passed. The returned declaration reference will have this lifetime.
-	/// - `name` - The name of the variable that exists in this scope to get information about
-	/// - `scopes` - The scope tree as an area vector slice; This is passed from a `ScopeData` object.
-	///
-	/// # Returns
-	/// A reference to the declaration data of the variable that exists in this scope with the given name. If none exists, `None` is returned. If it does exist
-	/// and `Some` is returned, the returned reference will have the same lifetime as this `Scope` object, as well as the given scopes slice.
-	#[must_use]
-	pub fn get_variable<'scopes>(&'scopes self, name: &Name, scopes: &'scopes [Self]) -> Option<&DeclarationData> {
-		self.variables
-			.get(name)
-			.or_else(|| self.parent.and_then(|parent| scopes.get(parent).unwrap().get_variable(name, scopes)))
-	}
-
 	/// Returns all variables that are available in this scope, including variables declared in ancestor scopes.
 	/// This traverses up the scope tree up to and including the global scope, and returns all variables declared
 	/// in those scopes.
@@ -122,17 +113,9 @@ impl Scope {
 	/// - `scopes` - The slice of scopes available from a `ScopeData` object.
 	///
 	/// # Returns
-	/// All variables that exist in this scope, including those declared in ancestor scopes.
-	#[must_use]
-	pub fn get_variables<'scopes>(&'scopes self, scopes: &'scopes [Self]) -> Vec<(&'scopes Name, &'scopes DeclarationData)> {
-		let mut variables = self.variables.iter().collect::<Vec<_>>();
-		if let Some(parent) = self.parent {
-			for variable in scopes.get(parent).unwrap().get_variables(scopes) {
-				variables.push(variable);
-			}
-		}
-
-		variables
+	/// An iterator over all variables that exist in this scope, including those declared in ancestor scopes, from the innermost scope outwards.
+	pub fn get_variables<'scopes>(&'scopes self, scopes: &'scopes [Self]) -> impl Iterator<Item = (&'scopes Name, &'scopes DeclarationData)> {
+		std::iter::successors(Some(self), |scope| scope.parent.and_then(|parent| scopes.get(parent))).flat_map(|scope| scope.variables.iter())
 	}
 
 	/// Reassigns a variable in this scope. This will NOT traverse up the scope tree through the current scope's parents to find the declaration for the given
@@ -145,8 +128,8 @@ impl Scope {
 	///
 	/// # Returns
 	/// An `Err` if no variable with the given name exists in the current scope.
-	fn reassign_variable_direct(&mut self, name: &Name, value: Expression) -> Result<(), Expression> {
-		if let Some(variable) = self.variables.get_mut(name) {
+	fn reassign_variable_direct(&mut self, name: Name, value: Expression) -> Result<(), Expression> {
+		if let Some(variable) = self.variables.get_mut(&name) {
 			variable.value = Some(value);
 			Ok(())
 		} else {
@@ -199,11 +182,21 @@ impl Scope {
 /// destroyed or removed, so their indices act as permanent unique IDs.
 ///
 /// This acts simply as a wrapper around the scope arena vector, as well as keeping track of the current scope, be it during parsing, compile-time, etc.
+#[derive(Clone)]
 pub struct ScopeData {
-	/// The arena of scopes stored as a flat vector. For more information, see the documentation on the `ScopeData` struct.
-	scopes: Vec<Scope>,
+	/// The arena of scopes stored as a flat vector. For more information, see the documentation on the `ScopeData` struct. This is shared between clones of
+	/// the scope data until one of them changes it, so the copies of the context that the program is transpiled with on other threads don't copy every
+	/// scope (see `Context::fork()`).
+	scopes: Arc<Vec<Scope>>,
 	/// The id of the current scope. This is guaranteed to always point to a valid scope, and by default is the global scope.
 	current_scope: usize,
+	/// The id of the only scope that declares a variable with each name, or `None` if more than one scope declares it. Because Cabin doesn't allow
+	/// shadowing, most names are declared in only a single scope, so resolving them is a single hash lookup followed by a check that the declaring scope is
+	/// an ancestor of the scope the variable is referenced from. Names declared in several scopes, such as the parameters of a function, which are declared
+	/// again in a new scope on every call, are resolved by walking up the parent chain instead, so resolving them doesn't get slower with each call. This is
+	/// kept in sync with the variables of each scope by `declare_new_variable_from_id()`, which is the only way variables are added.
+	/// This is shared between clones like `scopes`.
+	bindings: Arc<HashMap<Name, Option<usize>>>,
 }
 
 impl ScopeData {
@@ -215,14 +208,16 @@ impl ScopeData {
 	#[must_use]
 	pub fn global() -> Self {
 		Self {
-			scopes: vec![Scope {
+			scopes: Arc::new(vec![Scope {
 				scope_type: ScopeType::Global,
 				index: 0,
+				depth: 0,
 				children: Vec::new(),
 				variables: HashMap::new(),
 				parent: None,
-			}],
+			}]),
 			current_scope: 0,
+			bindings: Arc::default(),
 		}
 	}
 
@@ -241,7 +236,7 @@ impl ScopeData {
 	/// # Returns
 	/// A mutable reference to the current scope
 	fn current_mut(&mut self) -> &mut Scope {
-		self.scopes.get_mut(self.current_scope).unwrap()
+		Arc::make_mut(&mut self.scopes).get_mut(self.current_scope).unwrap()
 	}
 
 	/// Returns a reference to the scope with the given id. If none exists, `None` is returned. This is `O(1)`.
@@ -256,6 +251,59 @@ impl ScopeData {
 		self.scopes.get(id)
 	}
 
+	/// Returns whether the scope with the given id `ancestor` is the scope with the given id `descendant` or one of its ancestors. This only walks up from the
+	/// descendant until it reaches the depth of the ancestor, so checking against the global scope is `O(1)`.
+	///
+	/// # Parameters
+	/// - `ancestor` - The id of the scope that may be an ancestor
+	/// - `descendant` - The id of the scope that may be a descendant
+	///
+	/// # Returns
+	/// Whether `ancestor` is `descendant` or one of its ancestors. If either id doesn't point to a valid scope, `false` is returned.
+	fn is_ancestor_or_self(&self, ancestor: usize, descendant: usize) -> bool {
+		let Some(ancestor_depth) = self.scopes.get(ancestor).map(|scope| scope.depth) else {
+			return false;
+		};
+
+		let mut current = descendant;
+		while let Some(scope) = self.scopes.get(current) {
+			if scope.depth <= ancestor_depth {
+				return current == ancestor;
+			}
+			let Some(parent) = scope.parent else {
+				return false;
+			};
+			current = parent;
+		}
+
+		false
+	}
+
+	/// Returns the id of the scope that declares the variable with the given name that's visible from the scope with the given id. This is the closest scope
+	/// up the scope tree from the given scope that declares a variable with the given name, which is found using the `bindings` index instead of checking
+	/// each scope up the tree when only one scope declares the name.
+	///
+	/// # Parameters
+	/// - `name` - The name of the variable to resolve
+	/// - `id` - The id of the scope the variable is referenced from
+	///
+	/// # Returns
+	/// The id of the scope that declares the variable, or `None` if no variable with the given name exists in the scope with the given id.
+	fn resolve(&self, name: Name, id: usize) -> Option<usize> {
+		if let Some(declaring_scope) = *self.bindings.get(&name)? {
+			return self.is_ancestor_or_self(declaring_scope, id).then_some(declaring_scope);
+		}
+
+		let mut current = Some(id);
+		while let Some(scope) = current.and_then(|scope_id| self.scopes.get(scope_id)) {
+			if scope.variables.contains_key(&name) {
+				return Some(scope.index);
+			}
+			current = scope.parent;
+		}
+		None
+	}
+
 	/// Returns the declaration information about a variable that exists in the current scope. The variable may be declared in this scope, or any one of its parents;
 	/// As long as it exists in the current scope, the information will be retrieved. If no variable exists in the current scope with the given name,
 	/// `None` is returned.
@@ -267,7 +315,7 @@ impl ScopeData {
 	/// A reference to the variable declaration, or `None` if the variable does not exist in the current scope.
 	#[must_use]
 	pub fn get_variable(&self, name: &Name) -> Option<&DeclarationData> {
-		self.current().get_variable(name, &self.scopes)
+		self.get_variable_from_id(name, self.current_scope)
 	}
 
 	/// Returns the declaration information about a variable that exists in the scope with the given id. The variable may be declared in this scope, or any one
@@ -281,7 +329,9 @@ impl ScopeData {
 	/// A reference to the variable declaration, or `None` if the variable does not exist in the current scope.
 	#[must_use]
 	pub fn get_variable_from_id(&self, name: &Name, id: usize) -> Option<&DeclarationData> {
-		self.get_scope_from_id(id).and_then(|scope| scope.get_variable(name, &self.scopes))
+		self.resolve(*name, id)
+			.and_then(|declaring_scope| self.get_scope_from_id(declaring_scope))
+			.and_then(|scope| scope.get_variable_direct(name))
 	}
 
 	/// Enters a new scope. This creates a new scope with the given scope type, and sets the current scope to be that one. The newly created scope is added
@@ -290,9 +340,11 @@ impl ScopeData {
 	/// # Parameters
 	/// - `scope_type` - The type of the scope. For now, this is only used for debugging purposes, but in the future may be used for other things.
 	pub fn enter_new_scope(&mut self, scope_type: ScopeType) {
-		self.scopes.push(Scope {
+		let depth = self.current().depth + 1;
+		Arc::make_mut(&mut self.scopes).push(Scope {
 			variables: HashMap::new(),
 			index: self.scopes.len(),
+			depth,
 			parent: Some(self.current_scope),
 			children: Vec::new(),
 			scope_type,
@@ -352,16 +404,20 @@ impl ScopeData {
 	/// # Returns
 	/// An error if a variable already exists with the given name in the scope with the given id.
 	pub fn declare_new_variable_from_id(&mut self, name: Name, type_annotation: Option<Expression>, value: Expression, tags: TagList, id: usize) -> anyhow::Result<()> {
-		let mut current = Some(self.current_scope);
-		while let Some(current_index) = current {
-			if let Some(variable) = self.scopes.get_mut(current_index).unwrap().get_variable_direct(&name) {
-				anyhow::bail!("\nError declaring new variable \"{name}\": The variable \"{name}\" already exists in the current scope, and Cabin doesn't allow shadowing\nThe variable is described as follows: {variable:?}", name = name.cabin_name());
-			}
-			current = self.scopes.get(current_index).unwrap().parent;
+		if let Some(variable) = self.get_variable(&name) {
+			anyhow::bail!("\nError declaring new variable \"{name}\": The variable \"{name}\" already exists in the current scope, and Cabin doesn't allow shadowing\nThe variable is described as follows: {variable:?}", name = name.cabin_name());
 		}
 
-		self.scopes.get_mut(id).unwrap().variables.insert(
-			name.clone(),
+		Arc::make_mut(&mut self.bindings)
+			.entry(name)
+			.and_modify(|declaring_scope| {
+				if *declaring_scope != Some(id) {
+					*declaring_scope = None;
+				}
+			})
+			.or_insert(Some(id));
+		Arc::make_mut(&mut self.scopes).get_mut(id).unwrap().variables.insert(
+			name,
 			DeclarationData {
 				name,
 				type_annotation,
@@ -400,8 +456,8 @@ impl ScopeData {
 		current
 	}
 
-	/// Reassigns a variable in the scope with the given id. This will traverse up the scope tree through the scope's parents to find the declaration for the given
-	/// variable name, and reassign the value. This is only to be used to reassign an existing variable. To add a new variable, use `add_variable()`. To
+	/// Reassigns a variable in the scope with the given id. This will find the declaration for the given variable name in the scope or any of its parents,
+	/// and reassign the value. This is only to be used to reassign an existing variable. To add a new variable, use `add_variable()`. To
 	/// reassign a variable declared in the current scope, use `reassign_variable()`. If the function traverses all the way into the global scope
 	/// and no variable with the given name is found, an error is returned.
 	///
@@ -412,16 +468,12 @@ impl ScopeData {
 	///
 	/// # Returns
 	/// An `Err` if no variable with the given name exists in the current scope.
-	pub fn reassign_variable_from_id(&mut self, name: &Name, mut value: Expression, id: usize) -> anyhow::Result<()> {
-		// Traverse up the parent tree looking for the declaration and reassign it
-		let mut current = Some(id);
-		while let Some(current_index) = current {
-			// If we find it, we're done (return Ok), if not, we continue
-			match self.scopes.get_mut(current_index).unwrap().reassign_variable_direct(name, value) {
-				Ok(()) => return Ok(()),
-				Err(returned_value) => value = returned_value,
+	pub fn reassign_variable_from_id(&mut self, name: &Name, value: Expression, id: usize) -> anyhow::Result<()> {
+		// Find the scope that declares the variable and reassign it there
+		if let Some(declaring_scope) = self.resolve(*name, id) {
+			if Arc::make_mut(&mut self.scopes).get_mut(declaring_scope).unwrap().reassign_variable_direct(*name, value).is_ok() {
+				return Ok(());
 			}
-			current = self.scopes.get(current_index).unwrap().parent;
 		}
 
 		// No variable found
@@ -431,6 +483,37 @@ impl ScopeData {
 		);
 	}
 
+	/// Marks the value of a variable in the scope with the given id as unknown at compile-time, such as after it's assigned a value that's only known at
+	/// runtime. Code evaluated at compile-time afterwards then treats the variable like a parameter instead of using the value it held before. A variable
+	/// without a type annotation is given the given type, so that its type is still known once its value isn't.
+	///
+	/// # Parameters
+	/// - `name` - The name of the variable. A variable with this name must exist in the scope with the given id, otherwise, an `Err` will be returned.
+	/// - `value_type` - The type of the variable's previous value, or `None` if it isn't known.
+	/// - `unknown` - The value that's unknown at compile-time (see `Context::unknown_at_compile_time()`).
+	/// - `id` - The id of the scope that the variable is referenced from.
+	///
+	/// # Returns
+	/// An `Err` if no variable with the given name exists in the scope with the given id.
+	pub fn forget_variable_value_from_id(&mut self, name: &Name, value_type: Option<Expression>, unknown: Expression, id: usize) -> anyhow::Result<()> {
+		let Some(variable) = self
+			.resolve(*name, id)
+			.and_then(|declaring_scope| Arc::make_mut(&mut self.scopes).get_mut(declaring_scope))
+			.and_then(|scope| scope.variables.get_mut(name))
+		else {
+			anyhow::bail!(
+				"Error forgetting the value of variable \"{name}\": No variable with the name \"{name}\" exists in this scope",
+				name = name.cabin_name()
+			);
+		};
+
+		if variable.type_annotation.is_none() {
+			variable.type_annotation = value_type;
+		}
+		variable.value = Some(unknown);
+		Ok(())
+	}
+
 	/// Reassigns a variable in the current scope. This will traverse up the scope tree through the current scope's parents to find the declaration for the given
 	/// variable name, and reassign the value. This is only to be used to reassign an existing variable. To add a new variable, use `add_variable()`. To
 	/// reassign a variable declared in this specific scope, use `reassign_variable_from_id()`. If the function traverses all the way into the global scope
@@ -447,14 +530,24 @@ impl ScopeData {
 		self.reassign_variable_from_id(name, value, self.current_scope)
 	}
 
-	/// Returns the variables in the current scope which have the closest names to the given name. This is
-	/// used by the compiler to suggest variables with close names when the user attempts to reference a variable
-	/// that can't be found.
+	/// Returns whether the variable with the given name, as seen from the scope with the given id, is declared in the global scope.
+	///
+	/// # Parameters
+	/// - `name` - The name of the variable.
+	/// - `id` - The id of the scope that the variable is referenced from.
 	///
 	/// # Returns
-	/// a sorted list, which are sorted by how close they are to the given variable name.
+	/// Whether the variable is a global variable. If no variable with the given name exists in the scope, `false` is returned.
 	#[must_use]
-	pub fn get_variables(&self) -> Vec<(&Name, &DeclarationData)> {
+	pub fn is_global_variable(&self, name: &Name, id: usize) -> bool {
+		self.resolve(*name, id) == Some(0)
+	}
+
+	/// Returns all variables that are available in the current scope, including variables declared in ancestor scopes (see `Scope::get_variables()`).
+	///
+	/// # Returns
+	/// An iterator over the variables, from the innermost scope outwards.
+	pub fn get_variables(&self) -> impl Iterator<Item = (&Name, &DeclarationData)> {
 		self.current().get_variables(&self.scopes)
 	}
 
@@ -471,14 +564,10 @@ impl ScopeData {
 	/// name.
 	#[must_use]
 	pub fn get_closest_variables(&self, name: &Name, max: usize) -> Vec<(&Name, &DeclarationData)> {
-		let mut all_variables = self.get_variables();
-		all_variables.sort_by(|(first, _), (second, _)| first.cabin_name().distance_to(&name.cabin_name()).cmp(&second.cabin_name().distance_to(&name.cabin_name())));
-
-		if all_variables.len() <= max {
-			all_variables
-		} else {
-			all_variables.get(0..max).unwrap().to_vec()
-		}
+		let mut all_variables = self.get_variables().collect::<Vec<_>>();
+		all_variables.sort_by_cached_key(|(variable, _)| variable.cabin_name().distance_to(name.cabin_name()));
+		all_variables.truncate(max);
+		all_variables
 	}
 
 	/// Returns the declaration information of a global variable. This is exactly equivalent to `get_variable_from_id(name, 0)`, because
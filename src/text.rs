@@ -0,0 +1,262 @@
+use crate::{cache::StableHasher, reachability::CItem};
+
+use colored::Colorize as _;
+use std::{
+	collections::{btree_map::Entry, BTreeMap},
+	fmt::Write as _,
+	hash::{Hash as _, Hasher as _},
+};
+
+/// The C fields of the `Text` struct (see `Group::c_prelude()`). Text stores its length, so getting the length of Text never has to search it for its
+/// end, and Text of up to 23 bytes is stored inline in the struct itself rather than in a separate allocation. Longer Text points to its bytes, which are
+/// either owned by the Text on the heap or borrowed from somewhere that outlives it, such as a constant or the buffer of a file. The bytes are always
+/// followed by a zero, so Text can still be passed to C functions that expect strings.
+pub const TEXT_FIELDS: &str = "\tsize_t length;\n\tsize_t capacity;\n\tuint8_t storage;\n\tunion {\n\t\tchar* internal_value;\n\t\tchar inline_value[24];\n\t};";
+
+/// The C functions that implement Text, which are written right after the definition of the `Text` struct (see `TEXT_FIELDS`). Text is immutable once
+/// it's built, so copies of Text share the bytes that it points to; Only Text that's still being built is appended to. Appending grows the Text's buffer
+/// to at least twice its size, so building Text one piece at a time copies each byte a constant number of times on average.
+///
+/// A builder collects many pieces of Text into one, such as the parts of a line of a log or a template. It's the same as appending to Text, but keeps the
+/// Text that's being built separate from the finished Text that it produces.
+pub const TEXT_RUNTIME: &str = r#"
+#define CABIN_TEXT_INLINE_CAPACITY (sizeof(((Text_u*) 0)->inline_value) - 1)
+
+enum {
+	CABIN_TEXT_BORROWED = 0,
+	CABIN_TEXT_INLINE = 1,
+	CABIN_TEXT_HEAP = 2,
+};
+
+static inline const char* cabin_text_data(const Text_u* text) {
+	return text->storage == CABIN_TEXT_INLINE ? text->inline_value : text->internal_value;
+}
+
+static inline size_t cabin_text_length(const Text_u* text) {
+	return text->length;
+}
+
+static inline void cabin_text_borrow(Text_u* text, const char* data, size_t length) {
+	text->length = length;
+	text->capacity = 0;
+	text->storage = CABIN_TEXT_BORROWED;
+	text->internal_value = (char*) data;
+}
+
+static inline void cabin_text_adopt(Text_u* text, char* data, size_t length) {
+	text->length = length;
+	text->capacity = length;
+	text->storage = CABIN_TEXT_HEAP;
+	text->internal_value = data;
+}
+
+static inline void cabin_text_reserve(Text_u* text, size_t capacity) {
+	if (text->storage != CABIN_TEXT_BORROWED && capacity <= text->capacity) {
+		return;
+	}
+	const char* data = cabin_text_data(text);
+	if (text->storage == CABIN_TEXT_BORROWED && capacity <= CABIN_TEXT_INLINE_CAPACITY) {
+		if (text->length > 0) {
+			memcpy(text->inline_value, data, text->length);
+		}
+		text->inline_value[text->length] = '\0';
+		text->capacity = CABIN_TEXT_INLINE_CAPACITY;
+		text->storage = CABIN_TEXT_INLINE;
+		return;
+	}
+	size_t grown = text->capacity * 2;
+	if (grown < capacity) {
+		grown = capacity;
+	}
+	char* buffer = malloc(grown + 1);
+	if (buffer == NULL) {
+		fprintf(stderr, "Error: Out of memory\n");
+		exit(1);
+	}
+	if (text->length > 0) {
+		memcpy(buffer, data, text->length);
+	}
+	buffer[text->length] = '\0';
+	if (text->storage == CABIN_TEXT_HEAP) {
+		free(text->internal_value);
+	}
+	text->internal_value = buffer;
+	text->capacity = grown;
+	text->storage = CABIN_TEXT_HEAP;
+}
+
+static inline void cabin_text_append(Text_u* text, const char* data, size_t length) {
+	cabin_text_reserve(text, text->length + length);
+	char* end = (text->storage == CABIN_TEXT_INLINE ? text->inline_value : text->internal_value) + text->length;
+	memcpy(end, data, length);
+	end[length] = '\0';
+	text->length += length;
+}
+
+static inline Text_u cabin_text_from(const char* data, size_t length) {
+	Text_u text = { 0 };
+	cabin_text_append(&text, data, length);
+	return text;
+}
+
+static inline Text_u cabin_text_concat(const Text_u* left, const Text_u* right) {
+	Text_u text = { 0 };
+	cabin_text_reserve(&text, left->length + right->length);
+	cabin_text_append(&text, cabin_text_data(left), left->length);
+	cabin_text_append(&text, cabin_text_data(right), right->length);
+	return text;
+}
+
+typedef struct cabin_text_builder {
+	Text_u text;
+} cabin_text_builder;
+
+static inline void cabin_text_builder_append(cabin_text_builder* builder, const Text_u* piece) {
+	cabin_text_append(&builder->text, cabin_text_data(piece), piece->length);
+}
+
+static inline Text_u cabin_text_builder_finish(cabin_text_builder* builder) {
+	Text_u text = builder->text;
+	if (text.storage == CABIN_TEXT_BORROWED) {
+		cabin_text_borrow(&text, "", 0);
+	}
+	builder->text = (Text_u) { 0 };
+	return text;
+}"#;
+
+/// The pool of Text whose value is known at compile-time, such as Text literals. Each distinct value is written into the generated C code once, as a
+/// constant that every use of the value points to, instead of creating a new object for it everywhere it's used (see `Object::write_c()`).
+///
+/// Constants are named after a stable hash of their value (see `cache::StableHasher`), so that items of the program transpiled on different threads give
+/// the same value the same name, the pools of each thread can be merged afterwards (see `Context::apply_changes()`), and the names are the same in every
+/// build, which cached translation units rely on. Two different values whose hashes collide are an error rather than silently sharing a constant.
+#[derive(Clone, Debug, Default)]
+pub struct TextConstants {
+	/// The values of the constants in the pool keyed on the names of their constants, in sorted order, so that the generated C code doesn't depend on the
+	/// order that values were found in.
+	values: BTreeMap<String, String>,
+}
+
+impl TextConstants {
+	/// Adds Text with the given value to this pool, if it's not there already, and returns the name of its constant.
+	///
+	/// # Parameters
+	/// - `value` - The value of the Text.
+	///
+	/// # Returns
+	/// The name of the C constant that holds the Text.
+	///
+	/// # Errors
+	/// If the pool already has a different value whose constant has the same name.
+	pub fn constant(&mut self, value: &str) -> anyhow::Result<String> {
+		let name = text_constant_name(value);
+		self.insert(name.clone(), value)?;
+		Ok(name)
+	}
+
+	/// Adds the constants of another pool to this one.
+	///
+	/// # Parameters
+	/// - `other` - The pool to add the constants of.
+	///
+	/// # Errors
+	/// If the pools have different values whose constants have the same name.
+	pub fn extend(&mut self, other: Self) -> anyhow::Result<()> {
+		other.values.into_iter().try_for_each(|(name, value)| self.insert(name, &value))
+	}
+
+	/// Adds a constant to this pool, if it's not there already.
+	///
+	/// # Parameters
+	/// - `name` - The name of the constant (see `text_constant_name()`).
+	/// - `value` - The value of the constant.
+	///
+	/// # Errors
+	/// If the pool already has a different value with the same name.
+	fn insert(&mut self, name: String, value: &str) -> anyhow::Result<()> {
+		match self.values.entry(name) {
+			Entry::Vacant(entry) => {
+				entry.insert(value.to_owned());
+			},
+			Entry::Occupied(entry) => {
+				if entry.get() != value {
+					anyhow::bail!(
+						"The Text constants {} and {} have the same hash, so they can't both be in the generated C code",
+						c_string_literal(entry.get()).bold().cyan(),
+						c_string_literal(value).bold().cyan()
+					);
+				}
+			},
+		}
+		Ok(())
+	}
+
+	/// Returns the C items that define the constants in this pool. Each constant is its own item, so constants that nothing reachable uses are left out of
+	/// the program (see `reachability::reachable_items()`). The constants are declared weak, so that every translation unit that includes the header
+	/// shares a single copy of each (see `units.rs`).
+	///
+	/// # Returns
+	/// The items of the constants, in sorted order of their names.
+	#[must_use]
+	pub fn items(&self) -> Vec<CItem> {
+		self.values
+			.iter()
+			.map(|(name, value)| {
+				let name = name.clone();
+				CItem {
+					kind: "text constant",
+					code: format!(
+						"__attribute__((weak)) Text_u {name} = {{ .length = {length}, .storage = CABIN_TEXT_BORROWED, .internal_value = {literal} }};\n",
+						length = value.len(),
+						literal = c_string_literal(value)
+					),
+					symbols: vec![name],
+					is_root: false,
+				}
+			})
+			.collect()
+	}
+}
+
+/// Returns the name of the C constant that holds Text with the given value in the program's pool of Text (see `TextConstants`).
+///
+/// # Parameters
+/// - `value` - The value of the Text.
+///
+/// # Returns
+/// The name of the constant.
+fn text_constant_name(value: &str) -> String {
+	let mut hasher = StableHasher::new();
+	value.hash(&mut hasher);
+	format!("cabin_text_{:016x}", hasher.finish())
+}
+
+/// Returns a C string literal with the given value. Quotes, backslashes, and question marks (which could start a trigraph) are escaped, and bytes that
+/// aren't printable ASCII characters are written as octal escapes, so the literal holds exactly the bytes of the value.
+///
+/// # Parameters
+/// - `value` - The value of the string.
+///
+/// # Returns
+/// The C string literal, including its quotes.
+#[must_use]
+pub fn c_string_literal(value: &str) -> String {
+	let mut literal = String::with_capacity(value.len() + 2);
+	literal.push('"');
+	for byte in value.bytes() {
+		match byte {
+			b'"' => literal.push_str("\\\""),
+			b'\\' => literal.push_str("\\\\"),
+			b'?' => literal.push_str("\\?"),
+			b'\n' => literal.push_str("\\n"),
+			b'\t' => literal.push_str("\\t"),
+			b'\r' => literal.push_str("\\r"),
+			b' '..=b'~' => literal.push(char::from(byte)),
+
+			// Octal escapes are at most three digits long, so unlike hexadecimal escapes, they never run into a digit that comes after them
+			_ => write!(literal, "\\{byte:03o}").unwrap_or_else(|_error| unreachable!()),
+		}
+	}
+	literal.push('"');
+	literal
+}
@@ -0,0 +1,314 @@
+use crate::compile_time::instances::FunctionInstantiation;
+
+use std::{
+	fmt::Write as _,
+	sync::{Mutex, PoisonError},
+	time::{Duration, Instant},
+};
+
+use colored::Colorize as _;
+
+/// The global phase timings of the compiler. This is `None` unless timings were enabled with `enable()`; While it's `None`, phases aren't recorded at all,
+/// and `phase()` just runs the phase it's given. This is global rather than stored in the `Context` because some phases (such as reading the source code) run
+/// before the context exists, and because the C compiler is timed inside of functions that don't care whether timings are enabled.
+static TIMINGS: Mutex<Option<Timings>> = Mutex::new(None);
+
+/// The phases recorded since timings were enabled.
+struct Timings {
+	/// The time that timings were enabled at. The start time of each phase is stored relative to this.
+	start: Instant,
+	/// The phases that have finished, in the order that they finished in. Nested phases finish before the phases that contain them.
+	phases: Vec<Phase>,
+	/// The number of phases that are currently running, which is the depth that a phase starting now is nested at.
+	depth: usize,
+	/// The number of times that instances of each function were asked for while the program was evaluated, most often first (see
+	/// `record_instantiations()`).
+	instantiations: Vec<FunctionInstantiation>,
+	/// The number of C functions that were folded into another function with identical code.
+	folded_functions: usize,
+}
+
+/// The maximum number of functions shown in the instantiation table of the summary. Functions are shown in order of how often they were instantiated, so
+/// these are the ones most likely to be causing code size to grow.
+const INSTANTIATION_ROWS: usize = 16;
+
+/// A single timed phase of the compiler, such as parsing or compiling the generated C code.
+#[derive(Clone)]
+struct Phase {
+	/// The name of the phase, as shown in the summary table and the trace file.
+	name: &'static str,
+	/// The time that the phase started at, relative to when timings were enabled.
+	start: Duration,
+	/// How long the phase took to run.
+	duration: Duration,
+	/// The peak memory used by the compiler during the phase, in bytes. This is only measured for top-level phases, and only on operating systems that
+	/// report it (see `peak_memory()`), so it's `None` otherwise.
+	peak_memory: Option<u64>,
+	/// The number of phases that this phase is nested inside of.
+	depth: usize,
+}
+
+/// Enables timings for the rest of the compiler's execution, so that all phases run with `phase()` are recorded from now on.
+pub fn enable() {
+	*TIMINGS.lock().unwrap_or_else(PoisonError::into_inner) = Some(Timings {
+		start: Instant::now(),
+		phases: Vec::new(),
+		depth: 0,
+		instantiations: Vec::new(),
+		folded_functions: 0,
+	});
+}
+
+/// Records how many times instances of each function were asked for while the program was evaluated, and how many C functions were folded into another
+/// function with identical code, to be shown in the summary table. Nothing is recorded if timings aren't enabled.
+///
+/// # Parameters
+/// - `instantiations` - The instantiations of each function, most often first (see `FunctionInstances::instantiations()`).
+/// - `folded_functions` - The number of C functions that were folded into another function.
+pub fn record_instantiations(instantiations: Vec<FunctionInstantiation>, folded_functions: usize) {
+	if let Some(timings) = TIMINGS.lock().unwrap_or_else(PoisonError::into_inner).as_mut() {
+		timings.instantiations = instantiations;
+		timings.folded_functions = folded_functions;
+	}
+}
+
+/// Runs a phase of the compiler, recording how long it took and how much memory it used if timings are enabled. Phases can be nested; For example, the C
+/// compiler subprocess is timed as a phase inside of the phase that compiles the generated C code.
+///
+/// # Parameters
+/// - `name` - The name of the phase, as shown in the summary table and the trace file.
+/// - `run` - The function that runs the phase.
+///
+/// # Returns
+/// The value returned by `run`.
+pub fn phase<T>(name: &'static str, run: impl FnOnce() -> T) -> T {
+	let depth = {
+		let mut guard = TIMINGS.lock().unwrap_or_else(PoisonError::into_inner);
+		let Some(timings) = guard.as_mut() else {
+			drop(guard);
+			return run();
+		};
+		timings.depth += 1;
+		timings.depth - 1
+	};
+
+	// Resetting the peak in a nested phase would lose the peak of the phase containing it, so only top-level phases measure memory
+	if depth == 0 {
+		reset_peak_memory();
+	}
+	let start = Instant::now();
+	let value = run();
+	let duration = start.elapsed();
+	let peak_memory = if depth == 0 { peak_memory() } else { None };
+
+	if let Some(timings) = TIMINGS.lock().unwrap_or_else(PoisonError::into_inner).as_mut() {
+		timings.depth -= 1;
+		timings.phases.push(Phase {
+			name,
+			start: start.duration_since(timings.start),
+			duration,
+			peak_memory,
+			depth,
+		});
+	}
+
+	value
+}
+
+/// Reports the recorded phases at the end of a command, as asked for by its `--timings` and `--timings-file` flags. Nothing is reported if timings aren't
+/// enabled.
+///
+/// # Parameters
+/// - `print_table` - Whether to print the summary table (see `print_summary()`).
+/// - `trace_file` - The file to write the phases to in the Chrome trace event format, if any (see `write_chrome_trace()`).
+///
+/// # Errors
+/// If the trace file couldn't be written.
+pub fn report(print_table: bool, trace_file: Option<&str>) -> anyhow::Result<()> {
+	if print_table {
+		print_summary();
+	}
+	if let Some(path) = trace_file {
+		write_chrome_trace(path)?;
+	}
+	Ok(())
+}
+
+/// Prints a table of the recorded phases, showing how long each one took and the peak memory used during it. Nothing is printed if timings aren't enabled.
+/// This is printed even in quiet mode, because timings are only recorded when they're explicitly asked for.
+pub fn print_summary() {
+	let Some(phases) = recorded_phases() else {
+		return;
+	};
+
+	println!("\n{}", "Timings:".bold().green());
+	println!("{}", format!("\t{:<28}{:>12}{:>16}", "Phase", "Time", "Peak Memory").bold());
+	let mut total = Duration::ZERO;
+	for phase in &phases {
+		if phase.depth == 0 {
+			total += phase.duration;
+		}
+		let name = format!("{}{}", "  ".repeat(phase.depth), phase.name);
+		let memory = phase.peak_memory.map_or_else(|| "-".to_owned(), format_bytes);
+		println!("\t{name:<28}{:>12}{memory:>16}", format_duration(phase.duration));
+	}
+	println!("{}", format!("\t{:<28}{:>12}", "Total", format_duration(total)).bold());
+	println!();
+
+	print_instantiations();
+}
+
+/// Prints a table of the functions that were instantiated most often while the program was evaluated, with how many distinct instances of each were
+/// created, and how many C functions were folded into another function. Nothing is printed if timings aren't enabled or no functions were instantiated.
+fn print_instantiations() {
+	let Some((instantiations, folded_functions)) = TIMINGS.lock().unwrap_or_else(PoisonError::into_inner).as_ref().map(|timings| {
+		(
+			timings
+				.instantiations
+				.iter()
+				.take(INSTANTIATION_ROWS)
+				.map(|instantiation| (instantiation.name.clone(), instantiation.requests, instantiation.instances))
+				.collect::<Vec<_>>(),
+			timings.folded_functions,
+		)
+	}) else {
+		return;
+	};
+	if instantiations.is_empty() {
+		return;
+	}
+
+	println!("{}", "Function Instances:".bold().green());
+	println!("{}", format!("\t{:<28}{:>12}{:>16}", "Function", "Requested", "Instances").bold());
+	for (name, requests, instances) in &instantiations {
+		println!("\t{name:<28}{requests:>12}{instances:>16}");
+	}
+	println!("\t{folded_functions} identical C functions folded into shared instances");
+	println!();
+}
+
+/// Writes the recorded phases to a file in the Chrome trace event format, which can be opened with `chrome://tracing`, Perfetto, and most build dashboards.
+/// Each phase is written as a "complete" event, with its start time and duration in microseconds.
+///
+/// # Parameters
+/// - `path` - The path of the file to write the trace to. The file is overwritten if it already exists.
+///
+/// # Errors
+/// If the file couldn't be written.
+pub fn write_chrome_trace(path: &str) -> anyhow::Result<()> {
+	let Some(phases) = recorded_phases() else {
+		return Ok(());
+	};
+
+	let mut trace = String::from("{\"traceEvents\":[");
+	for (index, phase) in phases.iter().enumerate() {
+		if index != 0 {
+			trace.push(',');
+		}
+		write!(
+			trace,
+			"\n\t{{\"name\":\"{}\",\"cat\":\"cabin\",\"ph\":\"X\",\"ts\":{},\"dur\":{},\"pid\":{},\"tid\":0",
+			phase.name.replace('\\', "\\\\").replace('"', "\\\""),
+			phase.start.as_micros(),
+			phase.duration.as_micros(),
+			std::process::id()
+		)?;
+		if let Some(peak_memory) = phase.peak_memory {
+			write!(trace, ",\"args\":{{\"peak_memory_bytes\":{peak_memory}}}")?;
+		}
+		trace.push('}');
+	}
+	trace.push_str("\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	std::fs::write(path, trace).map_err(|error| anyhow::anyhow!("Error writing timings to \"{path}\": {error}"))
+}
+
+/// Returns a copy of the recorded phases, sorted by when they started, so that each nested phase comes right after the phase that contains it. The phases
+/// are copied so that the lock around them isn't held while they're being reported.
+///
+/// # Returns
+/// The sorted phases, or `None` if timings aren't enabled.
+fn recorded_phases() -> Option<Vec<Phase>> {
+	let mut phases = TIMINGS.lock().unwrap_or_else(PoisonError::into_inner).as_ref()?.phases.clone();
+	phases.sort_by_key(|phase| (phase.start, phase.depth));
+	Some(phases)
+}
+
+/// Resets the peak memory of the compiler's process to its current memory usage, so that the next call to `peak_memory()` only measures the peak since
+/// now. This is only supported on Linux, and does nothing elsewhere or if the kernel doesn't allow it.
+fn reset_peak_memory() {
+	// Writing 5 to clear_refs resets the peak resident set size of the process
+	drop(std::fs::write("/proc/self/clear_refs", "5"));
+}
+
+/// Returns the peak memory used by the compiler's process since it started or since `reset_peak_memory()` was last called, measured as the peak resident
+/// set size of the process.
+///
+/// # Returns
+/// The peak memory in bytes, or `None` if the operating system doesn't report it. This is currently only reported on Linux.
+fn peak_memory() -> Option<u64> {
+	process_memory("VmHWM")
+}
+
+/// Returns the memory currently used by the compiler's process, measured as its resident set size. This is used to enforce the memory budget of compile-time
+/// evaluation (see `CompileTimeBudget`).
+///
+/// # Returns
+/// The current memory in bytes, or `None` if the operating system doesn't report it. This is currently only reported on Linux.
+#[must_use]
+pub fn current_memory() -> Option<u64> {
+	process_memory("VmRSS")
+}
+
+/// Returns a measurement of the compiler's process memory from `/proc/self/status`.
+///
+/// # Parameters
+/// - `field` - The name of the measurement in `/proc/self/status`, such as `VmHWM`.
+///
+/// # Returns
+/// The measurement in bytes, or `None` if the operating system doesn't report it.
+fn process_memory(field: &str) -> Option<u64> {
+	let status = std::fs::read_to_string("/proc/self/status").ok()?;
+	let kilobytes = status
+		.lines()
+		.find_map(|line| line.strip_prefix(field)?.strip_prefix(':'))?
+		.trim()
+		.strip_suffix("kB")?
+		.trim()
+		.parse::<u64>()
+		.ok()?;
+	Some(kilobytes * 1024)
+}
+
+/// Formats a duration for the summary table, in milliseconds or seconds depending on how long it is.
+///
+/// # Parameters
+/// - `duration` - The duration to format.
+///
+/// # Returns
+/// The formatted duration.
+#[must_use]
+pub fn format_duration(duration: Duration) -> String {
+	if duration.as_secs() > 0 {
+		format!("{:.2}s", duration.as_secs_f64())
+	} else {
+		format!("{:.2}ms", duration.as_secs_f64() * 1000.0)
+	}
+}
+
+/// Formats a number of bytes for the summary table, in kibibytes or mebibytes depending on how large it is.
+///
+/// # Parameters
+/// - `bytes` - The number of bytes to format.
+///
+/// # Returns
+/// The formatted number of bytes.
+#[must_use]
+pub fn format_bytes(bytes: u64) -> String {
+	let size = bytes as f64;
+	if size >= 1024.0 * 1024.0 {
+		format!("{:.2} MiB", size / (1024.0 * 1024.0))
+	} else {
+		format!("{:.2} KiB", size / 1024.0)
+	}
+}
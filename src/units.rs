@@ -0,0 +1,265 @@
+use crate::{
+	cache::{StableHasher, CACHE_DIRECTORY},
+	compiler::{get_c_compiler, get_native_executable_extension, temp_output_path, C_COMPILER_FLAGS},
+	context::Context,
+	emitter::collapse_blank_lines,
+	parser::Program,
+	profile::BuildProfile,
+	timings,
+};
+
+use std::{
+	hash::{Hash as _, Hasher as _},
+	path::{Path, PathBuf},
+	process::{Command, ExitStatus, Stdio},
+	sync::{
+		atomic::{AtomicUsize, Ordering},
+		Mutex, PoisonError,
+	},
+};
+
+/// The maximum number of function definitions in each translation unit. Each unit is compiled by its own C compiler process, so this trades the overhead of
+/// starting the C compiler and parsing the header for each unit against how much of the program is recompiled when a single function changes.
+const FUNCTIONS_PER_UNIT: usize = 8;
+
+/// The directory that compiled translation units are cached in, relative to the root of the project. This is inside of the build cache, so it's removed
+/// by `cabin clean`.
+fn object_cache_directory() -> PathBuf {
+	Path::new(CACHE_DIRECTORY).join("objects")
+}
+
+/// A program transpiled into C as multiple translation units. The declarations of the program's groups and functions are put in a shared header, and the
+/// function definitions are split into units of up to `FUNCTIONS_PER_UNIT` functions that each include the header, followed by a final unit for the
+/// program's main function. The units can then be compiled in parallel, and compiled units can be reused between builds as long as neither their code
+/// nor the header has changed.
+pub struct TranslationUnits {
+	/// The file name of the shared header, which includes a hash of its contents, so that a unit's code changes whenever the header it includes does.
+	header_name: String,
+	/// The C code of the shared header.
+	header: String,
+	/// The C code of each translation unit, each of which starts by including the header.
+	units: Vec<String>,
+}
+
+impl TranslationUnits {
+	/// Transpiles an abstract syntax tree (AST) into translation units. This generates the same C code as `compiler::transpile()`, but split into units.
+	///
+	/// # Parameters
+	/// - `compile_time_ast` - an AST that has already gone through compile-time evaluation.
+	/// - `context` - The context of the program, which supplies global data such as the scopes and variables declared in the program.
+	///
+	/// # Returns
+	/// The translation units of the program.
+	///
+	/// # Errors
+	/// If there was an error during transpilation.
+	pub fn transpile(compile_time_ast: &Program, context: &mut Context) -> anyhow::Result<Self> {
+		let program = compile_time_ast.split_c(context)?;
+		let main = collapse_blank_lines(&program.main);
+
+		let header = collapse_blank_lines(program.header.trim()) + "\n";
+		let header_name = format!("cabin_{:016x}.h", hash_of(&header));
+
+		let include = format!("#include \"{header_name}\"\n\n");
+		let mut units = program
+			.functions
+			.chunks(FUNCTIONS_PER_UNIT)
+			.map(|functions| include.clone() + collapse_blank_lines(functions.concat().trim()).as_str() + "\n")
+			.collect::<Vec<_>>();
+		units.push(include + main.trim() + "\n");
+
+		Ok(Self { header_name, header, units })
+	}
+
+	/// Returns the number of translation units, including the unit for the main function.
+	#[must_use]
+	pub const fn unit_count(&self) -> usize {
+		self.units.len()
+	}
+
+	/// Returns the C code of all of the translation units combined into a single file, with the header at the top. This is written for `--emit-c` and
+	/// stored in the build cache, so that there's always a single C file for each build.
+	#[must_use]
+	pub fn combined(&self) -> String {
+		let include = format!("#include \"{}\"\n\n", self.header_name);
+		let mut combined = self.header.clone();
+		for unit in &self.units {
+			combined.push('\n');
+			combined.push_str(unit.strip_prefix(&include).unwrap_or(unit));
+		}
+		combined
+	}
+
+	/// Compiles the translation units into a native executable. Units are compiled concurrently by up to `context.jobs` C compiler processes, and then
+	/// linked together. If caching is enabled, compiled units are stored in the build cache keyed by a hash of their code and the build profile, and units
+	/// that have already been compiled are reused, so changing a single function only recompiles the unit that it's in.
+	///
+	/// # Parameters
+	/// - `output_path` - The file to output the executable to, without an extension.
+	/// - `profile` - The build profile to compile with.
+	/// - `use_cache` - Whether to reuse and store compiled units in the build cache. If this is false, the units are compiled in a temporary directory that's
+	/// removed afterwards.
+	/// - `context` - The global compiler context.
+	///
+	/// # Returns
+	/// The path of the compiled executable, and the number of units that had to be compiled.
+	///
+	/// # Errors
+	/// If a unit fails to compile, or the units fail to link.
+	pub fn compile_to(&self, output_path: &str, profile: &BuildProfile, use_cache: bool, context: &mut Context) -> anyhow::Result<(String, usize)> {
+		let compiler = get_c_compiler().ok_or_else(|| anyhow::anyhow!("No C compiler found!"))?;
+		let arguments = profile.c_compiler_arguments(compiler)?;
+		let directory = if use_cache {
+			object_cache_directory()
+		} else {
+			PathBuf::from(temp_output_path() + "-units")
+		};
+		std::fs::create_dir_all(&directory).map_err(|error| anyhow::anyhow!("Error creating translation unit directory: {error}"))?;
+
+		let header_path = directory.join(&self.header_name);
+		if !header_path.is_file() {
+			write_atomically(&header_path, &self.header)?;
+		}
+
+		// Each object file is named by a hash of everything that affects it, so an existing object file is always up to date
+		let objects = self
+			.units
+			.iter()
+			.map(|unit| {
+				let mut hasher = StableHasher::new();
+				unit.hash(&mut hasher);
+				compiler.hash(&mut hasher);
+				C_COMPILER_FLAGS.hash(&mut hasher);
+				profile.hash(&mut hasher);
+				directory.join(format!("{:016x}.o", hasher.finish()))
+			})
+			.collect::<Vec<_>>();
+		let stale_units = (0..self.units.len())
+			.filter(|index| objects.get(*index).is_some_and(|object| !object.is_file()))
+			.collect::<Vec<_>>();
+
+		// Compilation
+		let unit_compiler = |index: usize| -> anyhow::Result<ExitStatus> {
+			let object = objects.get(index).unwrap_or_else(|| unreachable!());
+			let unfinished_object = object.with_extension(format!("{}.o", std::process::id()));
+			let source = object.with_extension(format!("{}.c", std::process::id()));
+			write_atomically(&source, self.units.get(index).unwrap_or_else(|| unreachable!()))?;
+			let status = Command::new(compiler)
+				.args(&arguments)
+				.args(C_COMPILER_FLAGS)
+				.arg("-c")
+				.arg("-o")
+				.arg(&unfinished_object)
+				.arg(&source)
+				.stderr(Stdio::null())
+				.status()
+				.map_err(|error| anyhow::anyhow!("Error during C compilation: Unable to spawn C compiler: {error}."))?;
+			std::fs::remove_file(&source)?;
+			if status.success() {
+				std::fs::rename(&unfinished_object, object).map_err(|error| anyhow::anyhow!("Error storing compiled translation unit: {error}"))?;
+			}
+			Ok(status)
+		};
+		let compiled = timings::phase("C compiler", || compile_in_parallel(&stale_units, context.jobs, &unit_compiler));
+
+		// Linking
+		let executable = format!("{output_path}{}", get_native_executable_extension());
+		let linked = compiled.and_then(|failures| {
+			if let Some((index, status)) = failures.first() {
+				context.encountered_compiler_bug = true;
+				anyhow::bail!("Error during C compilation: Compiling translation unit {index} failed with {status}.");
+			}
+			timings::phase("Linking", || {
+				Command::new(compiler)
+					.args(&arguments)
+					.args(C_COMPILER_FLAGS)
+					.arg("-o")
+					.arg(&executable)
+					.args(&objects)
+					.stderr(Stdio::null())
+					.status()
+			})
+			.map_err(|error| anyhow::anyhow!("Error during C compilation: Unable to spawn C compiler for linking: {error}."))
+		});
+
+		// The temporary directory is removed even if compilation failed
+		if !use_cache {
+			std::fs::remove_dir_all(&directory)?;
+		}
+		let status = linked?;
+		if !status.success() {
+			context.encountered_compiler_bug = true;
+			anyhow::bail!("Error during C compilation: Linking failed with {status}.");
+		}
+
+		Ok((executable, stale_units.len()))
+	}
+}
+
+/// Compiles translation units concurrently, on up to the given number of threads. Each thread takes the next unit that hasn't been compiled yet until all
+/// of them have been.
+///
+/// # Parameters
+/// - `units` - The indices of the units to compile.
+/// - `jobs` - The maximum number of units to compile at once.
+/// - `compile_unit` - Compiles the unit with the given index, returning the exit status of the C compiler.
+///
+/// # Returns
+/// The indices and exit statuses of the units that failed to compile, in the order of the units.
+///
+/// # Errors
+/// If the C compiler couldn't be run for any unit.
+fn compile_in_parallel(units: &[usize], jobs: usize, compile_unit: &(impl Fn(usize) -> anyhow::Result<ExitStatus> + Sync)) -> anyhow::Result<Vec<(usize, ExitStatus)>> {
+	let next_unit = AtomicUsize::new(0);
+	let finished = Mutex::new(Vec::new());
+	std::thread::scope(|scope| {
+		for _ in 0..jobs.clamp(1, units.len().max(1)) {
+			scope.spawn(|| {
+				while let Some(index) = units.get(next_unit.fetch_add(1, Ordering::Relaxed)) {
+					let result = compile_unit(*index);
+					finished.lock().unwrap_or_else(PoisonError::into_inner).push((*index, result));
+				}
+			});
+		}
+	});
+
+	let mut results = finished.into_inner().unwrap_or_else(PoisonError::into_inner);
+	results.sort_by_key(|(index, _result)| *index);
+	let mut failures = Vec::new();
+	for (index, result) in results {
+		let status = result?;
+		if !status.success() {
+			failures.push((index, status));
+		}
+	}
+	Ok(failures)
+}
+
+/// Writes a file by writing it under a name that's unique to this process and then renaming it into place, so that other instances of the compiler never
+/// see a partially written file.
+///
+/// # Parameters
+/// - `path` - The path of the file to write.
+/// - `contents` - The contents to write to the file.
+///
+/// # Errors
+/// If the file couldn't be written or renamed.
+fn write_atomically(path: &Path, contents: &str) -> anyhow::Result<()> {
+	let unfinished = path.with_extension(format!("{}.tmp", std::process::id()));
+	std::fs::write(&unfinished, contents).map_err(|error| anyhow::anyhow!("Error writing {}: {error}", path.display()))?;
+	std::fs::rename(&unfinished, path).map_err(|error| anyhow::anyhow!("Error writing {}: {error}", path.display()))?;
+	Ok(())
+}
+
+/// Returns a hash of the given code, which is used to name the files that the code is stored in.
+///
+/// # Parameters
+/// - `code` - The code to hash.
+///
+/// # Returns
+/// The hash of the code.
+fn hash_of(code: &str) -> u64 {
+	let mut hasher = StableHasher::new();
+	code.hash(&mut hasher);
+	hasher.finish()
+}
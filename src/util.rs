@@ -1,4 +1,10 @@
-use std::fmt::Display;
+use std::{
+	fmt::Display,
+	sync::{
+		atomic::{AtomicUsize, Ordering},
+		Mutex, PoisonError,
+	},
+};
 
 /// A trait that allows adding English suffixes (like "st", "nd", "rd", and "th") to numbers.
 pub trait IntegerSuffix: Display {
@@ -28,3 +34,34 @@ impl IntegerSuffix for usize {
 		}
 	}
 }
+
+/// Calls a function on each of the given items on up to `jobs` threads at once, such as formatting each file of a project. Each thread repeatedly takes
+/// the next item that no thread has started on yet, so a few large items don't leave the other threads idle.
+///
+/// # Parameters
+/// - `items` - The items to call the function on.
+/// - `jobs` - The maximum number of threads to use.
+/// - `function` - The function to call on each item.
+///
+/// # Returns
+/// The result of calling the function on each item, in the same order as the given items.
+pub fn map_in_parallel<T: Sync, O: Send>(items: &[T], jobs: usize, function: &(impl Fn(&T) -> O + Sync)) -> Vec<O> {
+	let next_item = AtomicUsize::new(0);
+	let finished = Mutex::new(Vec::new());
+	std::thread::scope(|scope| {
+		for _ in 0..jobs.clamp(1, items.len().max(1)) {
+			scope.spawn(|| loop {
+				let index = next_item.fetch_add(1, Ordering::Relaxed);
+				let Some(item) = items.get(index) else {
+					break;
+				};
+				let result = function(item);
+				finished.lock().unwrap_or_else(PoisonError::into_inner).push((index, result));
+			});
+		}
+	});
+
+	let mut results = finished.into_inner().unwrap_or_else(PoisonError::into_inner);
+	results.sort_by_key(|(index, _result)| *index);
+	results.into_iter().map(|(_index, result)| result).collect()
+}